@@ -0,0 +1,78 @@
+#ifndef BATCHKERNEL_H
+#define BATCHKERNEL_H
+
+#include <cstddef>
+#include <cstdint>
+#include "core/PendulumIntegrator.h"
+
+// Instruction sets the batch kernel is compiled for. Higher levels process
+// more pendulums per instruction: 1, 4 (AVX2) or 8 (AVX-512) lanes.
+enum class SimdLevel {
+    Scalar,
+    Avx2,
+    Avx512
+};
+
+/*
+ * @brief One call's worth of pendulums for the lane-parallel DP5 kernel.
+ *
+ * Plain pointers into structure-of-arrays storage: member i of this job reads
+ * theta1[i] ... omega2[i] and writes its reductions to the output arrays at
+ * the same index. Output pointers may be null when a reduction is not needed.
+ */
+struct BatchKernelJob {
+    PendulumParameters parameters;
+    PendulumIntegrator::ToleranceProfile tolerances; // Step-size controller, as for PendulumIntegrator
+    double duration = 0.0;    // Simulated seconds per member
+    bool trackEnergy = false; // Fill maxEnergyDrift / finalEnergyDrift
+    bool trackFlip = false;   // Fill firstFlipTime (-1 if the member never flips)
+    bool stopOnFlip = false;  // Retire a member as soon as it flips (needs trackFlip)
+
+    std::size_t count = 0;
+    const double* theta1 = nullptr;
+    const double* omega1 = nullptr;
+    const double* theta2 = nullptr;
+    const double* omega2 = nullptr;
+
+    double* finalTheta1 = nullptr;
+    double* finalOmega1 = nullptr;
+    double* finalTheta2 = nullptr;
+    double* finalOmega2 = nullptr;
+    double* finalTime = nullptr;
+    double* maxEnergyDrift = nullptr;
+    double* finalEnergyDrift = nullptr;
+    double* firstFlipTime = nullptr;
+    std::uint32_t* acceptedSteps = nullptr;
+    std::uint32_t* rejectedSteps = nullptr;
+    std::uint8_t* failed = nullptr;
+};
+
+/*
+ * @brief Lane-parallel Dormand-Prince 5(4) integration of many pendulums.
+ *
+ * Each SIMD lane carries one pendulum with its own time, step size and FSAL
+ * stage. All seven stages, the right-hand side (including sin/cos) and the
+ * error norm are evaluated for every lane at once; the step-size controller
+ * then accepts or rejects each lane separately, exactly as PendulumIntegrator
+ * does for a single pendulum. A lane whose member has finished is refilled
+ * with the next member of the job, so lanes do not idle while slower
+ * (flipping) members are still integrating.
+ *
+ * Results match PendulumIntegrator to within rounding: the kernel uses its own
+ * polynomial sin/cos and fused multiply-adds, so trajectories are not
+ * bit-identical and chaotic members diverge after long enough.
+ */
+class BatchKernel
+{
+public:
+    // Best level supported by both this build and the running CPU
+    static SimdLevel detect();
+    static bool isAvailable(SimdLevel level);
+    static const char* name(SimdLevel level);
+    static std::size_t laneCount(SimdLevel level);
+
+    // Integrates every member of the job with the given (available) level
+    static void run(SimdLevel level, const BatchKernelJob& job);
+};
+
+#endif // BATCHKERNEL_H
@@ -0,0 +1,232 @@
+#ifndef COMPRESSEDHISTORY_H
+#define COMPRESSEDHISTORY_H
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <string>
+#include <vector>
+
+/*
+ * @brief Chunked, losslessly compressed history for arbitrarily long runs.
+ *
+ * Every accepted step is one row: a shared time column plus one column per
+ * recorded quantity (see Column; angles in radians as integrated, theta2
+ * relative to the first rod). New rows go to an uncompressed tail;
+ * once the tail holds chunkRows rows it is sealed into a compressed chunk
+ * and a new tail begins. Each column of a chunk is its own bit stream:
+ *
+ *  - time: delta-of-delta of the IEEE bit patterns, so a fixed sample rate
+ *    costs a few bits per row;
+ *  - every other column: the difference between the bit patterns of the
+ *    value and of a Lagrange extrapolation through the six previous rows
+ *    (at their actual times, so adaptive steps predict as well as a fixed
+ *    rate), coded Gorilla-style in a bit width that is reused while the
+ *    residuals fit it. The state signals take 15-25 bits per value.
+ *
+ * Total energy is not stored: it is rebuilt as kinetic + potential, which
+ * is how the integrator computes it, so it decodes bit-exactly.
+ *
+ * Chunks carry their first and last time and their first row number (rows
+ * are numbered from the last clear(), dropped ones included). Times must
+ * not decrease, so a time range is located by binary search over the
+ * chunks and only the chunks that overlap it are decoded; a row range is
+ * located the same way, which lets a reader fetch just the rows appended
+ * since it last looked. With a byte budget set, the oldest chunks are
+ * dropped once the compressed size exceeds it.
+ *
+ * save()/load() write the chunks verbatim (the tail as a final short chunk)
+ * to a .dphist file, so a history reloads without re-encoding. The
+ * floating-point prediction is only guaranteed to round the same way within
+ * one build, so every chunk also stores a checksum of its raw bits: load()
+ * decodes each chunk, bounded by its word count, and rejects the file if a
+ * stream runs short or the decoded bits do not match.
+ *
+ * Not thread-safe: reads decode into shared scratch buffers.
+ */
+class CompressedHistory
+{
+public:
+    enum class Column {
+        Time,
+        Theta1,          // Absolute angle of the first rod, rad
+        Omega1,          // Angular velocity of the first rod, rad/s
+        Theta2,          // Relative angle of the second rod, rad
+        Omega2,          // Relative angular velocity of the second rod, rad/s
+        KineticEnergy,
+        PotentialEnergy,
+        TotalEnergy,
+        Count
+    };
+    static constexpr std::size_t COLUMN_COUNT = static_cast<std::size_t>(Column::Count);
+    static constexpr std::size_t DEFAULT_CHUNK_ROWS = 4096;
+
+    // Rows [0, size) of one chunk or of the tail, one pointer per column
+    struct RowBlock {
+        std::array<const double*, COLUMN_COUNT> columns{};
+        std::size_t size = 0;
+
+        double value(Column column, std::size_t row) const { return columns[static_cast<std::size_t>(column)][row]; }
+        double time(std::size_t row) const { return columns[0][row]; }
+    };
+
+    explicit CompressedHistory(std::size_t chunkRows = DEFAULT_CHUNK_ROWS);
+
+    void append(double time,
+                double theta1, double omega1,
+                double theta2, double omega2,
+                double kineticEnergy, double potentialEnergy);
+    void clear();
+
+    // Compressed bytes kept before the oldest chunks are dropped; 0 = unlimited
+    void setByteBudget(std::size_t bytes);
+    std::size_t byteBudget() const { return m_byteBudget; }
+
+    std::size_t chunkRows() const { return m_chunkRows; }
+    std::size_t chunkCount() const { return m_chunks.size(); }
+    std::size_t size() const { return m_sealedRows + tailSize(); }
+    bool empty() const { return size() == 0; }
+    std::uint64_t droppedRows() const { return m_droppedRows; }
+    // Number the next appended row will get
+    std::uint64_t endRow() const { return m_droppedRows + size(); }
+
+    double startTime() const;
+    double endTime() const;
+
+    // Encoded size of the sealed chunks
+    std::size_t compressedBytes() const { return m_compressedBytes; }
+    // Everything held: sealed chunks and the uncompressed tail
+    std::size_t memoryBytes() const;
+
+    // Calls visit(const RowBlock&) for the rows with time in [tMin, tMax], in time order.
+    // Only the chunks that overlap the range are decoded.
+    template <typename Visitor>
+    void visitRange(double tMin, double tMax, Visitor&& visit) const
+    {
+        if (empty() || tMax < tMin) {
+            return;
+        }
+        // First chunk whose last time reaches tMin
+        auto it = std::lower_bound(m_chunks.begin(), m_chunks.end(), tMin,
+            [](const Chunk& chunk, double t) { return chunk.lastTime < t; });
+        for (; it != m_chunks.end() && it->firstTime <= tMax; ++it) {
+            decodeChunk(*it, m_scratch);
+            visitClipped(blockOf(m_scratch, it->rows), tMin, tMax, visit);
+        }
+        if (tailSize() > 0 && m_tail[0].front() <= tMax) {
+            visitClipped(blockOf(m_tail, tailSize()), tMin, tMax, visit);
+        }
+    }
+
+    // First retained row whose time is at least `time` (endRow() if none).
+    // Decodes the time stream of at most one chunk.
+    std::uint64_t lowerBound(double time) const;
+
+    // Calls visit(const RowBlock&) for the retained rows numbered [firstRow, endRow), in order
+    template <typename Visitor>
+    void visitRows(std::uint64_t firstRow, std::uint64_t endRow, Visitor&& visit) const
+    {
+        firstRow = std::max(firstRow, m_droppedRows);
+        endRow = std::min(endRow, this->endRow());
+        if (firstRow >= endRow) {
+            return;
+        }
+        // First chunk that ends after firstRow
+        auto it = std::upper_bound(m_chunks.begin(), m_chunks.end(), firstRow,
+            [](std::uint64_t row, const Chunk& chunk) { return row < chunk.firstRow + chunk.rows; });
+        for (; it != m_chunks.end() && it->firstRow < endRow; ++it) {
+            decodeChunk(*it, m_scratch);
+            visitSlice(blockOf(m_scratch, it->rows), it->firstRow, firstRow, endRow, visit);
+        }
+        const std::uint64_t tailRow = m_droppedRows + m_sealedRows;
+        if (tailSize() > 0 && tailRow < endRow) {
+            visitSlice(blockOf(m_tail, tailSize()), tailRow, firstRow, endRow, visit);
+        }
+    }
+
+    // Writes the history to path; the tail is stored as a final short chunk
+    bool save(const std::string& path, std::string* error = nullptr) const;
+    // Replaces the contents with a file written by save()
+    bool load(const std::string& path, std::string* error = nullptr);
+
+private:
+    // Columns that are encoded; total energy is derived
+    static constexpr std::size_t STORED_COLUMNS = COLUMN_COUNT - 1;
+    using Columns = std::array<std::vector<double>, COLUMN_COUNT>;
+
+    struct Chunk {
+        double firstTime = 0.0;
+        double lastTime = 0.0;
+        std::uint64_t firstRow = 0;
+        std::uint32_t rows = 0;
+        std::array<std::uint32_t, STORED_COLUMNS + 1> offsets{}; // Word offset of each column stream, then the end
+        std::vector<std::uint64_t> words;
+        std::uint64_t checksum = 0; // Of the stored columns' bit patterns, see checksum()
+    };
+
+    std::size_t tailSize() const { return m_tail[0].size(); }
+
+    Chunk encodeChunk(const Columns& columns, std::size_t rows) const;
+    // False if a column stream ended early (only possible for a corrupt file)
+    static bool decodeChunk(const Chunk& chunk, Columns& out);
+    static std::uint64_t checksum(const Columns& columns, std::size_t rows);
+    void sealTail();
+    void enforceBudget();
+
+    static RowBlock blockOf(const Columns& columns, std::size_t rows)
+    {
+        RowBlock block;
+        for (std::size_t c = 0; c < COLUMN_COUNT; ++c) {
+            block.columns[c] = columns[c].data();
+        }
+        block.size = rows;
+        return block;
+    }
+
+    // Narrows a block to [tMin, tMax] and passes it on if anything is left
+    template <typename Visitor>
+    static void visitClipped(RowBlock block, double tMin, double tMax, Visitor& visit)
+    {
+        const double* times = block.columns[0];
+        const std::size_t first = static_cast<std::size_t>(std::lower_bound(times, times + block.size, tMin) - times);
+        const std::size_t last = static_cast<std::size_t>(std::upper_bound(times + first, times + block.size, tMax) - times);
+        if (first >= last) {
+            return;
+        }
+        for (auto& column : block.columns) {
+            column += first;
+        }
+        block.size = last - first;
+        visit(static_cast<const RowBlock&>(block));
+    }
+
+    // Passes on the rows of a block (whose first row is blockRow) numbered [firstRow, endRow)
+    template <typename Visitor>
+    static void visitSlice(RowBlock block, std::uint64_t blockRow,
+                           std::uint64_t firstRow, std::uint64_t endRow, Visitor& visit)
+    {
+        const std::size_t first = firstRow > blockRow ? static_cast<std::size_t>(firstRow - blockRow) : 0;
+        const std::size_t last = static_cast<std::size_t>(std::min<std::uint64_t>(endRow - blockRow, block.size));
+        if (first >= last) {
+            return;
+        }
+        for (auto& column : block.columns) {
+            column += first;
+        }
+        block.size = last - first;
+        visit(static_cast<const RowBlock&>(block));
+    }
+
+    std::size_t m_chunkRows;
+    std::size_t m_byteBudget = 0;
+    std::deque<Chunk> m_chunks;
+    std::size_t m_sealedRows = 0;
+    std::size_t m_compressedBytes = 0;
+    std::uint64_t m_droppedRows = 0;
+    Columns m_tail;
+    mutable Columns m_scratch; // Decoded chunk, reused across reads
+};
+
+#endif // COMPRESSEDHISTORY_H
@@ -6,12 +6,31 @@
 #include <QPointF>
 #include <deque>
 #include <algorithm>
+#include <array>
 #include <vector>
 #include <QList>
 #include <QMetaType>
 #include <QString>
 #include <QVariantList>
+#include <QByteArray>
+#include <QElapsedTimer>
 #include <QVector>
+#include <QUrl>
+#include <QColor>
+#include <QImage>
+#include <QVariantMap>
+#include <QQuickImageProvider>
+#include <mutex>
+#include "core/RingBuffer.h"
+#include "core/CompressedHistory.h"
+#include "core/HistoryPyramid.h"
+#include "core/LineSimplifier.h"
+#include "core/PhaseDensity.h"
+#include "core/PendulumIntegrator.h"
+#include "core/PoincareSection.h"
+#include "core/SimulationEngine.h"
+#include "core/TrajectoryRecorder.h"
+#include "core/TrajectoryReplay.h"
 
 Q_DECLARE_METATYPE(QList<QPointF>)
 
@@ -34,14 +53,39 @@ class DoublePendulum : public QObject
     Q_PROPERTY(double c2 READ getC2 WRITE setC2 NOTIFY c2Changed)
     Q_PROPERTY(double g READ getG WRITE setG NOTIFY gChanged)
     Q_PROPERTY(double simulationSpeed READ getSimulationSpeed WRITE setSimulationSpeed NOTIFY simulationSpeedChanged)
+    Q_PROPERTY(IntegratorMethod integratorMethod READ getIntegratorMethod WRITE setIntegratorMethod NOTIFY integratorMethodChanged)
+    Q_PROPERTY(QString toleranceProfile READ getToleranceProfile WRITE setToleranceProfile NOTIFY toleranceProfileChanged)
+    Q_PROPERTY(double absoluteTolerance READ getAbsoluteTolerance WRITE setAbsoluteTolerance NOTIFY toleranceProfileChanged)
+    Q_PROPERTY(double relativeTolerance READ getRelativeTolerance WRITE setRelativeTolerance NOTIFY toleranceProfileChanged)
+    Q_PROPERTY(double minStepSize READ getMinStepSize WRITE setMinStepSize NOTIFY toleranceProfileChanged)
+    Q_PROPERTY(double maxStepSize READ getMaxStepSize WRITE setMaxStepSize NOTIFY toleranceProfileChanged)
+    Q_PROPERTY(double rejectedStepRatio READ getRejectedStepRatio NOTIFY stepStatisticsChanged)
+    Q_PROPERTY(double averageStepSize READ getAverageStepSize NOTIFY stepStatisticsChanged)
+    Q_PROPERTY(double historySampleRate READ getHistorySampleRate WRITE setHistorySampleRate NOTIFY historySampleRateChanged)
+    Q_PROPERTY(double fixedTimestep READ getFixedTimestep WRITE setFixedTimestep NOTIFY fixedTimestepChanged)
     Q_PROPERTY(bool simulationFailed READ getSimulationFailed NOTIFY simulationFailedChanged)
+    Q_PROPERTY(bool running READ isRunning WRITE setRunning NOTIFY runningChanged)
     Q_PROPERTY(bool showTrace1 READ getShowTrace1 WRITE setShowTrace1 NOTIFY showTrace1Changed)
     Q_PROPERTY(bool showTrace2 READ getShowTrace2 WRITE setShowTrace2 NOTIFY showTrace2Changed)
+    Q_PROPERTY(int traceEpoch READ getTraceEpoch NOTIFY historyUpdated)
     Q_PROPERTY(double currentKineticEnergy READ getCurrentKineticEnergy NOTIFY currentKineticEnergyChanged)
     Q_PROPERTY(double currentPotentialEnergy READ getCurrentPotentialEnergy NOTIFY currentPotentialEnergyChanged)
     Q_PROPERTY(double currentTotalEnergy READ getCurrentTotalEnergy NOTIFY currentTotalEnergyChanged)
     Q_PROPERTY(double currentTime READ getCurrentTime NOTIFY currentTimeChanged)
     Q_PROPERTY(bool bob2PoincareFlash READ getBob2PoincareFlash NOTIFY bob2PoincareFlashChanged)
+    Q_PROPERTY(PoincareSectionType poincareSection READ getPoincareSection WRITE setPoincareSection NOTIFY poincareSectionChanged)
+    Q_PROPERTY(double historyStartTime READ getHistoryStartTime NOTIFY historyUpdated)
+    Q_PROPERTY(double historyEndTime READ getHistoryEndTime NOTIFY historyUpdated)
+    Q_PROPERTY(double historyEndRow READ getHistoryEndRow NOTIFY historyUpdated)
+    Q_PROPERTY(int historyEpoch READ getHistoryEpoch NOTIFY historyUpdated)
+    Q_PROPERTY(bool recording READ isRecording WRITE setRecording NOTIFY recordingChanged)
+    Q_PROPERTY(QString recordingDirectory READ getRecordingDirectory WRITE setRecordingDirectory NOTIFY recordingChanged)
+    Q_PROPERTY(QString recordingPath READ getRecordingPath NOTIFY recordingChanged)
+    Q_PROPERTY(double recordedFrames READ getRecordedFrames NOTIFY historyUpdated)
+    Q_PROPERTY(bool replayActive READ isReplayActive NOTIFY replayChanged)
+    Q_PROPERTY(QString replayPath READ getReplayPath NOTIFY replayChanged)
+    Q_PROPERTY(double replayStartTime READ getReplayStartTime NOTIFY replayChanged)
+    Q_PROPERTY(double replayEndTime READ getReplayEndTime NOTIFY replayChanged)
 
 public:
     // Enum for time series types
@@ -56,6 +100,41 @@ public:
     };
     Q_ENUM(TimeSeriesType)
 
+    // Surface of section for the Poincare map; crossings are located exactly
+    // on the integrator's dense output (see PoincareEventLocator)
+    enum class PoincareSectionType {
+        Theta1Zero, // theta1 = 0 upwards; map shows (theta2, omega2)
+        Theta2Zero, // absolute theta2 = 0 upwards; map shows (theta1, omega1)
+        Omega1Zero  // omega1 = 0 in both directions (turning points); map shows (theta2, omega2)
+    };
+    Q_ENUM(PoincareSectionType)
+
+    // Stepping scheme, in the order of PendulumIntegrator::Method
+    enum class IntegratorMethod {
+        DormandPrince5,   // Adaptive, default
+        DormandPrince853, // Adaptive 8th order, for high-accuracy reference runs
+        ImplicitMidpoint, // Symplectic, fixed step
+        GaussLegendre4,
+        GaussLegendre6,
+        Automatic         // Gauss-Legendre 4 without friction, DP5 with it
+    };
+    Q_ENUM(IntegratorMethod)
+
+    // What a frame's collectFromEngine() changed, i.e. what publishFrame() has to announce
+    enum class FrameChanges {
+        None,           // Nothing new (replay, manual control, stale snapshot)
+        State,          // The displayed state
+        StateAndHistory // The state, and history rows were appended
+    };
+
+    // Real-time pacing of the simulation thread, as of the last collectFromEngine()
+    struct PhysicsTiming {
+        double lagSeconds = 0.0;        // Wall time the simulation is behind the clock
+        double droppedTime = 0.0;       // Simulated time given up to stay within SimulationEngine::MAX_LAG_SECONDS
+        double load = 0.0;              // Share of an engine tick spent integrating
+        std::uint64_t overrunTicks = 0; // Engine ticks cut short by their integration deadline
+    };
+
     explicit DoublePendulum(
         // Physical parameters
         double m1, double m2,     // Point masses
@@ -74,8 +153,29 @@ public:
         QObject *parent = nullptr
     );
 
-    // Public methods for simulation
+    ~DoublePendulum() override;
+
+    // Public methods for simulation.
+    // The integrator runs on its own thread (see SimulationEngine); while it
+    // is paused, step() asks it to advance dt * simulationSpeed once.
     Q_INVOKABLE void step(double dt);
+    // Pulls finished steps from the simulation thread into the history,
+    // traces and Poincare map, then refreshes the state properties.
+    // Called once per UI frame; it never waits for the integrator.
+    // Same as publishFrame(collectFromEngine()).
+    Q_INVOKABLE void syncFromEngine();
+    // The two halves of syncFromEngine(), for a frame loop that times them
+    // separately: collectFromEngine() drains the engine into the history, trace
+    // buffers and state members, publishFrame() emits the per-frame state and
+    // history signals, which is where QML bindings and trace items do their work.
+    // With a fixed timestep the displayed state is interpolated between the
+    // last two physics steps, one step behind the clock; the energy and time
+    // readouts are those of the interpolated state.
+    FrameChanges collectFromEngine();
+    void publishFrame(FrameChanges changes);
+    const PhysicsTiming& physicsTiming() const { return m_physicsTiming; }
+    // Stops the simulation thread; called before the application quits
+    void shutdown();
     Q_INVOKABLE void reset(double newTheta1_abs, double newOmega1, 
                           double newTheta2_rel, double newOmega2);
     
@@ -126,15 +226,49 @@ public:
     double getG() const;
     void setG(double newGValue);
 
+    // Current physical parameters, as handed to the integrator
+    PendulumParameters parameters() const;
+
     // Getter and setter for simulation speed
     double getSimulationSpeed() const;
     void setSimulationSpeed(double newSpeed);
+    IntegratorMethod getIntegratorMethod() const;
+    void setIntegratorMethod(IntegratorMethod method);
+    // Adaptive controller preset: "realtime", "analysis" or "reference"; reads "custom"
+    // once any tolerance below has been edited individually
+    QString getToleranceProfile() const;
+    void setToleranceProfile(const QString& name);
+    double getAbsoluteTolerance() const;
+    void setAbsoluteTolerance(double tolerance);
+    double getRelativeTolerance() const;
+    void setRelativeTolerance(double tolerance);
+    double getMinStepSize() const;
+    void setMinStepSize(double step);
+    double getMaxStepSize() const;
+    void setMaxStepSize(double step);
+    // Live controller statistics over the last STEP_STATISTICS_WINDOW_MS of wall time:
+    // share of step attempts rejected, and simulated time per accepted step
+    double getRejectedStepRatio() const;
+    double getAverageStepSize() const;
+    // History samples per simulated second, interpolated within steps; 0 = one per accepted step
+    double getHistorySampleRate() const;
+    void setHistorySampleRate(double hz);
+    // Physics step length in simulated seconds (see SimulationEngine::setFixedTimestep()); 0 = one step per engine tick
+    double getFixedTimestep() const;
+    void setFixedTimestep(double seconds);
     bool getSimulationFailed() const;
 
+    // Whether the simulation thread advances in real time
+    bool isRunning() const;
+    void setRunning(bool running);
+
     // New methods for trace functionality
     Q_INVOKABLE QVector<QPointF> getTrace1Points() const;
     Q_INVOKABLE QVector<QPointF> getTrace2Points() const;
     Q_INVOKABLE void clearTraces();
+    // Bumped whenever the trace buffers are cleared, so a drawer that keeps its
+    // own copy knows to start over from getTrace1Points()/getTrace2Points()
+    int getTraceEpoch() const;
     
     // Getters and setters for trace visibility
     bool getShowTrace1() const;
@@ -142,7 +276,7 @@ public:
     bool getShowTrace2() const;
     void setShowTrace2(bool show);
 
-    // Methods for graph history data
+    // Methods for graph history data: the most recent MAX_BUFFER_SIZE rows, decoded from the archive
     Q_INVOKABLE QVector<QPointF> getTheta1History() const;
     Q_INVOKABLE QVector<QPointF> getTheta2History() const;
     Q_INVOKABLE QVector<QPointF> getOmega1History() const;
@@ -157,27 +291,76 @@ public:
     // Methods for Poincare map data
     Q_INVOKABLE QVector<QPointF> getPoincareMapPoints() const;
     Q_INVOKABLE void clearPoincareMapPoints();
+    PoincareSectionType getPoincareSection() const;
+    void setPoincareSection(PoincareSectionType section);
     
+    // Chart and trace data channel.
+    // These methods return packed point buffers: interleaved doubles
+    // [x0, y0, x1, y1, ...]. QML receives them as an ArrayBuffer and reads
+    // them through a Float64Array, so no point is boxed into a QVariant.
+
     // New methods for incremental traces
-    Q_INVOKABLE QVariantList consumeNewTrace1Points();
-    Q_INVOKABLE QVariantList consumeNewTrace2Points();
+    Q_INVOKABLE QByteArray consumeNewTrace1Points();
+    Q_INVOKABLE QByteArray consumeNewTrace2Points();
     
-    // New method for phase portrait data
-    Q_INVOKABLE QVariantList getPhasePortraitData(
+    // New method for phase portrait data (live: the most recent MAX_BUFFER_SIZE rows)
+    Q_INVOKABLE QByteArray getPhasePortraitData(
         TimeSeriesType xSeries,
         TimeSeriesType ySeries
     );
     
+    // Phase portrait as a density image. The trajectory is binned into a
+    // width x height hit-count grid (see PhaseDensity) and coloured in `color`,
+    // more opaque where it passes more often; each call only bins the rows
+    // added since the last one, and the grid is rebuilt from the whole history
+    // when the series, the size, the history or the replay change. The image is
+    // served as "image://phasedensity/<revision>"; the result holds that
+    // revision, whether there is anything to draw ("empty"), the data bounding
+    // box (dataXMin ... dataYMax) and the extent the image covers (gridXMin ... gridYMax).
+    Q_INVOKABLE QVariantMap updatePhaseDensity(
+        TimeSeriesType xSeries,
+        TimeSeriesType ySeries,
+        int width,
+        int height,
+        const QColor& color
+    );
+    // Copy of the last coloured density image; safe to call from the image provider's thread
+    QImage phaseDensityImage() const;
+
     // New method for processed time series data
-    Q_INVOKABLE QVariantList getProcessedTimeSeriesData(
+    // With pixelWidth > 0 a long viewport is reduced to a min/max envelope per
+    // pixel column (at most four points per column) before RDP and the point limit.
+    // With rdpTargetPoints > 0 RDP keeps that many points instead of using rdpEpsilon.
+    Q_INVOKABLE QByteArray getProcessedTimeSeriesData(
         TimeSeriesType seriesType,
         double viewPortMinTime,
         double viewPortMaxTime,
         bool rdpEnabled,
         double rdpEpsilon,
         bool limitPointsEnabled,
-        int maxPointsLimit
+        int maxPointsLimit,
+        int pixelWidth = 0,
+        int rdpTargetPoints = 0
+    );
+
+    // Rows of one series appended since a chart last looked, for drawing them
+    // onto what it already has. Rows are numbered from the last history clear
+    // (historyEpoch counts the clears; historyEndRow is the next row number):
+    // the result holds the rows [max(fromRow, first row at fromTime),
+    // getHistoryRowAt(toTime)) as interleaved (time, value) doubles. With
+    // pixelWidth > 0, [fromTime, toTime) is pixelWidth columns of the plot and
+    // the rows are reduced as getProcessedTimeSeriesData reduces a viewport:
+    // more than four rows per column become the min/max envelope of each
+    // column. Empty in replay mode.
+    Q_INVOKABLE QByteArray getTimeSeriesDelta(
+        TimeSeriesType seriesType,
+        double fromRow,
+        double fromTime,
+        double toTime,
+        int pixelWidth = 0
     );
+    // First history row whose time is at least `time` (historyEndRow if none)
+    Q_INVOKABLE double getHistoryRowAt(double time) const;
 
     // Getters for current energy values
     double getCurrentKineticEnergy() const;
@@ -187,6 +370,39 @@ public:
     // Getter for current simulation time
     double getCurrentTime() const;
 
+    // Time range covered by the stored history (0 when it is empty)
+    double getHistoryStartTime() const;
+    double getHistoryEndTime() const;
+    double getHistoryEndRow() const;
+    int getHistoryEpoch() const;
+
+    // Trajectory recording. While enabled, every history sample is streamed to a
+    // .dptraj file in recordingDirectory (see TrajectoryRecorder); the file is
+    // created with the first sample and a new one is started whenever the
+    // simulation clock restarts (reset, clearHistory), so each file is one run.
+    bool isRecording() const;
+    void setRecording(bool enabled);
+    QString getRecordingDirectory() const;
+    void setRecordingDirectory(const QString& directory);
+    // File being written; empty until the first sample arrives
+    QString getRecordingPath() const;
+    double getRecordedFrames() const;
+
+    // Replay mode. The recording is memory-mapped (see TrajectoryReplay) and
+    // takes the place of the live history: the state properties, traces,
+    // charts and phase portrait follow a cursor that running/step() advance
+    // through the file, and the history ends at the cursor. The live
+    // simulation is paused meanwhile and resumes where it was on closeReplay().
+    // The parameter properties show the recording's values while it is open;
+    // the engine keeps the live ones, which the properties return to on closeReplay().
+    Q_INVOKABLE bool openReplay(const QUrl& fileUrl);
+    Q_INVOKABLE void closeReplay();
+    Q_INVOKABLE void seekReplay(double time);
+    bool isReplayActive() const;
+    QString getReplayPath() const;
+    double getReplayStartTime() const;
+    double getReplayEndTime() const;
+
     // Getter for bob2 Poincare flash state
     bool getBob2PoincareFlash() const;
     
@@ -211,7 +427,13 @@ signals:
     void c2Changed();
     void gChanged();
     void simulationSpeedChanged();
+    void integratorMethodChanged();
+    void toleranceProfileChanged();
+    void stepStatisticsChanged();
+    void historySampleRateChanged();
+    void fixedTimestepChanged();
     void simulationFailedChanged();
+    void runningChanged();
     void showTrace1Changed();
     void showTrace2Changed();
     void historyUpdated(); // Signal that the data for graphs has been updated
@@ -220,6 +442,9 @@ signals:
     void currentTotalEnergyChanged();
     void currentTimeChanged();
     void bob2PoincareFlashChanged();
+    void poincareSectionChanged();
+    void recordingChanged();
+    void replayChanged();
 
 private Q_SLOTS:
     void resetBob2Flash();
@@ -233,12 +458,18 @@ private:
     double c1, c2;    // Quadratic air resistance coefficients
     double g;         // Gravity acceleration
     double m_simulationSpeed = 1.0; // Simulation speed multiplier
+    IntegratorMethod m_integratorMethod = IntegratorMethod::DormandPrince5;
+    PendulumIntegrator::ToleranceProfile m_toleranceProfile;
     bool m_simulationFailed = false; // Simulation failure state
     bool m_isManualControlActive = false; // Flag to indicate user is dragging the pendulum
     
+    // Number of chart series (TimeSeriesType values)
+    static constexpr size_t TIME_SERIES_COUNT = static_cast<size_t>(TimeSeriesType::TotalEnergy) + 1;
+
     // Maximum number of points to store in history and trace buffers.
     // A value of 500,000 provides a good balance between long-term
-    // chart visibility and memory consumption.
+    // chart visibility and memory consumption. The buffers are circular,
+    // so the oldest point is overwritten in O(1) once the cap is reached.
     static constexpr size_t MAX_BUFFER_SIZE = 500000;
     
     // Current state
@@ -248,26 +479,40 @@ private:
     double omega2;    // Angular velocity of the second rod
     
     // Trace-related members
-    QVector<QPointF> m_trace1_points;
-    QVector<QPointF> m_trace2_points;
+    RingBuffer<QPointF> m_trace1_points{MAX_BUFFER_SIZE};
+    RingBuffer<QPointF> m_trace2_points{MAX_BUFFER_SIZE};
     bool m_showTrace1 = false;
     bool m_showTrace2 = false;
+    int m_traceEpoch = 0;
     
-    // Graph history data
-    QVector<QPointF> m_theta1History; // X = time, Y = theta1
-    QVector<QPointF> m_theta2History; // X = time, Y = theta2
-    QVector<QPointF> m_omega1History; // X = time, Y = omega1
-    QVector<QPointF> m_omega2History; // X = time, Y = omega2
-    QVector<QPointF> m_kineticEnergyHistory; // X = time, Y = T (kinetic energy)
-    QVector<QPointF> m_potentialEnergyHistory; // X = time, Y = V (potential energy)
-    QVector<QPointF> m_totalEnergyHistory; // X = time, Y = E (total energy)
+    // Graph history: the whole run, one row per accepted step, compressed. Every
+    // history reader decodes from here; there is no raw copy of the rows.
+    CompressedHistory m_historyArchive;
+    // Min/max levels of every chart series (in chart units, TimeSeriesType order) over the archive
+    HistoryPyramid m_historyPyramid{TIME_SERIES_COUNT};
+    // RDP for the chart requests; keeps its scratch between calls
+    LineSimplifier m_lineSimplifier;
+    int m_historyEpoch = 0; // Bumped whenever the history rows are cleared
+
+    // Phase portrait density and what it has been fed from
+    PhaseDensity m_phaseDensity;
+    TimeSeriesType m_densityXSeries = TimeSeriesType::Theta1_Degrees;
+    TimeSeriesType m_densityYSeries = TimeSeriesType::Theta1_Degrees;
+    int m_densityEpoch = -1;            // historyEpoch of the live rows fed; -1 = nothing fed
+    QString m_densitySource;            // Replay path, empty for the live history
+    QSize m_densitySize;                // Grid size requested by the chart
+    std::uint64_t m_densityFedRows = 0; // Next archive row (live) or replay frame to feed
+    std::uint64_t m_densityColoredSamples = 0;
+    QColor m_densityColor;
+    int m_densityRevision = 0;
+    mutable std::mutex m_densityImageMutex;
+    QImage m_densityImage;
     double m_currentTimeForHistory = 0.0; // Current simulation time for history
-    double m_last_used_h = 0.001;         // Last successfully used integration step
-    double m_time_accumulator = 0.0;      // Time accumulator between frames
     
     // Poincare map related
-    QVector<QPointF> m_poincareMapPoints; // points of the Poincare map
-    double prev_theta1_for_poincare = 0.0; // For tracking theta1 = 0 intersection
+    RingBuffer<QPointF> m_poincareMapPoints{MAX_BUFFER_SIZE}; // points of the Poincare map
+    PoincareSectionType m_poincareSectionType = PoincareSectionType::Theta1Zero;
+    PoincareSection m_poincareSection; // Core description of m_poincareSectionType
     bool m_bob2PoincareFlash = false;
     QTimer* m_bob2FlashTimer;
     
@@ -280,71 +525,130 @@ private:
     std::vector<QPointF> m_new_trace1_points;
     std::vector<QPointF> m_new_trace2_points;
 
-    // FSAL (First Same As Last) optimization
-    bool m_fsal_ready = false;
-    std::vector<double> m_last_fsal_k;
-    double m_last_fsal_t = 0.0;
+    // Integrator thread; owned through the QObject parent
+    SimulationEngine* m_engine = nullptr;
+
+    // Trajectory recording
+    TrajectoryRecorder m_recorder;
+    bool m_recordingEnabled = true;
+    QString m_recordingDirectory;
+
+    // Replay of a recording; m_replayIndex is the frame shown, m_replayTime the cursor
+    TrajectoryReplay m_replay;
+    std::size_t m_replayIndex = 0;
+    double m_replayTime = 0.0;
+    bool m_replayPlaying = false;
+    QElapsedTimer m_replayClock; // Wall time since the last playback advance
+    PendulumParameters m_liveParameters; // Live run's parameters, shown again on closeReplay()
+
+    // Step counters at the start of the current statistics window
+    QElapsedTimer m_stepStatisticsTimer;
+    std::uint64_t m_windowAcceptedSteps = 0;
+    std::uint64_t m_windowRejectedSteps = 0;
+    double m_windowStartTime = 0.0;
+    double m_rejectedStepRatio = 0.0;
+    double m_averageStepSize = 0.0;
+
+    PhysicsTiming m_physicsTiming;
+
+    void pushParametersToEngine();
+    // Sets the parameter members and notifies, bypassing the setters' clamping and the engine
+    void showParameters(const PendulumParameters& p);
+    void applyToleranceProfile(const PendulumIntegrator::ToleranceProfile& profile);
+    void updateStepStatistics(const SimulationSnapshot& snapshot);
+    void pushStateToEngine();
+
+    // Opens a new recording file for the current run
+    void beginRecordingFile();
+    // Closes the current file; one that never received a frame is deleted
+    void finishRecordingFile();
+    // Streams one history row to the recording, opening the file if needed
+    void recordFrame(const TrajectoryFrame& frame);
+
+    // Moves the replay cursor forward by simulated seconds and shows the frame it reaches
+    void advanceReplay(double seconds);
+    // Shows a replay frame: state properties, energies and traces
+    void showReplayFrame(std::size_t index);
+    // Last replay frame at or before time t (the first frame if none)
+    std::size_t replayFrameAt(double t) const;
+    // One past the last replay frame at or before time t, never past the cursor
+    std::size_t replayRowsUntil(double t) const;
+    // Value of a chart series at a replay frame, in chart units
+    static double seriesValueAt(TimeSeriesType type, const TrajectoryFrame& frame);
+
+    // Appends one row to the history, its archive and the chart pyramid
+    void appendHistoryRow(double time, const PendulumState& state,
+                          double kineticEnergy, double potentialEnergy, double totalEnergy);
+    void clearHistoryRows();
+    // First row of a fresh history (and of the recording): the current state at t = 0
+    void seedHistory();
 
     // Helper function to update energy values based on the current state
-    void updateEnergies(const std::vector<double>& state);
+    void updateEnergies(const PendulumState& state);
 
     // Helper function to update trace points for the bobs
-    void updateTraces(const std::vector<double>& state);
+    void updateTraces(const PendulumState& state);
+    // Empties both traces and their incremental buffers, bumping the trace epoch
+    void clearTracePoints();
+
+    // Maps a chart series onto the history column it is derived from
+    static CompressedHistory::Column historyColumnFor(TimeSeriesType type);
+
+    // Value of a chart series at a row of a decoded archive block, in chart units (degrees, absolute theta2)
+    static double seriesValueAt(TimeSeriesType type, const CompressedHistory::RowBlock& block, std::size_t row);
+
+    // Bins the history rows the phase density has not seen; starts it over (and
+    // returns true) when the series, the size or the history it was fed from changed
+    bool feedPhaseDensity(TimeSeriesType xSeries, TimeSeriesType ySeries, int width, int height);
+    // Colours the hit counts into m_densityImage: log scale, zero counts transparent
+    void colorPhaseDensity(const QColor& color);
+
+    // Packs points into the interleaved-double buffer used by the chart data channel
+    static QByteArray packPoints(const QPointF* points, qsizetype count);
+
+    // First of the most recent MAX_BUFFER_SIZE archive rows, the window of the full-history getters
+    std::uint64_t firstRecentHistoryRow() const;
+    // Copies a history column over that window into (time, value) points for the QVector getters
+    QVector<QPointF> historyColumnAsPoints(CompressedHistory::Column column) const;
 
     // Helper function to calculate distance between points
     double calculateDistance(const QPointF& p1, const QPointF& p2) const;
 
-    // Compute derivatives for the RK4 method
-    std::vector<double> getDerivatives(double t, const std::vector<double>& yState) const;
-    
-    // Dormand-Prince parameters as constants - updated for better energy conservation
-    static constexpr double DOPRI_ATOL = 1.0e-14;    // Absolute tolerance
-    static constexpr double DOPRI_RTOL = 1.0e-13;    // Relative tolerance
-    static constexpr double DOPRI_HMIN = 1.0e-8;     // Minimum step size
-    static constexpr double DOPRI_HMAX = 0.005;      // Maximum step size, reduced for smoother plotting
-    static constexpr double DOPRI_SAFETY_FACTOR = 0.9; // Safety factor for step size selection
-    static constexpr double DOPRI_FAC_MIN = 0.2;      // Minimum factor for step size changes
-    static constexpr double DOPRI_FAC_MAX = 5.0;      // Maximum factor for step size changes
-    
-    // Dormand-Prince 5(4) Butcher Tableau coefficients.
-    // Using static constexpr makes them compile-time constants available to all instances.
-    static constexpr double DP5_C2=1./5., DP5_C3=3./10., DP5_C4=4./5., DP5_C5=8./9., DP5_C6=1., DP5_C7=1.;
-
-    static constexpr double DP5_A21=1./5., DP5_A31=3./40., DP5_A32=9./40.,
-                            DP5_A41=44./45., DP5_A42=-56./15., DP5_A43=32./9.,
-                            DP5_A51=19372./6561., DP5_A52=-25360./2187., DP5_A53=64448./6561., DP5_A54=-212./729.,
-                            DP5_A61=9017./3168., DP5_A62=-355./33., DP5_A63=46732./5247., DP5_A64=49./176., DP5_A65=-5103./18656.,
-                            DP5_A71=35./384., DP5_A73=500./1113., DP5_A74=125./192., DP5_A75=-2187./6784., DP5_A76=11./84.;
-    
-    // Coefficients for the 5th order solution (y_{n+1})
-    static constexpr double DP5_B1=35./384., DP5_B2=0., DP5_B3=500./1113., DP5_B4=125./192., DP5_B5=-2187./6784., DP5_B6=11./84., DP5_B7=0.;
-
-    // Coefficients for the 4th order embedded solution (for error estimation)
-    static constexpr double DP5_E1=71./57600., DP5_E2=0., DP5_E3=-71./16695., DP5_E4=71./1920., DP5_E5=-17253./339200., DP5_E6=22./525., DP5_E7=-1./40.;
-    
     // --- Simulation & Gameplay Constants ---
 
     // Duration of the visual flash on Poincare section crossing (in milliseconds)
     static constexpr int POINCARE_FLASH_DURATION_MS = 250;
 
-    // Tolerance for theta1 to be considered "at the vertical" for the Poincare map
-    static constexpr double POINCARE_THETA1_TOLERANCE_RAD = 0.15;
-    
-    // Minimum positive velocity for a valid Poincare section crossing (to avoid trivial crossings)
-    static constexpr double POINCARE_OMEGA1_MIN_VELOCITY_RAD_S = 0.05;
+    // Wall time over which the rejected-step ratio and mean step are averaged
+    static constexpr qint64 STEP_STATISTICS_WINDOW_MS = 500;
+
+    // Compressed history kept for the charts before the oldest chunks are dropped:
+    // a few hours of per-step history at 20-25 bytes per row
+    static constexpr size_t HISTORY_ARCHIVE_BYTE_BUDGET = size_t(256) << 20;
+
+    // Opacity of a phase density cell visited once; the busiest cell is opaque
+    static constexpr double PHASE_DENSITY_MIN_ALPHA = 0.2;
+
+    // Most rows a replay reader returns per request; longer ranges are read with a
+    // fixed stride, so the cost does not grow with the length of the recording
+    static constexpr size_t REPLAY_MAX_ROWS = MAX_BUFFER_SIZE;
 
     // Minimum physical distance between two consecutive points in a trace to be stored.
     // This prevents the trace buffer from being flooded with redundant data.
     static constexpr double MIN_TRACE_DISTANCE = 0.01;
-    
-    // Dormand-Prince 5(4) method for adaptive step size integration
-    void performOneDormandPrinceStep(
-        double tCurrent,
-        const std::vector<double>& yCurrent, // Input state {th1, o1, th2, o2}
-        double& hInOut,                      // Input: proposed step; Output: suggested step for next attempt/step
-        std::vector<double>& yNext,          // Output: state after successful step
-        bool& stepAccepted                   // Output: true if step was accepted, false otherwise
-    );
+
+};
+
+// Serves DoublePendulum::phaseDensityImage() as "image://phasedensity/<revision>"
+class PhaseDensityImageProvider : public QQuickImageProvider
+{
+public:
+    explicit PhaseDensityImageProvider(DoublePendulum* pendulum);
+
+    QImage requestImage(const QString& id, QSize* size, const QSize& requestedSize) override;
+
+private:
+    DoublePendulum* m_pendulum;
 };
 
 #endif // DOUBLEPENDULUM_H
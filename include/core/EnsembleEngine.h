@@ -0,0 +1,116 @@
+#ifndef ENSEMBLEENGINE_H
+#define ENSEMBLEENGINE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "core/BatchKernel.h"
+#include "core/PendulumIntegrator.h"
+
+/*
+ * @brief Structure-of-arrays storage for an ensemble of pendulums.
+ *
+ * Every member shares the physical parameters and differs only in its initial
+ * condition. Members keep no history: only the reductions that were asked for
+ * are stored, one array per quantity. Reduction arrays are empty when the
+ * corresponding reduction is disabled.
+ */
+struct EnsembleBatch {
+    // Initial conditions {theta1_abs, omega1_abs, theta2_rel, omega2_rel}
+    std::vector<double> theta1, omega1, theta2, omega2;
+
+    // EnsembleEngine::FinalState
+    std::vector<double> finalTheta1, finalOmega1, finalTheta2, finalOmega2;
+    std::vector<double> finalTime;          // Below the duration if integration failed
+    // EnsembleEngine::EnergyDrift (|E(t) - E(0)|)
+    std::vector<double> maxEnergyDrift;
+    std::vector<double> finalEnergyDrift;   // Signed E(end) - E(0)
+    // EnsembleEngine::FirstFlipTime; negative when the member never flipped
+    std::vector<double> firstFlipTime;
+    // EnsembleEngine::StepCounts
+    std::vector<std::uint32_t> acceptedSteps, rejectedSteps;
+
+    std::vector<std::uint8_t> failed;       // Always filled: 1 if the integrator gave up
+
+    std::size_t size() const { return theta1.size(); }
+};
+
+/*
+ * @brief Integrates many independent pendulums across all CPU cores.
+ *
+ * Members are integrated with the same adaptive DP5 scheme as the interactive
+ * simulation, each with its own step size. Work is distributed in grains of
+ * consecutive members by a WorkStealingScheduler, so members that need many
+ * small steps (after a flip) do not leave other cores idle.
+ *
+ * By default each grain goes through the lane-parallel BatchKernel at the best
+ * SIMD level the CPU supports; Config::vectorized = false keeps the one-member-
+ * at-a-time PendulumIntegrator path as a reference.
+ */
+class EnsembleEngine
+{
+public:
+    enum Reduction : unsigned {
+        FinalState    = 1u << 0,
+        EnergyDrift   = 1u << 1,
+        FirstFlipTime = 1u << 2,
+        StepCounts    = 1u << 3,
+        AllReductions = FinalState | EnergyDrift | FirstFlipTime | StepCounts
+    };
+
+    struct Config {
+        PendulumParameters parameters;
+        PendulumIntegrator::ToleranceProfile tolerances; // Step-size controller of every member
+        double duration = 10.0;             // Simulated seconds per member
+        unsigned reductions = AllReductions;
+        std::size_t threadCount = 0;        // 0: every hardware thread
+        std::size_t grainSize = 64;         // Members per scheduling unit
+        // Use BatchKernel instead of PendulumIntegrator when the resolved level has
+        // more than one lane; the one-lane kernel is slower than the reference path
+        bool vectorized = true;
+        bool forceKernel = false;           // Use BatchKernel even at SimdLevel::Scalar (benchmarks)
+        SimdLevel maxSimdLevel = SimdLevel::Avx512; // Cap for the detected level
+    };
+
+    EnsembleEngine();
+    explicit EnsembleEngine(const Config& config);
+
+    const Config& config() const { return m_config; }
+    void setConfig(const Config& config) { m_config = config; }
+
+    // Member initial conditions
+    void resize(std::size_t memberCount);
+    std::size_t size() const { return m_batch.size(); }
+    void setInitialState(std::size_t member, const PendulumState& state);
+    PendulumState initialState(std::size_t member) const;
+
+    // Integrates every member for config().duration; blocks until done
+    void run();
+
+    const EnsembleBatch& batch() const { return m_batch; }
+    EnsembleBatch& batch() { return m_batch; }
+
+    // Statistics of the last run()
+    std::size_t lastThreadCount() const { return m_lastThreadCount; }
+    std::size_t lastStealCount() const { return m_lastStealCount; }
+    bool lastRunVectorized() const { return m_lastRunVectorized; }
+    SimdLevel lastSimdLevel() const { return m_lastSimdLevel; }
+
+    // A member has flipped once either rod passes over the top
+    static bool hasFlipped(const PendulumState& state);
+
+private:
+    void prepareReductions();
+    void integrateRange(std::size_t first, std::size_t last);
+    void integrateMember(std::size_t member);
+    void integrateKernelRange(std::size_t first, std::size_t last);
+
+    Config m_config;
+    EnsembleBatch m_batch;
+    std::size_t m_lastThreadCount = 0;
+    std::size_t m_lastStealCount = 0;
+    bool m_lastRunVectorized = false;
+    SimdLevel m_lastSimdLevel = SimdLevel::Scalar;
+};
+
+#endif // ENSEMBLEENGINE_H
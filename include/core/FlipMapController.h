@@ -0,0 +1,109 @@
+#ifndef FLIPMAPCONTROLLER_H
+#define FLIPMAPCONTROLLER_H
+
+#include <QObject>
+#include <QImage>
+#include <QQuickImageProvider>
+#include <QThread>
+#include <QTimer>
+#include <QElapsedTimer>
+#include <QUrl>
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include "core/FlipMapGenerator.h"
+
+class DoublePendulum;
+
+/*
+ * @brief Computes the time-to-flip map in the background for the QML view.
+ *
+ * A FlipMapGenerator runs on its own thread with the current parameters of the
+ * pendulum. Each finished tile is coloured straight into a shared QImage; a
+ * GUI-thread timer then bumps imageRevision, so the view reloads the image
+ * from the "flipmap" image provider a few times per second while tiles keep
+ * arriving.
+ */
+class FlipMapController : public QObject
+{
+    Q_OBJECT
+    Q_PROPERTY(int resolution READ resolution WRITE setResolution NOTIFY resolutionChanged)
+    Q_PROPERTY(double duration READ duration WRITE setDuration NOTIFY durationChanged)
+    Q_PROPERTY(bool running READ isRunning NOTIFY runningChanged)
+    Q_PROPERTY(double progress READ progress NOTIFY progressChanged)
+    Q_PROPERTY(double elapsedSeconds READ elapsedSeconds NOTIFY progressChanged)
+    Q_PROPERTY(int imageRevision READ imageRevision NOTIFY imageRevisionChanged)
+
+public:
+    explicit FlipMapController(QObject* parent = nullptr);
+    ~FlipMapController() override;
+
+    int resolution() const { return m_resolution; }
+    void setResolution(int resolution);
+    double duration() const { return m_duration; }
+    void setDuration(double duration);
+    bool isRunning() const { return m_thread != nullptr; }
+    double progress() const { return m_progress; }
+    double elapsedSeconds() const { return m_elapsedSeconds; }
+    int imageRevision() const { return m_imageRevision; }
+
+    // Starts a new map with the pendulum's current parameters, replacing any running one
+    Q_INVOKABLE void start(DoublePendulum* pendulum);
+    Q_INVOKABLE void cancel();
+    // PNG/JPEG of the coloured map, or the 16-bit flip-time map for a .pgm file name
+    Q_INVOKABLE bool saveImage(const QUrl& fileUrl);
+
+    // Copy of the coloured map; safe to call from the image provider's thread
+    QImage image() const;
+
+public slots:
+    // Stops the worker thread (connected to QCoreApplication::aboutToQuit)
+    void shutdown();
+
+signals:
+    void resolutionChanged();
+    void durationChanged();
+    void runningChanged();
+    void progressChanged();
+    void imageRevisionChanged();
+    void finished(bool completed);
+
+private:
+    void colorizeTile(const FlipMapTile& tile); // Worker thread
+    void updateProgress();
+    void onThreadFinished();
+    static QRgb colorFor(float flipTime, double duration);
+
+    int m_resolution = 512;
+    double m_duration = 10.0;
+    double m_progress = 0.0;
+    double m_elapsedSeconds = 0.0;
+    int m_imageRevision = 0;
+
+    std::unique_ptr<FlipMapGenerator> m_generator;
+    QThread* m_thread = nullptr;
+    bool m_completed = false;
+    std::size_t m_tileCount = 0;
+    std::atomic<std::size_t> m_tilesDone{0};
+    std::size_t m_tilesShown = 0;
+
+    mutable std::mutex m_imageMutex;
+    QImage m_image;
+
+    QTimer m_refreshTimer; // Coalesces tile updates into a few image reloads per second
+    QElapsedTimer m_clock;
+};
+
+// Serves FlipMapController::image() as "image://flipmap/<revision>"
+class FlipMapImageProvider : public QQuickImageProvider
+{
+public:
+    explicit FlipMapImageProvider(FlipMapController* controller);
+
+    QImage requestImage(const QString& id, QSize* size, const QSize& requestedSize) override;
+
+private:
+    FlipMapController* m_controller;
+};
+
+#endif // FLIPMAPCONTROLLER_H
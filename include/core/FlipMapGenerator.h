@@ -0,0 +1,109 @@
+#ifndef FLIPMAPGENERATOR_H
+#define FLIPMAPGENERATOR_H
+
+#include <atomic>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <functional>
+#include <vector>
+#include "core/BatchKernel.h"
+#include "core/PendulumIntegrator.h"
+
+// Grid of initial conditions for a time-to-flip map. Both rods start at rest;
+// theta1 runs along x (left to right), the absolute angle of rod 2 along y
+// (top row = theta2Max), sampled at pixel centres.
+struct FlipMapConfig {
+    PendulumParameters parameters;
+    std::size_t width = 512;
+    std::size_t height = 512;
+    double theta1Min = -M_PI;
+    double theta1Max = M_PI;
+    double theta2Min = -M_PI;       // Absolute angle of rod 2
+    double theta2Max = M_PI;
+    double duration = 10.0;         // Simulated seconds before a pixel counts as "never"
+    PendulumIntegrator::ToleranceProfile tolerances; // Step-size controller of the pixel runs
+    std::size_t tileSize = 64;      // Tile edge in pixels; one tile is one scheduling unit
+    std::size_t threadCount = 0;    // 0: every hardware thread
+    SimdLevel maxSimdLevel = SimdLevel::Avx512;
+};
+
+// Pixel rectangle of a finished tile
+struct FlipMapTile {
+    std::size_t x = 0;
+    std::size_t y = 0;
+    std::size_t width = 0;
+    std::size_t height = 0;
+};
+
+/*
+ * @brief Builds the time-to-flip fractal of the double pendulum.
+ *
+ * Every pixel is one simulation with the same physics as the interactive
+ * pendulum (rod masses and friction included), integrated by BatchKernel until
+ * either rod passes over the top or the duration runs out. Pixels whose
+ * initial energy is below the lowest energy of any flipped configuration are
+ * filled in without integrating: friction only removes energy, so they can
+ * never flip.
+ *
+ * Tiles are spread over all cores by a WorkStealingScheduler; the tile
+ * callback runs on the worker thread that finished the tile, so the caller
+ * can show the map while it is still being computed.
+ */
+class FlipMapGenerator
+{
+public:
+    // Runs on a worker thread; the tile's pixels are final when it is called
+    using TileCallback = std::function<void(const FlipMapTile&)>;
+
+    static constexpr float NEVER_FLIPPED = -1.0f;
+
+    explicit FlipMapGenerator(const FlipMapConfig& config);
+
+    const FlipMapConfig& config() const { return m_config; }
+
+    // Computes the whole map; returns false if cancel() stopped it early
+    bool run(const TileCallback& onTile = TileCallback());
+    // May be called from any thread while run() is working
+    void cancel() { m_cancelled.store(true, std::memory_order_relaxed); }
+
+    std::size_t tileCount() const;
+
+    // Row-major flip times in seconds, NEVER_FLIPPED where no flip happened
+    const std::vector<float>& flipTimes() const { return m_flipTimes; }
+    float flipTime(std::size_t x, std::size_t y) const { return m_flipTimes[y * m_config.width + x]; }
+
+    // Statistics of the last run()
+    std::size_t energyPrunedPixels() const { return m_prunedPixels.load(std::memory_order_relaxed); }
+    std::size_t failedPixels() const { return m_failedPixels.load(std::memory_order_relaxed); }
+    std::size_t lastThreadCount() const { return m_lastThreadCount; }
+    SimdLevel lastSimdLevel() const { return m_simdLevel; }
+
+    double theta1At(std::size_t x) const;
+    double theta2At(std::size_t y) const;
+
+    // 0 for "never", otherwise 65535 at t = 0 falling linearly to 1 at the duration
+    static std::uint16_t encode16(float flipTime, double duration);
+
+    // Binary PGM (P5) with 16-bit big-endian samples, values from encode16()
+    bool writePgm16(std::FILE* file) const;
+    // width * height native-endian floats, same layout as flipTimes()
+    bool writeRawFloat(std::FILE* file) const;
+
+private:
+    void computeTile(std::size_t tile);
+    // Lowest potential energy at which either rod can reach the upright position
+    double flipEnergyThreshold() const;
+
+    FlipMapConfig m_config;
+    std::vector<float> m_flipTimes;
+    std::atomic<bool> m_cancelled{false};
+    std::atomic<std::size_t> m_prunedPixels{0};
+    std::atomic<std::size_t> m_failedPixels{0};
+    std::size_t m_lastThreadCount = 0;
+    SimdLevel m_simdLevel = SimdLevel::Scalar;
+    const TileCallback* m_onTile = nullptr;
+};
+
+#endif // FLIPMAPGENERATOR_H
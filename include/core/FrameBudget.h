@@ -0,0 +1,100 @@
+#ifndef FRAMEBUDGET_H
+#define FRAMEBUDGET_H
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+/*
+ * @brief Time budgets of the phases of a GUI frame, and what overran them.
+ *
+ * A frame period is split into a budget per phase (a share of the period).
+ * The frame loop reports how long each phase took; the budget keeps, per
+ * phase, the last and a smoothed duration, the peak over the current metrics
+ * window and how many frames went over the phase budget.
+ *
+ * A frame counts as dropped when it starts more than DROP_THRESHOLD periods
+ * after the previous one. Its cause is the phase of the previous frame that
+ * exceeded its budget by the largest factor, or Unaccounted when every phase
+ * stayed within budget, i.e. the time went to something the loop does not
+ * measure (layout, other event handlers, the compositor).
+ *
+ * Phases are recorded while the frame is open, which lasts until the next
+ * beginFrame(). Render runs on the render thread, so the frame loop records
+ * it just before starting the next frame.
+ */
+class FrameBudget
+{
+public:
+    enum Phase {
+        Physics,   // Draining the integrator: history rows, trace buffers, displayed state
+        Traces,    // Announcing the frame: trace items and views bound to the state
+        Charts,    // Chart refresh
+        Render,    // Scene graph sync and render (render thread)
+        PhaseCount
+    };
+    // Cause of a dropped frame: a phase, or Unaccounted
+    static constexpr int Unaccounted = PhaseCount;
+
+    // A frame interval over this many periods means a frame was missed
+    static constexpr double DROP_THRESHOLD = 1.5;
+    // Weight of the newest frame in the smoothed durations
+    static constexpr double SMOOTHING = 0.1;
+
+    struct PhaseStats {
+        double last = 0.0;        // Seconds, latest frame
+        double average = 0.0;     // Seconds, exponentially smoothed
+        double peak = 0.0;        // Seconds, since resetPeaks()
+        std::uint64_t overruns = 0; // Frames over the phase budget
+    };
+
+    FrameBudget();
+
+    void setFramePeriod(double seconds);
+    double framePeriod() const { return m_period; }
+    // Share of the frame period given to a phase; shares are not normalised
+    void setShare(Phase phase, double share);
+    double share(Phase phase) const { return m_shares[phase]; }
+    double budget(Phase phase) const { return m_shares[phase] * m_period; }
+
+    // Starts a frame at `now` (seconds on any monotonic clock)
+    void beginFrame(double now);
+    // Adds time spent in a phase during the current frame
+    void record(Phase phase, double seconds);
+    // Seconds the current frame has spent so far
+    double spent() const;
+    // Whether the current frame can still afford the phase's budget
+    // without cutting into the render budget
+    bool hasRoomFor(Phase phase) const;
+
+    const PhaseStats& stats(Phase phase) const { return m_stats[phase]; }
+    std::uint64_t frames() const { return m_frames; }
+    std::uint64_t droppedFrames() const { return m_droppedFrames; }
+    // Phase (or Unaccounted) blamed for the latest dropped frame; -1 before any
+    int lastDropCause() const { return m_lastDropCause; }
+    // Dropped frames blamed on a phase (or Unaccounted)
+    std::uint64_t dropsCausedBy(int cause) const { return m_dropCauses[static_cast<std::size_t>(cause)]; }
+    // Seconds between the starts of the last two frames
+    double lastInterval() const { return m_lastInterval; }
+
+    void resetPeaks();
+    void reset();
+
+private:
+    // Phase of the finished frame that went furthest over budget, or Unaccounted
+    int worstPhase() const;
+
+    double m_period = 1.0 / 60.0;
+    std::array<double, PhaseCount> m_shares{};
+    std::array<double, PhaseCount> m_current{};  // Current frame
+    std::array<double, PhaseCount> m_previous{}; // Frame before it
+    std::array<PhaseStats, PhaseCount> m_stats{};
+    std::array<std::uint64_t, PhaseCount + 1> m_dropCauses{};
+    double m_lastStart = -1.0;
+    double m_lastInterval = 0.0;
+    std::uint64_t m_frames = 0;
+    std::uint64_t m_droppedFrames = 0;
+    int m_lastDropCause = -1;
+};
+
+#endif // FRAMEBUDGET_H
@@ -0,0 +1,90 @@
+#ifndef HISTORYPYRAMID_H
+#define HISTORYPYRAMID_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/*
+ * @brief Level-of-detail min/max pyramid over the history, for chart downsampling.
+ *
+ * Rows are grouped into leaves of BUCKET_ROWS rows; a leaf keeps its first
+ * and last time and, per series, min, max, first and last value. Above the
+ * leaves, level k holds the min/max of 2^k consecutive leaves, built as soon
+ * as both halves are complete, so appending costs O(1) amortised and about
+ * 5 bytes per row for seven series.
+ *
+ * envelope() answers a chart request with the M4 reduction (first, min, max,
+ * last per pixel column) for any viewport. The range is covered by aligned
+ * buckets no wider than half a pixel's worth of rows, so the work is
+ * O(pixels) whatever the history length, and a bucket that straddles a
+ * column boundary spills at most half a column into its neighbour. Leaves
+ * at the ends of the viewport are taken whole, so the edge columns may
+ * include a few rows just outside it.
+ *
+ * Rows are numbered from the last clear(); dropRowsBefore() forgets the
+ * buckets that lie entirely before a row (storage is compacted lazily).
+ */
+class HistoryPyramid
+{
+public:
+    static constexpr std::size_t BUCKET_ROWS = 64;
+    // Below this many rows per pixel column the caller should read the rows itself
+    static constexpr std::size_t MIN_ROWS_PER_PIXEL = 2 * BUCKET_ROWS;
+
+    explicit HistoryPyramid(std::size_t seriesCount);
+
+    // values holds one value per series
+    void append(double time, const double* values);
+    void clear();
+    void dropRowsBefore(std::uint64_t row);
+
+    std::size_t seriesCount() const { return m_seriesCount; }
+    std::uint64_t rowCount() const { return m_rowCount; }
+    std::size_t levelCount() const { return m_levels.size(); }
+    std::size_t memoryBytes() const;
+
+    // Appends the M4 envelope of one series over [tMin, tMax] at the given
+    // width to out as interleaved (time, value) pairs. Returns false, with out
+    // untouched, when the range holds fewer than MIN_ROWS_PER_PIXEL rows per
+    // column (or has been dropped).
+    bool envelope(std::size_t series, double tMin, double tMax, std::size_t pixels, std::vector<double>& out) const;
+
+    // M4 reduction of interleaved (time, value) points sorted by time
+    static void reduce(const double* points, std::size_t count,
+                       double tMin, double tMax, std::size_t pixels, std::vector<double>& out);
+
+private:
+    // Buckets of one level, `stride` doubles each. Bucket i is data[(i - firstIndex) * stride];
+    // those below retainedFrom are dropped and compacted away once they make up half the storage.
+    struct Level {
+        std::vector<double> data;
+        std::uint64_t firstIndex = 0;
+        std::uint64_t retainedFrom = 0;
+        std::uint64_t count = 0; // Complete buckets, counted from row 0
+
+        const double* bucket(std::uint64_t index, std::size_t stride) const
+        {
+            return data.data() + static_cast<std::size_t>(index - firstIndex) * stride;
+        }
+    };
+
+    // Leaf layout: first time, last time, then per series min, max, first, last
+    std::size_t leafStride() const { return 2 + 4 * m_seriesCount; }
+    // Upper levels: per series min, max
+    std::size_t nodeStride() const { return 2 * m_seriesCount; }
+
+    // Leaf `index`, including the one still filling
+    const double* leaf(std::uint64_t index) const;
+    std::uint64_t leafCount() const { return m_levels[0].count + (m_openRows > 0 ? 1 : 0); }
+    void completeLeaf();
+    static void compact(Level& level, std::size_t stride);
+
+    std::size_t m_seriesCount;
+    std::vector<Level> m_levels; // [0] = leaves
+    std::vector<double> m_open;  // Leaf being filled
+    std::size_t m_openRows = 0;
+    std::uint64_t m_rowCount = 0;
+};
+
+#endif // HISTORYPYRAMID_H
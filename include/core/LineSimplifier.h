@@ -0,0 +1,54 @@
+#ifndef LINESIMPLIFIER_H
+#define LINESIMPLIFIER_H
+
+#include <cstddef>
+#include <vector>
+
+/*
+ * @brief Ramer-Douglas-Peucker simplification of a polyline, in place.
+ *
+ * Points are interleaved (x, y) doubles. The kept points are moved to the
+ * front of the array, in their original order, and their count returned;
+ * the first and last points are always kept.
+ *
+ * simplify() keeps every point farther than epsilon from the chord of the
+ * segment it falls in. Segments are taken left to right, so each one is
+ * written out as soon as it needs no further split, and only the right
+ * ends of the pending segments are stacked. The stack has a fixed size:
+ * if a pathological curve would overflow it, the two rightmost pending
+ * segments are merged and searched again when reached. The result still
+ * keeps every segment within epsilon; it only costs some repeated work.
+ *
+ * simplifyToCount() keeps at most `target` points instead: it always splits
+ * the pending segment with the largest deviation next, so the points kept
+ * are the most significant ones whatever the scale of the data. Its scratch
+ * (one entry per kept point) lives in the object and is reused by later calls.
+ *
+ * The distance is to the line through the segment ends (to the first end
+ * when both coincide).
+ */
+class LineSimplifier
+{
+public:
+    static constexpr std::size_t STACK_DEPTH = 64;
+
+    static std::size_t simplify(double* points, std::size_t count, double epsilon);
+    std::size_t simplifyToCount(double* points, std::size_t count, std::size_t target);
+
+private:
+    struct Segment {
+        std::size_t first;
+        std::size_t last;
+        std::size_t farthest;
+        double distance;
+
+        bool operator<(const Segment& other) const { return distance < other.distance; }
+    };
+
+    static Segment measure(const double* points, std::size_t first, std::size_t last);
+
+    std::vector<Segment> m_segments; // Heap of the segments that can still be split
+    std::vector<std::size_t> m_kept;
+};
+
+#endif // LINESIMPLIFIER_H
@@ -0,0 +1,107 @@
+#ifndef LYAPUNOVESTIMATOR_H
+#define LYAPUNOVESTIMATOR_H
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "core/PendulumIntegrator.h"
+
+// 4x4 Jacobian of PendulumIntegrator::derivatives, row-major: J[i][j] = d f_i / d y_j
+using PendulumJacobian = std::array<std::array<double, 4>, 4>;
+
+struct LyapunovConfig {
+    double duration = 100.0;               // Simulated seconds, including the transient
+    double transient = 10.0;               // Seconds integrated before averaging starts
+    double renormalizationInterval = 0.5;  // Seconds between Gram-Schmidt renormalizations
+    int exponentCount = 1;                 // 1: lambda_max only, up to 4: full spectrum
+    std::size_t threadCount = 0;           // Sweeps: 0 = every hardware thread
+    PendulumIntegrator::ToleranceProfile tolerances; // Step-size controller, as for PendulumIntegrator
+};
+
+struct LyapunovResult {
+    std::array<double, 4> exponents{};     // 1/s, largest first; unused entries are 0
+    double time = 0.0;                     // Simulated time reached
+    std::uint32_t acceptedSteps = 0;
+    std::uint32_t rejectedSteps = 0;
+    bool failed = false;
+};
+
+/*
+ * @brief Lyapunov exponents from the variational equations of the pendulum.
+ *
+ * The state is integrated together with exponentCount tangent vectors
+ * v' = J(y) v in one extended Dormand-Prince 5(4) system, so every stage
+ * evaluates the right-hand side and its analytic Jacobian at the same point.
+ * Step-size control looks at the state components only, with the same
+ * ToleranceProfile rules as PendulumIntegrator: the tangent vectors ride
+ * along on the trajectory's steps instead of forcing their own.
+ *
+ * Every renormalizationInterval seconds the tangent vectors are
+ * re-orthonormalized (modified Gram-Schmidt); the logarithms of their
+ * stretch factors, averaged over the time since the transient, are the
+ * running exponent estimates.
+ */
+class LyapunovEstimator
+{
+public:
+    LyapunovEstimator(const PendulumParameters& parameters, const PendulumState& state,
+                      int exponentCount = 1, double renormalizationInterval = 0.5,
+                      const PendulumIntegrator::ToleranceProfile& tolerances = PendulumIntegrator::ToleranceProfile());
+
+    // Integrates until time() reaches t; false once the integration has failed
+    bool advanceTo(double t);
+    // Forgets the growth accumulated so far (end of the transient)
+    void restartAveraging();
+
+    double time() const { return m_time; }
+    const PendulumState& state() const { return m_state; }
+    int exponentCount() const { return m_exponentCount; }
+    bool failed() const { return m_failed; }
+    std::uint32_t acceptedSteps() const { return m_acceptedSteps; }
+    std::uint32_t rejectedSteps() const { return m_rejectedSteps; }
+
+    // Running estimate of exponent i (0 = largest) over the averaging window
+    double exponent(int i) const;
+    LyapunovResult result() const;
+
+    // Right-hand side and its Jacobian in one pass; same physics as PendulumIntegrator::derivatives
+    static void derivativesWithJacobian(const CompiledParameters& c, const PendulumState& y,
+                                        PendulumState& f, PendulumJacobian& jacobian);
+
+    // Full run for one parameter set: transient, then averaging until config.duration
+    static LyapunovResult estimate(const PendulumParameters& parameters, const PendulumState& state,
+                                   const LyapunovConfig& config);
+    // estimate() for every parameter set, spread across cores
+    static std::vector<LyapunovResult> sweep(const std::vector<PendulumParameters>& parameterSets,
+                                             const PendulumState& state, const LyapunovConfig& config);
+
+private:
+    static constexpr int MAX_DIMENSION = 4 + 4 * 4; // State plus four tangent vectors
+    using Extended = std::array<double, MAX_DIMENSION>;
+
+    void evaluate(const Extended& y, Extended& dy) const;
+    bool step(double maxStep);
+    void renormalize();
+
+    CompiledParameters m_compiled;
+    PendulumIntegrator::ToleranceProfile m_profile;
+    int m_exponentCount;
+    int m_dimension;
+    double m_renormalizationInterval;
+
+    Extended m_y{};        // State followed by the tangent vectors
+    Extended m_k0{};       // FSAL stage: derivative at m_y
+    PendulumState m_state{};
+    double m_time = 0.0;
+    double m_nextStep = PendulumIntegrator::INITIAL_STEP;
+    double m_nextRenormalization = 0.0;
+    bool m_failed = false;
+
+    std::array<double, 4> m_logGrowth{}; // Sum of log stretch factors per tangent vector
+    double m_averagingStart = 0.0;
+    std::uint32_t m_acceptedSteps = 0;
+    std::uint32_t m_rejectedSteps = 0;
+};
+
+#endif // LYAPUNOVESTIMATOR_H
@@ -0,0 +1,285 @@
+#ifndef PENDULUMINTEGRATOR_H
+#define PENDULUMINTEGRATOR_H
+
+#include <array>
+#include <cstdint>
+
+// Physical parameters of the double pendulum
+struct PendulumParameters {
+    double m1 = 1.0, m2 = 1.0;             // Point masses at the ends of rods
+    double rodMass1 = 0.5, rodMass2 = 0.5; // Rod masses
+    double l1 = 1.0, l2 = 1.0;             // Rod lengths
+    double b1 = 0.0, b2 = 0.0;             // Linear friction coefficients
+    double c1 = 0.0, c2 = 0.0;             // Quadratic air resistance coefficients
+    double g = 9.81;                       // Gravity acceleration
+};
+
+// Integrator state {theta1_abs, omega1_abs, theta2_rel, omega2_rel}.
+// A fixed-size array keeps the whole DP5 path on the stack.
+using PendulumState = std::array<double, 4>;
+
+// Non-conservative terms present in a parameter set; selects the right-hand side kernel
+enum class FrictionModel {
+    None,   // b = c = 0: conservative
+    Linear, // Only linear friction (c = 0)
+    Full    // Linear friction and quadratic air resistance
+};
+
+/*
+ * @brief Parameter-only terms of the equations of motion.
+ *
+ * The mass-matrix and gravity coefficients change only when a parameter
+ * does, so they are folded once per parameter set instead of once per
+ * right-hand side evaluation.
+ */
+struct CompiledParameters {
+    double a11 = 0.0;      // (m1 + rod1/3 + m2 + rod2) l1^2
+    double a22 = 0.0;      // (m2 + rod2/3) l2^2
+    double coupling = 0.0; // (m2 + rod2/2) l1 l2; the off-diagonal mass term is coupling * cos(theta1 - theta2)
+    double gravity1 = 0.0; // g (m1 + rod1/2 + m2 + rod2) l1
+    double gravity2 = 0.0; // g (m2 + rod2/2) l2
+    double b1 = 0.0, b2 = 0.0, c1 = 0.0, c2 = 0.0;
+    FrictionModel friction = FrictionModel::None;
+
+    static CompiledParameters compile(const PendulumParameters& p);
+};
+
+/*
+ * @brief Dormand-Prince 5(4) Butcher tableau.
+ *
+ * The one copy of the coefficients, shared by every DP5 stepper in the core:
+ * PendulumIntegrator, the variational system of LyapunovEstimator and the
+ * lane-parallel batch kernel.
+ */
+struct DormandPrince5Tableau {
+    static constexpr double C2=1./5., C3=3./10., C4=4./5., C5=8./9., C6=1., C7=1.;
+
+    static constexpr double A21=1./5., A31=3./40., A32=9./40.,
+                            A41=44./45., A42=-56./15., A43=32./9.,
+                            A51=19372./6561., A52=-25360./2187., A53=64448./6561., A54=-212./729.,
+                            A61=9017./3168., A62=-355./33., A63=46732./5247., A64=49./176., A65=-5103./18656.,
+                            A71=35./384., A73=500./1113., A74=125./192., A75=-2187./6784., A76=11./84.;
+
+    // Coefficients for the 5th order solution (y_{n+1})
+    static constexpr double B1=35./384., B2=0., B3=500./1113., B4=125./192., B5=-2187./6784., B6=11./84., B7=0.;
+
+    // Coefficients of the error estimate (5th minus embedded 4th order solution)
+    static constexpr double E1=71./57600., E2=0., E3=-71./16695., E4=71./1920., E5=-17253./339200., E6=22./525., E7=-1./40.;
+
+    // Dense output coefficients (Hairer, Norsett & Wanner, DOPRI5 continuous extension)
+    static constexpr double D1=-12715105075./11282082432., D3=87487479700./32700410799.,
+                            D4=-10690763975./1880347072., D5=701980252875./199316789632.,
+                            D6=-1453857185./822651844., D7=69997945./29380423.;
+};
+
+struct PendulumEnergies {
+    double kinetic = 0.0;
+    double potential = 0.0;
+    double total = 0.0;
+};
+
+/*
+ * @brief Integrator for the double pendulum with a selectable stepping scheme.
+ *
+ * Plain C++ with no Qt dependency: it owns the parameters, the current state,
+ * the simulation time and the step-size controller, so it can run on any
+ * thread. Callers drive it one step at a time with tryStep().
+ *
+ * The default scheme is adaptive Dormand-Prince 5(4); its 8th-order sibling
+ * DOP853 takes far longer steps at tight tolerances and is meant for
+ * near-machine-precision reference runs. The Gauss-Legendre
+ * collocation methods are symplectic: they step the canonical variables
+ * (absolute angles, conjugate momenta) at a fixed step size, so for a
+ * frictionless pendulum the energy error stays bounded over arbitrarily long
+ * runs instead of drifting, at steps far larger than DP5 needs for the same
+ * energy accuracy. Every scheme provides dense output over its last step.
+ */
+class PendulumIntegrator
+{
+public:
+    enum class StepResult {
+        Accepted, // State and time advanced
+        Rejected, // Error too large; step size reduced, state unchanged
+        Failed    // Non-finite state or no acceptable step above the minimum step
+    };
+
+    enum class Method {
+        DormandPrince5,   // Adaptive explicit 5(4), tolerances from the ToleranceProfile
+        DormandPrince853, // Adaptive explicit 8(5,3), same controller settings
+        ImplicitMidpoint, // Gauss-Legendre with 1 stage, order 2, fixed step
+        GaussLegendre4,   // 2 stages, order 4, fixed step
+        GaussLegendre6,   // 3 stages, order 6, fixed step
+        Automatic         // GaussLegendre4 without friction, DormandPrince5 with it
+    };
+
+    PendulumIntegrator(const PendulumParameters& parameters, const PendulumState& state);
+
+    Method method() const { return m_method; }
+    void setMethod(Method method);
+    // Scheme the next step will use (resolves Automatic for the current parameters)
+    Method activeMethod() const;
+    bool usesFixedStep() const;
+    // Step of the fixed-step schemes. When their stage iteration fails to converge the
+    // step is retried at half the size (each retry is a rejected step and counted in
+    // collocationRetries()); the step after it is back at this size.
+    double fixedStepSize() const { return m_fixedStepSize; }
+    void setFixedStepSize(double step);
+    static const char* methodName(Method method);
+
+    const PendulumParameters& parameters() const { return m_parameters; }
+    const CompiledParameters& compiledParameters() const { return m_compiled; }
+    void setParameters(const PendulumParameters& parameters);
+
+    // Restarts the integration from the given state and time
+    void reset(const PendulumState& state, double time = 0.0);
+    // Replaces the state without touching the simulation time
+    void setState(const PendulumState& state);
+
+    // Step-size controller settings of the adaptive schemes; see ToleranceProfile below
+    struct ToleranceProfile;
+    const ToleranceProfile& toleranceProfile() const;
+    void setToleranceProfile(const ToleranceProfile& profile);
+    // Upper bound for the controller's step (DOPRI_HMAX by default). Dense output
+    // and event location keep samples and section crossings exact at any step size.
+    double maxStepSize() const;
+    void setMaxStepSize(double maxStep);
+
+    const PendulumState& state() const { return m_state; }
+    double time() const { return m_time; }
+    double lastStepSize() const { return m_lastStepSize; }
+    bool failed() const { return m_failed; }
+
+    // Attempts a single adaptive step no longer than maxStep
+    StepResult tryStep(double maxStep);
+
+    // Dense output: the continuous extension of the last accepted step, valid for
+    // t in [denseStartTime(), time()]. 4th order for DP5 and free; 7th order for
+    // DOP853, whose three extra stages are evaluated on the first call per step;
+    // cubic Hermite for the Gauss-Legendre schemes.
+    bool hasDenseOutput() const { return m_denseValid; }
+    double denseStartTime() const { return m_time - m_lastStepSize; }
+    PendulumState interpolate(double t) const;
+
+    PendulumEnergies energies() const { return energies(m_parameters, m_state); }
+    // Counters since construction: right-hand side evaluations (in either
+    // coordinate system) and step attempts
+    std::uint64_t rhsEvaluations() const { return m_rhsEvaluations; }
+    std::uint64_t acceptedSteps() const { return m_acceptedSteps; }
+    std::uint64_t rejectedSteps() const { return m_rejectedSteps; }
+    // Fixed-step attempts retried at a smaller step because the stage iteration diverged
+    std::uint64_t collocationRetries() const { return m_collocationRetries; }
+
+    // Right-hand side of the equations of motion. The PendulumParameters overload
+    // compiles the parameters on every call; prefer the compiled one in loops.
+    static PendulumState derivatives(const PendulumParameters& p, const PendulumState& y);
+    static PendulumState derivatives(const CompiledParameters& c, const PendulumState& y);
+    static PendulumEnergies energies(const PendulumParameters& p, const PendulumState& y);
+
+    // Dormand-Prince parameters of the "reference" profile, the default - tight for energy conservation
+    static constexpr double DOPRI_ATOL = 1.0e-14;    // Absolute tolerance
+    static constexpr double DOPRI_RTOL = 1.0e-13;    // Relative tolerance
+    static constexpr double DOPRI_HMIN = 1.0e-8;     // Minimum step size
+    static constexpr double DOPRI_HMAX = 0.005;      // Maximum step size, reduced for smoother plotting
+    static constexpr double DOPRI_SAFETY_FACTOR = 0.9; // Safety factor for step size selection
+    static constexpr double DOPRI_FAC_MIN = 0.2;      // Minimum factor for step size changes
+    static constexpr double DOPRI_FAC_MAX = 5.0;      // Maximum factor for step size changes
+    static constexpr double INITIAL_STEP = 0.001;     // Step tried after a reset
+    static constexpr double DEFAULT_FIXED_STEP = 0.01; // Gauss-Legendre step, s
+
+    /*
+     * @brief Accuracy/throughput trade-off of the adaptive controller.
+     *
+     * Defaults are the "reference" preset. "analysis" loosens the tolerances
+     * to roughly what plots and Poincare maps can resolve; "realtime" goes
+     * further and relies on dense output for smooth history.
+     */
+    struct ToleranceProfile {
+        double absoluteTolerance = DOPRI_ATOL;
+        double relativeTolerance = DOPRI_RTOL;
+        double minStep = DOPRI_HMIN;
+        double maxStep = DOPRI_HMAX;
+        double safetyFactor = DOPRI_SAFETY_FACTOR;
+        double minFactor = DOPRI_FAC_MIN; // Bounds of the step change per attempt
+        double maxFactor = DOPRI_FAC_MAX;
+
+        static ToleranceProfile realtime();
+        static ToleranceProfile analysis();
+        static ToleranceProfile reference() { return ToleranceProfile(); }
+        // Step to try after an attempt of size h with weighted RMS error errNorm:
+        // safetyFactor * h * errNorm^exponent (exponent -1/(order + 1) of the error
+        // estimate), bounded by the change factors and by [minStep, maxStep]
+        double proposeStep(double h, double errNorm, double exponent) const;
+        // This profile with minStep at least 1e-15 and maxStep at least minStep
+        ToleranceProfile bounded() const;
+        // "realtime", "analysis" or "reference"; false for any other name
+        static bool fromName(const char* name, ToleranceProfile& profile);
+        // Name of the preset equal to this profile, or "custom"
+        const char* name() const;
+        bool operator==(const ToleranceProfile& other) const;
+    };
+
+private:
+    // One attempt of the active adaptive scheme for the current friction model
+    void performAdaptiveStep(double& hInOut, PendulumState& yNext, bool& stepAccepted);
+
+    // Dormand-Prince 5(4) method for adaptive step size integration; the
+    // friction model is fixed per step so every stage calls the same kernel
+    template <FrictionModel F>
+    void performOneDormandPrinceStep(
+        const PendulumState& yCurrent,       // Input state {th1, o1, th2, o2}
+        double& hInOut,                      // Input: proposed step; Output: suggested step for next attempt/step
+        PendulumState& yNext,                // Output: state after successful step
+        bool& stepAccepted                   // Output: true if step was accepted, false otherwise
+    );
+
+    // Dormand-Prince 8(5,3), same contract as performOneDormandPrinceStep
+    template <FrictionModel F>
+    void performOneDop853Step(const PendulumState& yCurrent, double& hInOut, PendulumState& yNext, bool& stepAccepted);
+    // Evaluates the three dense-output stages of the last DOP853 step and finishes its interpolant
+    void completeDop853DenseOutput() const;
+
+    // One fixed step of the active Gauss-Legendre scheme
+    StepResult tryCollocationStep(double maxStep);
+    // Cubic Hermite interpolant through both ends of the last step
+    void setHermiteDenseOutput(const PendulumState& y0, const PendulumState& f0,
+                               const PendulumState& y1, const PendulumState& f1, double h);
+
+    PendulumParameters m_parameters;
+    CompiledParameters m_compiled; // Rebuilt by setParameters()
+    PendulumState m_state;
+    Method m_method = Method::DormandPrince5;
+    double m_fixedStepSize = DEFAULT_FIXED_STEP;
+    double m_retryStepSize = 0.0; // Reduced size for retrying the current fixed step; 0 = none
+    std::uint64_t m_collocationRetries = 0;
+    mutable std::uint64_t m_rhsEvaluations = 0; // Also counts lazily evaluated dense-output stages
+    double m_time = 0.0;
+    double m_nextStepSize = INITIAL_STEP; // Step proposed by the controller
+    double m_lastStepSize = 0.0;          // Size of the last accepted step
+    ToleranceProfile m_profile;
+    std::uint64_t m_acceptedSteps = 0;
+    std::uint64_t m_rejectedSteps = 0;
+    bool m_failed = false;
+
+    // FSAL (First Same As Last): the last stage of an accepted step is the
+    // derivative at the new state, so it is reused as the next first stage.
+    bool m_fsalReady = false;
+    PendulumState m_fsalK{};
+
+    // Interpolation polynomial of the last accepted step, built from its stages:
+    // y(theta) = d0 + theta (d1 + (1 - theta) (d2 + theta (d3 + (1 - theta) (d4 + ...))))
+    bool m_denseValid = false;
+    mutable bool m_densePending = false; // DOP853 rows d4..d7 not built yet
+    mutable std::array<PendulumState, 8> m_dense{};
+    // Stages of the last DOP853 step, plus the three dense-output stages once evaluated
+    mutable std::array<PendulumState, 16> m_dop853Stages{};
+};
+
+inline const PendulumIntegrator::ToleranceProfile& PendulumIntegrator::toleranceProfile() const { return m_profile; }
+inline double PendulumIntegrator::maxStepSize() const { return m_profile.maxStep; }
+inline bool PendulumIntegrator::usesFixedStep() const
+{
+    const Method method = activeMethod();
+    return method != Method::DormandPrince5 && method != Method::DormandPrince853;
+}
+
+#endif // PENDULUMINTEGRATOR_H
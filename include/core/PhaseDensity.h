@@ -0,0 +1,102 @@
+#ifndef PHASEDENSITY_H
+#define PHASEDENSITY_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/*
+ * @brief Hit-count raster of a phase-space trajectory.
+ *
+ * Samples (x, y) are binned into a width x height grid of counters, and the
+ * cells between consecutive samples are counted too, so a sparse stretch of
+ * the trajectory stays a continuous line. Adding a sample costs O(1) plus the
+ * cells its segment crosses; drawing the portrait costs O(width * height)
+ * however long the trajectory is.
+ *
+ * The grid range is not known in advance. The first PENDING_SAMPLES samples
+ * are held back and fix it to their bounding box plus a margin; a later
+ * sample outside the grid doubles its extent on that axis, merging pairs of
+ * cells, which is exact, so nothing already counted has to be binned again.
+ * The new extent is centred on the samples, but repeated growth can leave
+ * them a quarter of an axis; sparse() reports that, and a caller that still
+ * has the samples can bin them again on a grid fixed by fitTo().
+ *
+ * Cell (col, row) covers x from xMin() + col * cellWidth and y from
+ * yMin() + row * cellHeight: row 0 is at the bottom.
+ */
+class PhaseDensity
+{
+public:
+    static constexpr std::size_t PENDING_SAMPLES = 64;
+
+    PhaseDensity() = default;
+
+    // Clears the counts; sizes are rounded up to even, at least 2
+    void reset(std::size_t width, std::size_t height);
+
+    void add(double x, double y);
+    // The next sample starts a new stroke
+    void breakStroke() { m_hasLast = false; }
+    // Fixes the grid range from the held-back samples, if any
+    void settle();
+    // Fixes the grid range to a known bounding box (plus the margin) before
+    // the first sample, for a rebuild from samples seen before
+    void fitTo(double xMin, double xMax, double yMin, double yMax);
+
+    std::size_t width() const { return m_width; }
+    std::size_t height() const { return m_height; }
+    std::uint64_t sampleCount() const { return m_samples; }
+    bool empty() const { return m_samples == 0; }
+    bool hasGrid() const { return m_hasGrid; }
+
+    const std::uint32_t* counts() const { return m_counts.data(); }
+    std::uint32_t maxCount() const { return m_maxCount; }
+
+    // Grid extent (valid once hasGrid())
+    double xMin() const { return m_xMin; }
+    double xMax() const { return m_xMin + m_cellWidth * static_cast<double>(m_width); }
+    double yMin() const { return m_yMin; }
+    double yMax() const { return m_yMin + m_cellHeight * static_cast<double>(m_height); }
+
+    // Whether an axis has doubled since the grid was fixed and the samples now
+    // span less than half of it (a fitted grid gives them about 0.77 of each axis)
+    bool sparse() const;
+
+    // Bounding box of the samples
+    double dataXMin() const { return m_dataXMin; }
+    double dataXMax() const { return m_dataXMax; }
+    double dataYMin() const { return m_dataYMin; }
+    double dataYMax() const { return m_dataYMax; }
+
+private:
+    void bin(double x, double y);
+    void grow(double x, double y);
+    void increment(std::size_t col, std::size_t row);
+    long long colOf(double x) const;
+    long long rowOf(double y) const;
+
+    std::size_t m_width = 0;
+    std::size_t m_height = 0;
+    std::vector<std::uint32_t> m_counts;
+    std::uint32_t m_maxCount = 0;
+    std::uint64_t m_samples = 0;
+
+    bool m_hasGrid = false;
+    double m_xMin = 0.0;
+    double m_yMin = 0.0;
+    double m_cellWidth = 1.0;
+    double m_cellHeight = 1.0;
+    bool m_xGrown = false; // Doubled since the grid was fixed
+    bool m_yGrown = false;
+
+    double m_dataXMin = 0.0, m_dataXMax = 0.0;
+    double m_dataYMin = 0.0, m_dataYMax = 0.0;
+
+    std::vector<double> m_pending; // Interleaved samples held back until the grid is fixed
+    bool m_hasLast = false;
+    long long m_lastCol = 0;
+    long long m_lastRow = 0;
+};
+
+#endif // PHASEDENSITY_H
@@ -0,0 +1,85 @@
+#ifndef POINCARESECTION_H
+#define POINCARESECTION_H
+
+#include <array>
+#include <cstddef>
+#include "core/PendulumIntegrator.h"
+
+/*
+ * @brief Surface of section g(y) = 0 in the pendulum's state space.
+ *
+ * Angle sections are taken modulo 2*pi on the lower half of the circle:
+ * g = sin(theta - level), counted only where cos(theta - level) > 0. A rod
+ * that has turned over several times therefore keeps crossing the same
+ * physical ray, and the sign flip of g through the upright position is not
+ * mistaken for a crossing.
+ */
+struct PoincareSection {
+    enum class Kind {
+        Theta1, // Absolute angle of rod 1 equals level
+        Theta2, // Absolute angle of rod 2 equals level
+        Omega1, // Angular velocity of rod 1 equals level (turning points for level 0)
+        Energy  // Total mechanical energy equals level, J (meaningful with friction)
+    };
+    enum class Direction {
+        Increasing, // g goes from negative to non-negative
+        Decreasing,
+        Both
+    };
+
+    Kind kind = Kind::Theta1;
+    double level = 0.0;
+    Direction direction = Direction::Increasing;
+
+    // Section function; crossings are its sign changes in the chosen direction
+    double value(const PendulumParameters& p, const PendulumState& y) const;
+    // Whether a zero of value() at y lies on the counted branch of the section
+    bool admissible(const PendulumState& y) const;
+    // Point plotted on the map: angles wrapped to (-pi, pi]. Theta2 sections give
+    // (theta1, omega1), every other section (theta2_rel, omega2_rel).
+    std::array<double, 2> mapCoordinates(const PendulumState& y) const;
+};
+
+// One located crossing: the interpolated state at the exact crossing time
+struct PoincareCrossing {
+    double time = 0.0;
+    PendulumState state{};
+};
+
+/*
+ * @brief Finds section crossings on the integrator's dense output.
+ *
+ * After every accepted step the section function is sampled at a few points
+ * of the step's interpolant; each bracketed sign change is then refined by
+ * the Illinois variant of regula falsi on the same polynomial. No extra
+ * right-hand side evaluations are needed and the crossing is located to the
+ * interpolant's accuracy whatever the step size, so the maximum step no
+ * longer has to be kept small for the map's sake.
+ *
+ * The check is stateless: both ends of the bracket come from the last step
+ * itself, and a zero exactly at a step boundary belongs to the step that
+ * ends there.
+ */
+class PoincareEventLocator
+{
+public:
+    // Sign checks per step; also the most crossings one step can report
+    static constexpr std::size_t SUBDIVISIONS = 4;
+    using Crossings = std::array<PoincareCrossing, SUBDIVISIONS>;
+
+    explicit PoincareEventLocator(const PoincareSection& section = PoincareSection());
+
+    const PoincareSection& section() const { return m_section; }
+    void setSection(const PoincareSection& section) { m_section = section; }
+
+    // Crossings inside the step the integrator accepted last, in time order
+    std::size_t locate(const PendulumIntegrator& integrator, Crossings& crossings) const;
+
+private:
+    bool crosses(double gA, double gB) const;
+    double refine(const PendulumIntegrator& integrator, double tA, double gA, double tB, double gB) const;
+
+    PoincareSection m_section;
+};
+
+#endif // POINCARESECTION_H
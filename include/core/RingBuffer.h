@@ -0,0 +1,121 @@
+#ifndef RINGBUFFER_H
+#define RINGBUFFER_H
+
+#include <algorithm>
+#include <cstddef>
+#include <utility>
+#include <vector>
+
+/*
+ * @brief Fixed-capacity circular buffer for history and trace data.
+ *
+ * Appending is O(1). Once the buffer is full, every append overwrites the
+ * oldest element instead of shifting the whole storage (as QVector::removeFirst
+ * does). Storage grows lazily up to the capacity, so an unused buffer costs
+ * nothing.
+ *
+ * Elements are addressed by logical index: 0 is the oldest element and
+ * size() - 1 is the newest. Readers that want raw memory can request
+ * contiguous spans; because of the wrap-around a logical range is split into
+ * at most two spans.
+ */
+template <typename T>
+class RingBuffer
+{
+public:
+    // Read-only view over a contiguous run of stored elements
+    struct Span {
+        const T* data = nullptr;
+        std::size_t size = 0;
+
+        const T* begin() const { return data; }
+        const T* end() const { return data + size; }
+        bool empty() const { return size == 0; }
+        const T& operator[](std::size_t i) const { return data[i]; }
+    };
+
+    // A logical range split at the wrap-around point: first, then second
+    using SpanPair = std::pair<Span, Span>;
+
+    explicit RingBuffer(std::size_t capacity)
+        : m_capacity(capacity > 0 ? capacity : 1)
+    {
+    }
+
+    std::size_t capacity() const { return m_capacity; }
+    std::size_t size() const { return m_storage.size(); }
+    bool empty() const { return m_storage.empty(); }
+    bool isFull() const { return m_storage.size() == m_capacity; }
+
+    // Appends a value, evicting the oldest element if the buffer is full
+    void push_back(const T& value)
+    {
+        if (m_storage.size() < m_capacity) {
+            m_storage.push_back(value);
+            return;
+        }
+        m_storage[m_head] = value;
+        m_head = (m_head + 1 == m_capacity) ? 0 : m_head + 1;
+    }
+
+    void append(const T& value) { push_back(value); }
+
+    // Removes all elements; allocated storage is kept for reuse
+    void clear()
+    {
+        m_storage.clear();
+        m_head = 0;
+    }
+
+    const T& operator[](std::size_t i) const { return m_storage[physicalIndex(i)]; }
+    T& operator[](std::size_t i) { return m_storage[physicalIndex(i)]; }
+
+    const T& front() const { return (*this)[0]; }
+    const T& back() const { return (*this)[m_storage.size() - 1]; }
+
+    // Returns the logical range [first, first + count) as up to two contiguous spans.
+    // The second span is empty unless the range crosses the wrap-around point.
+    SpanPair spans(std::size_t first, std::size_t count) const
+    {
+        const std::size_t n = m_storage.size();
+        if (first >= n || count == 0) {
+            return {};
+        }
+        count = std::min(count, n - first);
+
+        const std::size_t start = physicalIndex(first);
+        const std::size_t firstRun = std::min(count, n - start);
+        SpanPair result;
+        result.first = Span{m_storage.data() + start, firstRun};
+        if (firstRun < count) {
+            result.second = Span{m_storage.data(), count - firstRun};
+        }
+        return result;
+    }
+
+    SpanPair spans() const { return spans(0, m_storage.size()); }
+
+    // Copies the logical range [first, first + count) to the end of any container with push_back/reserve
+    template <typename Container>
+    void copyTo(Container& out, std::size_t first = 0, std::size_t count = static_cast<std::size_t>(-1)) const
+    {
+        const SpanPair parts = spans(first, count);
+        out.reserve(out.size() + parts.first.size + parts.second.size);
+        for (const T& v : parts.first) out.push_back(v);
+        for (const T& v : parts.second) out.push_back(v);
+    }
+
+private:
+    std::size_t physicalIndex(std::size_t logical) const
+    {
+        // m_head is non-zero only once the buffer is full, i.e. size == capacity
+        const std::size_t idx = m_head + logical;
+        return idx >= m_capacity ? idx - m_capacity : idx;
+    }
+
+    std::vector<T> m_storage;
+    std::size_t m_capacity;
+    std::size_t m_head = 0; // Physical index of the oldest element
+};
+
+#endif // RINGBUFFER_H
@@ -0,0 +1,250 @@
+#ifndef SIMULATIONENGINE_H
+#define SIMULATIONENGINE_H
+
+#include <QObject>
+#include <QThread>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include "core/PendulumIntegrator.h"
+#include "core/PoincareSection.h"
+#include "core/SpscQueue.h"
+#include "core/TripleBuffer.h"
+
+// One history sample, streamed to the GUI thread for history/traces: either an
+// accepted integration step or, with a sample rate set, one point of a fixed time grid
+struct SimulationSample {
+    double time = 0.0;
+    PendulumState state{};
+    PendulumEnergies energies;
+    std::uint32_t epoch = 0;       // Reset generation the sample belongs to
+};
+
+// A Poincare section crossing located inside an accepted step
+struct SimulationCrossing {
+    PoincareCrossing crossing;
+    std::uint32_t epoch = 0;       // Reset generation the crossing belongs to
+    std::uint32_t section = 0;     // Section generation (see setPoincareSection())
+};
+
+// Latest integrator state, readable at any moment without blocking the worker
+struct SimulationSnapshot {
+    double time = 0.0;
+    PendulumState state{};
+    PendulumEnergies energies;
+    double lastStepSize = 0.0;
+    std::uint64_t acceptedSteps = 0; // Integrator step counters, for rejection and mean-step readouts
+    std::uint64_t rejectedSteps = 0;
+    bool failed = false;
+    std::uint32_t epoch = 0;
+    // The last two physics step boundaries (see setFixedTimestep()), for drawing
+    // the state between them; without a fixed timestep a tick is one step
+    double stepTime = 0.0;
+    PendulumState stepState{};
+    double previousStepTime = 0.0;
+    PendulumState previousStepState{};
+    // Real-time pacing
+    double timeDebt = 0.0;           // Simulated time owed to the clock; clockTime = time + timeDebt
+    double droppedTime = 0.0;        // Simulated time given up since the last reset, see MAX_LAG_SECONDS
+    double tickLoad = 0.0;           // Share of the last tick spent integrating
+    std::uint64_t overrunTicks = 0;  // Ticks cut short by the integration deadline, since the last reset
+};
+
+/*
+ * @brief Runs the pendulum integrator on a dedicated thread.
+ *
+ * The worker thread owns a PendulumIntegrator and advances it in a fixed
+ * real-time pacing loop: every PACING_PERIOD_MS it integrates the wall-clock
+ * time elapsed since the previous tick, scaled by the simulation speed.
+ * Results leave the thread through two lock-free channels:
+ *  - history samples go into a single-producer/single-consumer queue, which
+ *    the GUI thread drains into the history store. By default every accepted
+ *    step is one sample; with a sample rate set, samples sit on a fixed
+ *    simulated-time grid and are read off the integrator's dense output, so
+ *    the history density no longer depends on the step size;
+ *  - Poincare section crossings, located exactly on the same dense output,
+ *    go into a second queue;
+ *  - the newest state is published through a triple buffer, so readers get
+ *    the latest snapshot without ever blocking the integrator.
+ *
+ * With a fixed timestep the owed time is paid in whole physics steps of that
+ * length (the adaptive schemes take as many substeps as they need inside
+ * one); the remainder waits for the next tick, and the snapshot carries the
+ * last two step boundaries so the GUI can draw the state in between. When
+ * the integrator cannot keep up, at most MAX_LAG_SECONDS of wall time is
+ * owed: the rest is given up and counted in droppedTime rather than making
+ * the simulation fall ever further behind.
+ *
+ * All control methods are called from the GUI thread. They only record a
+ * pending command, which the worker applies at the start of its next tick.
+ */
+class SimulationEngine : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit SimulationEngine(const PendulumParameters& parameters,
+                              const PendulumState& state,
+                              QObject* parent = nullptr);
+    ~SimulationEngine() override;
+
+    void start();
+    void stop();
+
+    // --- Control (GUI thread) ---
+    void setRunning(bool running);
+    bool isRunning() const { return m_running.load(std::memory_order_relaxed); }
+    void setHeld(bool held); // Manual dragging: freeze the integrator
+    void setSimulationSpeed(double speed);
+    // Length of a physics step in simulated seconds; 0 integrates to the clock every tick
+    void setFixedTimestep(double seconds);
+    double fixedTimestep() const { return m_fixedTimestep.load(std::memory_order_relaxed); }
+    // History samples per simulated second; 0 records every accepted step
+    void setSampleRate(double hz);
+    double sampleRate() const { return m_sampleRate.load(std::memory_order_relaxed); }
+    void setParameters(const PendulumParameters& parameters);
+    // Restarts from the given state; samples produced before the call are discarded
+    void reset(const PendulumState& state, double time = 0.0);
+    // Replaces the state but keeps the simulation time and history
+    void setState(const PendulumState& state);
+    // Integrates a fixed amount of simulated time while paused (single step)
+    void requestAdvance(double simulatedSeconds);
+    // Section whose crossings are reported; crossings of the previous one are discarded
+    void setPoincareSection(const PoincareSection& section);
+    // Stepping scheme; takes effect at the worker's next tick
+    void setIntegratorMethod(PendulumIntegrator::Method method);
+    // Step-size controller settings of the adaptive schemes; take effect at the worker's next tick
+    void setToleranceProfile(const PendulumIntegrator::ToleranceProfile& profile);
+
+    // --- Output (GUI thread) ---
+    const SimulationSnapshot& latestSnapshot() { return m_snapshot.latest(); }
+    std::uint32_t currentEpoch() const { return m_epoch.load(std::memory_order_acquire); }
+
+    // Pops every queued sample of the current epoch and hands it to fn
+    template <typename Fn>
+    std::size_t drainSamples(Fn&& fn)
+    {
+        const std::uint32_t epoch = currentEpoch();
+        std::size_t count = 0;
+        SimulationSample sample;
+        while (m_samples.tryPop(sample)) {
+            if (sample.epoch != epoch) continue; // Produced before the last reset
+            fn(sample);
+            ++count;
+        }
+        return count;
+    }
+
+    // Pops every queued crossing of the current epoch and section and hands it to fn
+    template <typename Fn>
+    std::size_t drainCrossings(Fn&& fn)
+    {
+        const std::uint32_t epoch = currentEpoch();
+        const std::uint32_t section = m_sectionGeneration.load(std::memory_order_acquire);
+        std::size_t count = 0;
+        SimulationCrossing crossing;
+        while (m_crossings.tryPop(crossing)) {
+            if (crossing.epoch != epoch || crossing.section != section) continue;
+            fn(crossing.crossing);
+            ++count;
+        }
+        return count;
+    }
+
+signals:
+    // Emitted from the worker thread once a requestAdvance() budget is consumed
+    void advanceFinished();
+
+private:
+    struct PendingCommands {
+        bool hasParameters = false;
+        PendulumParameters parameters;
+        bool hasReset = false;
+        PendulumState resetState{};
+        double resetTime = 0.0;
+        bool hasState = false;
+        PendulumState state{};
+        double advance = 0.0;
+        bool hasMethod = false;
+        PendulumIntegrator::Method method = PendulumIntegrator::Method::DormandPrince5;
+        bool hasProfile = false;
+        PendulumIntegrator::ToleranceProfile profile;
+        bool hasSection = false;
+        PoincareSection section;
+        std::uint32_t sectionGeneration = 0;
+    };
+
+    void run();
+    void applyPendingCommands();
+    // Pays up to `debt` of real-time debt, in whole physics steps with a fixed timestep;
+    // returns the time actually advanced
+    double advanceClock(double debt, std::chrono::steady_clock::time_point deadline);
+    // Integrates up to budget simulated seconds; returns the time actually advanced
+    double integrate(double budget, std::chrono::steady_clock::time_point deadline);
+    // The integrator has reached a physics step boundary
+    void markStepBoundary();
+    // Both step boundaries at the integrator's state (reset, state edit)
+    void restartStepBoundaries();
+    // Queues the samples owed by the step just accepted
+    void recordStep();
+    void pushSample(double time, const PendulumState& state, const PendulumEnergies& energies);
+    void locateCrossings();
+    void restartSampleGrid();
+    void publishSnapshot();
+    void wake();
+
+    static constexpr int PACING_PERIOD_MS = 4;             // Worker tick, 250 Hz
+    // Wall time the simulation may fall behind the clock before owed time is dropped
+    static constexpr double MAX_LAG_SECONDS = 0.25;
+    static constexpr std::size_t SAMPLE_QUEUE_CAPACITY = 1 << 16;
+    // Free queue space required before a step. A Gauss-Legendre step (DEFAULT_FIXED_STEP)
+    // spans at most 100 grid samples at MAX_SAMPLE_RATE_HZ; adaptive steps are capped
+    // at SAMPLE_QUEUE_HEADROOM grid intervals, whatever the tolerance profile allows
+    static constexpr double MAX_SAMPLE_RATE_HZ = 10000.0;
+    static constexpr std::size_t SAMPLE_QUEUE_HEADROOM = 128;
+    static constexpr std::size_t CROSSING_QUEUE_CAPACITY = 1 << 12;
+
+    // Worker-owned state
+    PendulumIntegrator m_integrator;
+    double m_timeDebt = 0.0;   // Simulated time owed to the real-time clock
+    double m_advanceDebt = 0.0; // Simulated time owed to requestAdvance()
+    double m_stepRemaining = 0.0; // Rest of a fixed physics step cut short by the deadline
+    double m_stepTime = 0.0;
+    PendulumState m_stepState{};
+    double m_previousStepTime = 0.0;
+    PendulumState m_previousStepState{};
+    double m_droppedTime = 0.0;
+    double m_tickLoad = 0.0;
+    std::uint64_t m_overrunTicks = 0;
+    bool m_deadlineHit = false;      // Set by integrate() when it runs out of time
+    PoincareEventLocator m_locator;
+    std::uint32_t m_workerSection = 0;
+    std::uint32_t m_workerEpoch = 0;
+    double m_gridRate = 0.0;         // Rate the sample grid below was laid out for
+    long long m_nextSampleIndex = 0; // Next grid sample is at m_nextSampleIndex / m_gridRate
+
+    // Channels to the GUI thread
+    SpscQueue<SimulationSample> m_samples{SAMPLE_QUEUE_CAPACITY};
+    SpscQueue<SimulationCrossing> m_crossings{CROSSING_QUEUE_CAPACITY};
+    TripleBuffer<SimulationSnapshot> m_snapshot;
+
+    // Commands from the GUI thread
+    std::mutex m_commandMutex;
+    std::condition_variable m_wakeCondition;
+    PendingCommands m_pending;
+    std::atomic<bool> m_hasPending{false};
+    std::atomic<bool> m_running{false};
+    std::atomic<bool> m_held{false};
+    std::atomic<double> m_speed{1.0};
+    std::atomic<double> m_sampleRate{0.0};
+    std::atomic<double> m_fixedTimestep{0.0};
+    std::atomic<std::uint32_t> m_epoch{0};
+    std::atomic<std::uint32_t> m_sectionGeneration{0};
+    std::atomic<bool> m_stopRequested{false};
+
+    QThread* m_thread = nullptr;
+};
+
+#endif // SIMULATIONENGINE_H
@@ -0,0 +1,85 @@
+#ifndef SPSCQUEUE_H
+#define SPSCQUEUE_H
+
+#include <atomic>
+#include <cstddef>
+#include <vector>
+
+/*
+ * @brief Bounded lock-free single-producer/single-consumer queue.
+ *
+ * Exactly one thread may call tryPush() and exactly one (other) thread may
+ * call tryPop(). Neither side ever blocks: a full queue makes tryPush()
+ * return false and the producer decides what to do (the simulation engine
+ * simply pauses integrating until the consumer catches up).
+ *
+ * The capacity is rounded up to a power of two so indices wrap with a mask.
+ */
+template <typename T>
+class SpscQueue
+{
+public:
+    explicit SpscQueue(std::size_t capacity)
+    {
+        std::size_t size = 2;
+        while (size < capacity) size <<= 1;
+        m_slots.resize(size);
+        m_mask = size - 1;
+    }
+
+    SpscQueue(const SpscQueue&) = delete;
+    SpscQueue& operator=(const SpscQueue&) = delete;
+
+    std::size_t capacity() const { return m_slots.size(); }
+
+    // Producer side
+    bool tryPush(const T& value)
+    {
+        const std::size_t tail = m_tail.load(std::memory_order_relaxed);
+        if (tail - m_cachedHead == m_slots.size()) {
+            m_cachedHead = m_head.load(std::memory_order_acquire);
+            if (tail - m_cachedHead == m_slots.size()) {
+                return false;
+            }
+        }
+        m_slots[tail & m_mask] = value;
+        m_tail.store(tail + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Consumer side
+    bool tryPop(T& value)
+    {
+        const std::size_t head = m_head.load(std::memory_order_relaxed);
+        if (head == m_cachedTail) {
+            m_cachedTail = m_tail.load(std::memory_order_acquire);
+            if (head == m_cachedTail) {
+                return false;
+            }
+        }
+        value = m_slots[head & m_mask];
+        m_head.store(head + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Approximate number of queued elements; exact only on a quiescent queue
+    std::size_t sizeApprox() const
+    {
+        return m_tail.load(std::memory_order_acquire) - m_head.load(std::memory_order_acquire);
+    }
+
+private:
+    static constexpr std::size_t CACHE_LINE = 64;
+
+    std::vector<T> m_slots;
+    std::size_t m_mask = 0;
+
+    // Producer and consumer indices live on separate cache lines to avoid false sharing.
+    // Each side also keeps a cached copy of the other side's index.
+    alignas(CACHE_LINE) std::atomic<std::size_t> m_tail{0};
+    std::size_t m_cachedHead = 0;
+    alignas(CACHE_LINE) std::atomic<std::size_t> m_head{0};
+    std::size_t m_cachedTail = 0;
+};
+
+#endif // SPSCQUEUE_H
@@ -0,0 +1,62 @@
+#ifndef TRAJECTORYFILE_H
+#define TRAJECTORYFILE_H
+
+#include <cstddef>
+#include <cstdint>
+#include "core/PendulumIntegrator.h"
+
+/*
+ * @brief On-disk layout of a recorded trajectory (*.dptraj).
+ *
+ * A fixed TRAJECTORY_HEADER_SIZE-byte header followed by tightly packed
+ * frames, all native-endian. Frames are appended while the run goes on and
+ * the header's frame count is only patched when the recorder closes, so
+ * readers take the count from the file size instead: a recording cut short
+ * by a crash is still readable up to its last complete frame.
+ *
+ * A file covers one continuous run, so frame times increase monotonically.
+ */
+
+// Angles as integrated: theta1 absolute, theta2 relative to the first rod
+struct TrajectoryFrame {
+    double time = 0.0;
+    double theta1 = 0.0, omega1 = 0.0;
+    double theta2 = 0.0, omega2 = 0.0;
+    double kineticEnergy = 0.0;
+    double potentialEnergy = 0.0;
+};
+static_assert(sizeof(TrajectoryFrame) == 7 * sizeof(double), "TrajectoryFrame must be seven packed doubles");
+
+constexpr char TRAJECTORY_MAGIC[8] = {'D', 'P', 'T', 'R', 'A', 'J', '\r', '\n'};
+constexpr std::uint32_t TRAJECTORY_VERSION = 1;
+constexpr std::size_t TRAJECTORY_HEADER_SIZE = 256;
+
+// Header flags
+constexpr std::uint32_t TRAJECTORY_FLAG_PARAMETERS_CHANGED = 1u << 0; // Edited mid-run; the header holds the initial set
+
+struct TrajectoryFileHeader {
+    char magic[8] = {};
+    std::uint32_t version = TRAJECTORY_VERSION;
+    std::uint32_t headerSize = TRAJECTORY_HEADER_SIZE;
+    std::uint32_t frameSize = sizeof(TrajectoryFrame);
+    std::uint32_t flags = 0;
+    std::uint64_t frameCount = 0; // Written on close; informational only
+    // Physical parameters at the start of the recording, in PendulumParameters order
+    double m1 = 0.0, m2 = 0.0;
+    double rodMass1 = 0.0, rodMass2 = 0.0;
+    double l1 = 0.0, l2 = 0.0;
+    double b1 = 0.0, b2 = 0.0;
+    double c1 = 0.0, c2 = 0.0;
+    double g = 0.0;
+    double sampleRate = 0.0;  // History sample rate, Hz; 0 = one frame per accepted step
+    char method[16] = {};     // PendulumIntegrator::methodName() of the active scheme, NUL-padded
+    std::uint8_t reserved[TRAJECTORY_HEADER_SIZE - 144] = {};
+
+    static TrajectoryFileHeader make(const PendulumParameters& parameters, const char* methodName, double sampleRate);
+    PendulumParameters parameters() const;
+    // Magic, version and sizes this build can read
+    bool valid() const;
+};
+static_assert(sizeof(TrajectoryFileHeader) == TRAJECTORY_HEADER_SIZE, "Trajectory header layout changed");
+
+#endif // TRAJECTORYFILE_H
@@ -0,0 +1,88 @@
+#ifndef TRAJECTORYRECORDER_H
+#define TRAJECTORYRECORDER_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "core/TrajectoryFile.h"
+
+/*
+ * @brief Streams trajectory frames to a .dptraj file from a background thread.
+ *
+ * The producer (one thread) appends frames into a block of BLOCK_FRAMES;
+ * a full block is handed to the writer thread under a short lock and the
+ * producer carries on with a recycled one, so it never waits on the disk.
+ * The writer issues one fwrite() per block. Blocks queue up without bound
+ * if the disk is slower than the simulation - at 56 bytes per frame that
+ * takes a far faster integrator than this one.
+ *
+ * A write error stops the writer; failed() reports it and later frames are
+ * dropped rather than buffered.
+ */
+class TrajectoryRecorder
+{
+public:
+    static constexpr std::size_t BLOCK_FRAMES = 16384; // 896 KiB per write
+
+    TrajectoryRecorder() = default;
+    ~TrajectoryRecorder();
+
+    TrajectoryRecorder(const TrajectoryRecorder&) = delete;
+    TrajectoryRecorder& operator=(const TrajectoryRecorder&) = delete;
+
+    // Creates (truncates) path, writes the header and starts the writer thread
+    bool open(const std::string& path, const TrajectoryFileHeader& header);
+    // Writes the pending frames, patches the header and joins the writer.
+    // Returns false if any write failed.
+    bool close();
+
+    bool isOpen() const { return m_file != nullptr; }
+    const std::string& path() const { return m_path; }
+
+    // Producer side
+    void append(const TrajectoryFrame& frame)
+    {
+        m_fill.push_back(frame);
+        ++m_framesAppended;
+        if (m_fill.size() == BLOCK_FRAMES) {
+            submitBlock();
+        }
+    }
+    // Hands the partially filled block to the writer, e.g. before the file is read back
+    void flush();
+    // Sets TRAJECTORY_FLAG_PARAMETERS_CHANGED in the header written on close
+    void markParametersChanged() { m_header.flags |= TRAJECTORY_FLAG_PARAMETERS_CHANGED; }
+
+    std::uint64_t framesAppended() const { return m_framesAppended; }
+    std::uint64_t bytesWritten() const { return m_bytesWritten.load(std::memory_order_relaxed); }
+    bool failed() const { return m_failed.load(std::memory_order_relaxed); }
+
+private:
+    using Block = std::vector<TrajectoryFrame>;
+
+    void submitBlock();
+    void writerLoop();
+
+    std::FILE* m_file = nullptr;
+    std::string m_path;
+    TrajectoryFileHeader m_header;
+    Block m_fill; // Producer-owned
+    std::uint64_t m_framesAppended = 0;
+
+    std::mutex m_mutex;
+    std::condition_variable m_wake;
+    std::deque<Block> m_queue;   // Full blocks waiting for the writer
+    std::vector<Block> m_spare;  // Written blocks, recycled by the producer
+    bool m_stopRequested = false;
+    std::atomic<std::uint64_t> m_bytesWritten{0};
+    std::atomic<bool> m_failed{false};
+    std::thread m_writer;
+};
+
+#endif // TRAJECTORYRECORDER_H
@@ -0,0 +1,58 @@
+#ifndef TRAJECTORYREPLAY_H
+#define TRAJECTORYREPLAY_H
+
+#include <cstddef>
+#include <string>
+#include "core/TrajectoryFile.h"
+
+/*
+ * @brief Read-only, memory-mapped view of a .dptraj recording.
+ *
+ * The file is mapped whole and frames are read in place: nothing is copied
+ * into RAM up front, and the pages a reader touches are cached and evicted by
+ * the OS, so a recording of hundreds of millions of frames costs only the
+ * address space. The frame count is fixed when the file is opened; frames
+ * appended to a recording still in progress appear after reopening it.
+ */
+class TrajectoryReplay
+{
+public:
+    TrajectoryReplay() = default;
+    ~TrajectoryReplay();
+
+    TrajectoryReplay(const TrajectoryReplay&) = delete;
+    TrajectoryReplay& operator=(const TrajectoryReplay&) = delete;
+
+    // Maps path; on failure the replay stays closed and error says why
+    bool open(const std::string& path, std::string* error = nullptr);
+    void close();
+
+    bool isOpen() const { return m_data != nullptr; }
+    const std::string& path() const { return m_path; }
+    const TrajectoryFileHeader& header() const { return m_header; }
+    PendulumParameters parameters() const { return m_header.parameters(); }
+
+    std::size_t size() const { return m_frameCount; }
+    bool empty() const { return m_frameCount == 0; }
+    const TrajectoryFrame& frame(std::size_t index) const { return m_frames[index]; }
+    const TrajectoryFrame* frames() const { return m_frames; }
+    double startTime() const { return m_frameCount > 0 ? m_frames[0].time : 0.0; }
+    double endTime() const { return m_frameCount > 0 ? m_frames[m_frameCount - 1].time : 0.0; }
+
+    // Index of the first frame at or after time t (size() if none); binary search
+    std::size_t lowerBound(double t) const;
+
+private:
+    std::string m_path;
+    TrajectoryFileHeader m_header;
+    void* m_data = nullptr;
+    std::size_t m_mappedBytes = 0;
+    const TrajectoryFrame* m_frames = nullptr;
+    std::size_t m_frameCount = 0;
+#ifdef _WIN32
+    void* m_fileHandle = nullptr;
+    void* m_mappingHandle = nullptr;
+#endif
+};
+
+#endif // TRAJECTORYREPLAY_H
@@ -0,0 +1,58 @@
+#ifndef TRIPLEBUFFER_H
+#define TRIPLEBUFFER_H
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+
+/*
+ * @brief Wait-free "latest value" channel between one writer and one reader.
+ *
+ * The writer fills a private back slot and publishes it by swapping it with
+ * the shared middle slot; the reader swaps the middle slot with its private
+ * front slot whenever a fresh value is available. Neither side ever waits
+ * for the other, and the reader always sees a complete value.
+ */
+template <typename T>
+class TripleBuffer
+{
+public:
+    TripleBuffer() = default;
+    explicit TripleBuffer(const T& initial)
+    {
+        m_slots.fill(initial);
+    }
+
+    TripleBuffer(const TripleBuffer&) = delete;
+    TripleBuffer& operator=(const TripleBuffer&) = delete;
+
+    // Writer side
+    void publish(const T& value)
+    {
+        m_slots[m_backIndex] = value;
+        const std::uint8_t previous = m_middle.exchange(static_cast<std::uint8_t>(m_backIndex | FRESH_BIT),
+                                                        std::memory_order_acq_rel);
+        m_backIndex = previous & INDEX_MASK;
+    }
+
+    // Reader side: returns the most recently published value
+    const T& latest()
+    {
+        if (m_middle.load(std::memory_order_acquire) & FRESH_BIT) {
+            const std::uint8_t previous = m_middle.exchange(m_frontIndex, std::memory_order_acq_rel);
+            m_frontIndex = previous & INDEX_MASK;
+        }
+        return m_slots[m_frontIndex];
+    }
+
+private:
+    static constexpr std::uint8_t INDEX_MASK = 0x3;
+    static constexpr std::uint8_t FRESH_BIT = 0x4;
+
+    std::array<T, 3> m_slots{};
+    std::atomic<std::uint8_t> m_middle{1};
+    std::uint8_t m_backIndex = 0;  // Owned by the writer
+    std::uint8_t m_frontIndex = 2; // Owned by the reader
+};
+
+#endif // TRIPLEBUFFER_H
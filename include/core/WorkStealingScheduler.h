@@ -0,0 +1,61 @@
+#ifndef WORKSTEALINGSCHEDULER_H
+#define WORKSTEALINGSCHEDULER_H
+
+#include <atomic>
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <mutex>
+
+/*
+ * @brief Parallel-for over an index range with range stealing between workers.
+ *
+ * parallelFor() splits [0, count) evenly across the workers up front. Each
+ * worker takes grain-sized pieces from the front of its own range; once it
+ * runs dry it steals the back half of the largest remaining range of another
+ * worker, beyond that worker's next grain; a range of one grain or less is
+ * left to its owner. Uneven work (some pendulums flip and need many more steps than
+ * others) is therefore rebalanced without a shared queue that every worker
+ * would contend on.
+ *
+ * The calling thread works as worker 0; the other workers are std::threads
+ * started for the duration of the call.
+ */
+class WorkStealingScheduler
+{
+public:
+    using RangeTask = std::function<void(std::size_t first, std::size_t last)>;
+
+    // threadCount == 0 uses every hardware thread
+    explicit WorkStealingScheduler(std::size_t threadCount = 0);
+    ~WorkStealingScheduler();
+
+    WorkStealingScheduler(const WorkStealingScheduler&) = delete;
+    WorkStealingScheduler& operator=(const WorkStealingScheduler&) = delete;
+
+    std::size_t threadCount() const { return m_threadCount; }
+
+    // Calls task(first, last) on disjoint ranges that together cover [0, count).
+    // Blocks until every range has been processed.
+    void parallelFor(std::size_t count, std::size_t grainSize, const RangeTask& task);
+
+    // Number of successful steals during the last parallelFor()
+    std::size_t lastStealCount() const { return m_stealCount.load(std::memory_order_relaxed); }
+
+private:
+    struct alignas(64) WorkerRange {
+        std::mutex mutex;
+        std::size_t begin = 0;
+        std::size_t end = 0;
+    };
+
+    void workerLoop(std::size_t self, std::size_t grainSize, const RangeTask& task);
+    bool takeFront(std::size_t self, std::size_t grainSize, std::size_t& first, std::size_t& last);
+    bool stealInto(std::size_t self, std::size_t grainSize);
+
+    std::size_t m_threadCount;
+    std::unique_ptr<WorkerRange[]> m_ranges;
+    std::atomic<std::size_t> m_stealCount{0};
+};
+
+#endif // WORKSTEALINGSCHEDULER_H
@@ -0,0 +1,279 @@
+#ifndef CHARTITEM_H
+#define CHARTITEM_H
+
+#include <QQuickItem>
+#include <QColor>
+#include <QImage>
+#include <QPointF>
+#include <QPointer>
+#include <QRectF>
+#include <QVector>
+#include <cstdint>
+#include <deque>
+#include <vector>
+#include "core/DoublePendulum.h"
+#include "ui/FrameScheduler.h"
+
+/*
+ * @brief Scene-graph chart of the pendulum's history.
+ *
+ * The plot background, the grid and the axes are retained nodes that are
+ * rebuilt only when the size or a colour changes; the zero lines move with
+ * the ranges. Labels are not drawn here: the ranges and plotRect are
+ * properties, so the QML around the item keeps them as Text items.
+ *
+ * TimeSeries reads the series straight from the pendulum. A full fetch
+ * (getProcessedTimeSeriesData, reduced to the plot width) happens when a
+ * setting, the size or the history changes; while following the end, only
+ * the rows added since are appended (getTimeSeriesDelta). While the
+ * scheduler runs, new rows are taken on its chartTick, so that work is
+ * paced by chartInterval and timed as the Charts phase of the frame.
+ * The line is kept in data units under a transform node, cut into chunks of
+ * LINE_CHUNK_POINTS points: scrolling and a change of the Y range only change
+ * the matrix, and a frame uploads just the chunk being filled. The window
+ * is a full windowWidth wide even while the history is shorter, and it moves
+ * by whole pixel columns. Appended rows are reduced column by column exactly
+ * as the fetch reduces the window, so the two paths draw the same line. Only
+ * a new window or plot width fetches again. Once the window has moved by the
+ * plot width, the line's vertices are rebuilt around the view and the Y range
+ * shrinks back to the data.
+ *
+ * PhasePortrait draws only the frame: the portrait is the density image laid
+ * over the plot in QML, and setDataBounds() gives its bounding box.
+ * PoincareMap keeps the finished series and the one being filled from
+ * getPoincareMapPoints(), and refresh() pulls the latter.
+ *
+ * Work queued by the setters, and by historyUpdated when there is no running
+ * scheduler, is done in updatePolish, once per frame however many changes came in. The software backend draws
+ * no custom geometry; there the whole chart is painted with QPainter.
+ */
+class ChartItem : public QQuickItem
+{
+    Q_OBJECT
+    Q_PROPERTY(DoublePendulum* pendulum READ pendulum WRITE setPendulum NOTIFY pendulumChanged)
+    Q_PROPERTY(FrameScheduler* scheduler READ scheduler WRITE setScheduler NOTIFY schedulerChanged)
+    Q_PROPERTY(bool active READ isActive WRITE setActive NOTIFY activeChanged)
+    Q_PROPERTY(Mode mode READ mode WRITE setMode NOTIFY modeChanged)
+    Q_PROPERTY(int series READ series WRITE setSeries NOTIFY seriesChanged)
+    Q_PROPERTY(bool following READ following WRITE setFollowing NOTIFY followingChanged)
+    Q_PROPERTY(double windowWidth READ windowWidth WRITE setWindowWidth NOTIFY windowWidthChanged)
+    Q_PROPERTY(double viewMinX READ viewMinX WRITE setViewMinX NOTIFY viewChanged)
+    Q_PROPERTY(double viewMaxX READ viewMaxX WRITE setViewMaxX NOTIFY viewChanged)
+    Q_PROPERTY(bool rdpEnabled READ rdpEnabled WRITE setRdpEnabled NOTIFY processingChanged)
+    Q_PROPERTY(double rdpEpsilon READ rdpEpsilon WRITE setRdpEpsilon NOTIFY processingChanged)
+    Q_PROPERTY(int rdpTargetPoints READ rdpTargetPoints WRITE setRdpTargetPoints NOTIFY processingChanged)
+    Q_PROPERTY(bool limitPoints READ limitPoints WRITE setLimitPoints NOTIFY processingChanged)
+    Q_PROPERTY(int maxPoints READ maxPoints WRITE setMaxPoints NOTIFY processingChanged)
+    Q_PROPERTY(QColor plotColor READ plotColor WRITE setPlotColor NOTIFY colorsChanged)
+    Q_PROPERTY(QColor gridColor READ gridColor WRITE setGridColor NOTIFY colorsChanged)
+    Q_PROPERTY(QColor axisColor READ axisColor WRITE setAxisColor NOTIFY colorsChanged)
+    Q_PROPERTY(QColor zeroLineColor READ zeroLineColor WRITE setZeroLineColor NOTIFY colorsChanged)
+    Q_PROPERTY(QColor lineColor READ lineColor WRITE setLineColor NOTIFY colorsChanged)
+    Q_PROPERTY(double pointRadius READ pointRadius WRITE setPointRadius NOTIFY pointRadiusChanged)
+    Q_PROPERTY(double minX READ minX NOTIFY rangeChanged)
+    Q_PROPERTY(double maxX READ maxX NOTIFY rangeChanged)
+    Q_PROPERTY(double minY READ minY NOTIFY rangeChanged)
+    Q_PROPERTY(double maxY READ maxY NOTIFY rangeChanged)
+    Q_PROPERTY(bool hasData READ hasData NOTIFY rangeChanged)
+    Q_PROPERTY(QRectF plotRect READ plotRect NOTIFY plotRectChanged)
+    Q_PROPERTY(int poincareSeriesCount READ poincareSeriesCount NOTIFY poincareSeriesChanged)
+
+public:
+    enum Mode {
+        TimeSeries,
+        PhasePortrait,
+        PoincareMap
+    };
+    Q_ENUM(Mode)
+
+    // Grid cells across and down the plot; the labels sit on these lines
+    static constexpr int GRID_LINES_X = 30;
+    static constexpr int GRID_LINES_Y = 24;
+    // Plot area inside the item, in pixels
+    static constexpr double PADDING_LEFT = 60.0;
+    static constexpr double PADDING_RIGHT = 20.0;
+    static constexpr double PADDING_TOP = 10.0;
+    static constexpr double PADDING_BOTTOM = 40.0;
+    // Share of the data range added on each side (the time axis gets none)
+    static constexpr double RANGE_MARGIN = 0.15;
+    // Line points per vertex-buffer chunk
+    static constexpr std::uint64_t LINE_CHUNK_POINTS = 1024;
+
+    explicit ChartItem(QQuickItem* parent = nullptr);
+
+    DoublePendulum* pendulum() const { return m_pendulum; }
+    void setPendulum(DoublePendulum* pendulum);
+    // Frame loop whose chartTick takes the new history rows while it runs
+    FrameScheduler* scheduler() const { return m_scheduler; }
+    void setScheduler(FrameScheduler* scheduler);
+    // Nothing is fetched while inactive; becoming active fetches everything again
+    bool isActive() const { return m_active; }
+    void setActive(bool active);
+    Mode mode() const { return m_mode; }
+    void setMode(Mode mode);
+    // DoublePendulum::TimeSeriesType of the time series
+    int series() const { return m_series; }
+    void setSeries(int series);
+    // Whether the time window follows the end of the history
+    bool following() const { return m_following; }
+    void setFollowing(bool following);
+    // Seconds shown while following
+    double windowWidth() const { return m_windowWidth; }
+    void setWindowWidth(double width);
+    // Time window; set while following, and set from outside to pan or zoom
+    double viewMinX() const { return m_viewMinX; }
+    void setViewMinX(double x);
+    double viewMaxX() const { return m_viewMaxX; }
+    void setViewMaxX(double x);
+
+    // Passed to getProcessedTimeSeriesData. RDP works on the whole window, so
+    // with it new rows are not appended; nor past the point limit
+    bool rdpEnabled() const { return m_rdpEnabled; }
+    void setRdpEnabled(bool enabled);
+    double rdpEpsilon() const { return m_rdpEpsilon; }
+    void setRdpEpsilon(double epsilon);
+    int rdpTargetPoints() const { return m_rdpTargetPoints; }
+    void setRdpTargetPoints(int points);
+    bool limitPoints() const { return m_limitPoints; }
+    void setLimitPoints(bool enabled);
+    int maxPoints() const { return m_maxPoints; }
+    void setMaxPoints(int points);
+
+    QColor plotColor() const { return m_plotColor; }
+    void setPlotColor(const QColor& color);
+    QColor gridColor() const { return m_gridColor; }
+    void setGridColor(const QColor& color);
+    QColor axisColor() const { return m_axisColor; }
+    void setAxisColor(const QColor& color);
+    QColor zeroLineColor() const { return m_zeroLineColor; }
+    void setZeroLineColor(const QColor& color);
+    QColor lineColor() const { return m_lineColor; }
+    void setLineColor(const QColor& color);
+    // Radius of the Poincaré map points, in pixels
+    double pointRadius() const { return m_pointRadius; }
+    void setPointRadius(double radius);
+
+    // Ranges the plot area shows
+    double minX() const { return m_minX; }
+    double maxX() const { return m_maxX; }
+    double minY() const { return m_minY; }
+    double maxY() const { return m_maxY; }
+    bool hasData() const { return m_hasData; }
+    QRectF plotRect() const;
+    int poincareSeriesCount() const { return static_cast<int>(m_poincareSeries.size()); }
+
+    // Fetches the chart again on the next frame (time series, Poincaré map)
+    Q_INVOKABLE void refresh();
+    // Phase portrait: bounding box of the data, or none
+    Q_INVOKABLE void setDataBounds(double xMin, double xMax, double yMin, double yMax);
+    Q_INVOKABLE void clearData();
+
+    // Poincaré map series. The last one is being filled from getPoincareMapPoints();
+    // finalizePoincareSeries() takes those points into it, if there are any.
+    Q_INVOKABLE void beginPoincareSeries(const QColor& color);
+    Q_INVOKABLE void finalizePoincareSeries();
+    Q_INVOKABLE void clearPoincareSeries();
+
+signals:
+    void pendulumChanged();
+    void schedulerChanged();
+    void activeChanged();
+    void modeChanged();
+    void seriesChanged();
+    void followingChanged();
+    void windowWidthChanged();
+    void viewChanged();
+    void processingChanged();
+    void colorsChanged();
+    void pointRadiusChanged();
+    void rangeChanged();
+    void plotRectChanged();
+    void poincareSeriesChanged();
+
+protected:
+    void updatePolish() override;
+    QSGNode* updatePaintNode(QSGNode* oldNode, UpdatePaintNodeData* data) override;
+    void geometryChange(const QRectF& newGeometry, const QRectF& oldGeometry) override;
+
+private:
+    struct PoincareSeries
+    {
+        QColor color;
+        QVector<QPointF> points;
+    };
+
+    void scheduleRefresh();
+    void onHistoryUpdated();
+    void onChartTick();
+    // Appends the pending rows, or fetches the window again when they cannot be appended
+    void takePendingRows();
+    void setView(double minX, double maxX);
+    void refreshNow();
+    void fetchTimeSeries();
+    // Appends the rows added since the last fetch; false when a full fetch is needed
+    bool appendNewRows();
+    void pullPoincarePoints();
+
+    // Data bounds to ranges, with RANGE_MARGIN and degenerate ranges widened
+    void setRanges(double xMin, double xMax, double yMin, double yMax, bool marginX);
+    // Y bounds of the line points at or after `fromX`; false when there are none
+    bool lineYBounds(double fromX, double& yMin, double& yMax) const;
+    void appendLinePoints(const char* packed, std::size_t count);
+    // Drops whole chunks that lie left of the time window
+    void trimLine();
+
+    QSGNode* updateGeometryNodes(QSGNode* oldNode);
+    QSGNode* updateSoftwareNode(QSGNode* oldNode);
+    void paintSoftware(QImage& image, qreal dpr) const;
+
+    QPointer<DoublePendulum> m_pendulum;
+    QPointer<FrameScheduler> m_scheduler;
+    bool m_active = true;
+    Mode m_mode = TimeSeries;
+    int m_series = 0;
+    bool m_following = true;
+    double m_windowWidth = 30.0;
+    double m_viewMinX = 0.0;
+    double m_viewMaxX = 30.0;
+    bool m_rdpEnabled = false;
+    double m_rdpEpsilon = 0.25;
+    int m_rdpTargetPoints = 0;
+    bool m_limitPoints = true;
+    int m_maxPoints = 10000;
+    QColor m_plotColor = Qt::white;
+    QColor m_gridColor = QColor(0xBB, 0xBB, 0xBB);
+    QColor m_axisColor = QColor(0x33, 0x33, 0x33);
+    QColor m_zeroLineColor = Qt::black;
+    QColor m_lineColor = Qt::black;
+    double m_pointRadius = 2.0;
+
+    double m_minX = 0.0;
+    double m_maxX = 1.0;
+    double m_minY = 0.0;
+    double m_maxY = 1.0;
+    bool m_hasData = false;
+
+    bool m_refreshPending = true;
+    bool m_appendPending = false;
+
+    // Time series line in data units; m_lineFirst numbers the front point, counting from the last fetch
+    std::deque<QPointF> m_line;
+    std::uint64_t m_lineFirst = 0;
+    double m_lineOriginX = 0.0;        // Subtracted from the times so the vertices keep float precision
+    double m_cursor = -1.0;            // First history row not drawn yet; -1 = no appending
+    double m_cursorTime = 0.0;         // Time the drawn rows reach: the last fetch's end, then a column edge
+    int m_fetchEpoch = -1;             // historyEpoch at the last fetch
+    double m_scrolledPixels = 0.0;     // Since the line was last rebuilt around the view
+
+    std::vector<PoincareSeries> m_poincareSeries;
+
+    // Scene-graph side, touched in updatePaintNode while the GUI thread waits
+    bool m_lineRebuild = true;         // Line chunks are to be dropped
+    bool m_frameDirty = true;          // Background, grid and axes
+    bool m_pointsDirty = true;
+    bool m_colorsDirty = true;
+    std::uint64_t m_drawnEnd = 0;      // One past the last line point in the geometry
+    QImage m_raster;                   // Software backend only
+};
+
+#endif // CHARTITEM_H
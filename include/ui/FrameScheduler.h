@@ -0,0 +1,109 @@
+#ifndef FRAMESCHEDULER_H
+#define FRAMESCHEDULER_H
+
+#include <QElapsedTimer>
+#include <QObject>
+#include <QPointer>
+#include <QQuickWindow>
+#include <QTimer>
+#include <QVariantMap>
+#include <atomic>
+#include "core/DoublePendulum.h"
+#include "core/FrameBudget.h"
+
+/*
+ * @brief The GUI frame loop: paces the frames, times their phases against a FrameBudget.
+ *
+ * While running, every frame period (1 / targetFps) the scheduler
+ *  - collects the steps the simulation thread finished (Physics phase),
+ *  - publishes them, which runs the bindings and trace items (Traces phase),
+ *  - emits chartTick every chartInterval ms, when the frame still has room
+ *    for the Charts budget; a refresh that does not fit is put off to a later
+ *    frame, but never by more than one extra interval (Charts phase). The
+ *    time-series ChartItems append their new rows on it, so their work is
+ *    paced by chartInterval and booked here,
+ *  - emits frame().
+ * The scene graph sync and render of the window (Render phase) are measured
+ * on the render thread and booked to the frame they drew.
+ *
+ * Every METRICS_INTERVAL_MS the averages, drop counts and the simulation
+ * thread's lag are gathered into `metrics` for the status bar.
+ */
+class FrameScheduler : public QObject
+{
+    Q_OBJECT
+    Q_PROPERTY(QQuickWindow* window READ window WRITE setWindow NOTIFY windowChanged)
+    Q_PROPERTY(DoublePendulum* pendulum READ pendulum WRITE setPendulum NOTIFY pendulumChanged)
+    Q_PROPERTY(bool running READ isRunning WRITE setRunning NOTIFY runningChanged)
+    Q_PROPERTY(double targetFps READ targetFps WRITE setTargetFps NOTIFY targetFpsChanged)
+    Q_PROPERTY(int chartInterval READ chartInterval WRITE setChartInterval NOTIFY chartIntervalChanged)
+    Q_PROPERTY(QVariantMap metrics READ metrics NOTIFY metricsChanged)
+
+public:
+    static constexpr double DEFAULT_FPS = 60.0;
+    static constexpr int METRICS_INTERVAL_MS = 500;
+
+    explicit FrameScheduler(QObject* parent = nullptr);
+
+    // Window whose rendering is the Render phase
+    QQuickWindow* window() const { return m_window; }
+    void setWindow(QQuickWindow* window);
+    DoublePendulum* pendulum() const { return m_pendulum; }
+    void setPendulum(DoublePendulum* pendulum);
+    // Starts and pauses the frames together with the simulation thread
+    bool isRunning() const { return m_running; }
+    void setRunning(bool running);
+    // Frames per second; 0 or less means DEFAULT_FPS
+    double targetFps() const { return m_targetFps; }
+    void setTargetFps(double fps);
+    // Milliseconds between chart refreshes
+    int chartInterval() const { return m_chartInterval; }
+    void setChartInterval(int milliseconds);
+    // fps, framePeriodMs, <phase>BudgetMs, <phase>Ms (smoothed) and <phase>PeakMs for
+    // physics, traces, charts and render, droppedFrames, lastDropCause (a phase name,
+    // "unaccounted" or ""), lagMs, droppedSimTime, physicsLoad, overrunTicks, chartDeferrals
+    QVariantMap metrics() const { return m_metrics; }
+
+    Q_INVOKABLE void start() { setRunning(true); }
+    Q_INVOKABLE void stop() { setRunning(false); }
+
+signals:
+    void windowChanged();
+    void pendulumChanged();
+    void runningChanged();
+    void targetFpsChanged();
+    void chartIntervalChanged();
+    void metricsChanged();
+    // A frame has been published
+    void frame();
+    // Time for the charts to refresh
+    void chartTick();
+
+private:
+    void runFrame();
+    void updateMetrics(double frameStart);
+    double now() const { return static_cast<double>(m_clock.nsecsElapsed()) * 1e-9; }
+    double framePeriod() const { return 1.0 / (m_targetFps > 0.0 ? m_targetFps : DEFAULT_FPS); }
+
+    QPointer<QQuickWindow> m_window;
+    QPointer<DoublePendulum> m_pendulum;
+    bool m_running = false;
+    double m_targetFps = DEFAULT_FPS;
+    int m_chartInterval = 100;
+
+    QTimer m_timer;
+    QElapsedTimer m_clock;
+    FrameBudget m_budget;
+    double m_lastChartTick = -1.0;
+    std::uint64_t m_chartDeferrals = 0;
+
+    // Render thread timing; the sum is taken by the next frame
+    std::atomic<qint64> m_renderStart{0};
+    std::atomic<qint64> m_renderNanos{0};
+
+    QVariantMap m_metrics;
+    double m_metricsStart = -1.0;
+    std::uint64_t m_metricsFrames = 0;
+};
+
+#endif // FRAMESCHEDULER_H
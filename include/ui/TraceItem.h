@@ -0,0 +1,128 @@
+#ifndef TRACEITEM_H
+#define TRACEITEM_H
+
+#include <QQuickItem>
+#include <QColor>
+#include <QImage>
+#include <QPointF>
+#include <QPointer>
+#include <cstdint>
+#include <deque>
+#include "core/DoublePendulum.h"
+
+/*
+ * @brief Scene-graph renderer for the trace of one bob.
+ *
+ * The item keeps the trace in physical units (metres from the pivot, y down)
+ * and maps it to pixels with `origin` and `pixelsPerMetre` through a
+ * transform node, so a resize or a zoom only changes a matrix. Every segment
+ * is a quad of two triangles in a vertex buffer cut into chunks of
+ * CHUNK_SEGMENTS segments: a full chunk is uploaded once and left alone, and
+ * a frame only rewrites the chunk being filled. Quads are as wide as
+ * lineWidth pixels at the scale they were built for; the geometry is rebuilt
+ * from the points when the scale drifts by more than WIDTH_REBUILD_RATIO.
+ *
+ * The software backend draws no custom geometry. There the trace is painted
+ * into an image with QPainter, new segments only, and painted again when the
+ * mapping or the size changes.
+ *
+ * New points are taken from the pendulum on historyUpdated with
+ * consumeNewTrace1Points()/consumeNewTrace2Points(), so only one item per bob
+ * should follow a pendulum. When traceEpoch changes the item starts over from
+ * getTrace1Points()/getTrace2Points().
+ */
+class TraceItem : public QQuickItem
+{
+    Q_OBJECT
+    Q_PROPERTY(DoublePendulum* pendulum READ pendulum WRITE setPendulum NOTIFY pendulumChanged)
+    Q_PROPERTY(int bob READ bob WRITE setBob NOTIFY bobChanged)
+    Q_PROPERTY(QColor color READ color WRITE setColor NOTIFY colorChanged)
+    Q_PROPERTY(double lineWidth READ lineWidth WRITE setLineWidth NOTIFY lineWidthChanged)
+    Q_PROPERTY(QPointF origin READ origin WRITE setOrigin NOTIFY originChanged)
+    Q_PROPERTY(double pixelsPerMetre READ pixelsPerMetre WRITE setPixelsPerMetre NOTIFY pixelsPerMetreChanged)
+    Q_PROPERTY(double maxSegmentLength READ maxSegmentLength WRITE setMaxSegmentLength NOTIFY maxSegmentLengthChanged)
+    Q_PROPERTY(int maxPoints READ maxPoints WRITE setMaxPoints NOTIFY maxPointsChanged)
+
+public:
+    // Segments per vertex-buffer chunk; the oldest points are dropped a chunk at a time
+    static constexpr std::uint64_t CHUNK_SEGMENTS = 4096;
+    // Scale change, either way, after which the quads are rebuilt for the line width
+    static constexpr double WIDTH_REBUILD_RATIO = 1.5;
+
+    explicit TraceItem(QQuickItem* parent = nullptr);
+
+    DoublePendulum* pendulum() const { return m_pendulum; }
+    void setPendulum(DoublePendulum* pendulum);
+    // 1 or 2
+    int bob() const { return m_bob; }
+    void setBob(int bob);
+    QColor color() const { return m_color; }
+    void setColor(const QColor& color);
+    double lineWidth() const { return m_lineWidth; }
+    void setLineWidth(double width);
+    // Pixel position of the pivot
+    QPointF origin() const { return m_origin; }
+    void setOrigin(const QPointF& origin);
+    double pixelsPerMetre() const { return m_pixelsPerMetre; }
+    void setPixelsPerMetre(double scale);
+    // Consecutive points further apart than this (in metres) are not joined; 0 joins all
+    double maxSegmentLength() const { return m_maxSegmentLength; }
+    void setMaxSegmentLength(double length);
+    // Points kept, as in the pendulum's trace buffer (at most CHUNK_SEGMENTS more)
+    int maxPoints() const { return m_maxPoints; }
+    void setMaxPoints(int points);
+
+    // Drops what is drawn and takes the whole trace from the pendulum again
+    Q_INVOKABLE void restart();
+
+signals:
+    void pendulumChanged();
+    void bobChanged();
+    void colorChanged();
+    void lineWidthChanged();
+    void originChanged();
+    void pixelsPerMetreChanged();
+    void maxSegmentLengthChanged();
+    void maxPointsChanged();
+
+protected:
+    QSGNode* updatePaintNode(QSGNode* oldNode, UpdatePaintNodeData* data) override;
+    void geometryChange(const QRectF& newGeometry, const QRectF& oldGeometry) override;
+
+private:
+    // Takes the points added since the last call (connected to historyUpdated)
+    void pullPoints();
+    // `count` QPointF packed as interleaved doubles, possibly unaligned
+    void appendPoints(const char* packed, std::size_t count);
+    // Whether the segment ending at point `index` is drawn
+    bool joins(std::uint64_t index) const;
+
+    QSGNode* updateGeometryNodes(QSGNode* oldNode);
+    QSGNode* updateSoftwareNode(QSGNode* oldNode);
+
+    QPointer<DoublePendulum> m_pendulum;
+    int m_bob = 1;
+    QColor m_color = Qt::red;
+    double m_lineWidth = 1.5;
+    QPointF m_origin;
+    double m_pixelsPerMetre = 1.0;
+    double m_maxSegmentLength = 0.0;
+    int m_maxPoints = 500000;
+
+    // Trace points; m_firstIndex numbers the front one, counting from the last restart
+    std::deque<QPointF> m_points;
+    std::uint64_t m_firstIndex = 0;
+    int m_traceEpoch = -1;
+
+    // Scene-graph side, touched in updatePaintNode while the GUI thread waits
+    bool m_rebuild = true;          // Everything drawn so far is to be dropped
+    bool m_colorDirty = true;
+    std::uint64_t m_drawnEnd = 0;   // One past the last point whose segment is drawn
+    double m_builtScale = 0.0;      // pixelsPerMetre the quads were built for
+    double m_builtLineWidth = 0.0;
+    QImage m_raster;                // Software backend only
+    QPointF m_rasterOrigin;
+    double m_rasterScale = 0.0;
+};
+
+#endif // TRACEITEM_H
@@ -3,6 +3,7 @@
 #include <QQmlContext>
 #include <cmath>
 #include "core/DoublePendulum.h"
+#include "core/FlipMapController.h"
 #include <QMetaType>
 #include <QList>
 #include <QPointF>
@@ -12,6 +13,9 @@
 #include <QUrl>
 #include <QQuickWindow>
 #include "ui/SplashScreenHandler.h"
+#include "ui/TraceItem.h"
+#include "ui/ChartItem.h"
+#include "ui/FrameScheduler.h"
 
 int main(int argc, char *argv[])
 {
@@ -20,6 +24,9 @@ int main(int argc, char *argv[])
     // Register the DoublePendulum class as a QML type so its enums are accessible
     // Using "PendulumApi" as the QML type name to avoid collision with the 3D model component
     qmlRegisterType<DoublePendulum>("DoublePendulum", 1, 0, "PendulumApi");
+    qmlRegisterType<TraceItem>("DoublePendulum", 1, 0, "TraceItem");
+    qmlRegisterType<ChartItem>("DoublePendulum", 1, 0, "ChartItem");
+    qmlRegisterType<FrameScheduler>("DoublePendulum", 1, 0, "FrameScheduler");
 
     QApplication app(argc, argv);
     
@@ -39,7 +46,17 @@ int main(int argc, char *argv[])
         nullptr              // parent
     );
 
+    // Join the simulation thread while the event loop and QML are still alive
+    QObject::connect(&app, &QCoreApplication::aboutToQuit, pendulum, &DoublePendulum::shutdown);
+
+    // Background generator for the time-to-flip map view
+    FlipMapController *flipMap = new FlipMapController(&app);
+    QObject::connect(&app, &QCoreApplication::aboutToQuit, flipMap, &FlipMapController::shutdown);
+
     QQmlApplicationEngine engine;
+    engine.rootContext()->setContextProperty("flipMap", flipMap);
+    engine.addImageProvider(QStringLiteral("flipmap"), new FlipMapImageProvider(flipMap)); // Engine takes ownership
+    engine.addImageProvider(QStringLiteral("phasedensity"), new PhaseDensityImageProvider(pendulum));
     
     QObject::connect(
         &engine,
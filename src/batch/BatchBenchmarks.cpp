@@ -0,0 +1,427 @@
+#include "BatchBenchmarks.h"
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <functional>
+#include <string>
+#include <vector>
+#include "core/CompressedHistory.h"
+#include "core/EnsembleEngine.h"
+#include "core/HistoryPyramid.h"
+#include "core/LineSimplifier.h"
+
+int runKernelBenchmark(const BatchOptions& options)
+{
+    const std::size_t n = options.ensembleSize > 0 ? options.ensembleSize : 512;
+
+    EnsembleEngine::Config config;
+    config.parameters = options.parameters;
+    config.tolerances = options.tolerances;
+    config.duration = options.duration;
+    config.threadCount = 1; // Per-core throughput; scaling across cores is measured by --ensemble
+
+    EnsembleEngine engine(config);
+    engine.resize(n);
+    const double center = 0.5 * static_cast<double>(n - 1);
+    for (std::size_t i = 0; i < n; ++i) {
+        PendulumState state = options.initialState;
+        state[0] += (static_cast<double>(i) - center) * options.spread;
+        engine.setInitialState(i, state);
+    }
+
+    struct Result {
+        double seconds = 0.0;
+        unsigned long long acceptedSteps = 0;
+        EnsembleBatch batch;
+    };
+    auto measure = [&engine, &config](bool vectorized, SimdLevel level) {
+        config.vectorized = vectorized;
+        config.forceKernel = vectorized; // The scalar row measures the one-lane kernel itself
+        config.maxSimdLevel = level;
+        engine.setConfig(config);
+        const auto started = std::chrono::steady_clock::now();
+        engine.run();
+        Result result;
+        result.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count();
+        result.batch = engine.batch();
+        for (std::uint32_t steps : result.batch.acceptedSteps) {
+            result.acceptedSteps += steps;
+        }
+        return result;
+    };
+
+    std::fprintf(stderr, "members            : %zu x %.3f s, 1 thread\n", n, options.duration);
+    std::fprintf(stderr, "%-10s %8s %14s %8s %14s %14s\n",
+                 "kernel", "lanes", "steps/sec", "speedup", "max |dstate|", "max |ddrift|");
+
+    const Result reference = measure(false, SimdLevel::Scalar);
+    const double referenceRate = reference.acceptedSteps / std::max(reference.seconds, 1e-12);
+    std::fprintf(stderr, "%-10s %8d %14.0f %8.2f %14s %14s\n", "reference", 1, referenceRate, 1.0, "-", "-");
+
+    const SimdLevel levels[] = {SimdLevel::Scalar, SimdLevel::Avx2, SimdLevel::Avx512};
+    for (SimdLevel level : levels) {
+        if (!BatchKernel::isAvailable(level)) {
+            std::fprintf(stderr, "%-10s %8s %14s\n", BatchKernel::name(level), "-", "not available");
+            continue;
+        }
+        const Result result = measure(true, level);
+        const double rate = result.acceptedSteps / std::max(result.seconds, 1e-12);
+
+        // Chaotic members diverge from the reference at a rate set by the
+        // Lyapunov exponent, so compare over short durations
+        double stateDifference = 0.0;
+        double driftDifference = 0.0;
+        for (std::size_t i = 0; i < n; ++i) {
+            const EnsembleBatch& a = reference.batch;
+            const EnsembleBatch& b = result.batch;
+            stateDifference = std::max({stateDifference,
+                                        std::abs(a.finalTheta1[i] - b.finalTheta1[i]),
+                                        std::abs(a.finalOmega1[i] - b.finalOmega1[i]),
+                                        std::abs(a.finalTheta2[i] - b.finalTheta2[i]),
+                                        std::abs(a.finalOmega2[i] - b.finalOmega2[i])});
+            driftDifference = std::max(driftDifference, std::abs(a.maxEnergyDrift[i] - b.maxEnergyDrift[i]));
+        }
+        std::fprintf(stderr, "%-10s %8zu %14.0f %8.2f %14.3e %14.3e\n", BatchKernel::name(level),
+                     BatchKernel::laneCount(level), rate, rate / referenceRate, stateDifference, driftDifference);
+    }
+    return 0;
+}
+
+/*
+ * @brief Compression ratio and access cost of CompressedHistory.
+ *
+ * Integrates one run (per accepted step, or at --sample-rate), appending
+ * every row to the compressed tier and to a plain copy of its columns, the
+ * reference for the bit-exact checks after a full decode and after a
+ * save/load round trip.
+ */
+int runHistoryBenchmark(const BatchOptions& options)
+{
+    PendulumIntegrator integrator(options.parameters, options.initialState);
+    integrator.setToleranceProfile(options.tolerances);
+    integrator.setMethod(options.method);
+    integrator.setFixedStepSize(options.fixedStep);
+
+    constexpr std::size_t COLUMNS = CompressedHistory::COLUMN_COUNT;
+    CompressedHistory history;
+    HistoryPyramid pyramid(COLUMNS - 1); // Every column but time
+    std::vector<double> plain; // Row-major copy, COLUMNS per row
+    double appendSeconds = 0.0;
+    double pyramidSeconds = 0.0;
+    auto appendRow = [&](double t, const PendulumState& state) {
+        const PendulumEnergies energies = PendulumIntegrator::energies(options.parameters, state);
+        const double row[COLUMNS] = {t, state[0], state[1], state[2], state[3],
+                                     energies.kinetic, energies.potential, energies.kinetic + energies.potential};
+        const auto started = std::chrono::steady_clock::now();
+        history.append(t, state[0], state[1], state[2], state[3], energies.kinetic, energies.potential);
+        const auto appended = std::chrono::steady_clock::now();
+        pyramid.append(t, row + 1);
+        appendSeconds += std::chrono::duration<double>(appended - started).count();
+        pyramidSeconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - appended).count();
+        plain.insert(plain.end(), row, row + COLUMNS);
+    };
+
+    long long sampleIndex = 1;
+    appendRow(integrator.time(), integrator.state());
+    while (integrator.time() < options.duration) {
+        const PendulumIntegrator::StepResult result = integrator.tryStep(options.duration - integrator.time());
+        if (result == PendulumIntegrator::StepResult::Failed) {
+            std::fprintf(stderr, "Integration failed at t = %.6f\n", integrator.time());
+            return 2;
+        }
+        if (result == PendulumIntegrator::StepResult::Rejected) {
+            continue;
+        }
+        if (options.sampleRate > 0.0) {
+            double t = static_cast<double>(sampleIndex) / options.sampleRate;
+            while (t <= integrator.time()) {
+                appendRow(t, integrator.interpolate(t));
+                t = static_cast<double>(++sampleIndex) / options.sampleRate;
+            }
+        } else {
+            appendRow(integrator.time(), integrator.state());
+        }
+    }
+
+    const std::size_t rows = history.size();
+    const double rawBytes = static_cast<double>(rows * COLUMNS * sizeof(double));
+    std::fprintf(stderr, "rows               : %zu in %zu chunks of %zu\n", rows, history.chunkCount(), history.chunkRows());
+    std::fprintf(stderr, "uncompressed       : %.2f MB (%zu bytes/row)\n", rawBytes / 1e6, COLUMNS * sizeof(double));
+    std::fprintf(stderr, "compressed         : %.2f MB (%.1f bytes/row, ratio %.2f), %.2f MB held\n",
+                 history.compressedBytes() / 1e6,
+                 static_cast<double>(history.compressedBytes()) / std::max<std::size_t>(rows - rows % history.chunkRows(), 1),
+                 rawBytes / std::max<double>(history.memoryBytes(), 1.0), history.memoryBytes() / 1e6);
+    std::fprintf(stderr, "append             : %.1f ns/row\n", appendSeconds / std::max<std::size_t>(rows, 1) * 1e9);
+
+    // Full decode, compared bit for bit with the plain copy
+    auto verify = [&](const CompressedHistory& source, double& seconds) {
+        std::size_t row = 0;
+        bool exact = true;
+        const auto started = std::chrono::steady_clock::now();
+        source.visitRange(-HUGE_VAL, HUGE_VAL, [&](const CompressedHistory::RowBlock& block) {
+            for (std::size_t i = 0; i < block.size; ++i, ++row) {
+                for (std::size_t c = 0; c < COLUMNS; ++c) {
+                    exact = exact && row < rows
+                        && std::memcmp(&block.columns[c][i], &plain[row * COLUMNS + c], sizeof(double)) == 0;
+                }
+            }
+        });
+        seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count();
+        return exact && row == rows;
+    };
+    double decodeSeconds = 0.0;
+    const bool exact = verify(history, decodeSeconds);
+    std::fprintf(stderr, "full decode        : %.1f ns/row, %s\n",
+                 decodeSeconds / std::max<std::size_t>(rows, 1) * 1e9, exact ? "bit-exact" : "MISMATCH");
+
+    // A chart-sized window at the end: only the chunks under it are decoded
+    constexpr int VIEWPORT_QUERIES = 200;
+    const double window = std::min(10.0, history.endTime() - history.startTime());
+    std::size_t viewportRows = 0;
+    const auto queried = std::chrono::steady_clock::now();
+    for (int q = 0; q < VIEWPORT_QUERIES; ++q) {
+        history.visitRange(history.endTime() - window, history.endTime(),
+                           [&viewportRows](const CompressedHistory::RowBlock& block) { viewportRows += block.size; });
+    }
+    const double querySeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - queried).count();
+    std::fprintf(stderr, "%4.1f s viewport    : %.3f ms (%zu rows)\n", window,
+                 querySeconds / VIEWPORT_QUERIES * 1e3, viewportRows / VIEWPORT_QUERIES);
+
+    // A chart tick: the row at the viewport start, then the rows appended since the last tick
+    constexpr std::uint64_t TICK_ROWS = 64;
+    std::uint64_t viewportRow = 0;
+    const auto lookedUp = std::chrono::steady_clock::now();
+    for (int q = 0; q < VIEWPORT_QUERIES; ++q) {
+        viewportRow += history.lowerBound(history.endTime() - window);
+    }
+    const double lookupSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - lookedUp).count();
+    std::size_t deltaRows = 0;
+    const auto fetched = std::chrono::steady_clock::now();
+    for (int q = 0; q < VIEWPORT_QUERIES; ++q) {
+        history.visitRows(history.endRow() - std::min<std::uint64_t>(TICK_ROWS, history.endRow()), history.endRow(),
+                          [&deltaRows](const CompressedHistory::RowBlock& block) { deltaRows += block.size; });
+    }
+    const double deltaSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - fetched).count();
+    std::fprintf(stderr, "viewport row lookup: %.2f us (row %llu), %zu-row delta %.2f us\n",
+                 lookupSeconds / VIEWPORT_QUERIES * 1e6,
+                 static_cast<unsigned long long>(viewportRow / VIEWPORT_QUERIES),
+                 deltaRows / VIEWPORT_QUERIES, deltaSeconds / VIEWPORT_QUERIES * 1e6);
+
+    // Whole-history chart request: pyramid envelope against the exact M4 of every row
+    constexpr std::size_t PIXELS = 1000;
+    const std::size_t series = static_cast<std::size_t>(CompressedHistory::Column::Theta1) - 1;
+    std::vector<double> envelope;
+    const auto enveloped = std::chrono::steady_clock::now();
+    const bool pyramidUsed = pyramid.envelope(series, history.startTime(), history.endTime(), PIXELS, envelope);
+    const double envelopeSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - enveloped).count();
+    std::vector<double> points;
+    points.reserve(2 * rows);
+    const auto reduced = std::chrono::steady_clock::now();
+    history.visitRange(-HUGE_VAL, HUGE_VAL, [&points](const CompressedHistory::RowBlock& block) {
+        for (std::size_t i = 0; i < block.size; ++i) {
+            points.push_back(block.time(i));
+            points.push_back(block.value(CompressedHistory::Column::Theta1, i));
+        }
+    });
+    std::vector<double> exactEnvelope;
+    HistoryPyramid::reduce(points.data(), rows, history.startTime(), history.endTime(), PIXELS, exactEnvelope);
+    const double reduceSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - reduced).count();
+    std::fprintf(stderr, "pyramid            : %zu levels, %.1f bytes/row, append %.1f ns/row\n",
+                 pyramid.levelCount(), static_cast<double>(pyramid.memoryBytes()) / std::max<std::size_t>(rows, 1),
+                 pyramidSeconds / std::max<std::size_t>(rows, 1) * 1e9);
+    if (pyramidUsed) {
+        std::fprintf(stderr, "%zu px envelope    : %.3f ms (%zu points), exact M4 of all rows %.1f ms (%zu points)\n",
+                     PIXELS, envelopeSeconds * 1e3, envelope.size() / 2, reduceSeconds * 1e3, exactEnvelope.size() / 2);
+    } else {
+        std::fprintf(stderr, "%zu px envelope    : fewer than %zu rows per pixel, rows are read directly\n",
+                     PIXELS, HistoryPyramid::MIN_ROWS_PER_PIXEL);
+    }
+
+    if (options.outputPath.empty()) {
+        return exact ? 0 : 2;
+    }
+    std::string error;
+    CompressedHistory reloaded;
+    if (!history.save(options.outputPath, &error) || !reloaded.load(options.outputPath, &error)) {
+        std::fprintf(stderr, "%s\n", error.c_str());
+        return 1;
+    }
+    double reloadSeconds = 0.0;
+    const bool reloadExact = verify(reloaded, reloadSeconds);
+    std::fprintf(stderr, "saved              : %s, reload %s\n", options.outputPath.c_str(),
+                 reloadExact ? "bit-exact" : "MISMATCH");
+    return exact && reloadExact ? 0 : 2;
+}
+
+/*
+ * @brief Steps/sec of the DP5 path in PendulumIntegrator.
+ *
+ * Integrates the initial condition for --duration, best of a few runs, and
+ * prints the final state in full precision so runs of other builds of the
+ * same step can be compared against it.
+ */
+int runDp5Benchmark(const BatchOptions& options)
+{
+    constexpr int REPEATS = 3;
+    double bestSeconds = 0.0;
+    unsigned long long accepted = 0;
+    PendulumState finalState{};
+    for (int repeat = 0; repeat < REPEATS; ++repeat) {
+        PendulumIntegrator integrator(options.parameters, options.initialState);
+        integrator.setMethod(PendulumIntegrator::Method::DormandPrince5);
+        unsigned long long steps = 0;
+        const auto started = std::chrono::steady_clock::now();
+        while (integrator.time() < options.duration) {
+            const PendulumIntegrator::StepResult result = integrator.tryStep(options.duration - integrator.time());
+            if (result == PendulumIntegrator::StepResult::Failed) {
+                std::fprintf(stderr, "DP5 step failed at t = %.6f\n", integrator.time());
+                return 2;
+            }
+            if (result == PendulumIntegrator::StepResult::Accepted) ++steps;
+        }
+        const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count();
+        if (repeat == 0 || seconds < bestSeconds) {
+            bestSeconds = seconds;
+            accepted = steps;
+            finalState = integrator.state();
+        }
+    }
+
+    std::fprintf(stderr, "run                : %.3f s simulated, best of %d\n", options.duration, REPEATS);
+    std::fprintf(stderr, "accepted steps     : %llu\n", accepted);
+    std::fprintf(stderr, "steps/sec          : %.0f\n", accepted / std::max(bestSeconds, 1e-12));
+    std::fprintf(stderr, "final state        : %.17g %.17g %.17g %.17g\n",
+                 finalState[0], finalState[1], finalState[2], finalState[3]);
+    return 0;
+}
+
+namespace {
+
+using ChartPoint = std::array<double, 2>;
+
+// theta1 in degrees against time in seconds, as the charts plot it: `points`
+// samples at `rate` from the dense output, interleaved into `series`
+bool sampleChartSeries(const BatchOptions& options, std::size_t points, double rate, std::vector<double>& series)
+{
+    const double duration = static_cast<double>(points - 1) / rate;
+    PendulumIntegrator integrator(options.parameters, options.initialState);
+    integrator.setToleranceProfile(options.tolerances);
+    integrator.setMethod(options.method);
+    integrator.setFixedStepSize(options.fixedStep);
+
+    series.clear();
+    series.reserve(2 * points);
+    series.push_back(integrator.time());
+    series.push_back(integrator.state()[0] * 180.0 / M_PI);
+    std::size_t sampleIndex = 1;
+    while (sampleIndex < points) {
+        const PendulumIntegrator::StepResult result = integrator.tryStep(duration - integrator.time());
+        if (result == PendulumIntegrator::StepResult::Failed) {
+            std::fprintf(stderr, "Integration failed at t = %.6f\n", integrator.time());
+            return false;
+        }
+        if (result == PendulumIntegrator::StepResult::Rejected) {
+            continue;
+        }
+        double t = static_cast<double>(sampleIndex) / rate;
+        while (sampleIndex < points && t <= integrator.time()) {
+            series.push_back(t);
+            series.push_back(integrator.interpolate(t)[0] * 180.0 / M_PI);
+            t = static_cast<double>(++sampleIndex) / rate;
+        }
+    }
+    return true;
+}
+
+// The RDP the charts used before LineSimplifier, kept as the reference: a
+// recursive std::function that copies both halves at every level and
+// concatenates the results
+std::vector<ChartPoint> copyingRdp(const std::vector<ChartPoint>& input, double epsilon)
+{
+    auto perpendicularDistance = [](const ChartPoint& pt, const ChartPoint& p1, const ChartPoint& p2) {
+        double dx = p2[0] - p1[0], dy = p2[1] - p1[1];
+        const double mag = std::sqrt(dx * dx + dy * dy);
+        if (mag > 0.0) { dx /= mag; dy /= mag; }
+        const double pvx = pt[0] - p1[0], pvy = pt[1] - p1[1];
+        return std::abs(pvx * dy - pvy * dx);
+    };
+    std::function<std::vector<ChartPoint>(const std::vector<ChartPoint>&)> simplify;
+    simplify = [&](const std::vector<ChartPoint>& points) -> std::vector<ChartPoint> {
+        if (points.size() <= 2) return points;
+        double dmax = 0.0;
+        std::size_t index = 0;
+        const std::size_t end = points.size() - 1;
+        for (std::size_t i = 1; i < end; ++i) {
+            const double d = perpendicularDistance(points[i], points[0], points[end]);
+            if (d > dmax) { index = i; dmax = d; }
+        }
+        if (dmax <= epsilon) return {points.front(), points.back()};
+        const std::vector<ChartPoint> left = simplify(std::vector<ChartPoint>(points.begin(), points.begin() + index + 1));
+        const std::vector<ChartPoint> right = simplify(std::vector<ChartPoint>(points.begin() + index, points.end()));
+        std::vector<ChartPoint> result(left.begin(), left.end() - 1);
+        result.insert(result.end(), right.begin(), right.end());
+        return result;
+    };
+    return simplify(input);
+}
+
+} // namespace
+
+/*
+ * @brief LineSimplifier against the former chart RDP on a chart-sized viewport.
+ *
+ * Samples theta1 (degrees, against time in seconds, as the chart sees it)
+ * at --sample-rate for 500k points, then simplifies it at a few epsilons
+ * with both implementations and checks that they keep the same points.
+ * The budget mode is timed for a few target counts.
+ */
+int runRdpBenchmark(const BatchOptions& options)
+{
+    constexpr std::size_t POINTS = 500000;
+    const double rate = options.sampleRate > 0.0 ? options.sampleRate : 1000.0;
+    const double duration = static_cast<double>(POINTS - 1) / rate;
+
+    std::vector<double> series;
+    if (!sampleChartSeries(options, POINTS, rate, series)) {
+        return 2;
+    }
+    std::vector<ChartPoint> reference(POINTS);
+    std::copy(series.begin(), series.end(), reference.front().data());
+    std::fprintf(stderr, "series             : %zu points of theta1 over %.1f s\n", POINTS, duration);
+
+    auto secondsSince = [](std::chrono::steady_clock::time_point started) {
+        return std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count();
+    };
+    std::vector<double> work;
+    bool identical = true;
+    for (const double epsilon : {0.01, 0.25, 1.0}) {
+        auto started = std::chrono::steady_clock::now();
+        const std::vector<ChartPoint> old = copyingRdp(reference, epsilon);
+        const double oldSeconds = secondsSince(started);
+
+        work = series;
+        started = std::chrono::steady_clock::now();
+        const std::size_t kept = LineSimplifier::simplify(work.data(), POINTS, epsilon);
+        const double newSeconds = secondsSince(started);
+
+        const bool same = kept == old.size()
+            && std::equal(work.begin(), work.begin() + 2 * kept, old.front().data());
+        identical = identical && same;
+        std::fprintf(stderr, "epsilon %-10g : recursive %8.2f ms, in place %6.2f ms (%5.1fx), %zu points, %s\n",
+                     epsilon, oldSeconds * 1e3, newSeconds * 1e3, oldSeconds / std::max(newSeconds, 1e-9),
+                     kept, same ? "same points" : "DIFFERENT points");
+    }
+
+    LineSimplifier simplifier;
+    for (const std::size_t target : {1000u, 4000u, 20000u}) {
+        work = series;
+        const auto started = std::chrono::steady_clock::now();
+        const std::size_t kept = simplifier.simplifyToCount(work.data(), POINTS, target);
+        std::fprintf(stderr, "target %-11zu : %.2f ms, %zu points\n", target, secondsSince(started) * 1e3, kept);
+    }
+    return identical ? 0 : 2;
+}
@@ -0,0 +1,14 @@
+#ifndef BATCHBENCHMARKS_H
+#define BATCHBENCHMARKS_H
+
+#include "BatchOptions.h"
+
+// --bench-* measurements of pendulum_batch; each prints its report on stderr
+// and returns the process exit status
+
+int runKernelBenchmark(const BatchOptions& options);
+int runHistoryBenchmark(const BatchOptions& options);
+int runDp5Benchmark(const BatchOptions& options);
+int runRdpBenchmark(const BatchOptions& options);
+
+#endif // BATCHBENCHMARKS_H
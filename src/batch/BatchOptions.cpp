@@ -0,0 +1,408 @@
+#include "BatchOptions.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+
+namespace {
+
+const ParameterName PARAMETER_NAMES[] = {
+    {"m1", &PendulumParameters::m1},
+    {"m2", &PendulumParameters::m2},
+    {"rod-mass1", &PendulumParameters::rodMass1},
+    {"rod-mass2", &PendulumParameters::rodMass2},
+    {"l1", &PendulumParameters::l1},
+    {"l2", &PendulumParameters::l2},
+    {"b1", &PendulumParameters::b1},
+    {"b2", &PendulumParameters::b2},
+    {"c1", &PendulumParameters::c1},
+    {"c2", &PendulumParameters::c2},
+    {"g", &PendulumParameters::g},
+};
+
+bool parseDouble(const char* text, double& value)
+{
+    char* end = nullptr;
+    value = std::strtod(text, &end);
+    return end != text && *end == '\0' && std::isfinite(value);
+}
+
+} // namespace
+
+void printUsage(const char* program)
+{
+    std::fprintf(stderr,
+        "Usage: %s [options]\n"
+        "\n"
+        "Integrates the double pendulum for a fixed simulated time without\n"
+        "real-time throttling and reports the integrator throughput.\n"
+        "\n"
+        "  --duration S        simulated seconds to integrate (default 10)\n"
+        "  --theta1 R          initial absolute angle of rod 1, rad (default pi/4)\n"
+        "  --omega1 R          initial angular velocity of rod 1, rad/s (default 0)\n"
+        "  --theta2 R          initial angle of rod 2 relative to rod 1, rad (default pi/4)\n"
+        "  --omega2 R          initial relative angular velocity of rod 2, rad/s (default 0)\n"
+        "  --m1, --m2 KG       point masses (default 1)\n"
+        "  --rod-mass1, --rod-mass2 KG  rod masses (default 0.5)\n"
+        "  --l1, --l2 M        rod lengths (default 1)\n"
+        "  --b1, --b2 K        linear friction coefficients (default 0)\n"
+        "  --c1, --c2 K        quadratic air resistance coefficients (default 0)\n"
+        "  --g A               gravity acceleration (default 9.81)\n"
+        "  --output PATH       stream the trajectory to PATH (default: no output)\n"
+        "  --format F          csv, binary (raw doubles) or trajectory: a .dptraj\n"
+        "                      recording with the parameters in its header, written\n"
+        "                      by a background thread (default csv)\n"
+        "  --every N           record every N-th accepted step (default 1)\n"
+        "  --sample-rate HZ    record at a fixed simulated rate instead, interpolating\n"
+        "                      within steps (dense output); overrides --every\n"
+        "  --profile P         adaptive tolerance preset: realtime (atol 1e-9, rtol 1e-8,\n"
+        "                      max step 0.02), analysis (1e-12, 1e-11, 0.01) or\n"
+        "                      reference (1e-14, 1e-13, 0.005; default)\n"
+        "  --atol A, --rtol R  override the preset's absolute/relative tolerance\n"
+        "  --hmin H            override the smallest step before giving up\n"
+        "  --max-step H        override the largest step the controller may take\n"
+        "  --method M          dp5, dop853 (adaptive 5th/8th order), midpoint, gl4,\n"
+        "                      gl6 (symplectic Gauss-Legendre, fixed step) or auto:\n"
+        "                      gl4 without friction, dp5 with it (default dp5)\n"
+        "  --step H            fixed step of the Gauss-Legendre methods (default 0.01)\n"
+        "  --compare-methods   run every method for --duration (e.g. 3600) and report\n"
+        "                      steps/sec, RHS calls and energy error\n"
+        "  --compare-tolerances  run dp5 and dop853 at rtol 1e-6 ... 1e-13 (atol =\n"
+        "                      rtol/10, no step cap unless --max-step) and report RHS\n"
+        "                      calls per simulated second and the final-state error\n"
+        "                      against a dop853 run at rtol 1e-15\n"
+        "\n"
+        "Poincare mode writes one row per section crossing, located exactly on the\n"
+        "dense output (t, state, and the two map coordinates):\n"
+        "  --poincare S[=L]    section: theta1, theta2 (absolute angle = L, mod 2pi,\n"
+        "                      lower half), omega1 or energy (= L); L defaults to 0\n"
+        "  --section-direction up|down|both\n"
+        "                      crossings counted (default up; both for energy)\n"
+        "\n"
+        "Ensemble mode integrates N members in parallel and writes one row of\n"
+        "reductions per member (final state, energy drift, first flip time):\n"
+        "  --ensemble N        number of members (default: single trajectory)\n"
+        "  --spread R          theta1 offset between neighbouring members, rad (default 1e-6)\n"
+        "  --threads N         worker threads (default: all hardware threads)\n"
+        "  --simd MODE         auto|avx512|avx2|scalar: best allowed batch kernel level,\n"
+        "                      off: reference integrator per member (default auto);\n"
+        "                      at the scalar level the reference integrator is used\n"
+        "\n"
+        "Flip-map mode integrates one pendulum per pixel, starting at rest, until\n"
+        "either rod flips over; x is theta1, y the absolute theta2 (top = +range):\n"
+        "  --flip-map WxH      map size in pixels, e.g. 2048x2048\n"
+        "  --map-range R       both angles span [-R, R], rad (default pi)\n"
+        "  --map-format F      pgm: 16-bit PGM, 65535 = instant flip down to 1 at\n"
+        "                      the duration, 0 = never; raw: W*H floats in seconds,\n"
+        "                      -1 = never (default pgm)\n"
+        "\n"
+        "Lyapunov mode integrates the variational equations along the trajectory\n"
+        "and reports the exponents; with --sweep, one row per parameter set:\n"
+        "  --lyapunov          enable (duration includes the transient)\n"
+        "  --exponents K       1: lambda_max only, 4: full spectrum (default 1)\n"
+        "  --transient S       seconds before averaging starts (default 10)\n"
+        "  --renorm S          seconds between renormalizations (default 0.5)\n"
+        "  --sweep P=A:B:N     N values of parameter P from A to B; repeat for a\n"
+        "                      grid (P: m1, m2, rod-mass1, rod-mass2, l1, l2, b1, b2,\n"
+        "                      c1, c2, g)\n"
+        "\n"
+        "  --bench-kernel      integrate an ensemble (default 512 members) on one thread\n"
+        "                      with the reference integrator and every available kernel\n"
+        "                      level, and compare throughput and results\n"
+        "  --bench-history     integrate one run into the compressed history tier and\n"
+        "                      report bytes per row, encode and viewport decode speed;\n"
+        "                      with --output, save it as .dphist and verify the reload\n"
+        "  --bench-rdp         simplify a 500k-point theta1 series (at --sample-rate,\n"
+        "                      default 1000 Hz) with LineSimplifier and with the former\n"
+        "                      recursive, copying RDP, and compare time and output\n"
+        "  --bench-dp5         integrate one run for --duration with the DP5 step of\n"
+        "                      PendulumIntegrator and print steps/sec and the final state\n"
+        "  --replay-info PATH  memory-map a .dptraj recording and print its header,\n"
+        "                      energy drift and scan/lookup timings\n"
+        "  --help              show this help\n",
+        program);
+}
+
+bool parseArguments(int argc, char* argv[], BatchOptions& options)
+{
+    struct DoubleOption { const char* name; double* target; };
+    const DoubleOption doubleOptions[] = {
+        {"--duration", &options.duration},
+        {"--theta1", &options.initialState[0]},
+        {"--omega1", &options.initialState[1]},
+        {"--theta2", &options.initialState[2]},
+        {"--omega2", &options.initialState[3]},
+        {"--m1", &options.parameters.m1},
+        {"--m2", &options.parameters.m2},
+        {"--rod-mass1", &options.parameters.rodMass1},
+        {"--rod-mass2", &options.parameters.rodMass2},
+        {"--l1", &options.parameters.l1},
+        {"--l2", &options.parameters.l2},
+        {"--b1", &options.parameters.b1},
+        {"--b2", &options.parameters.b2},
+        {"--c1", &options.parameters.c1},
+        {"--c2", &options.parameters.c2},
+        {"--g", &options.parameters.g},
+    };
+
+    for (int i = 1; i < argc; ++i) {
+        const char* arg = argv[i];
+        if (std::strcmp(arg, "--help") == 0) {
+            return false;
+        }
+        if (std::strcmp(arg, "--bench-kernel") == 0) {
+            options.benchKernel = true;
+            continue;
+        }
+        if (std::strcmp(arg, "--bench-history") == 0) {
+            options.benchHistory = true;
+            continue;
+        }
+        if (std::strcmp(arg, "--bench-rdp") == 0) {
+            options.benchRdp = true;
+            continue;
+        }
+        if (std::strcmp(arg, "--bench-dp5") == 0) {
+            options.benchDp5 = true;
+            continue;
+        }
+        if (std::strcmp(arg, "--compare-methods") == 0) {
+            options.compareMethods = true;
+            continue;
+        }
+        if (std::strcmp(arg, "--compare-tolerances") == 0) {
+            options.compareTolerances = true;
+            continue;
+        }
+        if (std::strcmp(arg, "--lyapunov") == 0) {
+            options.lyapunov = true;
+            continue;
+        }
+        if (i + 1 >= argc) {
+            std::fprintf(stderr, "Missing value for %s\n", arg);
+            return false;
+        }
+        const char* value = argv[++i];
+
+        bool matched = false;
+        for (const DoubleOption& option : doubleOptions) {
+            if (std::strcmp(arg, option.name) == 0) {
+                if (!parseDouble(value, *option.target)) {
+                    std::fprintf(stderr, "Invalid number for %s: %s\n", arg, value);
+                    return false;
+                }
+                matched = true;
+                break;
+            }
+        }
+        if (matched) continue;
+
+        if (std::strcmp(arg, "--output") == 0) {
+            options.outputPath = value;
+        } else if (std::strcmp(arg, "--format") == 0) {
+            if (std::strcmp(value, "csv") == 0) {
+                options.format = OutputFormat::Csv;
+            } else if (std::strcmp(value, "binary") == 0) {
+                options.format = OutputFormat::Binary;
+            } else if (std::strcmp(value, "trajectory") == 0) {
+                options.format = OutputFormat::Trajectory;
+            } else {
+                std::fprintf(stderr, "Unknown format: %s\n", value);
+                return false;
+            }
+        } else if (std::strcmp(arg, "--replay-info") == 0) {
+            options.replayPath = value;
+        } else if (std::strcmp(arg, "--ensemble") == 0) {
+            options.ensembleSize = static_cast<std::size_t>(std::max(0LL, std::atoll(value)));
+        } else if (std::strcmp(arg, "--spread") == 0) {
+            if (!parseDouble(value, options.spread)) {
+                std::fprintf(stderr, "Invalid number for %s: %s\n", arg, value);
+                return false;
+            }
+        } else if (std::strcmp(arg, "--threads") == 0) {
+            options.threads = static_cast<std::size_t>(std::max(0LL, std::atoll(value)));
+        } else if (std::strcmp(arg, "--simd") == 0) {
+            options.vectorized = true;
+            if (std::strcmp(value, "off") == 0) {
+                options.vectorized = false;
+            } else if (std::strcmp(value, "auto") == 0 || std::strcmp(value, "avx512") == 0) {
+                options.maxSimdLevel = SimdLevel::Avx512;
+            } else if (std::strcmp(value, "avx2") == 0) {
+                options.maxSimdLevel = SimdLevel::Avx2;
+            } else if (std::strcmp(value, "scalar") == 0) {
+                options.maxSimdLevel = SimdLevel::Scalar;
+            } else {
+                std::fprintf(stderr, "Unknown SIMD mode: %s\n", value);
+                return false;
+            }
+        } else if (std::strcmp(arg, "--flip-map") == 0) {
+            unsigned long width = 0;
+            unsigned long height = 0;
+            if (std::sscanf(value, "%lux%lu", &width, &height) != 2 || width == 0 || height == 0) {
+                std::fprintf(stderr, "Invalid map size: %s (expected WxH)\n", value);
+                return false;
+            }
+            options.mapWidth = width;
+            options.mapHeight = height;
+        } else if (std::strcmp(arg, "--map-range") == 0) {
+            if (!parseDouble(value, options.mapRange) || options.mapRange <= 0.0) {
+                std::fprintf(stderr, "Invalid map range: %s\n", value);
+                return false;
+            }
+        } else if (std::strcmp(arg, "--map-format") == 0) {
+            if (std::strcmp(value, "pgm") == 0) {
+                options.mapFormat = MapFormat::Pgm16;
+            } else if (std::strcmp(value, "raw") == 0) {
+                options.mapFormat = MapFormat::RawFloat;
+            } else {
+                std::fprintf(stderr, "Unknown map format: %s\n", value);
+                return false;
+            }
+        } else if (std::strcmp(arg, "--exponents") == 0) {
+            options.lyapunovConfig.exponentCount = std::atoi(value);
+            if (options.lyapunovConfig.exponentCount < 1 || options.lyapunovConfig.exponentCount > 4) {
+                std::fprintf(stderr, "--exponents must be between 1 and 4\n");
+                return false;
+            }
+        } else if (std::strcmp(arg, "--transient") == 0) {
+            if (!parseDouble(value, options.lyapunovConfig.transient) || options.lyapunovConfig.transient < 0.0) {
+                std::fprintf(stderr, "Invalid transient: %s\n", value);
+                return false;
+            }
+        } else if (std::strcmp(arg, "--renorm") == 0) {
+            if (!parseDouble(value, options.lyapunovConfig.renormalizationInterval)
+                || options.lyapunovConfig.renormalizationInterval <= 0.0) {
+                std::fprintf(stderr, "Invalid renormalization interval: %s\n", value);
+                return false;
+            }
+        } else if (std::strcmp(arg, "--sweep") == 0) {
+            SweepAxis axis;
+            char name[32] = {};
+            unsigned long count = 0;
+            if (std::sscanf(value, "%31[^=]=%lf:%lf:%lu", name, &axis.from, &axis.to, &count) != 4 || count == 0) {
+                std::fprintf(stderr, "Invalid sweep: %s (expected P=FROM:TO:COUNT)\n", value);
+                return false;
+            }
+            for (const ParameterName& parameter : PARAMETER_NAMES) {
+                if (std::strcmp(name, parameter.name) == 0) {
+                    axis.parameter = &parameter;
+                }
+            }
+            if (!axis.parameter) {
+                std::fprintf(stderr, "Unknown sweep parameter: %s\n", name);
+                return false;
+            }
+            axis.count = count;
+            options.sweepAxes.push_back(axis);
+        } else if (std::strcmp(arg, "--sample-rate") == 0) {
+            if (!parseDouble(value, options.sampleRate) || options.sampleRate <= 0.0) {
+                std::fprintf(stderr, "Invalid sample rate: %s\n", value);
+                return false;
+            }
+        } else if (std::strcmp(arg, "--profile") == 0) {
+            if (!PendulumIntegrator::ToleranceProfile::fromName(value, options.tolerances)) {
+                std::fprintf(stderr, "Unknown tolerance profile: %s\n", value);
+                return false;
+            }
+        } else if (std::strcmp(arg, "--atol") == 0 || std::strcmp(arg, "--rtol") == 0
+                   || std::strcmp(arg, "--hmin") == 0 || std::strcmp(arg, "--max-step") == 0) {
+            double* target = std::strcmp(arg, "--atol") == 0   ? &options.absoluteTolerance
+                             : std::strcmp(arg, "--rtol") == 0 ? &options.relativeTolerance
+                             : std::strcmp(arg, "--hmin") == 0 ? &options.minStep
+                                                               : &options.maxStep;
+            if (!parseDouble(value, *target) || *target <= 0.0) {
+                std::fprintf(stderr, "Invalid value for %s: %s\n", arg, value);
+                return false;
+            }
+        } else if (std::strcmp(arg, "--method") == 0) {
+            const PendulumIntegrator::Method methods[] = {
+                PendulumIntegrator::Method::DormandPrince5, PendulumIntegrator::Method::DormandPrince853,
+                PendulumIntegrator::Method::ImplicitMidpoint, PendulumIntegrator::Method::GaussLegendre4,
+                PendulumIntegrator::Method::GaussLegendre6, PendulumIntegrator::Method::Automatic,
+            };
+            bool known = false;
+            for (PendulumIntegrator::Method method : methods) {
+                if (std::strcmp(value, PendulumIntegrator::methodName(method)) == 0) {
+                    options.method = method;
+                    known = true;
+                }
+            }
+            if (!known) {
+                std::fprintf(stderr, "Unknown method: %s\n", value);
+                return false;
+            }
+        } else if (std::strcmp(arg, "--step") == 0) {
+            if (!parseDouble(value, options.fixedStep) || options.fixedStep < PendulumIntegrator::DOPRI_HMIN) {
+                std::fprintf(stderr, "Invalid step: %s\n", value);
+                return false;
+            }
+        } else if (std::strcmp(arg, "--poincare") == 0) {
+            struct SectionName { const char* name; PoincareSection::Kind kind; };
+            const SectionName sectionNames[] = {
+                {"theta1", PoincareSection::Kind::Theta1},
+                {"theta2", PoincareSection::Kind::Theta2},
+                {"omega1", PoincareSection::Kind::Omega1},
+                {"energy", PoincareSection::Kind::Energy},
+            };
+            const char* separator = std::strchr(value, '=');
+            const std::string name = separator ? std::string(value, separator) : std::string(value);
+            options.section.level = 0.0;
+            if (separator && !parseDouble(separator + 1, options.section.level)) {
+                std::fprintf(stderr, "Invalid section level: %s\n", value);
+                return false;
+            }
+            options.poincare = false;
+            for (const SectionName& section : sectionNames) {
+                if (name == section.name) {
+                    options.section.kind = section.kind;
+                    options.poincare = true;
+                }
+            }
+            if (!options.poincare) {
+                std::fprintf(stderr, "Unknown section: %s\n", value);
+                return false;
+            }
+            if (options.section.kind == PoincareSection::Kind::Energy) {
+                options.section.direction = PoincareSection::Direction::Both;
+            }
+        } else if (std::strcmp(arg, "--section-direction") == 0) {
+            if (std::strcmp(value, "up") == 0) {
+                options.section.direction = PoincareSection::Direction::Increasing;
+            } else if (std::strcmp(value, "down") == 0) {
+                options.section.direction = PoincareSection::Direction::Decreasing;
+            } else if (std::strcmp(value, "both") == 0) {
+                options.section.direction = PoincareSection::Direction::Both;
+            } else {
+                std::fprintf(stderr, "Unknown section direction: %s\n", value);
+                return false;
+            }
+        } else if (std::strcmp(arg, "--every") == 0) {
+            options.recordEvery = std::atoll(value);
+            if (options.recordEvery < 1) {
+                std::fprintf(stderr, "--every must be at least 1\n");
+                return false;
+            }
+        } else {
+            std::fprintf(stderr, "Unknown option: %s\n", arg);
+            return false;
+        }
+    }
+
+    if (options.duration <= 0.0) {
+        std::fprintf(stderr, "--duration must be positive\n");
+        return false;
+    }
+
+    PendulumIntegrator::ToleranceProfile& tolerances = options.tolerances;
+    tolerances.absoluteTolerance = std::isnan(options.absoluteTolerance) ? tolerances.absoluteTolerance : options.absoluteTolerance;
+    tolerances.relativeTolerance = std::isnan(options.relativeTolerance) ? tolerances.relativeTolerance : options.relativeTolerance;
+    tolerances.minStep = std::isnan(options.minStep) ? tolerances.minStep : options.minStep;
+    tolerances.maxStep = std::isnan(options.maxStep) ? tolerances.maxStep : options.maxStep;
+    if (tolerances.minStep > tolerances.maxStep) {
+        std::fprintf(stderr, "--hmin must not exceed the maximum step\n");
+        return false;
+    }
+    return true;
+}
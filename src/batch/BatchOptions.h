@@ -0,0 +1,82 @@
+#ifndef BATCHOPTIONS_H
+#define BATCHOPTIONS_H
+
+#include <cmath>
+#include <cstddef>
+#include <string>
+#include <vector>
+#include "core/BatchKernel.h"
+#include "core/LyapunovEstimator.h"
+#include "core/PendulumIntegrator.h"
+#include "core/PoincareSection.h"
+
+enum class OutputFormat { Csv, Binary, Trajectory }; // Trajectory: .dptraj through TrajectoryRecorder
+enum class MapFormat { Pgm16, RawFloat };
+
+// Physical parameters addressable by name (--sweep)
+struct ParameterName {
+    const char* name;
+    double PendulumParameters::*member;
+};
+// One swept parameter: count values evenly spaced over [from, to]
+struct SweepAxis {
+    const ParameterName* parameter = nullptr;
+    double from = 0.0;
+    double to = 0.0;
+    std::size_t count = 1;
+};
+
+struct BatchOptions {
+    PendulumParameters parameters;
+    PendulumState initialState{M_PI / 4, 0.0, M_PI / 4, 0.0};
+    double duration = 10.0;        // Simulated seconds
+    std::string outputPath;        // Empty: integrate only, write nothing
+    OutputFormat format = OutputFormat::Csv;
+    long long recordEvery = 1;     // Write every N-th accepted step
+    double sampleRate = 0.0;       // > 0: rows at this simulated rate from the dense output, Hz
+    // DP5 controller: a named preset, then any individual overrides (NaN = keep the preset's)
+    PendulumIntegrator::ToleranceProfile tolerances;
+    double absoluteTolerance = NAN;
+    double relativeTolerance = NAN;
+    double minStep = NAN;
+    double maxStep = NAN;
+    PendulumIntegrator::Method method = PendulumIntegrator::Method::DormandPrince5;
+    double fixedStep = PendulumIntegrator::DEFAULT_FIXED_STEP;
+    bool compareMethods = false;   // Steps/sec and energy error of every scheme
+    bool compareTolerances = false; // RHS calls of DP5 and DOP853 across tolerances
+    std::string replayPath;        // Non-empty: summarise this recording instead of integrating
+
+    // Poincare mode: one row per located section crossing
+    bool poincare = false;
+    PoincareSection section;
+
+    // Ensemble mode: members spread along theta1 around the initial condition
+    std::size_t ensembleSize = 0;  // 0: single trajectory
+    double spread = 1.0e-6;        // theta1 distance between neighbouring members, rad
+    std::size_t threads = 0;       // 0: every hardware thread
+    bool vectorized = true;        // --simd off: PendulumIntegrator per member
+    SimdLevel maxSimdLevel = SimdLevel::Avx512;
+
+    bool benchKernel = false;      // Compare the batch kernel against the reference path
+    bool benchHistory = false;     // Compressed history: size, encode/decode speed, round trip
+    bool benchRdp = false;         // Chart line simplification against the old recursive RDP
+    bool benchDp5 = false;         // Steps/sec of the DP5 step in PendulumIntegrator
+
+    // Flip-map mode: one simulation per pixel over a theta1 x theta2 grid
+    std::size_t mapWidth = 0;      // 0: no map
+    std::size_t mapHeight = 0;
+    double mapRange = M_PI;        // Both angles span [-range, range]
+    MapFormat mapFormat = MapFormat::Pgm16;
+
+    // Lyapunov mode: exponents for one parameter set or a grid of them
+    bool lyapunov = false;
+    LyapunovConfig lyapunovConfig;
+    std::vector<SweepAxis> sweepAxes;
+};
+
+void printUsage(const char* program);
+
+// Fills options from the command line; false on an unknown or malformed argument
+bool parseArguments(int argc, char* argv[], BatchOptions& options);
+
+#endif // BATCHOPTIONS_H
@@ -0,0 +1,655 @@
+#include "BatchRuns.h"
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+#include "core/EnsembleEngine.h"
+#include "core/FlipMapGenerator.h"
+#include "core/TrajectoryRecorder.h"
+#include "core/TrajectoryReplay.h"
+
+namespace {
+
+/*
+ * @brief Buffered sequential writer for rows of doubles.
+ *
+ * Rows are formatted into a fixed block and handed to fwrite() only when the
+ * block is full, so the integration loop never waits on small writes.
+ * CSV output starts with the given header line; binary rows are raw
+ * native-endian doubles in the same column order.
+ */
+class RowWriter
+{
+public:
+    RowWriter(std::FILE* file, OutputFormat format, const char* csvHeader)
+        : m_file(file)
+        , m_format(format)
+    {
+        m_block.reserve(BLOCK_SIZE);
+        if (m_format == OutputFormat::Csv) {
+            appendText(csvHeader);
+            appendText("\n");
+        }
+    }
+
+    ~RowWriter() { flush(); }
+
+    void write(const double* values, std::size_t count)
+    {
+        if (m_format == OutputFormat::Binary) {
+            append(reinterpret_cast<const char*>(values), count * sizeof(double));
+            return;
+        }
+        char line[32 * 16];
+        std::size_t length = 0;
+        for (std::size_t i = 0; i < count && length + 32 < sizeof(line); ++i) {
+            length += static_cast<std::size_t>(std::snprintf(line + length, sizeof(line) - length,
+                                                             i == 0 ? "%.17g" : ",%.17g", values[i]));
+        }
+        line[length++] = '\n';
+        append(line, length);
+    }
+
+    void flush()
+    {
+        if (!m_block.empty()) {
+            m_bytesWritten += std::fwrite(m_block.data(), 1, m_block.size(), m_file);
+            m_block.clear();
+        }
+    }
+
+    std::size_t bytesWritten() const { return m_bytesWritten + m_block.size(); }
+
+private:
+    static constexpr std::size_t BLOCK_SIZE = 1 << 20; // 1 MiB per fwrite
+
+    void appendText(const char* text) { append(text, std::strlen(text)); }
+
+    void append(const char* data, std::size_t size)
+    {
+        if (m_block.size() + size > BLOCK_SIZE) {
+            flush();
+        }
+        m_block.insert(m_block.end(), data, data + size);
+    }
+
+    std::FILE* m_file;
+    OutputFormat m_format;
+    std::vector<char> m_block;
+    std::size_t m_bytesWritten = 0;
+};
+
+// Integrates to options.duration with the given method and controller settings
+PendulumIntegrator integrateTo(const BatchOptions& options, PendulumIntegrator::Method method,
+                               const PendulumIntegrator::ToleranceProfile& tolerances)
+{
+    PendulumIntegrator integrator(options.parameters, options.initialState);
+    integrator.setToleranceProfile(tolerances);
+    integrator.setMethod(method);
+    while (integrator.time() < options.duration) {
+        const double remaining = options.duration - integrator.time();
+        if (remaining < tolerances.minStep / 2.0
+            || integrator.tryStep(remaining) == PendulumIntegrator::StepResult::Failed) {
+            break;
+        }
+    }
+    return integrator;
+}
+
+// Cartesian product of the sweep axes, first axis varying slowest
+std::vector<PendulumParameters> expandSweep(const PendulumParameters& base, const std::vector<SweepAxis>& axes)
+{
+    std::vector<PendulumParameters> sets{base};
+    for (const SweepAxis& axis : axes) {
+        std::vector<PendulumParameters> expanded;
+        expanded.reserve(sets.size() * axis.count);
+        for (const PendulumParameters& set : sets) {
+            for (std::size_t i = 0; i < axis.count; ++i) {
+                const double u = axis.count > 1 ? static_cast<double>(i) / static_cast<double>(axis.count - 1) : 0.0;
+                PendulumParameters parameters = set;
+                parameters.*(axis.parameter->member) = axis.from + u * (axis.to - axis.from);
+                expanded.push_back(parameters);
+            }
+        }
+        sets.swap(expanded);
+    }
+    return sets;
+}
+
+} // namespace
+
+int runSingle(const BatchOptions& options, std::FILE* outputFile)
+{
+    PendulumIntegrator integrator(options.parameters, options.initialState);
+    integrator.setToleranceProfile(options.tolerances);
+    integrator.setMethod(options.method);
+    integrator.setFixedStepSize(options.fixedStep);
+    const double initialEnergy = integrator.energies().total;
+
+    long long acceptedSteps = 0;
+    long long rejectedSteps = 0;
+    long long sampleIndex = 1; // Fixed-rate mode: next grid time is sampleIndex / sampleRate
+    std::size_t bytesWritten = 0;
+
+    const auto started = std::chrono::steady_clock::now();
+    {
+        std::unique_ptr<RowWriter> writer;
+        std::unique_ptr<TrajectoryRecorder> recorder;
+        auto writeState = [&](double t, const PendulumState& state) {
+            const PendulumEnergies energies = PendulumIntegrator::energies(options.parameters, state);
+            if (recorder) {
+                recorder->append({t, state[0], state[1], state[2], state[3], energies.kinetic, energies.potential});
+            } else {
+                const double row[6] = {t, state[0], state[1], state[2], state[3], energies.total};
+                writer->write(row, 6);
+            }
+        };
+        if (outputFile) {
+            writer = std::make_unique<RowWriter>(outputFile, options.format, "t,theta1,omega1,theta2,omega2,total_energy");
+        } else if (options.format == OutputFormat::Trajectory && !options.outputPath.empty()) {
+            recorder = std::make_unique<TrajectoryRecorder>();
+            const TrajectoryFileHeader header = TrajectoryFileHeader::make(
+                options.parameters, PendulumIntegrator::methodName(integrator.activeMethod()), options.sampleRate);
+            if (!recorder->open(options.outputPath, header)) {
+                std::fprintf(stderr, "Failed to open %s for writing\n", options.outputPath.c_str());
+                return 1;
+            }
+        }
+        const bool recording = writer || recorder;
+        if (recording) {
+            writeState(integrator.time(), integrator.state());
+        }
+
+        while (integrator.time() < options.duration) {
+            const double remaining = options.duration - integrator.time();
+            if (remaining < PendulumIntegrator::DOPRI_HMIN / 2.0) {
+                break;
+            }
+            const PendulumIntegrator::StepResult result = integrator.tryStep(remaining);
+            if (result == PendulumIntegrator::StepResult::Failed) {
+                break;
+            }
+            if (result == PendulumIntegrator::StepResult::Rejected) {
+                ++rejectedSteps;
+                continue;
+            }
+            ++acceptedSteps;
+            if (recording && options.sampleRate > 0.0) {
+                // Every grid time inside the step just taken, read off its interpolant
+                double t = static_cast<double>(sampleIndex) / options.sampleRate;
+                while (t <= integrator.time()) {
+                    writeState(t, integrator.interpolate(t));
+                    t = static_cast<double>(++sampleIndex) / options.sampleRate;
+                }
+            } else if (recording && acceptedSteps % options.recordEvery == 0) {
+                writeState(integrator.time(), integrator.state());
+            }
+        }
+
+        if (writer) {
+            writer->flush();
+            bytesWritten = writer->bytesWritten();
+        } else if (recorder) {
+            // Joins the writer thread, so the count covers every frame
+            if (!recorder->close()) {
+                std::fprintf(stderr, "Failed to write %s\n", options.outputPath.c_str());
+            }
+            bytesWritten = recorder->bytesWritten();
+        }
+    }
+    const double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count();
+
+    const double finalEnergy = integrator.energies().total;
+    const PendulumState& finalState = integrator.state();
+    std::fprintf(stderr, "method             : %s (profile %s)\n", PendulumIntegrator::methodName(integrator.activeMethod()),
+                 integrator.toleranceProfile().name());
+    std::fprintf(stderr, "simulated time     : %.6f s%s\n", integrator.time(), integrator.failed() ? " (integration failed)" : "");
+    std::fprintf(stderr, "accepted steps     : %lld\n", acceptedSteps);
+    std::fprintf(stderr, "rejected steps     : %lld (%.2f%% of attempts)\n", rejectedSteps,
+                 acceptedSteps + rejectedSteps > 0 ? 100.0 * rejectedSteps / (acceptedSteps + rejectedSteps) : 0.0);
+    if (integrator.collocationRetries() > 0) {
+        std::fprintf(stderr, "collocation retries: %llu (fixed steps halved once the stage iteration diverged)\n",
+                     static_cast<unsigned long long>(integrator.collocationRetries()));
+    }
+    std::fprintf(stderr, "average step       : %.6g s\n", acceptedSteps > 0 ? integrator.time() / acceptedSteps : 0.0);
+    std::fprintf(stderr, "rhs evaluations    : %llu\n", static_cast<unsigned long long>(integrator.rhsEvaluations()));
+    std::fprintf(stderr, "wall time          : %.6f s\n", elapsed);
+    std::fprintf(stderr, "steps/sec          : %.0f\n", elapsed > 0.0 ? acceptedSteps / elapsed : 0.0);
+    std::fprintf(stderr, "sim s per wall s   : %.1f\n", elapsed > 0.0 ? integrator.time() / elapsed : 0.0);
+    std::fprintf(stderr, "energy drift       : %.3e J\n", finalEnergy - initialEnergy);
+    std::fprintf(stderr, "final state        : %.17g %.17g %.17g %.17g\n", finalState[0], finalState[1], finalState[2], finalState[3]);
+    if (!options.outputPath.empty()) {
+        std::fprintf(stderr, "bytes written      : %zu\n", bytesWritten);
+    }
+
+    return integrator.failed() ? 2 : 0;
+}
+
+int runEnsemble(const BatchOptions& options, std::FILE* outputFile)
+{
+    EnsembleEngine::Config config;
+    config.parameters = options.parameters;
+    config.tolerances = options.tolerances;
+    config.duration = options.duration;
+    config.threadCount = options.threads;
+    config.vectorized = options.vectorized;
+    config.maxSimdLevel = options.maxSimdLevel;
+
+    EnsembleEngine engine(config);
+    const std::size_t n = options.ensembleSize;
+    engine.resize(n);
+    const double center = 0.5 * static_cast<double>(n - 1);
+    for (std::size_t i = 0; i < n; ++i) {
+        PendulumState state = options.initialState;
+        state[0] += (static_cast<double>(i) - center) * options.spread;
+        engine.setInitialState(i, state);
+    }
+
+    const auto started = std::chrono::steady_clock::now();
+    engine.run();
+    const double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count();
+
+    const EnsembleBatch& batch = engine.batch();
+    unsigned long long acceptedSteps = 0;
+    std::size_t flipped = 0;
+    std::size_t failed = 0;
+    double worstDrift = 0.0;
+    for (std::size_t i = 0; i < n; ++i) {
+        acceptedSteps += batch.acceptedSteps[i];
+        flipped += batch.firstFlipTime[i] >= 0.0 ? 1 : 0;
+        failed += batch.failed[i];
+        worstDrift = std::max(worstDrift, batch.maxEnergyDrift[i]);
+    }
+
+    if (outputFile) {
+        RowWriter writer(outputFile, options.format,
+                         "member,theta1_0,omega1_0,theta2_0,omega2_0,"
+                         "t_end,theta1,omega1,theta2,omega2,"
+                         "max_energy_drift,final_energy_drift,first_flip_time,accepted_steps,rejected_steps,failed");
+        for (std::size_t i = 0; i < n; ++i) {
+            const double row[16] = {
+                static_cast<double>(i), batch.theta1[i], batch.omega1[i], batch.theta2[i], batch.omega2[i],
+                batch.finalTime[i], batch.finalTheta1[i], batch.finalOmega1[i], batch.finalTheta2[i], batch.finalOmega2[i],
+                batch.maxEnergyDrift[i], batch.finalEnergyDrift[i], batch.firstFlipTime[i],
+                static_cast<double>(batch.acceptedSteps[i]), static_cast<double>(batch.rejectedSteps[i]),
+                static_cast<double>(batch.failed[i])};
+            writer.write(row, 16);
+        }
+    }
+
+    std::fprintf(stderr, "members            : %zu\n", n);
+    std::fprintf(stderr, "threads            : %zu (%zu steals)\n", engine.lastThreadCount(), engine.lastStealCount());
+    std::fprintf(stderr, "kernel             : %s\n",
+                 engine.lastRunVectorized() ? BatchKernel::name(engine.lastSimdLevel()) : "reference");
+    std::fprintf(stderr, "accepted steps     : %llu\n", acceptedSteps);
+    std::fprintf(stderr, "wall time          : %.6f s\n", elapsed);
+    std::fprintf(stderr, "steps/sec          : %.0f\n", elapsed > 0.0 ? acceptedSteps / elapsed : 0.0);
+    std::fprintf(stderr, "members/sec        : %.1f\n", elapsed > 0.0 ? n / elapsed : 0.0);
+    std::fprintf(stderr, "flipped members    : %zu\n", flipped);
+    std::fprintf(stderr, "worst energy drift : %.3e J\n", worstDrift);
+    if (failed > 0) {
+        std::fprintf(stderr, "failed members     : %zu\n", failed);
+    }
+
+    return failed > 0 ? 2 : 0;
+}
+
+int runFlipMap(const BatchOptions& options, std::FILE* outputFile)
+{
+    FlipMapConfig config;
+    config.parameters = options.parameters;
+    config.tolerances = options.tolerances;
+    config.width = options.mapWidth;
+    config.height = options.mapHeight;
+    config.theta1Min = config.theta2Min = -options.mapRange;
+    config.theta1Max = config.theta2Max = options.mapRange;
+    config.duration = options.duration;
+    config.threadCount = options.threads;
+    config.maxSimdLevel = options.vectorized ? options.maxSimdLevel : SimdLevel::Scalar;
+
+    FlipMapGenerator generator(config);
+    const std::size_t tiles = generator.tileCount();
+    std::atomic<std::size_t> tilesDone{0};
+    std::mutex progressMutex;
+    std::size_t reportedPercent = 0;
+
+    const auto started = std::chrono::steady_clock::now();
+    generator.run([&](const FlipMapTile&) {
+        const std::size_t percent = (tilesDone.fetch_add(1) + 1) * 100 / tiles;
+        std::lock_guard<std::mutex> lock(progressMutex);
+        if (percent >= reportedPercent + 10) {
+            reportedPercent = percent - percent % 10;
+            const double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count();
+            std::fprintf(stderr, "  %3zu%% of tiles after %.1f s\n", reportedPercent, elapsed);
+        }
+    });
+    const double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count();
+
+    std::size_t flipped = 0;
+    for (float time : generator.flipTimes()) {
+        flipped += time >= 0.0f ? 1 : 0;
+    }
+    const std::size_t pixels = config.width * config.height;
+
+    bool written = true;
+    if (outputFile) {
+        written = options.mapFormat == MapFormat::Pgm16 ? generator.writePgm16(outputFile)
+                                                       : generator.writeRawFloat(outputFile);
+        if (!written) {
+            std::fprintf(stderr, "Failed to write %s\n", options.outputPath.c_str());
+        }
+    }
+
+    std::fprintf(stderr, "map                : %zux%zu, %zu tiles, %.3f s per pixel\n",
+                 config.width, config.height, tiles, config.duration);
+    std::fprintf(stderr, "threads            : %zu, kernel %s\n", generator.lastThreadCount(),
+                 BatchKernel::name(generator.lastSimdLevel()));
+    std::fprintf(stderr, "wall time          : %.3f s\n", elapsed);
+    std::fprintf(stderr, "pixels/sec         : %.0f\n", elapsed > 0.0 ? pixels / elapsed : 0.0);
+    std::fprintf(stderr, "flipped pixels     : %zu (%.1f%%)\n", flipped, 100.0 * flipped / pixels);
+    std::fprintf(stderr, "energy-pruned      : %zu (%.1f%%)\n", generator.energyPrunedPixels(),
+                 100.0 * generator.energyPrunedPixels() / pixels);
+    if (generator.failedPixels() > 0) {
+        std::fprintf(stderr, "failed pixels      : %zu\n", generator.failedPixels());
+    }
+    return written ? 0 : 1;
+}
+
+int runPoincare(const BatchOptions& options, std::FILE* outputFile)
+{
+    PendulumIntegrator integrator(options.parameters, options.initialState);
+    integrator.setToleranceProfile(options.tolerances);
+    integrator.setMethod(options.method);
+    integrator.setFixedStepSize(options.fixedStep);
+    const PoincareEventLocator locator(options.section);
+
+    long long acceptedSteps = 0;
+    long long crossingCount = 0;
+    const auto started = std::chrono::steady_clock::now();
+    {
+        std::unique_ptr<RowWriter> writer;
+        if (outputFile) {
+            writer = std::make_unique<RowWriter>(outputFile, options.format, "t,theta1,omega1,theta2,omega2,map_x,map_y");
+        }
+        PoincareEventLocator::Crossings crossings;
+        while (integrator.time() < options.duration) {
+            const double remaining = options.duration - integrator.time();
+            if (remaining < PendulumIntegrator::DOPRI_HMIN / 2.0) {
+                break;
+            }
+            const PendulumIntegrator::StepResult result = integrator.tryStep(remaining);
+            if (result == PendulumIntegrator::StepResult::Failed) {
+                break;
+            }
+            if (result == PendulumIntegrator::StepResult::Rejected) {
+                continue;
+            }
+            ++acceptedSteps;
+            const std::size_t count = locator.locate(integrator, crossings);
+            crossingCount += static_cast<long long>(count);
+            for (std::size_t i = 0; writer && i < count; ++i) {
+                const PendulumState& y = crossings[i].state;
+                const std::array<double, 2> point = options.section.mapCoordinates(y);
+                const double row[7] = {crossings[i].time, y[0], y[1], y[2], y[3], point[0], point[1]};
+                writer->write(row, 7);
+            }
+        }
+    }
+    const double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count();
+
+    std::fprintf(stderr, "simulated time     : %.6f s%s\n", integrator.time(), integrator.failed() ? " (integration failed)" : "");
+    std::fprintf(stderr, "accepted steps     : %lld\n", acceptedSteps);
+    std::fprintf(stderr, "crossings          : %lld\n", crossingCount);
+    std::fprintf(stderr, "wall time          : %.6f s\n", elapsed);
+    std::fprintf(stderr, "sim s per wall s   : %.1f\n", elapsed > 0.0 ? integrator.time() / elapsed : 0.0);
+    return integrator.failed() ? 2 : 0;
+}
+
+int runMethodComparison(const BatchOptions& options)
+{
+    const PendulumIntegrator::Method methods[] = {
+        PendulumIntegrator::Method::DormandPrince5, PendulumIntegrator::Method::DormandPrince853,
+        PendulumIntegrator::Method::ImplicitMidpoint, PendulumIntegrator::Method::GaussLegendre4,
+        PendulumIntegrator::Method::GaussLegendre6,
+    };
+    std::fprintf(stderr, "%.1f s simulated, fixed step %.4g s\n", options.duration, options.fixedStep);
+    std::fprintf(stderr, "%-9s %10s %12s %10s %12s %12s %12s\n",
+                 "method", "steps", "steps/sec", "rhs/step", "sim s/wall s", "max |dE| J", "final dE J");
+
+    int status = 0;
+    for (PendulumIntegrator::Method method : methods) {
+        PendulumIntegrator integrator(options.parameters, options.initialState);
+        integrator.setToleranceProfile(options.tolerances);
+        integrator.setMethod(method);
+        integrator.setFixedStepSize(options.fixedStep);
+        const double initialEnergy = integrator.energies().total;
+
+        long long acceptedSteps = 0;
+        double maxEnergyError = 0.0;
+        const auto started = std::chrono::steady_clock::now();
+        while (integrator.time() < options.duration) {
+            const double remaining = options.duration - integrator.time();
+            if (remaining < PendulumIntegrator::DOPRI_HMIN / 2.0) {
+                break;
+            }
+            const PendulumIntegrator::StepResult result = integrator.tryStep(remaining);
+            if (result == PendulumIntegrator::StepResult::Failed) {
+                break;
+            }
+            if (result == PendulumIntegrator::StepResult::Accepted) {
+                ++acceptedSteps;
+                maxEnergyError = std::max(maxEnergyError, std::abs(integrator.energies().total - initialEnergy));
+            }
+        }
+        const double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count();
+
+        std::fprintf(stderr, "%-9s %10lld %12.0f %10.2f %12.1f %12.3e %12.3e%s\n",
+                     PendulumIntegrator::methodName(method), acceptedSteps,
+                     elapsed > 0.0 ? acceptedSteps / elapsed : 0.0,
+                     acceptedSteps > 0 ? static_cast<double>(integrator.rhsEvaluations()) / acceptedSteps : 0.0,
+                     elapsed > 0.0 ? integrator.time() / elapsed : 0.0,
+                     maxEnergyError, integrator.energies().total - initialEnergy,
+                     integrator.failed() ? "  (failed)" : "");
+        status = integrator.failed() ? 2 : status;
+    }
+    return status;
+}
+
+/*
+ * @brief Cost of DP5 and DOP853 at matching tolerances.
+ *
+ * Both schemes run the same trajectory at rtol 1e-6 ... 1e-13 (atol one
+ * decade lower). The step cap is lifted unless --max-step is given, so the
+ * controllers alone decide the step. Accuracy is the largest final-state
+ * difference from a DOP853 run at rtol 1e-15.
+ */
+int runToleranceComparison(const BatchOptions& options)
+{
+    const double maxStep = std::isnan(options.maxStep) ? options.duration : options.maxStep;
+    PendulumIntegrator::ToleranceProfile tolerances = options.tolerances;
+    tolerances.maxStep = maxStep;
+    tolerances.relativeTolerance = 1.0e-15;
+    tolerances.absoluteTolerance = 1.0e-16;
+    const PendulumIntegrator reference = integrateTo(options, PendulumIntegrator::Method::DormandPrince853, tolerances);
+
+    std::fprintf(stderr, "%.1f s simulated, max step %.4g s, reference: dop853 at rtol 1e-15 (%llu rhs calls)\n",
+                 options.duration, maxStep, static_cast<unsigned long long>(reference.rhsEvaluations()));
+    std::fprintf(stderr, "%-7s %-7s %10s %12s %12s %12s %12s\n",
+                 "rtol", "method", "steps", "rhs/sim s", "sim s/wall s", "state error", "|dE| J");
+
+    int status = reference.failed() ? 2 : 0;
+    const PendulumIntegrator::Method methods[] = {
+        PendulumIntegrator::Method::DormandPrince5, PendulumIntegrator::Method::DormandPrince853,
+    };
+    for (int exponent = 6; exponent <= 13; ++exponent) {
+        tolerances.relativeTolerance = std::pow(10.0, -exponent);
+        tolerances.absoluteTolerance = tolerances.relativeTolerance / 10.0;
+        for (PendulumIntegrator::Method method : methods) {
+            const auto started = std::chrono::steady_clock::now();
+            const PendulumIntegrator integrator = integrateTo(options, method, tolerances);
+            const double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count();
+
+            double stateError = 0.0;
+            for (std::size_t j = 0; j < integrator.state().size(); ++j) {
+                stateError = std::max(stateError, std::abs(integrator.state()[j] - reference.state()[j]));
+            }
+            const double initialEnergy = PendulumIntegrator::energies(options.parameters, options.initialState).total;
+            std::fprintf(stderr, "1e-%-4d %-7s %10llu %12.0f %12.1f %12.3e %12.3e%s\n", exponent,
+                         PendulumIntegrator::methodName(method),
+                         static_cast<unsigned long long>(integrator.acceptedSteps()),
+                         integrator.rhsEvaluations() / integrator.time(),
+                         elapsed > 0.0 ? integrator.time() / elapsed : 0.0,
+                         stateError, std::abs(integrator.energies().total - initialEnergy),
+                         integrator.failed() ? "  (failed)" : "");
+            status = integrator.failed() ? 2 : status;
+        }
+    }
+    return status;
+}
+
+/*
+ * @brief Summary of a .dptraj recording, read through the memory map.
+ *
+ * One sequential pass over every frame (energy drift) and a burst of
+ * random time lookups, both timed, show what replay costs for a file of
+ * this size without loading it.
+ */
+int runReplayInfo(const BatchOptions& options)
+{
+    TrajectoryReplay replay;
+    std::string error;
+    const auto opened = std::chrono::steady_clock::now();
+    if (!replay.open(options.replayPath, &error)) {
+        std::fprintf(stderr, "%s\n", error.c_str());
+        return 1;
+    }
+    const double openTime = std::chrono::duration<double>(std::chrono::steady_clock::now() - opened).count();
+
+    const TrajectoryFileHeader& header = replay.header();
+    const PendulumParameters p = replay.parameters();
+    std::fprintf(stderr, "recording          : %s (format %u)\n", replay.path().c_str(), header.version);
+    std::fprintf(stderr, "method             : %s, sample rate %g Hz%s\n", header.method, header.sampleRate,
+                 header.sampleRate > 0.0 ? "" : " (every accepted step)");
+    std::fprintf(stderr, "parameters         : m %g %g, rod mass %g %g, l %g %g, b %g %g, c %g %g, g %g%s\n",
+                 p.m1, p.m2, p.rodMass1, p.rodMass2, p.l1, p.l2, p.b1, p.b2, p.c1, p.c2, p.g,
+                 (header.flags & TRAJECTORY_FLAG_PARAMETERS_CHANGED) ? " (changed during the run)" : "");
+    std::fprintf(stderr, "frames             : %zu%s\n", replay.size(),
+                 header.frameCount == replay.size() ? "" : " (recorder not closed cleanly)");
+    std::fprintf(stderr, "time range         : %.6f .. %.6f s\n", replay.startTime(), replay.endTime());
+    std::fprintf(stderr, "map time           : %.3f ms\n", openTime * 1e3);
+    if (replay.empty()) {
+        return 0;
+    }
+
+    const auto scanned = std::chrono::steady_clock::now();
+    const TrajectoryFrame& first = replay.frame(0);
+    const double initialEnergy = first.kineticEnergy + first.potentialEnergy;
+    double maxEnergyError = 0.0;
+    for (std::size_t i = 0; i < replay.size(); ++i) {
+        const TrajectoryFrame& frame = replay.frame(i);
+        maxEnergyError = std::max(maxEnergyError, std::abs(frame.kineticEnergy + frame.potentialEnergy - initialEnergy));
+    }
+    const double scanTime = std::chrono::duration<double>(std::chrono::steady_clock::now() - scanned).count();
+    std::fprintf(stderr, "max energy error   : %.3e J\n", maxEnergyError);
+    std::fprintf(stderr, "full scan          : %.3f s (%.0f MB/s)\n", scanTime,
+                 scanTime > 0.0 ? replay.size() * sizeof(TrajectoryFrame) / scanTime / 1e6 : 0.0);
+
+    constexpr int LOOKUPS = 1000000;
+    const double span = replay.endTime() - replay.startTime();
+    std::size_t checksum = 0;
+    const auto looked = std::chrono::steady_clock::now();
+    for (int i = 0; i < LOOKUPS; ++i) {
+        // Golden-ratio sequence: evenly spread, deterministic query times
+        const double fraction = std::fmod(i * 0.6180339887498949, 1.0);
+        checksum += replay.lowerBound(replay.startTime() + fraction * span);
+    }
+    const double lookupTime = std::chrono::duration<double>(std::chrono::steady_clock::now() - looked).count();
+    std::fprintf(stderr, "time lookup        : %.0f ns (binary search, checksum %zu)\n",
+                 lookupTime / LOOKUPS * 1e9, checksum % 1000);
+    return 0;
+}
+
+int runLyapunov(const BatchOptions& options, std::FILE* outputFile)
+{
+    LyapunovConfig config = options.lyapunovConfig;
+    config.duration = options.duration;
+    config.threadCount = options.threads;
+    config.tolerances = options.tolerances;
+    const int k = config.exponentCount;
+
+    if (options.sweepAxes.empty()) {
+        // Single parameter set: show the running estimate while it converges
+        LyapunovEstimator estimator(options.parameters, options.initialState, k, config.renormalizationInterval,
+                                    config.tolerances);
+        const double transient = std::min(config.transient, config.duration);
+        const auto started = std::chrono::steady_clock::now();
+        if (transient > 0.0) {
+            estimator.advanceTo(transient);
+            estimator.restartAveraging();
+        }
+        const int reports = 10;
+        for (int r = 1; r <= reports && !estimator.failed(); ++r) {
+            estimator.advanceTo(transient + (config.duration - transient) * r / reports);
+            std::fprintf(stderr, "t = %10.3f s  lambda:", estimator.time());
+            for (int i = 0; i < k; ++i) {
+                std::fprintf(stderr, " %+.6f", estimator.exponent(i));
+            }
+            std::fprintf(stderr, "\n");
+        }
+        const double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count();
+        std::fprintf(stderr, "accepted steps     : %u\n", estimator.acceptedSteps());
+        std::fprintf(stderr, "wall time          : %.6f s\n", elapsed);
+        std::fprintf(stderr, "steps/sec          : %.0f\n", elapsed > 0.0 ? estimator.acceptedSteps() / elapsed : 0.0);
+        return estimator.failed() ? 2 : 0;
+    }
+
+    const std::vector<PendulumParameters> sets = expandSweep(options.parameters, options.sweepAxes);
+    const auto started = std::chrono::steady_clock::now();
+    const std::vector<LyapunovResult> results = LyapunovEstimator::sweep(sets, options.initialState, config);
+    const double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count();
+
+    std::size_t failed = 0;
+    unsigned long long acceptedSteps = 0;
+    for (const LyapunovResult& result : results) {
+        failed += result.failed ? 1 : 0;
+        acceptedSteps += result.acceptedSteps;
+    }
+
+    if (outputFile) {
+        std::string header = "m1,m2,rod_mass1,rod_mass2,l1,l2,b1,b2,c1,c2,g,t_end";
+        for (int i = 0; i < k; ++i) {
+            header += ",lambda" + std::to_string(i + 1);
+        }
+        header += ",accepted_steps,rejected_steps,failed";
+        RowWriter writer(outputFile, options.format, header.c_str());
+        for (std::size_t s = 0; s < sets.size(); ++s) {
+            const PendulumParameters& p = sets[s];
+            const LyapunovResult& result = results[s];
+            double row[12 + 4 + 3] = {p.m1, p.m2, p.rodMass1, p.rodMass2, p.l1, p.l2, p.b1, p.b2, p.c1, p.c2, p.g, result.time};
+            std::size_t columns = 12;
+            for (int i = 0; i < k; ++i) {
+                row[columns++] = result.exponents[i];
+            }
+            row[columns++] = result.acceptedSteps;
+            row[columns++] = result.rejectedSteps;
+            row[columns++] = result.failed ? 1.0 : 0.0;
+            writer.write(row, columns);
+        }
+    }
+
+    std::fprintf(stderr, "parameter sets     : %zu\n", sets.size());
+    std::fprintf(stderr, "accepted steps     : %llu\n", acceptedSteps);
+    std::fprintf(stderr, "wall time          : %.6f s\n", elapsed);
+    std::fprintf(stderr, "steps/sec          : %.0f\n", elapsed > 0.0 ? acceptedSteps / elapsed : 0.0);
+    if (failed > 0) {
+        std::fprintf(stderr, "failed sets        : %zu\n", failed);
+    }
+    return failed > 0 ? 2 : 0;
+}
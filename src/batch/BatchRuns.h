@@ -0,0 +1,21 @@
+#ifndef BATCHRUNS_H
+#define BATCHRUNS_H
+
+#include <cstdio>
+#include "BatchOptions.h"
+
+// Simulation modes of pendulum_batch. Each returns the process exit status
+// (0 ok, 1 bad input or I/O, 2 integration failure) and reports on stderr;
+// outputFile is null when nothing is written.
+
+int runSingle(const BatchOptions& options, std::FILE* outputFile);
+int runEnsemble(const BatchOptions& options, std::FILE* outputFile);
+int runFlipMap(const BatchOptions& options, std::FILE* outputFile);
+int runPoincare(const BatchOptions& options, std::FILE* outputFile);
+int runLyapunov(const BatchOptions& options, std::FILE* outputFile);
+
+int runMethodComparison(const BatchOptions& options);
+int runToleranceComparison(const BatchOptions& options);
+int runReplayInfo(const BatchOptions& options);
+
+#endif // BATCHRUNS_H
@@ -0,0 +1,74 @@
+// Headless batch runner: integrates one initial condition (or an ensemble of
+// nearby ones) as fast as the CPU allows and streams the results to disk.
+// Links only the Qt-free core.
+//
+// BatchOptions.cpp parses the command line, BatchRuns.cpp holds the
+// simulation modes and BatchBenchmarks.cpp the --bench-* measurements.
+
+#include <cstdio>
+#include "BatchBenchmarks.h"
+#include "BatchOptions.h"
+#include "BatchRuns.h"
+
+int main(int argc, char* argv[])
+{
+    BatchOptions options;
+    if (!parseArguments(argc, argv, options)) {
+        printUsage(argv[0]);
+        return 1;
+    }
+    if (options.benchKernel) {
+        return runKernelBenchmark(options);
+    }
+    if (options.benchHistory) {
+        return runHistoryBenchmark(options);
+    }
+    if (options.benchRdp) {
+        return runRdpBenchmark(options);
+    }
+    if (options.benchDp5) {
+        return runDp5Benchmark(options);
+    }
+    if (options.compareMethods) {
+        return runMethodComparison(options);
+    }
+    if (options.compareTolerances) {
+        return runToleranceComparison(options);
+    }
+    if (!options.replayPath.empty()) {
+        return runReplayInfo(options);
+    }
+    const bool singleRun = !options.lyapunov && options.mapWidth == 0 && options.ensembleSize == 0 && !options.poincare;
+    if (options.format == OutputFormat::Trajectory && !singleRun) {
+        std::fprintf(stderr, "--format trajectory records single runs only\n");
+        return 1;
+    }
+
+    std::FILE* outputFile = nullptr;
+    if (!options.outputPath.empty() && options.format != OutputFormat::Trajectory) {
+        const bool binary = options.format == OutputFormat::Binary || options.mapWidth > 0;
+        outputFile = std::fopen(options.outputPath.c_str(), binary ? "wb" : "w");
+        if (!outputFile) {
+            std::fprintf(stderr, "Failed to open %s for writing\n", options.outputPath.c_str());
+            return 1;
+        }
+    }
+
+    int status = 0;
+    if (options.lyapunov) {
+        status = runLyapunov(options, outputFile);
+    } else if (options.mapWidth > 0) {
+        status = runFlipMap(options, outputFile);
+    } else if (options.ensembleSize > 0) {
+        status = runEnsemble(options, outputFile);
+    } else if (options.poincare) {
+        status = runPoincare(options, outputFile);
+    } else {
+        status = runSingle(options, outputFile);
+    }
+
+    if (outputFile) {
+        std::fclose(outputFile);
+    }
+    return status;
+}
@@ -0,0 +1,154 @@
+#include "core/BatchKernel.h"
+#include "BatchKernelImpl.h"
+
+#if defined(PENDULUM_BATCH_KERNEL_X86) && defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+namespace {
+
+// One pendulum per "vector": the portable fallback and the reference for the
+// wider instantiations.
+struct ScalarLane {
+    static constexpr int Width = 1;
+    using Mask = bool;
+    double v;
+
+    static ScalarLane set1(double x) { return {x}; }
+    static ScalarLane load(const double* p) { return {*p}; }
+    void store(double* p) const { *p = v; }
+    static bool maskAnd(bool a, bool b) { return a && b; }
+};
+
+inline ScalarLane operator+(ScalarLane a, ScalarLane b) { return {a.v + b.v}; }
+inline ScalarLane operator-(ScalarLane a, ScalarLane b) { return {a.v - b.v}; }
+inline ScalarLane operator*(ScalarLane a, ScalarLane b) { return {a.v * b.v}; }
+inline ScalarLane operator/(ScalarLane a, ScalarLane b) { return {a.v / b.v}; }
+// Unfused: without hardware FMA std::fma would be a library call per operation
+inline ScalarLane fma(ScalarLane a, ScalarLane b, ScalarLane c) { return {a.v * b.v + c.v}; }
+inline ScalarLane abs(ScalarLane a) { return {std::fabs(a.v)}; }
+inline ScalarLane max(ScalarLane a, ScalarLane b) { return {a.v < b.v ? b.v : a.v}; }
+inline ScalarLane roundNearest(ScalarLane a) { return {std::nearbyint(a.v)}; }
+inline ScalarLane floorOf(ScalarLane a) { return {std::floor(a.v)}; }
+inline bool lessThan(ScalarLane a, ScalarLane b) { return a.v < b.v; }
+inline ScalarLane select(bool mask, ScalarLane ifTrue, ScalarLane ifFalse) { return mask ? ifTrue : ifFalse; }
+
+#ifdef PENDULUM_BATCH_KERNEL_X86
+struct CpuFeatures {
+    bool avx2 = false;
+    bool avx512 = false;
+};
+
+CpuFeatures queryCpuFeatures()
+{
+    CpuFeatures features;
+#if defined(_MSC_VER)
+    int info[4] = {};
+    __cpuid(info, 0);
+    if (info[0] < 7) {
+        return features;
+    }
+    __cpuid(info, 1);
+    const bool fma = (info[2] & (1 << 12)) != 0;
+    const bool osxsave = (info[2] & (1 << 27)) != 0;
+    if (!osxsave) {
+        return features;
+    }
+    // The OS must save the YMM (and for AVX-512 the opmask/ZMM) state
+    const unsigned long long xcr0 = _xgetbv(0);
+    const bool ymmState = (xcr0 & 0x6) == 0x6;
+    const bool zmmState = (xcr0 & 0xe6) == 0xe6;
+    __cpuidex(info, 7, 0);
+    features.avx2 = ymmState && fma && (info[1] & (1 << 5)) != 0;
+    features.avx512 = zmmState && fma && (info[1] & (1 << 16)) != 0 && (info[1] & (1 << 17)) != 0;
+#else
+    __builtin_cpu_init();
+    features.avx2 = __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma");
+    features.avx512 = features.avx2 && __builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx512dq");
+#endif
+    return features;
+}
+
+const CpuFeatures& cpuFeatures()
+{
+    static const CpuFeatures features = queryCpuFeatures();
+    return features;
+}
+#endif
+
+} // namespace
+
+SimdLevel BatchKernel::detect()
+{
+    if (isAvailable(SimdLevel::Avx512)) {
+        return SimdLevel::Avx512;
+    }
+    if (isAvailable(SimdLevel::Avx2)) {
+        return SimdLevel::Avx2;
+    }
+    return SimdLevel::Scalar;
+}
+
+bool BatchKernel::isAvailable(SimdLevel level)
+{
+    switch (level) {
+    case SimdLevel::Scalar:
+        return true;
+#ifdef PENDULUM_BATCH_KERNEL_X86
+    case SimdLevel::Avx2:
+        return cpuFeatures().avx2;
+    case SimdLevel::Avx512:
+        return cpuFeatures().avx512;
+#endif
+    default:
+        return false;
+    }
+}
+
+const char* BatchKernel::name(SimdLevel level)
+{
+    switch (level) {
+    case SimdLevel::Avx2:
+        return "avx2";
+    case SimdLevel::Avx512:
+        return "avx512";
+    default:
+        return "scalar";
+    }
+}
+
+std::size_t BatchKernel::laneCount(SimdLevel level)
+{
+    switch (level) {
+    case SimdLevel::Avx2:
+        return 4;
+    case SimdLevel::Avx512:
+        return 8;
+    default:
+        return 1;
+    }
+}
+
+void BatchKernel::run(SimdLevel level, const BatchKernelJob& job)
+{
+    if (job.count == 0) {
+        return;
+    }
+    // Never dispatch into code the CPU cannot execute
+    if (!isAvailable(level)) {
+        level = detect();
+    }
+    switch (level) {
+#ifdef PENDULUM_BATCH_KERNEL_X86
+    case SimdLevel::Avx512:
+        runBatchKernelAvx512(job);
+        break;
+    case SimdLevel::Avx2:
+        runBatchKernelAvx2(job);
+        break;
+#endif
+    default:
+        integrateLanes<ScalarLane>(job);
+        break;
+    }
+}
@@ -0,0 +1,37 @@
+// AVX2 + FMA instantiation of the batch kernel: 4 pendulums per instruction.
+// Built with -mavx2 -mfma (/arch:AVX2); only called after runtime detection.
+
+#include <immintrin.h>
+#include "BatchKernelImpl.h"
+
+namespace {
+
+struct Avx2Lanes {
+    static constexpr int Width = 4;
+    using Mask = __m256d;
+    __m256d v;
+
+    static Avx2Lanes set1(double x) { return {_mm256_set1_pd(x)}; }
+    static Avx2Lanes load(const double* p) { return {_mm256_load_pd(p)}; }
+    void store(double* p) const { _mm256_store_pd(p, v); }
+    static __m256d maskAnd(__m256d a, __m256d b) { return _mm256_and_pd(a, b); }
+};
+
+inline Avx2Lanes operator+(Avx2Lanes a, Avx2Lanes b) { return {_mm256_add_pd(a.v, b.v)}; }
+inline Avx2Lanes operator-(Avx2Lanes a, Avx2Lanes b) { return {_mm256_sub_pd(a.v, b.v)}; }
+inline Avx2Lanes operator*(Avx2Lanes a, Avx2Lanes b) { return {_mm256_mul_pd(a.v, b.v)}; }
+inline Avx2Lanes operator/(Avx2Lanes a, Avx2Lanes b) { return {_mm256_div_pd(a.v, b.v)}; }
+inline Avx2Lanes fma(Avx2Lanes a, Avx2Lanes b, Avx2Lanes c) { return {_mm256_fmadd_pd(a.v, b.v, c.v)}; }
+inline Avx2Lanes abs(Avx2Lanes a) { return {_mm256_andnot_pd(_mm256_set1_pd(-0.0), a.v)}; }
+inline Avx2Lanes max(Avx2Lanes a, Avx2Lanes b) { return {_mm256_max_pd(a.v, b.v)}; }
+inline Avx2Lanes roundNearest(Avx2Lanes a) { return {_mm256_round_pd(a.v, _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC)}; }
+inline Avx2Lanes floorOf(Avx2Lanes a) { return {_mm256_floor_pd(a.v)}; }
+inline __m256d lessThan(Avx2Lanes a, Avx2Lanes b) { return _mm256_cmp_pd(a.v, b.v, _CMP_LT_OQ); }
+inline Avx2Lanes select(__m256d mask, Avx2Lanes ifTrue, Avx2Lanes ifFalse) { return {_mm256_blendv_pd(ifFalse.v, ifTrue.v, mask)}; }
+
+} // namespace
+
+void runBatchKernelAvx2(const BatchKernelJob& job)
+{
+    integrateLanes<Avx2Lanes>(job);
+}
@@ -0,0 +1,39 @@
+// AVX-512F instantiation of the batch kernel: 8 pendulums per instruction.
+// Built with -mavx512f (/arch:AVX512); only called after runtime detection.
+
+#include <immintrin.h>
+#include "BatchKernelImpl.h"
+
+namespace {
+
+struct Avx512Lanes {
+    static constexpr int Width = 8;
+    using Mask = __mmask8;
+    __m512d v;
+
+    static Avx512Lanes set1(double x) { return {_mm512_set1_pd(x)}; }
+    static Avx512Lanes load(const double* p) { return {_mm512_load_pd(p)}; }
+    void store(double* p) const { _mm512_store_pd(p, v); }
+    static __mmask8 maskAnd(__mmask8 a, __mmask8 b) { return static_cast<__mmask8>(a & b); }
+};
+
+inline Avx512Lanes operator+(Avx512Lanes a, Avx512Lanes b) { return {_mm512_add_pd(a.v, b.v)}; }
+inline Avx512Lanes operator-(Avx512Lanes a, Avx512Lanes b) { return {_mm512_sub_pd(a.v, b.v)}; }
+inline Avx512Lanes operator*(Avx512Lanes a, Avx512Lanes b) { return {_mm512_mul_pd(a.v, b.v)}; }
+inline Avx512Lanes operator/(Avx512Lanes a, Avx512Lanes b) { return {_mm512_div_pd(a.v, b.v)}; }
+inline Avx512Lanes fma(Avx512Lanes a, Avx512Lanes b, Avx512Lanes c) { return {_mm512_fmadd_pd(a.v, b.v, c.v)}; }
+inline Avx512Lanes abs(Avx512Lanes a) { return {_mm512_abs_pd(a.v)}; }
+// The unmasked max/roundscale intrinsics pass an undefined source vector that GCC reports
+// as -Wmaybe-uninitialized; the zero-masked forms with all lanes set are the same instruction
+inline Avx512Lanes max(Avx512Lanes a, Avx512Lanes b) { return {_mm512_maskz_max_pd(0xFF, a.v, b.v)}; }
+inline Avx512Lanes roundNearest(Avx512Lanes a) { return {_mm512_maskz_roundscale_pd(0xFF, a.v, _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC)}; }
+inline Avx512Lanes floorOf(Avx512Lanes a) { return {_mm512_maskz_roundscale_pd(0xFF, a.v, _MM_FROUND_TO_NEG_INF | _MM_FROUND_NO_EXC)}; }
+inline __mmask8 lessThan(Avx512Lanes a, Avx512Lanes b) { return _mm512_cmp_pd_mask(a.v, b.v, _CMP_LT_OQ); }
+inline Avx512Lanes select(__mmask8 mask, Avx512Lanes ifTrue, Avx512Lanes ifFalse) { return {_mm512_mask_blend_pd(mask, ifFalse.v, ifTrue.v)}; }
+
+} // namespace
+
+void runBatchKernelAvx512(const BatchKernelJob& job)
+{
+    integrateLanes<Avx512Lanes>(job);
+}
@@ -0,0 +1,426 @@
+#ifndef BATCHKERNELIMPL_H
+#define BATCHKERNELIMPL_H
+
+// Lane-generic DP5 kernel shared by the scalar, AVX2 and AVX-512 translation
+// units. Each unit defines a vector type V and instantiates integrateLanes<V>.
+//
+// Every function here has internal linkage and avoids inline library helpers
+// (std::min, std::isfinite, ...): the AVX units are compiled with wider
+// instruction sets, and a shared inline symbol could otherwise be picked by the
+// linker for code that runs on CPUs without them.
+//
+// A vector type V provides:
+//   V::Width, V::Mask
+//   V::set1(double), V::load(const double*), v.store(double*)   (64-byte aligned)
+//   + - * / operators, fma(a, b, c) = a * b + c, abs(v), roundNearest(v), floorOf(v)
+//   lessThan(a, b) -> Mask, V::maskAnd(m1, m2), select(mask, ifTrue, ifFalse)
+
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include "core/BatchKernel.h"
+
+namespace {
+
+using DP5 = DormandPrince5Tableau;
+
+// The equations-of-motion terms of PendulumIntegrator plus the kinetic-energy
+// factors the energy reduction needs, computed once per job
+struct KernelCoefficients : CompiledParameters {
+    double kinetic1 = 0.0; // 0.5 (m1 + rod1/3) l1^2 + 0.5 (m2 + rod2) l1^2
+    double kinetic2 = 0.0; // 0.5 (m2 + rod2/3) l2^2
+};
+
+static inline KernelCoefficients makeKernelCoefficients(const PendulumParameters& p)
+{
+    KernelCoefficients c{CompiledParameters::compile(p)};
+    c.kinetic1 = 0.5 * (p.m1 + p.rodMass1 / 3.0) * p.l1 * p.l1 + 0.5 * (p.m2 + p.rodMass2) * p.l1 * p.l1;
+    c.kinetic2 = 0.5 * (p.m2 + p.rodMass2 / 3.0) * p.l2 * p.l2;
+    return c;
+}
+
+static inline double minOf(double a, double b) { return b < a ? b : a; }
+static inline double maxOf(double a, double b) { return a < b ? b : a; }
+static inline bool isFiniteValue(double x) { return (x - x) == 0.0; } // false for inf and NaN
+
+/*
+ * @brief sin and cos of every lane.
+ *
+ * Cody-Waite reduction by pi/2 (three-part constant, exact for |x| < 2^20)
+ * followed by the Cephes minimax polynomials on [-pi/4, pi/4]; the quadrant
+ * picks which polynomial and sign each lane uses. Accurate to about 1 ulp.
+ */
+template <class V>
+static inline void sinCos(V x, V& sinOut, V& cosOut)
+{
+    const V n = roundNearest(x * V::set1(0.63661977236758134308)); // x * 2/pi
+    V r = fma(n, V::set1(-1.57079632673412561417e+00), x);
+    r = fma(n, V::set1(-6.07710050630396597660e-11), r);
+    r = fma(n, V::set1(-2.02226624879595063154e-21), r);
+
+    const V z = r * r;
+    V ps = V::set1(1.58962301576546568060e-10);
+    ps = fma(ps, z, V::set1(-2.50507477628578072866e-8));
+    ps = fma(ps, z, V::set1(2.75573136213857245213e-6));
+    ps = fma(ps, z, V::set1(-1.98412698295895385996e-4));
+    ps = fma(ps, z, V::set1(8.33333333332211858878e-3));
+    ps = fma(ps, z, V::set1(-1.66666666666666307295e-1));
+    const V sinR = fma(r * z, ps, r);
+
+    V pc = V::set1(-1.13585365213876817300e-11);
+    pc = fma(pc, z, V::set1(2.08757008419747316778e-9));
+    pc = fma(pc, z, V::set1(-2.75573141792967388112e-7));
+    pc = fma(pc, z, V::set1(2.48015872888517045348e-5));
+    pc = fma(pc, z, V::set1(-1.38888888888730564116e-3));
+    pc = fma(pc, z, V::set1(4.16666666666665929218e-2));
+    const V cosR = fma(z * z, pc, V::set1(1.0) - V::set1(0.5) * z);
+
+    // Quadrant q = n mod 4 in {0, 1, 2, 3}
+    const V q = n - V::set1(4.0) * floorOf(n * V::set1(0.25));
+    const V qOdd = q - V::set1(2.0) * floorOf(q * V::set1(0.5));
+    const typename V::Mask swap = lessThan(V::set1(0.5), qOdd);                  // q = 1, 3
+    const typename V::Mask sinNegative = lessThan(V::set1(1.5), q);              // q = 2, 3
+    const typename V::Mask cosNegative = V::maskAnd(lessThan(V::set1(0.5), q),
+                                                    lessThan(q, V::set1(2.5)));  // q = 1, 2
+
+    const V sinBase = select(swap, cosR, sinR);
+    const V cosBase = select(swap, sinR, cosR);
+    sinOut = select(sinNegative, V::set1(0.0) - sinBase, sinBase);
+    cosOut = select(cosNegative, V::set1(0.0) - cosBase, cosBase);
+}
+
+// Lane-parallel PendulumIntegrator::derivatives
+template <class V>
+static inline void derivatives(const KernelCoefficients& c, const V (&y)[4], V (&dy)[4])
+{
+    const V theta1 = y[0];
+    const V omega1 = y[1];
+    const V omega2Rel = y[3];
+    const V theta2Abs = theta1 + y[2];
+    const V omega2Abs = omega1 + omega2Rel;
+
+    V sinDelta, cosDelta, sinTheta1, cosTheta1, sinTheta2, cosTheta2;
+    sinCos(theta1 - theta2Abs, sinDelta, cosDelta);
+    sinCos(theta1, sinTheta1, cosTheta1);
+    sinCos(theta2Abs, sinTheta2, cosTheta2);
+
+    const V a11 = V::set1(c.a11);
+    const V a22 = V::set1(c.a22);
+    const V coupling = V::set1(c.coupling);
+    const V a12 = coupling * cosDelta;
+
+    const V qnc1 = V::set1(0.0) - V::set1(c.b1) * omega1 - V::set1(c.c1) * omega1 * abs(omega1);
+    const V qnc2 = V::set1(0.0) - V::set1(c.b2) * omega2Rel - V::set1(c.c2) * omega2Rel * abs(omega2Rel);
+
+    const V b1 = V::set1(0.0) - coupling * omega2Abs * omega2Abs * sinDelta
+                 - V::set1(c.gravity1) * sinTheta1 + qnc1;
+    const V b2 = coupling * omega1 * omega1 * sinDelta
+                 - V::set1(c.gravity2) * sinTheta2 + qnc2;
+
+    const V det = a11 * a22 - a12 * a12;
+    const typename V::Mask singular = lessThan(abs(det), V::set1(1e-12));
+    const V theta1Acc = select(singular, V::set1(0.0), (b1 * a22 - a12 * b2) / det);
+    const V theta2AbsAcc = select(singular, V::set1(0.0), (a11 * b2 - b1 * a12) / det);
+
+    dy[0] = omega1;
+    dy[1] = theta1Acc;
+    dy[2] = omega2Rel;
+    dy[3] = theta2AbsAcc - theta1Acc;
+}
+
+// Lane-parallel total energy (PendulumIntegrator::energies().total)
+template <class V>
+static inline V totalEnergy(const KernelCoefficients& c, const V (&y)[4])
+{
+    const V omega1 = y[1];
+    const V omega2Abs = omega1 + y[3];
+    V sinTheta1, cosTheta1, sinTheta2Rel, cosTheta2Rel, sinTheta2Abs, cosTheta2Abs;
+    sinCos(y[0], sinTheta1, cosTheta1);
+    sinCos(y[2], sinTheta2Rel, cosTheta2Rel);
+    sinCos(y[0] + y[2], sinTheta2Abs, cosTheta2Abs);
+
+    const V kinetic = V::set1(c.kinetic1) * omega1 * omega1
+                      + V::set1(c.kinetic2) * omega2Abs * omega2Abs
+                      + V::set1(c.coupling) * omega1 * omega2Abs * cosTheta2Rel;
+    const V potential = V::set1(0.0) - (V::set1(c.gravity1) * cosTheta1 + V::set1(c.gravity2) * cosTheta2Abs);
+    return kinetic + potential;
+}
+
+// Per-lane working set, laid out so each row loads as one vector
+template <int W>
+struct alignas(64) LaneBlock {
+    double y[4][W];
+    double k0[4][W];     // FSAL stage: derivative at y
+    double ySol[4][W];   // Candidate 5th-order solution
+    double kLast[4][W];  // 7th stage, derivative at ySol
+    double errSq[W];     // Sum of squared scaled errors
+    double h[W];         // Step attempted this round (0 for idle lanes)
+    double energy[W];
+};
+
+// One DP5 attempt for every lane; idle lanes have h = 0 and stay put
+template <class V, int W>
+static inline void attemptStep(const KernelCoefficients& c, const PendulumIntegrator::ToleranceProfile& profile,
+                               LaneBlock<W>& b)
+{
+    const V h = V::load(b.h);
+    V y[4], k[7][4], stage[4];
+    for (int j = 0; j < 4; ++j) {
+        y[j] = V::load(b.y[j]);
+        k[0][j] = V::load(b.k0[j]);
+    }
+
+    for (int j = 0; j < 4; ++j) stage[j] = fma(h, V::set1(DP5::A21) * k[0][j], y[j]);
+    derivatives(c, stage, k[1]);
+
+    for (int j = 0; j < 4; ++j) stage[j] = fma(h, fma(V::set1(DP5::A32), k[1][j], V::set1(DP5::A31) * k[0][j]), y[j]);
+    derivatives(c, stage, k[2]);
+
+    for (int j = 0; j < 4; ++j) {
+        V s = V::set1(DP5::A41) * k[0][j];
+        s = fma(V::set1(DP5::A42), k[1][j], s);
+        s = fma(V::set1(DP5::A43), k[2][j], s);
+        stage[j] = fma(h, s, y[j]);
+    }
+    derivatives(c, stage, k[3]);
+
+    for (int j = 0; j < 4; ++j) {
+        V s = V::set1(DP5::A51) * k[0][j];
+        s = fma(V::set1(DP5::A52), k[1][j], s);
+        s = fma(V::set1(DP5::A53), k[2][j], s);
+        s = fma(V::set1(DP5::A54), k[3][j], s);
+        stage[j] = fma(h, s, y[j]);
+    }
+    derivatives(c, stage, k[4]);
+
+    for (int j = 0; j < 4; ++j) {
+        V s = V::set1(DP5::A61) * k[0][j];
+        s = fma(V::set1(DP5::A62), k[1][j], s);
+        s = fma(V::set1(DP5::A63), k[2][j], s);
+        s = fma(V::set1(DP5::A64), k[3][j], s);
+        s = fma(V::set1(DP5::A65), k[4][j], s);
+        stage[j] = fma(h, s, y[j]);
+    }
+    derivatives(c, stage, k[5]);
+
+    // The 7th stage point is the 5th-order solution itself (B = A7, B2 = B7 = 0)
+    for (int j = 0; j < 4; ++j) {
+        V s = V::set1(DP5::A71) * k[0][j];
+        s = fma(V::set1(DP5::A73), k[2][j], s);
+        s = fma(V::set1(DP5::A74), k[3][j], s);
+        s = fma(V::set1(DP5::A75), k[4][j], s);
+        s = fma(V::set1(DP5::A76), k[5][j], s);
+        stage[j] = fma(h, s, y[j]);
+    }
+    derivatives(c, stage, k[6]);
+
+    V errSq = V::set1(0.0);
+    for (int j = 0; j < 4; ++j) {
+        V e = V::set1(DP5::E1) * k[0][j];
+        e = fma(V::set1(DP5::E3), k[2][j], e);
+        e = fma(V::set1(DP5::E4), k[3][j], e);
+        e = fma(V::set1(DP5::E5), k[4][j], e);
+        e = fma(V::set1(DP5::E6), k[5][j], e);
+        e = fma(V::set1(DP5::E7), k[6][j], e);
+        const V error = h * e;
+        const V scale = fma(V::set1(profile.relativeTolerance), max(abs(y[j]), abs(stage[j])),
+                            V::set1(profile.absoluteTolerance));
+        const V scaled = error / scale;
+        errSq = fma(scaled, scaled, errSq);
+
+        stage[j].store(b.ySol[j]);
+        k[6][j].store(b.kLast[j]);
+    }
+    errSq.store(b.errSq);
+}
+
+template <class V, int W>
+static inline void computeDerivativesInto(const KernelCoefficients& c, LaneBlock<W>& b)
+{
+    V y[4], dy[4];
+    for (int j = 0; j < 4; ++j) y[j] = V::load(b.y[j]);
+    derivatives(c, y, dy);
+    for (int j = 0; j < 4; ++j) dy[j].store(b.kLast[j]); // Scratch: caller copies the lanes it needs
+}
+
+template <class V, int W>
+static inline void computeEnergy(const KernelCoefficients& c, LaneBlock<W>& b)
+{
+    V y[4];
+    for (int j = 0; j < 4; ++j) y[j] = V::load(b.y[j]);
+    totalEnergy(c, y).store(b.energy);
+}
+
+/*
+ * @brief Integrates every member of the job, W lanes at a time.
+ *
+ * The controller mirrors PendulumIntegrator::tryStep() lane by lane: the job's
+ * ToleranceProfile, FSAL reuse, maxStep clipping and the same failure rules.
+ */
+template <class V>
+static void integrateLanes(const BatchKernelJob& job)
+{
+    constexpr int W = V::Width;
+
+    const KernelCoefficients c = makeKernelCoefficients(job.parameters);
+    const PendulumIntegrator::ToleranceProfile profile = job.tolerances.bounded();
+    const double initialStep = minOf(profile.maxStep, maxOf(profile.minStep, PendulumIntegrator::INITIAL_STEP));
+    const double duration = job.duration;
+
+    LaneBlock<W> b{};
+    // Zero-filled so idle lanes never hold indeterminate values
+    std::ptrdiff_t member[W]{};
+    double time[W]{}, nextStep[W]{}, initialEnergy[W]{}, lastEnergy[W]{}, maxDrift[W]{}, flipTime[W]{};
+    std::uint32_t accepted[W]{}, rejected[W]{};
+    bool failed[W]{}, refilled[W]{}, stepped[W]{};
+    std::size_t nextMember = 0;
+
+    auto hasFlipped = [](double theta1, double theta2Rel) {
+        const double theta2Abs = theta1 + theta2Rel;
+        return theta1 > M_PI || theta1 < -M_PI || theta2Abs > M_PI || theta2Abs < -M_PI;
+    };
+
+    auto loadLane = [&](int l) {
+        if (nextMember >= job.count) {
+            member[l] = -1;
+            return false;
+        }
+        const std::size_t m = nextMember++;
+        member[l] = static_cast<std::ptrdiff_t>(m);
+        b.y[0][l] = job.theta1[m];
+        b.y[1][l] = job.omega1[m];
+        b.y[2][l] = job.theta2[m];
+        b.y[3][l] = job.omega2[m];
+        time[l] = 0.0;
+        nextStep[l] = initialStep;
+        maxDrift[l] = 0.0;
+        flipTime[l] = (job.trackFlip && hasFlipped(b.y[0][l], b.y[2][l])) ? 0.0 : -1.0;
+        accepted[l] = 0;
+        rejected[l] = 0;
+        failed[l] = false;
+        return true;
+    };
+
+    auto finishLane = [&](int l) {
+        const std::size_t m = static_cast<std::size_t>(member[l]);
+        if (job.finalTheta1) job.finalTheta1[m] = b.y[0][l];
+        if (job.finalOmega1) job.finalOmega1[m] = b.y[1][l];
+        if (job.finalTheta2) job.finalTheta2[m] = b.y[2][l];
+        if (job.finalOmega2) job.finalOmega2[m] = b.y[3][l];
+        if (job.finalTime) job.finalTime[m] = time[l];
+        if (job.trackEnergy) {
+            if (job.maxEnergyDrift) job.maxEnergyDrift[m] = maxDrift[l];
+            if (job.finalEnergyDrift) job.finalEnergyDrift[m] = lastEnergy[l] - initialEnergy[l];
+        }
+        if (job.trackFlip && job.firstFlipTime) job.firstFlipTime[m] = flipTime[l];
+        if (job.acceptedSteps) job.acceptedSteps[m] = accepted[l];
+        if (job.rejectedSteps) job.rejectedSteps[m] = rejected[l];
+        if (job.failed) job.failed[m] = failed[l] ? 1 : 0;
+        member[l] = -1;
+    };
+
+    // Idle lanes still run through the kernel; the zeroed block keeps them finite
+    for (int l = 0; l < W; ++l) {
+        member[l] = -1;
+    }
+
+    for (;;) {
+        // Retire finished lanes and refill them with the next members
+        bool anyRefilled = false;
+        bool anyActive = false;
+        for (int l = 0; l < W; ++l) {
+            refilled[l] = false;
+            if (member[l] >= 0 && (failed[l] || duration - time[l] < profile.minStep / 2.0
+                                   || (job.stopOnFlip && flipTime[l] >= 0.0))) {
+                finishLane(l);
+            }
+            if (member[l] < 0 && loadLane(l)) {
+                refilled[l] = true;
+                anyRefilled = true;
+            }
+            anyActive = anyActive || member[l] >= 0;
+        }
+        if (!anyActive) {
+            break;
+        }
+
+        if (anyRefilled) {
+            // Fresh lanes need their first stage (and reference energy)
+            computeDerivativesInto<V>(c, b);
+            if (job.trackEnergy) computeEnergy<V>(c, b);
+            for (int l = 0; l < W; ++l) {
+                if (!refilled[l]) continue;
+                for (int j = 0; j < 4; ++j) b.k0[j][l] = b.kLast[j][l];
+                if (job.trackEnergy) {
+                    initialEnergy[l] = b.energy[l];
+                    lastEnergy[l] = b.energy[l];
+                }
+            }
+        }
+
+        for (int l = 0; l < W; ++l) {
+            b.h[l] = member[l] >= 0 ? minOf(nextStep[l], duration - time[l]) : 0.0;
+        }
+
+        attemptStep<V>(c, profile, b);
+
+        // Per-lane accept mask and step-size control
+        bool anyAccepted = false;
+        for (int l = 0; l < W; ++l) {
+            stepped[l] = false;
+            if (member[l] < 0) continue;
+            const double h = b.h[l];
+            const double errNorm = std::sqrt(b.errSq[l] / 4.0);
+            const double hNew = profile.proposeStep(h, errNorm, -0.2);
+
+            if (errNorm > 1.0) {
+                ++rejected[l];
+                nextStep[l] = hNew;
+                if (h <= profile.minStep) failed[l] = true;
+                continue; // k0 still holds the derivative at y
+            }
+
+            bool finite = true;
+            for (int j = 0; j < 4; ++j) finite = finite && isFiniteValue(b.ySol[j][l]);
+            if (!finite) {
+                failed[l] = true;
+                continue;
+            }
+
+            for (int j = 0; j < 4; ++j) {
+                b.y[j][l] = b.ySol[j][l];
+                b.k0[j][l] = b.kLast[j][l];
+            }
+            time[l] += h;
+            ++accepted[l];
+            if (h == nextStep[l] || hNew < nextStep[l]) {
+                nextStep[l] = hNew;
+            }
+            stepped[l] = true;
+            anyAccepted = true;
+        }
+
+        if (anyAccepted && (job.trackEnergy || job.trackFlip)) {
+            if (job.trackEnergy) computeEnergy<V>(c, b);
+            for (int l = 0; l < W; ++l) {
+                if (!stepped[l]) continue;
+                if (job.trackEnergy) {
+                    lastEnergy[l] = b.energy[l];
+                    const double drift = b.energy[l] - initialEnergy[l];
+                    maxDrift[l] = maxOf(maxDrift[l], drift < 0.0 ? -drift : drift);
+                }
+                if (job.trackFlip && flipTime[l] < 0.0 && hasFlipped(b.y[0][l], b.y[2][l])) {
+                    flipTime[l] = time[l];
+                }
+            }
+        }
+    }
+}
+
+} // namespace
+
+// Entry points of the instruction-set specific translation units
+void runBatchKernelAvx2(const BatchKernelJob& job);
+void runBatchKernelAvx512(const BatchKernelJob& job);
+
+#endif // BATCHKERNELIMPL_H
@@ -0,0 +1,580 @@
+#include "core/CompressedHistory.h"
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+
+#if defined(_MSC_VER) && !defined(__clang__)
+#include <intrin.h>
+#endif
+
+namespace {
+
+constexpr char HISTORY_MAGIC[8] = {'D', 'P', 'H', 'I', 'S', 'T', '\r', '\n'};
+constexpr std::uint32_t HISTORY_VERSION = 2; // 2: per-chunk checksum
+
+std::uint64_t lowMask(unsigned bits)
+{
+    return bits >= 64 ? ~std::uint64_t(0) : (std::uint64_t(1) << bits) - 1;
+}
+
+// Takes a non-zero argument
+unsigned leadingZeros(std::uint64_t x)
+{
+#if defined(_MSC_VER) && !defined(__clang__)
+    unsigned long index;
+    _BitScanReverse64(&index, x);
+    return 63u - static_cast<unsigned>(index);
+#else
+    return static_cast<unsigned>(__builtin_clzll(x));
+#endif
+}
+
+std::uint64_t bitsOf(double v)
+{
+    std::uint64_t bits;
+    std::memcpy(&bits, &v, sizeof(bits));
+    return bits;
+}
+
+double doubleOf(std::uint64_t bits)
+{
+    double v;
+    std::memcpy(&v, &bits, sizeof(v));
+    return v;
+}
+
+#if defined(_MSC_VER) && !defined(__clang__)
+#define HISTORY_NOINLINE __declspec(noinline)
+#else
+#define HISTORY_NOINLINE __attribute__((noinline))
+#endif
+
+// Lagrange extrapolation through up to PREDICTOR_POINTS previous samples, at
+// their actual times: one set of weights per row, shared by every column
+constexpr std::size_t PREDICTOR_POINTS = 6;
+struct PredictorWeights {
+    double w[PREDICTOR_POINTS] = {};
+    std::size_t points = 0; // Previous samples used; 0 for the first row
+};
+
+void predictorWeights(const double* times, std::size_t rows, std::vector<PredictorWeights>& out)
+{
+    out.resize(rows);
+    for (std::size_t i = 0; i < rows; ++i) {
+        PredictorWeights& weights = out[i];
+        weights.points = std::min(i, PREDICTOR_POINTS);
+        const double t = times[i];
+        for (std::size_t j = 0; j < weights.points; ++j) {
+            const double tj = times[i - 1 - j];
+            double w = 1.0;
+            for (std::size_t m = 0; m < weights.points; ++m) {
+                if (m != j) {
+                    const double tm = times[i - 1 - m];
+                    w *= (t - tm) / (tj - tm);
+                }
+            }
+            weights.w[j] = w;
+        }
+        // Repeated times: hold the previous value instead
+        for (std::size_t j = 0; j < weights.points; ++j) {
+            if (!std::isfinite(weights.w[j])) {
+                weights = PredictorWeights();
+                weights.points = 1;
+                weights.w[0] = 1.0;
+                break;
+            }
+        }
+    }
+}
+
+// The encoder and the decoder must round the prediction identically. Keeping
+// it out of line stops the compiler from contracting it into FMAs differently
+// at the two call sites. That only holds within one binary: another compiler,
+// flag set or architecture (aarch64 GCC contracts by default) may round it
+// differently, which is why saved chunks carry a checksum of the raw bits.
+HISTORY_NOINLINE double predict(const PredictorWeights& weights, const double* values, std::size_t i)
+{
+    double p = 0.0;
+    for (std::size_t j = 0; j < weights.points; ++j) {
+        p += weights.w[j] * values[i - 1 - j];
+    }
+    return std::isfinite(p) ? p : values[i - 1];
+}
+
+std::uint64_t zigzag(std::uint64_t v) { return (v << 1) ^ (std::uint64_t(0) - (v >> 63)); }
+std::uint64_t unzigzag(std::uint64_t z) { return (z >> 1) ^ (std::uint64_t(0) - (z & 1)); }
+
+// Appends bits most-significant first
+class BitWriter
+{
+public:
+    explicit BitWriter(std::vector<std::uint64_t>& words) : m_words(words) {}
+
+    void write(std::uint64_t value, unsigned bits)
+    {
+        while (bits > 0) {
+            if (m_free == 0) {
+                m_words.push_back(0);
+                m_free = 64;
+            }
+            const unsigned n = std::min(bits, m_free);
+            const std::uint64_t part = (value >> (bits - n)) & lowMask(n);
+            m_words.back() |= part << (m_free - n);
+            m_free -= n;
+            bits -= n;
+        }
+    }
+
+private:
+    std::vector<std::uint64_t>& m_words;
+    unsigned m_free = 0;
+};
+
+// Reads bits most-significant first from [words, end). Reading past the end
+// yields zeros and sets overrun(), so a corrupt stream cannot leave its words
+class BitReader
+{
+public:
+    BitReader(const std::uint64_t* words, const std::uint64_t* end) : m_next(words), m_end(end) {}
+
+    std::uint64_t read(unsigned bits)
+    {
+        std::uint64_t result = 0;
+        while (bits > 0) {
+            if (m_left == 0) {
+                if (m_next < m_end) {
+                    m_current = *m_next++;
+                } else {
+                    m_current = 0;
+                    m_overrun = true;
+                }
+                m_left = 64;
+            }
+            const unsigned n = std::min(bits, m_left);
+            const std::uint64_t part = (m_current >> (m_left - n)) & lowMask(n);
+            result = n == 64 ? part : (result << n) | part;
+            m_left -= n;
+            bits -= n;
+        }
+        return result;
+    }
+
+    bool readBit() { return read(1) != 0; }
+    bool overrun() const { return m_overrun; }
+
+private:
+    const std::uint64_t* m_next;
+    const std::uint64_t* m_end;
+    bool m_overrun = false;
+    std::uint64_t m_current = 0;
+    unsigned m_left = 0;
+};
+
+// Delta-of-delta of the bit patterns, zigzagged into prefix-coded buckets
+void encodeTimes(const double* times, std::size_t rows, BitWriter& out)
+{
+    std::uint64_t previous = bitsOf(times[0]);
+    std::uint64_t previousDelta = 0;
+    out.write(previous, 64);
+    for (std::size_t i = 1; i < rows; ++i) {
+        const std::uint64_t bits = bitsOf(times[i]);
+        const std::uint64_t delta = bits - previous;
+        const std::uint64_t z = zigzag(delta - previousDelta);
+        if (z == 0) {
+            out.write(0b0, 1);
+        } else if (z < (std::uint64_t(1) << 7)) {
+            out.write(0b10, 2);
+            out.write(z, 7);
+        } else if (z < (std::uint64_t(1) << 12)) {
+            out.write(0b110, 3);
+            out.write(z, 12);
+        } else if (z < (std::uint64_t(1) << 24)) {
+            out.write(0b1110, 4);
+            out.write(z, 24);
+        } else {
+            out.write(0b1111, 4);
+            out.write(z, 64);
+        }
+        previous = bits;
+        previousDelta = delta;
+    }
+}
+
+void decodeTimes(BitReader& in, std::size_t rows, double* times)
+{
+    std::uint64_t previous = in.read(64);
+    std::uint64_t previousDelta = 0;
+    times[0] = doubleOf(previous);
+    for (std::size_t i = 1; i < rows; ++i) {
+        std::uint64_t z = 0;
+        if (in.readBit()) {
+            if (!in.readBit()) {
+                z = in.read(7);
+            } else if (!in.readBit()) {
+                z = in.read(12);
+            } else if (!in.readBit()) {
+                z = in.read(24);
+            } else {
+                z = in.read(64);
+            }
+        }
+        previousDelta += unzigzag(z);
+        previous += previousDelta;
+        times[i] = doubleOf(previous);
+    }
+}
+
+// Residual against the prediction: the difference of the bit patterns,
+// zigzagged. Residuals that fit the current width (and are not much
+// narrower) reuse it; otherwise a new width is sent first.
+constexpr unsigned WIDTH_SLACK = 4; // Narrower residuals than this re-send the width
+
+void encodeValues(const double* values, const PredictorWeights* weights, std::size_t rows, BitWriter& out)
+{
+    out.write(bitsOf(values[0]), 64);
+    unsigned width = 0; // 0 = none sent yet
+    for (std::size_t i = 1; i < rows; ++i) {
+        const double prediction = predict(weights[i], values, i);
+        const std::uint64_t z = zigzag(bitsOf(values[i]) - bitsOf(prediction));
+        if (z == 0) {
+            out.write(0b0, 1);
+            continue;
+        }
+        const unsigned length = 64 - leadingZeros(z);
+        if (length <= width && length + WIDTH_SLACK > width) {
+            out.write(0b10, 2);
+            out.write(z, width);
+        } else {
+            out.write(0b11, 2);
+            out.write(length - 1, 6);
+            out.write(z, length);
+            width = length;
+        }
+    }
+}
+
+void decodeValues(BitReader& in, const PredictorWeights* weights, std::size_t rows, double* values)
+{
+    values[0] = doubleOf(in.read(64));
+    unsigned width = 0;
+    for (std::size_t i = 1; i < rows; ++i) {
+        const double prediction = predict(weights[i], values, i);
+        std::uint64_t z = 0;
+        if (in.readBit()) {
+            if (in.readBit()) {
+                width = static_cast<unsigned>(in.read(6)) + 1;
+            }
+            z = in.read(width);
+        }
+        values[i] = doubleOf(bitsOf(prediction) + unzigzag(z));
+    }
+}
+
+void setError(std::string* error, const std::string& message)
+{
+    if (error) {
+        *error = message;
+    }
+}
+
+template <typename T>
+bool writeValue(std::FILE* file, const T& value) { return std::fwrite(&value, sizeof(T), 1, file) == 1; }
+
+template <typename T>
+bool readValue(std::FILE* file, T& value) { return std::fread(&value, sizeof(T), 1, file) == 1; }
+
+} // namespace
+
+CompressedHistory::CompressedHistory(std::size_t chunkRows)
+    : m_chunkRows(std::max<std::size_t>(chunkRows, 2))
+{
+}
+
+void CompressedHistory::append(double time,
+                               double theta1, double omega1,
+                               double theta2, double omega2,
+                               double kineticEnergy, double potentialEnergy)
+{
+    m_tail[static_cast<std::size_t>(Column::Time)].push_back(time);
+    m_tail[static_cast<std::size_t>(Column::Theta1)].push_back(theta1);
+    m_tail[static_cast<std::size_t>(Column::Omega1)].push_back(omega1);
+    m_tail[static_cast<std::size_t>(Column::Theta2)].push_back(theta2);
+    m_tail[static_cast<std::size_t>(Column::Omega2)].push_back(omega2);
+    m_tail[static_cast<std::size_t>(Column::KineticEnergy)].push_back(kineticEnergy);
+    m_tail[static_cast<std::size_t>(Column::PotentialEnergy)].push_back(potentialEnergy);
+    m_tail[static_cast<std::size_t>(Column::TotalEnergy)].push_back(kineticEnergy + potentialEnergy);
+    if (tailSize() == m_chunkRows) {
+        sealTail();
+    }
+}
+
+void CompressedHistory::clear()
+{
+    m_chunks.clear();
+    m_sealedRows = 0;
+    m_compressedBytes = 0;
+    m_droppedRows = 0;
+    for (auto& column : m_tail) {
+        column.clear();
+    }
+}
+
+void CompressedHistory::setByteBudget(std::size_t bytes)
+{
+    m_byteBudget = bytes;
+    enforceBudget();
+}
+
+double CompressedHistory::startTime() const
+{
+    if (!m_chunks.empty()) return m_chunks.front().firstTime;
+    return tailSize() > 0 ? m_tail[0].front() : 0.0;
+}
+
+double CompressedHistory::endTime() const
+{
+    if (tailSize() > 0) return m_tail[0].back();
+    return m_chunks.empty() ? 0.0 : m_chunks.back().lastTime;
+}
+
+std::size_t CompressedHistory::memoryBytes() const
+{
+    std::size_t bytes = m_compressedBytes;
+    for (const auto& column : m_tail) {
+        bytes += column.capacity() * sizeof(double);
+    }
+    for (const auto& column : m_scratch) {
+        bytes += column.capacity() * sizeof(double);
+    }
+    return bytes;
+}
+
+CompressedHistory::Chunk CompressedHistory::encodeChunk(const Columns& columns, std::size_t rows) const
+{
+    Chunk chunk;
+    chunk.rows = static_cast<std::uint32_t>(rows);
+    chunk.firstTime = columns[0].front();
+    chunk.lastTime = columns[0][rows - 1];
+    std::vector<PredictorWeights> weights;
+    predictorWeights(columns[0].data(), rows, weights);
+    for (std::size_t c = 0; c < STORED_COLUMNS; ++c) {
+        chunk.offsets[c] = static_cast<std::uint32_t>(chunk.words.size());
+        BitWriter writer(chunk.words);
+        if (c == static_cast<std::size_t>(Column::Time)) {
+            encodeTimes(columns[c].data(), rows, writer);
+        } else {
+            encodeValues(columns[c].data(), weights.data(), rows, writer);
+        }
+    }
+    chunk.offsets[STORED_COLUMNS] = static_cast<std::uint32_t>(chunk.words.size());
+    chunk.words.shrink_to_fit();
+    chunk.checksum = checksum(columns, rows);
+    return chunk;
+}
+
+std::uint64_t CompressedHistory::checksum(const Columns& columns, std::size_t rows)
+{
+    // FNV-1a over the bit patterns of the stored columns
+    std::uint64_t hash = 0xcbf29ce484222325ull;
+    for (std::size_t c = 0; c < STORED_COLUMNS; ++c) {
+        const double* values = columns[c].data();
+        for (std::size_t i = 0; i < rows; ++i) {
+            hash = (hash ^ bitsOf(values[i])) * 0x100000001b3ull;
+        }
+    }
+    return hash;
+}
+
+bool CompressedHistory::decodeChunk(const Chunk& chunk, Columns& out)
+{
+    for (auto& column : out) {
+        column.resize(chunk.rows);
+    }
+    // Time first: the value predictors are built from it
+    std::vector<PredictorWeights> weights;
+    bool complete = true;
+    for (std::size_t c = 0; c < STORED_COLUMNS; ++c) {
+        BitReader reader(chunk.words.data() + chunk.offsets[c], chunk.words.data() + chunk.offsets[c + 1]);
+        if (c == static_cast<std::size_t>(Column::Time)) {
+            decodeTimes(reader, chunk.rows, out[c].data());
+            predictorWeights(out[c].data(), chunk.rows, weights);
+        } else {
+            decodeValues(reader, weights.data(), chunk.rows, out[c].data());
+        }
+        complete = complete && !reader.overrun();
+    }
+    const double* kinetic = out[static_cast<std::size_t>(Column::KineticEnergy)].data();
+    const double* potential = out[static_cast<std::size_t>(Column::PotentialEnergy)].data();
+    double* total = out[static_cast<std::size_t>(Column::TotalEnergy)].data();
+    for (std::size_t i = 0; i < chunk.rows; ++i) {
+        total[i] = kinetic[i] + potential[i];
+    }
+    return complete;
+}
+
+std::uint64_t CompressedHistory::lowerBound(double time) const
+{
+    // First chunk whose last time reaches the time; only its time stream is needed
+    auto it = std::lower_bound(m_chunks.begin(), m_chunks.end(), time,
+        [](const Chunk& chunk, double t) { return chunk.lastTime < t; });
+    if (it != m_chunks.end()) {
+        if (!(it->firstTime < time)) {
+            return it->firstRow;
+        }
+        std::vector<double>& times = m_scratch[static_cast<std::size_t>(Column::Time)];
+        times.resize(it->rows);
+        const std::size_t column = static_cast<std::size_t>(Column::Time);
+        BitReader reader(it->words.data() + it->offsets[column], it->words.data() + it->offsets[column + 1]);
+        decodeTimes(reader, it->rows, times.data());
+        return it->firstRow + static_cast<std::uint64_t>(std::lower_bound(times.begin(), times.end(), time) - times.begin());
+    }
+    const std::vector<double>& tail = m_tail[static_cast<std::size_t>(Column::Time)];
+    return m_droppedRows + m_sealedRows
+        + static_cast<std::uint64_t>(std::lower_bound(tail.begin(), tail.end(), time) - tail.begin());
+}
+
+void CompressedHistory::sealTail()
+{
+    const std::size_t rows = tailSize();
+    if (rows == 0) {
+        return;
+    }
+    m_chunks.push_back(encodeChunk(m_tail, rows));
+    m_chunks.back().firstRow = m_droppedRows + m_sealedRows;
+    m_sealedRows += rows;
+    m_compressedBytes += m_chunks.back().words.size() * sizeof(std::uint64_t) + sizeof(Chunk);
+    for (auto& column : m_tail) {
+        column.clear();
+    }
+    enforceBudget();
+}
+
+void CompressedHistory::enforceBudget()
+{
+    // The newest chunk is always kept, however small the budget
+    while (m_byteBudget > 0 && m_compressedBytes > m_byteBudget && m_chunks.size() > 1) {
+        const Chunk& oldest = m_chunks.front();
+        m_compressedBytes -= oldest.words.size() * sizeof(std::uint64_t) + sizeof(Chunk);
+        m_sealedRows -= oldest.rows;
+        m_droppedRows += oldest.rows;
+        m_chunks.pop_front();
+    }
+}
+
+bool CompressedHistory::save(const std::string& path, std::string* error) const
+{
+    std::FILE* file = std::fopen(path.c_str(), "wb");
+    if (!file) {
+        setError(error, "cannot open " + path + " for writing");
+        return false;
+    }
+    const bool hasTail = tailSize() > 0;
+    const Chunk tail = hasTail ? encodeChunk(m_tail, tailSize()) : Chunk();
+    const std::uint64_t chunkCount = m_chunks.size() + (hasTail ? 1 : 0);
+
+    auto writeChunk = [file](const Chunk& chunk) {
+        return writeValue(file, chunk.firstTime)
+            && writeValue(file, chunk.lastTime)
+            && writeValue(file, chunk.rows)
+            && writeValue(file, chunk.checksum)
+            && std::fwrite(chunk.offsets.data(), sizeof(std::uint32_t), chunk.offsets.size(), file) == chunk.offsets.size()
+            && std::fwrite(chunk.words.data(), sizeof(std::uint64_t), chunk.words.size(), file) == chunk.words.size();
+    };
+
+    bool ok = std::fwrite(HISTORY_MAGIC, 1, sizeof(HISTORY_MAGIC), file) == sizeof(HISTORY_MAGIC)
+        && writeValue(file, HISTORY_VERSION)
+        && writeValue(file, static_cast<std::uint32_t>(m_chunkRows))
+        && writeValue(file, chunkCount)
+        && writeValue(file, m_droppedRows);
+    for (auto it = m_chunks.begin(); ok && it != m_chunks.end(); ++it) {
+        ok = writeChunk(*it);
+    }
+    if (ok && hasTail) {
+        ok = writeChunk(tail);
+    }
+    ok = std::fclose(file) == 0 && ok;
+    if (!ok) {
+        setError(error, "failed to write " + path);
+    }
+    return ok;
+}
+
+bool CompressedHistory::load(const std::string& path, std::string* error)
+{
+    std::FILE* file = std::fopen(path.c_str(), "rb");
+    if (!file) {
+        setError(error, "cannot open " + path);
+        return false;
+    }
+    char magic[sizeof(HISTORY_MAGIC)] = {};
+    std::uint32_t version = 0;
+    std::uint32_t chunkRows = 0;
+    std::uint64_t chunkCount = 0;
+    std::uint64_t droppedRows = 0;
+    if (std::fread(magic, 1, sizeof(magic), file) != sizeof(magic)
+        || std::memcmp(magic, HISTORY_MAGIC, sizeof(magic)) != 0
+        || !readValue(file, version) || version != HISTORY_VERSION
+        || !readValue(file, chunkRows) || chunkRows < 2
+        || !readValue(file, chunkCount)
+        || !readValue(file, droppedRows)) {
+        std::fclose(file);
+        setError(error, path + " is not a history file of a supported version");
+        return false;
+    }
+
+    std::deque<Chunk> chunks;
+    std::size_t rows = 0;
+    std::size_t bytes = 0;
+    for (std::uint64_t i = 0; i < chunkCount; ++i) {
+        Chunk chunk;
+        bool ok = readValue(file, chunk.firstTime)
+            && readValue(file, chunk.lastTime)
+            && readValue(file, chunk.rows)
+            && chunk.rows > 0 && chunk.rows <= chunkRows
+            && readValue(file, chunk.checksum)
+            && std::fread(chunk.offsets.data(), sizeof(std::uint32_t), chunk.offsets.size(), file) == chunk.offsets.size();
+        // Stream offsets must be ordered; the last one is the word count
+        for (std::size_t c = 1; ok && c < chunk.offsets.size(); ++c) {
+            ok = chunk.offsets[c] >= chunk.offsets[c - 1];
+        }
+        if (ok) {
+            chunk.words.resize(chunk.offsets[STORED_COLUMNS]);
+            ok = std::fread(chunk.words.data(), sizeof(std::uint64_t), chunk.words.size(), file) == chunk.words.size();
+        }
+        if (!ok) {
+            std::fclose(file);
+            setError(error, path + " is truncated or corrupt");
+            return false;
+        }
+        // Decoding relies on this build predicting exactly as the writer did; a chunk
+        // that decodes past its words or to other bits than were encoded is rejected
+        if (!decodeChunk(chunk, m_scratch) || checksum(m_scratch, chunk.rows) != chunk.checksum) {
+            std::fclose(file);
+            setError(error, path + " is corrupt or was written by a build that decodes it differently");
+            return false;
+        }
+        chunk.firstRow = droppedRows + rows;
+        rows += chunk.rows;
+        bytes += chunk.words.size() * sizeof(std::uint64_t) + sizeof(Chunk);
+        chunks.push_back(std::move(chunk));
+    }
+    std::fclose(file);
+
+    clear();
+    m_chunkRows = chunkRows;
+    m_chunks = std::move(chunks);
+    m_sealedRows = rows;
+    m_compressedBytes = bytes;
+    m_droppedRows = droppedRows;
+
+    // A short final chunk was the tail when the file was saved; appends continue it
+    if (!m_chunks.empty() && m_chunks.back().rows < m_chunkRows) {
+        const Chunk& last = m_chunks.back();
+        decodeChunk(last, m_tail);
+        m_sealedRows -= last.rows;
+        m_compressedBytes -= last.words.size() * sizeof(std::uint64_t) + sizeof(Chunk);
+        m_chunks.pop_back();
+    }
+    enforceBudget();
+    return true;
+}
@@ -1,17 +1,13 @@
 #include "core/DoublePendulum.h"
 #include <cmath>
 #include <algorithm>
+#include <QDateTime>
 #include <QDebug>
+#include <QDir>
 #include <QFile>
+#include <QStandardPaths>
 #include <QTextStream>
-#include <QElapsedTimer>
 #include <QTimer>
-#include <functional>
-
-// Since C++17, static constexpr members are implicitly inline, so they don't need a separate definition.
-// If using an older standard, these definitions would be necessary:
-// constexpr double DoublePendulum::DOPRI_ATOL;
-// ...etc.
 
 DoublePendulum::DoublePendulum(
     double m1, double m2,
@@ -36,15 +32,9 @@ DoublePendulum::DoublePendulum(
     , m_simulationFailed(false)
     , m_showTrace1(false)
     , m_showTrace2(false)
-    , prev_theta1_for_poincare(theta1_abs) // Инициализация переменной для карты Пуанкаре
     , m_currentKineticEnergy(0.0)
     , m_currentPotentialEnergy(0.0)
     , m_currentTotalEnergy(0.0)
-    , m_last_used_h(0.001)  // Инициализация с разумным начальным шагом
-    , m_time_accumulator(0.0) // Начальное значение аккумулятора времени
-    , m_fsal_ready(false)
-    , m_last_fsal_t(0.0)
-    , m_last_fsal_k(4, 0.0) // Assuming a 4-dimensional system
 {
     // Начальные настройки уже определены в .h файле
 
@@ -53,114 +43,151 @@ DoublePendulum::DoublePendulum(
     m_bob2FlashTimer->setSingleShot(true);
     m_bob2FlashTimer->setInterval(POINCARE_FLASH_DURATION_MS); // Длительность вспышки в мс
     connect(m_bob2FlashTimer, &QTimer::timeout, this, &DoublePendulum::resetBob2Flash);
+
+    m_historyArchive.setByteBudget(HISTORY_ARCHIVE_BYTE_BUDGET);
+
+    m_recordingDirectory = QStandardPaths::writableLocation(QStandardPaths::AppLocalDataLocation)
+                           + QStringLiteral("/recordings");
+
+    // Интегратор работает в отдельном потоке; GUI только забирает готовые шаги
+    m_engine = new SimulationEngine(parameters(), {theta1, omega1, theta2, omega2}, this);
+    connect(m_engine, &SimulationEngine::advanceFinished, this, &DoublePendulum::syncFromEngine);
+    m_engine->start();
+}
+
+DoublePendulum::~DoublePendulum()
+{
+    shutdown();
+}
+
+void DoublePendulum::shutdown()
+{
+    m_engine->stop();
+    finishRecordingFile();
 }
 
 void DoublePendulum::step(double dt)
 {
-    QElapsedTimer timer;
-    timer.start();
-    const double MAX_CALCULATION_TIME_MS = dt * 1000 * 0.8; // Use 80% of the frame time for calculation
-
-    double target_sim_time_to_advance = dt * m_simulationSpeed + m_time_accumulator;
-    m_time_accumulator = 0.0;
-
-    double time_advanced_this_call = 0.0;
-    double current_h = m_last_used_h;
-    std::vector<double> y_current_state = {theta1, omega1, theta2, omega2};
-    std::vector<double> y_next_state(4);
-    bool step_accepted_flag;
-
-    while (time_advanced_this_call < target_sim_time_to_advance && !m_simulationFailed) {
-        if (timer.elapsed() > MAX_CALCULATION_TIME_MS) {
-            m_time_accumulator = target_sim_time_to_advance - time_advanced_this_call;
-            break;
+    if (m_replay.isOpen()) {
+        if (!m_replayPlaying) {
+            advanceReplay(dt * m_simulationSpeed);
         }
+        return;
+    }
+    if (!m_engine->isRunning()) {
+        m_engine->requestAdvance(dt * m_simulationSpeed); // syncFromEngine() runs once it is done
+    }
+    syncFromEngine();
+}
 
-        double time_remaining = target_sim_time_to_advance - time_advanced_this_call;
-        if (current_h > time_remaining) {
-            if (time_remaining < DOPRI_HMIN / 2.0) {
-                m_time_accumulator = time_remaining;
-                break;
-            }
-            current_h = time_remaining;
+void DoublePendulum::syncFromEngine()
+{
+    publishFrame(collectFromEngine());
+}
+
+DoublePendulum::FrameChanges DoublePendulum::collectFromEngine()
+{
+    if (m_replay.isOpen()) {
+        // The live run is paused; playback follows the wall clock the way the engine does
+        if (m_replayPlaying) {
+            advanceReplay(static_cast<double>(m_replayClock.restart()) / 1000.0 * m_simulationSpeed);
         }
-        
-        double current_h_before_call = current_h;
-        performOneDormandPrinceStep(m_currentTimeForHistory, y_current_state, current_h, y_next_state, step_accepted_flag);
+        return FrameChanges::None;
+    }
 
-        if (step_accepted_flag) {
-            if (m_isManualControlActive) { // If manual control was somehow activated mid-step, abort history writing
-                return;
-            }
-            y_current_state = y_next_state;
-            m_currentTimeForHistory += current_h_before_call;
-            time_advanced_this_call += current_h_before_call;
-
-            for (const double& val : y_current_state) {
-                if (std::isnan(val) || std::isinf(val)) {
-                    m_simulationFailed = true;
-                    emit simulationFailedChanged();
-                    return; // Exit immediately
-                }
-            }
+    if (m_isManualControlActive) {
+        // The user is dragging the pendulum: whatever was integrated before the grab is stale
+        m_engine->drainSamples([](const SimulationSample&) {});
+        return FrameChanges::None;
+    }
 
-            m_theta1History.append(QPointF(m_currentTimeForHistory, y_current_state[0]));
-            m_omega1History.append(QPointF(m_currentTimeForHistory, y_current_state[1]));
-            m_theta2History.append(QPointF(m_currentTimeForHistory, y_current_state[2]));
-            m_omega2History.append(QPointF(m_currentTimeForHistory, y_current_state[3]));
-
-            // Update energies and traces using helper functions
-            updateEnergies(y_current_state);
-            updateTraces(y_current_state);
-
-            // Update energy history
-            m_kineticEnergyHistory.append(QPointF(m_currentTimeForHistory, m_currentKineticEnergy));
-            m_potentialEnergyHistory.append(QPointF(m_currentTimeForHistory, m_currentPotentialEnergy));
-            m_totalEnergyHistory.append(QPointF(m_currentTimeForHistory, m_currentTotalEnergy));
-
-            // Poincare map logic
-            if (((prev_theta1_for_poincare < 0 && y_current_state[0] >= 0) || (prev_theta1_for_poincare > 0 && y_current_state[0] <= 0)) && 
-                std::abs(y_current_state[0]) < POINCARE_THETA1_TOLERANCE_RAD && 
-                y_current_state[1] > POINCARE_OMEGA1_MIN_VELOCITY_RAD_S) {
-                m_poincareMapPoints.append(QPointF(y_current_state[2], y_current_state[3]));
-                if (!m_bob2PoincareFlash) {
-                    m_bob2PoincareFlash = true;
-                    emit bob2PoincareFlashChanged();
-                }
-                m_bob2FlashTimer->start();
-            }
-            prev_theta1_for_poincare = y_current_state[0];
+    const std::size_t drained = m_engine->drainSamples([this](const SimulationSample& sample) {
+        updateTraces(sample.state);
+        appendHistoryRow(sample.time, sample.state,
+                         sample.energies.kinetic, sample.energies.potential, sample.energies.total);
+        if (m_recordingEnabled) {
+            recordFrame({sample.time, sample.state[0], sample.state[1], sample.state[2], sample.state[3],
+                         sample.energies.kinetic, sample.energies.potential});
         }
-
-        // Prune history buffers if they exceed the maximum size
-        if (m_theta1History.size() > MAX_BUFFER_SIZE) {
-            m_theta1History.removeFirst();
-            m_omega1History.removeFirst();
-            m_theta2History.removeFirst();
-            m_omega2History.removeFirst();
-            m_kineticEnergyHistory.removeFirst();
-            m_potentialEnergyHistory.removeFirst();
-            m_totalEnergyHistory.removeFirst();
+    });
+    if (m_recorder.failed()) {
+        qWarning() << "Trajectory recording stopped: cannot write" << QString::fromStdString(m_recorder.path());
+        finishRecordingFile();
+        m_recordingEnabled = false;
+        emit recordingChanged();
+    }
+    const std::size_t crossings = m_engine->drainCrossings([this](const PoincareCrossing& crossing) {
+        const std::array<double, 2> point = m_poincareSection.mapCoordinates(crossing.state);
+        m_poincareMapPoints.append(QPointF(point[0], point[1]));
+    });
+
+    if (crossings > 0) {
+        if (!m_bob2PoincareFlash) {
+            m_bob2PoincareFlash = true;
+            emit bob2PoincareFlashChanged();
         }
+        m_bob2FlashTimer->start();
+    }
+
+    // The snapshot may still describe the state from before the last reset
+    const SimulationSnapshot& snapshot = m_engine->latestSnapshot();
+    if (snapshot.epoch != m_engine->currentEpoch()) {
+        return FrameChanges::None;
+    }
 
-        if (current_h < DOPRI_HMIN && !step_accepted_flag) {
+    const double speed = m_simulationSpeed > 0.0 ? m_simulationSpeed : 1.0;
+    m_physicsTiming.lagSeconds = std::max(0.0, snapshot.timeDebt) / speed;
+    m_physicsTiming.droppedTime = snapshot.droppedTime;
+    m_physicsTiming.load = snapshot.tickLoad;
+    m_physicsTiming.overrunTicks = snapshot.overrunTicks;
+
+    if (snapshot.failed) {
+        if (!m_simulationFailed) {
             m_simulationFailed = true;
             emit simulationFailedChanged();
-            break;
         }
-        m_last_used_h = current_h;
+        return FrameChanges::State;
     }
 
-    if (!m_simulationFailed) {
-        theta1 = y_current_state[0];
-        omega1 = y_current_state[1];
-        theta2 = y_current_state[2];
-        omega2 = y_current_state[3];
-        if (time_advanced_this_call > 0) {
-            emit historyUpdated();
-            emit currentTimeChanged();
+    PendulumState shown = snapshot.state;
+    PendulumEnergies shownEnergies = snapshot.energies;
+    double shownTime = snapshot.time;
+    const double stepLength = m_engine->fixedTimestep();
+    const double stepSpan = snapshot.stepTime - snapshot.previousStepTime;
+    if (stepLength > 0.0 && m_engine->isRunning() && stepSpan > 0.0) {
+        // Draw the clock time one step back, which always lies between the last two
+        // step boundaries; angles are unwrapped, so they interpolate linearly too.
+        // The energies and the clock readout describe the same instant.
+        const double renderTime = snapshot.time + snapshot.timeDebt - stepLength;
+        const double alpha = std::clamp((renderTime - snapshot.previousStepTime) / stepSpan, 0.0, 1.0);
+        for (std::size_t i = 0; i < shown.size(); ++i) {
+            shown[i] = snapshot.previousStepState[i] + alpha * (snapshot.stepState[i] - snapshot.previousStepState[i]);
         }
+        shownEnergies = PendulumIntegrator::energies(parameters(), shown);
+        shownTime = snapshot.previousStepTime + alpha * stepSpan;
+    }
+    theta1 = shown[0];
+    omega1 = shown[1];
+    theta2 = shown[2];
+    omega2 = shown[3];
+    m_currentKineticEnergy = shownEnergies.kinetic;
+    m_currentPotentialEnergy = shownEnergies.potential;
+    m_currentTotalEnergy = shownEnergies.total;
+    m_currentTimeForHistory = shownTime;
+    updateStepStatistics(snapshot);
+    return drained > 0 ? FrameChanges::StateAndHistory : FrameChanges::State;
+}
+
+void DoublePendulum::publishFrame(FrameChanges changes)
+{
+    if (changes == FrameChanges::None) {
+        return;
+    }
+    if (changes == FrameChanges::StateAndHistory) {
+        emit historyUpdated();
     }
+    // The interpolated clock moves every frame, not only when history rows arrive
+    emit currentTimeChanged();
 
     emit theta1Changed();
     emit theta2Changed();
@@ -175,86 +202,39 @@ double DoublePendulum::getTheta2() const { return theta2; }
 double DoublePendulum::getOmega2() const { return omega2; }
 
 void DoublePendulum::setTheta1(double newTheta1) {
+    if (m_replay.isOpen()) {
+        return; // The replay owns the shown state; dragging must not move the paused live run
+    }
     if (theta1 != newTheta1) {
         theta1 = newTheta1;
+        pushStateToEngine();
         emit theta1Changed();
         emit stateChanged();
     }
 }
 
 void DoublePendulum::setTheta2(double newTheta2) {
+    if (m_replay.isOpen()) {
+        return; // The replay owns the shown state; dragging must not move the paused live run
+    }
     if (theta2 != newTheta2) {
         theta2 = newTheta2;
+        pushStateToEngine();
         emit theta2Changed();
         emit stateChanged();
     }
 }
 
-/*
- * @brief Calculates the derivatives of the state vector.
- *
- * This function implements the core physics of the double pendulum. It solves
- * the system of linear equations A * x_ddot = B to find the angular
- * accelerations, where:
- *
- * x = [theta1_abs]
- *     [theta2_abs]
- *
- * x_ddot = [theta1_abs_ddot] -> angular acceleration of the first pendulum
- *          [theta2_abs_ddot] -> angular acceleration of the second pendulum
- *
- * A = [[ A11, A12 ],  // The mass matrix, dependent on the current state.
- *      [ A21, A22 ]]
- *
- * B = [[ B1 ],        // Vector of forces (gravity, centrifugal, Coriolis, friction).
- *      [ B2 ]]
- *
- * The function returns the state derivative vector dy/dt:
- * {omega1_abs, theta1_abs_ddot, omega2_rel, theta2_rel_ddot}
- */
-std::vector<double> DoublePendulum::getDerivatives(double t, const std::vector<double>& yState) const {
-    (void)t; // Mark 't' as unused to avoid compiler warnings
-
-    double current_theta1_abs = yState[0];
-    double current_omega1_abs = yState[1];
-    double current_theta2_rel = yState[2];
-    double current_omega2_rel_dot = yState[3];
-    double current_theta2_abs = current_theta1_abs + current_theta2_rel;
-    double current_omega2_abs = current_omega1_abs + current_omega2_rel_dot;
-
-    double A11 = (m1 + m_rodMass1/3.0 + m2 + m_rodMass2) * l1 * l1;
-    double A12 = (m2 + m_rodMass2/2.0) * l1 * l2 * cos(current_theta1_abs - current_theta2_abs);
-    double A21 = A12;
-    double A22 = (m2 + m_rodMass2/3.0) * l2 * l2;
-
-    double Q_nc1 = -b1 * current_omega1_abs - c1 * current_omega1_abs * std::abs(current_omega1_abs);
-    double Q_nc2 = -b2 * current_omega2_rel_dot - c2 * current_omega2_rel_dot * std::abs(current_omega2_rel_dot);
-
-    double B1 = -(m2 + m_rodMass2/2.0) * l1 * l2 * current_omega2_abs * current_omega2_abs * sin(current_theta1_abs - current_theta2_abs)
-                - g * (m1 + m_rodMass1/2.0 + m2 + m_rodMass2) * l1 * sin(current_theta1_abs)
-                + Q_nc1;
-    double B2 = (m2 + m_rodMass2/2.0) * l1 * l2 * current_omega1_abs * current_omega1_abs * sin(current_theta1_abs - current_theta2_abs)
-                - g * (m2 + m_rodMass2/2.0) * l2 * sin(current_theta2_abs)
-                + Q_nc2;
-
-    double det = A11 * A22 - A12 * A21;
-    if (std::fabs(det) < 1e-12) { // Use a slightly larger epsilon for singularity check
-        return {current_omega1_abs, 0.0, current_omega2_rel_dot, 0.0};
-    }
-
-    double theta1_abs_ddot = (B1 * A22 - A12 * B2) / det;
-    double theta2_abs_ddot = (A11 * B2 - B1 * A21) / det;
-    double theta2_rel_ddot = theta2_abs_ddot - theta1_abs_ddot;
-
-    return {current_omega1_abs, theta1_abs_ddot, current_omega2_rel_dot, theta2_rel_ddot};
-}
-
 void DoublePendulum::reset(double newTheta1_abs, double newOmega1, double newTheta2_rel, double newOmega2) {
     qDebug() << "C++ DoublePendulum::reset called with params:" << 
                 "\ntheta1_abs_rad=" << newTheta1_abs << " (" << newTheta1_abs * 180.0/M_PI << "°)" <<
                 "\nomega1=" << newOmega1 <<
                 "\ntheta2_rel_rad=" << newTheta2_rel << " (" << newTheta2_rel * 180.0/M_PI << "°)" <<
                 "\nomega2=" << newOmega2;
+
+    // A reset returns to the live run, and its clock restarts: a new recording file begins
+    closeReplay();
+    finishRecordingFile();
                 
     // Обновить состояние
     theta1 = newTheta1_abs;
@@ -263,37 +243,19 @@ void DoublePendulum::reset(double newTheta1_abs, double newOmega1, double newThe
     omega2 = newOmega2;
     
     // Очищаем исторические данные
-    m_theta1History.clear();
-    m_theta2History.clear();
-    m_omega1History.clear();
-    m_omega2History.clear();
-    m_kineticEnergyHistory.clear();
-    m_potentialEnergyHistory.clear();
-    m_totalEnergyHistory.clear();
-    
-    // Добавляем начальные значения
-    m_theta1History.append(QPointF(0, theta1));
-    m_theta2History.append(QPointF(0, theta2));
-    m_omega1History.append(QPointF(0, omega1));
-    m_omega2History.append(QPointF(0, omega2));
+    clearHistoryRows();
     
     // Очищаем трассы
-    m_trace1_points.clear();
-    m_trace2_points.clear();
+    clearTracePoints();
     
     // Сбрасываем текущее время
     m_currentTimeForHistory = 0.0;
     emit currentTimeChanged(); // Emit signal when time is reset
     
-    // Сбрасываем параметры интегрирования
-    m_last_used_h = 0.001;     // Возвращаем начальный шаг
-    m_time_accumulator = 0.0;  // Сбрасываем аккумулятор времени
-    
-    // Сбрасываем FSAL оптимизацию
-    m_fsal_ready = false;
+    // Перезапускаем интегратор; шаги, посчитанные до сброса, будут отброшены
+    m_engine->reset({theta1, omega1, theta2, omega2}, 0.0);
     
     // Сбрасываем карту Пуанкаре
-    prev_theta1_for_poincare = theta1;
     m_poincareMapPoints.clear();
     
     // Сбрасываем флаг ошибки симуляции
@@ -306,13 +268,7 @@ void DoublePendulum::reset(double newTheta1_abs, double newOmega1, double newThe
     updateEnergies({theta1, omega1, theta2, omega2});
 
     // Add initial state to history
-    m_theta1History.append(QPointF(0, theta1));
-    m_theta2History.append(QPointF(0, theta2));
-    m_omega1History.append(QPointF(0, omega1));
-    m_omega2History.append(QPointF(0, omega2));
-    m_kineticEnergyHistory.append(QPointF(0, m_currentKineticEnergy));
-    m_potentialEnergyHistory.append(QPointF(0, m_currentPotentialEnergy));
-    m_totalEnergyHistory.append(QPointF(0, m_currentTotalEnergy));
+    seedHistory();
 
     emit theta1Changed();
     emit theta2Changed();
@@ -326,31 +282,14 @@ void DoublePendulum::reset(double newTheta1_abs, double newOmega1, double newThe
     emit currentTimeChanged();
 }
 
-void DoublePendulum::updateEnergies(const std::vector<double>& state) {
-    double theta1_abs = state[0];
-    double omega1_abs = state[1];
-    double theta2_rel = state[2];
-    double omega2_rel = state[3];
-
-    double theta2_abs = theta1_abs + theta2_rel;
-    double omega2_abs = omega1_abs + omega2_rel;
-
-    // Kinetic Energy T = T1 + T2
-    double T1 = 0.5 * (m1 + m_rodMass1 / 3.0) * l1 * l1 * omega1_abs * omega1_abs;
-    double T2 = 0.5 * (m2 + m_rodMass2) * l1 * l1 * omega1_abs * omega1_abs +
-                0.5 * (m2 + m_rodMass2 / 3.0) * l2 * l2 * omega2_abs * omega2_abs +
-                (m2 + m_rodMass2 / 2.0) * l1 * l2 * omega1_abs * omega2_abs * cos(theta2_rel);
-    m_currentKineticEnergy = T1 + T2;
-
-    // Potential Energy V = V1 + V2 (relative to suspension point y=0)
-    double V1 = (m1 + m_rodMass1 / 2.0 + m2 + m_rodMass2) * g * l1 * cos(theta1_abs);
-    double V2 = (m2 + m_rodMass2 / 2.0) * g * l2 * cos(theta2_abs);
-    m_currentPotentialEnergy = -(V1 + V2); // Negative because y is downwards from origin
-
-    m_currentTotalEnergy = m_currentKineticEnergy + m_currentPotentialEnergy;
+void DoublePendulum::updateEnergies(const PendulumState& state) {
+    const PendulumEnergies energies = PendulumIntegrator::energies(parameters(), state);
+    m_currentKineticEnergy = energies.kinetic;
+    m_currentPotentialEnergy = energies.potential;
+    m_currentTotalEnergy = energies.total;
 }
 
-void DoublePendulum::updateTraces(const std::vector<double>& state) {
+void DoublePendulum::updateTraces(const PendulumState& state) {
     if (m_isManualControlActive) { // Don't update traces when in manual control mode
         return;
     }
@@ -366,13 +305,8 @@ void DoublePendulum::updateTraces(const std::vector<double>& state) {
         QPointF newPoint(x1_phys, y1_phys);
         // Add point only if it's far enough from the previous one
         if (m_trace1_points.empty() || calculateDistance(m_trace1_points.back(), newPoint) > MIN_TRACE_DISTANCE) {
-            m_trace1_points.push_back(newPoint);
+            m_trace1_points.push_back(newPoint); // Ring buffer evicts the oldest point when full
             m_new_trace1_points.push_back(newPoint); // Add to the incremental buffer
-            
-            // Prune trace buffer if it exceeds the maximum size
-            if (m_trace1_points.size() > MAX_BUFFER_SIZE) {
-                m_trace1_points.removeFirst();
-            }
         }
     }
 
@@ -383,13 +317,8 @@ void DoublePendulum::updateTraces(const std::vector<double>& state) {
         QPointF newPoint(x2_phys, y2_phys);
         // Add point only if it's far enough
         if (m_trace2_points.empty() || calculateDistance(m_trace2_points.back(), newPoint) > MIN_TRACE_DISTANCE) {
-            m_trace2_points.push_back(newPoint);
+            m_trace2_points.push_back(newPoint); // Ring buffer evicts the oldest point when full
             m_new_trace2_points.push_back(newPoint); // Add to the incremental buffer
-            
-            // Prune trace buffer if it exceeds the maximum size
-            if (m_trace2_points.size() > MAX_BUFFER_SIZE) {
-                m_trace2_points.removeFirst();
-            }
         }
     }
 }
@@ -401,6 +330,7 @@ void DoublePendulum::setM1(double newM1) {
     double clampedM1 = std::max(0.01, std::min(newM1, 30.0));
     if (m1 != clampedM1) {
         m1 = clampedM1;
+        pushParametersToEngine();
         emit m1Changed();
     }
 }
@@ -409,6 +339,7 @@ void DoublePendulum::setM2(double newM2) {
     double clampedM2 = std::max(0.01, std::min(newM2, 30.0));
     if (m2 != clampedM2) {
         m2 = clampedM2;
+        pushParametersToEngine();
         emit m2Changed();
     }
 }
@@ -420,6 +351,7 @@ void DoublePendulum::setRodMass1(double newRodMass1) {
     double clamped = std::max(0.0, std::min(newRodMass1, 10.0));
     if (m_rodMass1 != clamped) {
         m_rodMass1 = clamped;
+        pushParametersToEngine();
         emit rodMass1Changed();
     }
 }
@@ -428,6 +360,7 @@ void DoublePendulum::setRodMass2(double newRodMass2) {
     double clamped = std::max(0.0, std::min(newRodMass2, 10.0));
     if (m_rodMass2 != clamped) {
         m_rodMass2 = clamped;
+        pushParametersToEngine();
         emit rodMass2Changed();
     }
 }
@@ -440,6 +373,7 @@ void DoublePendulum::setL1(double newL1) {
     double clamped = std::max(0.1, std::min(newL1, 5.0));
     if (l1 != clamped) {
         l1 = clamped;
+        pushParametersToEngine();
         emit l1Changed();
     }
 }
@@ -448,6 +382,7 @@ void DoublePendulum::setL2(double newL2) {
     double clamped = std::max(0.1, std::min(newL2, 5.0));
     if (l2 != clamped) {
         l2 = clamped;
+        pushParametersToEngine();
         emit l2Changed();
     }
 }
@@ -460,6 +395,7 @@ void DoublePendulum::setB1(double newB1) {
     double clamped = std::max(0.0, std::min(newB1, 10.0));
     if (b1 != clamped) {
         b1 = clamped;
+        pushParametersToEngine();
         emit b1Changed();
     }
 }
@@ -468,6 +404,7 @@ void DoublePendulum::setB2(double newB2) {
     double clamped = std::max(0.0, std::min(newB2, 10.0));
     if (b2 != clamped) {
         b2 = clamped;
+        pushParametersToEngine();
         emit b2Changed();
     }
 }
@@ -480,6 +417,7 @@ void DoublePendulum::setC1(double newC1) {
     double clamped = std::max(0.0, std::min(newC1, 5.0));
     if (c1 != clamped) {
         c1 = clamped;
+        pushParametersToEngine();
         emit c1Changed();
     }
 }
@@ -488,6 +426,7 @@ void DoublePendulum::setC2(double newC2) {
     double clamped = std::max(0.0, std::min(newC2, 5.0));
     if (c2 != clamped) {
         c2 = clamped;
+        pushParametersToEngine();
         emit c2Changed();
     }
 }
@@ -499,24 +438,214 @@ void DoublePendulum::setG(double newGValue) {
     double clamped = std::max(0.0, std::min(newGValue, 100.0));
     if (g != clamped) {
         g = clamped;
+        pushParametersToEngine();
         emit gChanged();
     }
 }
 
 void DoublePendulum::setManualControl(bool isActive) {
     m_isManualControlActive = isActive;
+    m_engine->setHeld(isActive);
 }
 
 double DoublePendulum::getSimulationSpeed() const { return m_simulationSpeed; }
 void DoublePendulum::setSimulationSpeed(double newSpeed) {
     if (m_simulationSpeed != newSpeed && newSpeed > 0) {
         m_simulationSpeed = newSpeed;
+        m_engine->setSimulationSpeed(newSpeed);
         emit simulationSpeedChanged();
     }
 }
 
+DoublePendulum::IntegratorMethod DoublePendulum::getIntegratorMethod() const { return m_integratorMethod; }
+void DoublePendulum::setIntegratorMethod(IntegratorMethod method) {
+    static_assert(static_cast<int>(IntegratorMethod::Automatic) == static_cast<int>(PendulumIntegrator::Method::Automatic),
+                  "IntegratorMethod must mirror PendulumIntegrator::Method");
+    if (m_integratorMethod != method) {
+        m_integratorMethod = method;
+        m_engine->setIntegratorMethod(static_cast<PendulumIntegrator::Method>(method));
+        emit integratorMethodChanged();
+    }
+}
+
+QString DoublePendulum::getToleranceProfile() const { return QString::fromLatin1(m_toleranceProfile.name()); }
+void DoublePendulum::setToleranceProfile(const QString& name) {
+    PendulumIntegrator::ToleranceProfile profile;
+    if (!PendulumIntegrator::ToleranceProfile::fromName(name.toLatin1().constData(), profile)) {
+        qWarning() << "Unknown tolerance profile:" << name;
+        return;
+    }
+    applyToleranceProfile(profile);
+}
+
+double DoublePendulum::getAbsoluteTolerance() const { return m_toleranceProfile.absoluteTolerance; }
+void DoublePendulum::setAbsoluteTolerance(double tolerance) {
+    if (tolerance > 0) {
+        PendulumIntegrator::ToleranceProfile profile = m_toleranceProfile;
+        profile.absoluteTolerance = tolerance;
+        applyToleranceProfile(profile);
+    }
+}
+
+double DoublePendulum::getRelativeTolerance() const { return m_toleranceProfile.relativeTolerance; }
+void DoublePendulum::setRelativeTolerance(double tolerance) {
+    if (tolerance > 0) {
+        PendulumIntegrator::ToleranceProfile profile = m_toleranceProfile;
+        profile.relativeTolerance = tolerance;
+        applyToleranceProfile(profile);
+    }
+}
+
+double DoublePendulum::getMinStepSize() const { return m_toleranceProfile.minStep; }
+void DoublePendulum::setMinStepSize(double step) {
+    if (step > 0) {
+        PendulumIntegrator::ToleranceProfile profile = m_toleranceProfile;
+        profile.minStep = std::min(step, profile.maxStep);
+        applyToleranceProfile(profile);
+    }
+}
+
+double DoublePendulum::getMaxStepSize() const { return m_toleranceProfile.maxStep; }
+void DoublePendulum::setMaxStepSize(double step) {
+    if (step > 0) {
+        PendulumIntegrator::ToleranceProfile profile = m_toleranceProfile;
+        profile.maxStep = std::max(step, profile.minStep);
+        applyToleranceProfile(profile);
+    }
+}
+
+void DoublePendulum::applyToleranceProfile(const PendulumIntegrator::ToleranceProfile& profile) {
+    if (m_toleranceProfile == profile) {
+        return;
+    }
+    m_toleranceProfile = profile;
+    m_engine->setToleranceProfile(profile);
+    emit toleranceProfileChanged();
+}
+
+double DoublePendulum::getRejectedStepRatio() const { return m_rejectedStepRatio; }
+double DoublePendulum::getAverageStepSize() const { return m_averageStepSize; }
+
+void DoublePendulum::updateStepStatistics(const SimulationSnapshot& snapshot) {
+    // A reset or a counter behind the window start (new integrator state) restarts the window
+    if (!m_stepStatisticsTimer.isValid()
+        || snapshot.acceptedSteps < m_windowAcceptedSteps || snapshot.rejectedSteps < m_windowRejectedSteps
+        || snapshot.time < m_windowStartTime) {
+        m_stepStatisticsTimer.start();
+        m_windowAcceptedSteps = snapshot.acceptedSteps;
+        m_windowRejectedSteps = snapshot.rejectedSteps;
+        m_windowStartTime = snapshot.time;
+        return;
+    }
+    if (m_stepStatisticsTimer.elapsed() < STEP_STATISTICS_WINDOW_MS) {
+        return;
+    }
+
+    const std::uint64_t accepted = snapshot.acceptedSteps - m_windowAcceptedSteps;
+    const std::uint64_t rejected = snapshot.rejectedSteps - m_windowRejectedSteps;
+    if (accepted + rejected > 0) {
+        m_rejectedStepRatio = static_cast<double>(rejected) / static_cast<double>(accepted + rejected);
+        m_averageStepSize = accepted > 0 ? (snapshot.time - m_windowStartTime) / static_cast<double>(accepted) : 0.0;
+        emit stepStatisticsChanged();
+    }
+    m_stepStatisticsTimer.start();
+    m_windowAcceptedSteps = snapshot.acceptedSteps;
+    m_windowRejectedSteps = snapshot.rejectedSteps;
+    m_windowStartTime = snapshot.time;
+}
+
+double DoublePendulum::getHistorySampleRate() const { return m_engine->sampleRate(); }
+void DoublePendulum::setHistorySampleRate(double hz) {
+    const double previous = m_engine->sampleRate();
+    m_engine->setSampleRate(hz);
+    if (m_engine->sampleRate() != previous) {
+        emit historySampleRateChanged();
+    }
+}
+
+double DoublePendulum::getFixedTimestep() const { return m_engine->fixedTimestep(); }
+void DoublePendulum::setFixedTimestep(double seconds) {
+    const double previous = m_engine->fixedTimestep();
+    m_engine->setFixedTimestep(seconds);
+    if (m_engine->fixedTimestep() != previous) {
+        emit fixedTimestepChanged();
+    }
+}
+
 bool DoublePendulum::getSimulationFailed() const { return m_simulationFailed; }
 
+bool DoublePendulum::isRunning() const { return m_replay.isOpen() ? m_replayPlaying : m_engine->isRunning(); }
+void DoublePendulum::setRunning(bool running) {
+    if (m_replay.isOpen()) {
+        // Play/pause drives the replay cursor instead of the simulation thread
+        if (m_replayPlaying != running) {
+            m_replayPlaying = running;
+            m_replayClock.restart();
+            emit runningChanged();
+        }
+        return;
+    }
+    if (m_engine->isRunning() != running) {
+        m_engine->setRunning(running);
+        emit runningChanged();
+    }
+}
+
+PendulumParameters DoublePendulum::parameters() const {
+    PendulumParameters p;
+    p.m1 = m1;
+    p.m2 = m2;
+    p.rodMass1 = m_rodMass1;
+    p.rodMass2 = m_rodMass2;
+    p.l1 = l1;
+    p.l2 = l2;
+    p.b1 = b1;
+    p.b2 = b2;
+    p.c1 = c1;
+    p.c2 = c2;
+    p.g = g;
+    return p;
+}
+
+void DoublePendulum::pushParametersToEngine() {
+    if (m_replay.isOpen()) {
+        return; // Edits during a replay only change what is drawn; see openReplay()
+    }
+    m_engine->setParameters(parameters());
+    if (m_recorder.isOpen()) {
+        m_recorder.markParametersChanged();
+    }
+}
+
+void DoublePendulum::showParameters(const PendulumParameters& p) {
+    m1 = p.m1;
+    m2 = p.m2;
+    m_rodMass1 = p.rodMass1;
+    m_rodMass2 = p.rodMass2;
+    l1 = p.l1;
+    l2 = p.l2;
+    b1 = p.b1;
+    b2 = p.b2;
+    c1 = p.c1;
+    c2 = p.c2;
+    g = p.g;
+    emit m1Changed();
+    emit m2Changed();
+    emit rodMass1Changed();
+    emit rodMass2Changed();
+    emit l1Changed();
+    emit l2Changed();
+    emit b1Changed();
+    emit b2Changed();
+    emit c1Changed();
+    emit c2Changed();
+    emit gChanged();
+}
+
+void DoublePendulum::pushStateToEngine() {
+    m_engine->setState({theta1, omega1, theta2, omega2});
+}
+
 // New trace-related methods
 bool DoublePendulum::getShowTrace1() const { return m_showTrace1; }
 void DoublePendulum::setShowTrace1(bool show) {
@@ -534,36 +663,126 @@ void DoublePendulum::setShowTrace2(bool show) {
     }
 }
 
-QVector<QPointF> DoublePendulum::getTrace1Points() const { return m_trace1_points; }
-QVector<QPointF> DoublePendulum::getTrace2Points() const { return m_trace2_points; }
+// Copies a ring buffer into a QVector for QML, oldest point first
+static QVector<QPointF> toQVector(const RingBuffer<QPointF>& buffer)
+{
+    QVector<QPointF> result;
+    buffer.copyTo(result);
+    return result;
+}
 
-void DoublePendulum::clearTraces() {
+void DoublePendulum::clearTracePoints()
+{
     m_trace1_points.clear();
     m_trace2_points.clear();
     m_new_trace1_points.clear();
     m_new_trace2_points.clear();
+    ++m_traceEpoch;
+}
+
+int DoublePendulum::getTraceEpoch() const { return m_traceEpoch; }
+
+QVector<QPointF> DoublePendulum::getTrace1Points() const { return toQVector(m_trace1_points); }
+QVector<QPointF> DoublePendulum::getTrace2Points() const { return toQVector(m_trace2_points); }
+
+void DoublePendulum::clearTraces() {
+    clearTracePoints();
     emit historyUpdated();
 }
 
-QVector<QPointF> DoublePendulum::getTheta1History() const { return m_theta1History; }
-QVector<QPointF> DoublePendulum::getTheta2History() const { return m_theta2History; }
-QVector<QPointF> DoublePendulum::getOmega1History() const { return m_omega1History; }
-QVector<QPointF> DoublePendulum::getOmega2History() const { return m_omega2History; }
-QVector<QPointF> DoublePendulum::getKineticEnergyHistory() const { return m_kineticEnergyHistory; }
-QVector<QPointF> DoublePendulum::getPotentialEnergyHistory() const { return m_potentialEnergyHistory; }
-QVector<QPointF> DoublePendulum::getTotalEnergyHistory() const { return m_totalEnergyHistory; }
-QVector<QPointF> DoublePendulum::getPoincareMapPoints() const { return m_poincareMapPoints; }
+void DoublePendulum::appendHistoryRow(double time, const PendulumState& state,
+                                      double kineticEnergy, double potentialEnergy, double totalEnergy)
+{
+    m_historyArchive.append(time, state[0], state[1], state[2], state[3], kineticEnergy, potentialEnergy);
+
+    // Chart units, in TimeSeriesType order
+    const double series[TIME_SERIES_COUNT] = {
+        state[0] * 180.0 / M_PI,
+        (state[0] + state[2]) * 180.0 / M_PI,
+        state[1],
+        state[3],
+        kineticEnergy,
+        potentialEnergy,
+        totalEnergy,
+    };
+    m_historyPyramid.append(time, series);
+    // Keep the pyramid to the rows the archive still holds
+    m_historyPyramid.dropRowsBefore(m_historyArchive.droppedRows());
+}
+
+void DoublePendulum::clearHistoryRows()
+{
+    m_historyArchive.clear();
+    m_historyPyramid.clear();
+    ++m_historyEpoch;
+}
+
+void DoublePendulum::seedHistory()
+{
+    appendHistoryRow(0.0, {theta1, omega1, theta2, omega2},
+                     m_currentKineticEnergy, m_currentPotentialEnergy, m_currentTotalEnergy);
+    if (m_recordingEnabled) {
+        recordFrame({0.0, theta1, omega1, theta2, omega2, m_currentKineticEnergy, m_currentPotentialEnergy});
+    }
+}
+
+std::uint64_t DoublePendulum::firstRecentHistoryRow() const
+{
+    return m_historyArchive.endRow() - std::min<std::uint64_t>(m_historyArchive.size(), MAX_BUFFER_SIZE);
+}
+
+QVector<QPointF> DoublePendulum::historyColumnAsPoints(CompressedHistory::Column column) const
+{
+    const std::uint64_t first = firstRecentHistoryRow();
+    const std::uint64_t end = m_historyArchive.endRow();
+    QVector<QPointF> result;
+    result.reserve(static_cast<qsizetype>(end - first));
+    m_historyArchive.visitRows(first, end, [&result, column](const CompressedHistory::RowBlock& block) {
+        for (size_t row = 0; row < block.size; ++row) {
+            result.append(QPointF(block.time(row), block.value(column, row)));
+        }
+    });
+    return result;
+}
+
+QVector<QPointF> DoublePendulum::getTheta1History() const { return historyColumnAsPoints(CompressedHistory::Column::Theta1); }
+QVector<QPointF> DoublePendulum::getTheta2History() const { return historyColumnAsPoints(CompressedHistory::Column::Theta2); }
+QVector<QPointF> DoublePendulum::getOmega1History() const { return historyColumnAsPoints(CompressedHistory::Column::Omega1); }
+QVector<QPointF> DoublePendulum::getOmega2History() const { return historyColumnAsPoints(CompressedHistory::Column::Omega2); }
+QVector<QPointF> DoublePendulum::getKineticEnergyHistory() const { return historyColumnAsPoints(CompressedHistory::Column::KineticEnergy); }
+QVector<QPointF> DoublePendulum::getPotentialEnergyHistory() const { return historyColumnAsPoints(CompressedHistory::Column::PotentialEnergy); }
+QVector<QPointF> DoublePendulum::getTotalEnergyHistory() const { return historyColumnAsPoints(CompressedHistory::Column::TotalEnergy); }
+QVector<QPointF> DoublePendulum::getPoincareMapPoints() const { return toQVector(m_poincareMapPoints); }
 
 void DoublePendulum::clearHistory() {
-    m_theta1History.clear();
-    m_theta2History.clear();
-    m_omega1History.clear();
-    m_omega2History.clear();
-    m_kineticEnergyHistory.clear();
-    m_potentialEnergyHistory.clear();
-    m_totalEnergyHistory.clear();
+    closeReplay();
+    finishRecordingFile();
+    clearHistoryRows();
     m_poincareMapPoints.clear();
     m_currentTimeForHistory = 0.0;
+
+    // Keep the engine's state but restart the clock, so new history starts at t = 0.
+    // The shown state can be interpolated a step back; it is only what the engine
+    // continues from while a reset or a drag has not reached the engine yet.
+    const SimulationSnapshot& snapshot = m_engine->latestSnapshot();
+    if (!m_isManualControlActive && snapshot.epoch == m_engine->currentEpoch()) {
+        theta1 = snapshot.state[0];
+        omega1 = snapshot.state[1];
+        theta2 = snapshot.state[2];
+        omega2 = snapshot.state[3];
+    }
+    m_engine->reset({theta1, omega1, theta2, omega2}, 0.0);
+    updateEnergies({theta1, omega1, theta2, omega2});
+    seedHistory();
+
+    emit theta1Changed();
+    emit theta2Changed();
+    emit omega1Changed();
+    emit omega2Changed();
+    emit stateChanged();
+    emit currentKineticEnergyChanged();
+    emit currentPotentialEnergyChanged();
+    emit currentTotalEnergyChanged();
     emit currentTimeChanged();
     emit historyUpdated();
 }
@@ -573,10 +792,262 @@ void DoublePendulum::clearPoincareMapPoints() {
     emit historyUpdated();
 }
 
+DoublePendulum::PoincareSectionType DoublePendulum::getPoincareSection() const { return m_poincareSectionType; }
+void DoublePendulum::setPoincareSection(PoincareSectionType section) {
+    if (m_poincareSectionType == section) {
+        return;
+    }
+    m_poincareSectionType = section;
+    m_poincareSection = PoincareSection();
+    switch (section) {
+    case PoincareSectionType::Theta1Zero:
+        m_poincareSection.kind = PoincareSection::Kind::Theta1;
+        break;
+    case PoincareSectionType::Theta2Zero:
+        m_poincareSection.kind = PoincareSection::Kind::Theta2;
+        break;
+    case PoincareSectionType::Omega1Zero:
+        m_poincareSection.kind = PoincareSection::Kind::Omega1;
+        m_poincareSection.direction = PoincareSection::Direction::Both;
+        break;
+    }
+    m_engine->setPoincareSection(m_poincareSection);
+    // Points of different sections do not belong on one map
+    m_poincareMapPoints.clear();
+    emit poincareSectionChanged();
+    emit historyUpdated();
+}
+
 double DoublePendulum::getCurrentKineticEnergy() const { return m_currentKineticEnergy; }
 double DoublePendulum::getCurrentPotentialEnergy() const { return m_currentPotentialEnergy; }
 double DoublePendulum::getCurrentTotalEnergy() const { return m_currentTotalEnergy; }
 double DoublePendulum::getCurrentTime() const { return m_currentTimeForHistory; }
+double DoublePendulum::getHistoryStartTime() const {
+    if (m_replay.isOpen()) return m_replay.startTime();
+    return m_historyArchive.startTime();
+}
+double DoublePendulum::getHistoryEndTime() const {
+    if (m_replay.isOpen()) return m_replay.frame(m_replayIndex).time;
+    return m_historyArchive.endTime();
+}
+double DoublePendulum::getHistoryEndRow() const { return static_cast<double>(m_historyArchive.endRow()); }
+double DoublePendulum::getHistoryRowAt(double time) const { return static_cast<double>(m_historyArchive.lowerBound(time)); }
+int DoublePendulum::getHistoryEpoch() const { return m_historyEpoch; }
+
+bool DoublePendulum::isRecording() const { return m_recordingEnabled; }
+void DoublePendulum::setRecording(bool enabled) {
+    if (m_recordingEnabled == enabled) {
+        return;
+    }
+    m_recordingEnabled = enabled;
+    if (!enabled) {
+        finishRecordingFile();
+    }
+    emit recordingChanged();
+}
+
+QString DoublePendulum::getRecordingDirectory() const { return m_recordingDirectory; }
+void DoublePendulum::setRecordingDirectory(const QString& directory) {
+    if (m_recordingDirectory == directory) {
+        return;
+    }
+    // The current file stays where it is; the next one goes to the new directory
+    finishRecordingFile();
+    m_recordingDirectory = directory;
+    emit recordingChanged();
+}
+
+QString DoublePendulum::getRecordingPath() const { return QString::fromStdString(m_recorder.path()); }
+double DoublePendulum::getRecordedFrames() const { return static_cast<double>(m_recorder.framesAppended()); }
+
+void DoublePendulum::recordFrame(const TrajectoryFrame& frame) {
+    if (!m_recorder.isOpen()) {
+        beginRecordingFile();
+        if (!m_recorder.isOpen()) {
+            return;
+        }
+    }
+    m_recorder.append(frame);
+}
+
+void DoublePendulum::beginRecordingFile() {
+    if (!QDir().mkpath(m_recordingDirectory)) {
+        qWarning() << "Trajectory recording disabled: cannot create" << m_recordingDirectory;
+        m_recordingEnabled = false;
+        emit recordingChanged();
+        return;
+    }
+    const QString fileName = QStringLiteral("trajectory-%1.dptraj")
+        .arg(QDateTime::currentDateTime().toString(QStringLiteral("yyyyMMdd-HHmmss-zzz")));
+    const QString path = QDir(m_recordingDirectory).filePath(fileName);
+    const TrajectoryFileHeader header = TrajectoryFileHeader::make(
+        parameters(),
+        PendulumIntegrator::methodName(static_cast<PendulumIntegrator::Method>(m_integratorMethod)),
+        m_engine->sampleRate());
+    if (!m_recorder.open(path.toLocal8Bit().toStdString(), header)) {
+        qWarning() << "Trajectory recording disabled: cannot create" << path;
+        m_recordingEnabled = false;
+    }
+    emit recordingChanged();
+}
+
+void DoublePendulum::finishRecordingFile() {
+    if (!m_recorder.isOpen()) {
+        return;
+    }
+    const QString path = QString::fromStdString(m_recorder.path());
+    const bool empty = m_recorder.framesAppended() == 0;
+    if (!m_recorder.close()) {
+        qWarning() << "Trajectory recording: failed to finish" << path;
+    }
+    if (empty) {
+        QFile::remove(path);
+    }
+    emit recordingChanged();
+}
+
+bool DoublePendulum::openReplay(const QUrl& fileUrl) {
+    const QString path = fileUrl.isLocalFile() ? fileUrl.toLocalFile() : fileUrl.toString();
+    if (path.isEmpty()) {
+        return false;
+    }
+    closeReplay();
+    // Finishing the file being written puts every frame on disk (and a replay is not recorded again)
+    finishRecordingFile();
+
+    std::string error;
+    if (!m_replay.open(path.toLocal8Bit().toStdString(), &error)) {
+        qWarning() << "openReplay:" << QString::fromStdString(error);
+        return false;
+    }
+    if (m_replay.empty()) {
+        qWarning() << "openReplay: no frames in" << path;
+        m_replay.close();
+        return false;
+    }
+
+    // Playback takes over the play/pause state the live run had
+    m_replayPlaying = m_engine->isRunning();
+    m_engine->setRunning(false);
+    m_replayClock.start();
+
+    // The canvases draw with the recorded rod lengths; the energies were recorded as computed.
+    // The recorded values are shown as they are, unclamped, and never reach the engine:
+    // the live run keeps its own parameters, which closeReplay() puts back
+    m_liveParameters = parameters();
+    showParameters(m_replay.parameters());
+
+    clearTracePoints();
+    m_replayIndex = 0;
+    m_replayTime = m_replay.startTime();
+    showReplayFrame(0);
+    emit replayChanged();
+    emit runningChanged();
+    return true;
+}
+
+void DoublePendulum::closeReplay() {
+    if (!m_replay.isOpen()) {
+        return;
+    }
+    m_replay.close();
+    m_replayIndex = 0;
+    clearTracePoints();
+    showParameters(m_liveParameters);
+    m_engine->setRunning(m_replayPlaying);
+    m_replayPlaying = false;
+
+    // Back to the live run where it was left
+    const SimulationSnapshot& snapshot = m_engine->latestSnapshot();
+    theta1 = snapshot.state[0];
+    omega1 = snapshot.state[1];
+    theta2 = snapshot.state[2];
+    omega2 = snapshot.state[3];
+    m_currentKineticEnergy = snapshot.energies.kinetic;
+    m_currentPotentialEnergy = snapshot.energies.potential;
+    m_currentTotalEnergy = snapshot.energies.total;
+    m_currentTimeForHistory = snapshot.time;
+
+    emit replayChanged();
+    emit runningChanged();
+    emit theta1Changed();
+    emit theta2Changed();
+    emit omega1Changed();
+    emit omega2Changed();
+    emit stateChanged();
+    emit currentKineticEnergyChanged();
+    emit currentPotentialEnergyChanged();
+    emit currentTotalEnergyChanged();
+    emit currentTimeChanged();
+    emit historyUpdated();
+}
+
+void DoublePendulum::seekReplay(double time) {
+    if (!m_replay.isOpen()) {
+        return;
+    }
+    // Traces are drawn from the cursor on, not rebuilt for the skipped part
+    clearTracePoints();
+    m_replayTime = std::clamp(time, m_replay.startTime(), m_replay.endTime());
+    showReplayFrame(replayFrameAt(m_replayTime));
+}
+
+void DoublePendulum::advanceReplay(double seconds) {
+    if (seconds <= 0.0) {
+        return;
+    }
+    m_replayTime = std::min(m_replayTime + seconds, m_replay.endTime());
+    const std::size_t index = replayFrameAt(m_replayTime);
+    if (index <= m_replayIndex) {
+        return;
+    }
+    // Feed the traces every frame passed over, as the live run would have
+    const std::size_t first = std::max(m_replayIndex + 1, index > MAX_BUFFER_SIZE ? index - MAX_BUFFER_SIZE : 0);
+    for (std::size_t i = first; i < index; ++i) {
+        const TrajectoryFrame& frame = m_replay.frame(i);
+        updateTraces({frame.theta1, frame.omega1, frame.theta2, frame.omega2});
+    }
+    showReplayFrame(index);
+}
+
+void DoublePendulum::showReplayFrame(std::size_t index) {
+    m_replayIndex = index;
+    const TrajectoryFrame& frame = m_replay.frame(index);
+    theta1 = frame.theta1;
+    omega1 = frame.omega1;
+    theta2 = frame.theta2;
+    omega2 = frame.omega2;
+    updateTraces({theta1, omega1, theta2, omega2});
+    m_currentKineticEnergy = frame.kineticEnergy;
+    m_currentPotentialEnergy = frame.potentialEnergy;
+    m_currentTotalEnergy = frame.kineticEnergy + frame.potentialEnergy;
+    m_currentTimeForHistory = frame.time;
+
+    emit theta1Changed();
+    emit theta2Changed();
+    emit omega1Changed();
+    emit omega2Changed();
+    emit stateChanged();
+    emit currentKineticEnergyChanged();
+    emit currentPotentialEnergyChanged();
+    emit currentTotalEnergyChanged();
+    emit currentTimeChanged();
+    emit historyUpdated();
+}
+
+std::size_t DoublePendulum::replayFrameAt(double t) const {
+    const std::size_t end = m_replay.lowerBound(std::nextafter(t, HUGE_VAL));
+    return end > 0 ? end - 1 : 0;
+}
+
+std::size_t DoublePendulum::replayRowsUntil(double t) const {
+    return std::min(m_replay.lowerBound(std::nextafter(t, HUGE_VAL)), m_replayIndex + 1);
+}
+
+bool DoublePendulum::isReplayActive() const { return m_replay.isOpen(); }
+QString DoublePendulum::getReplayPath() const { return QString::fromStdString(m_replay.path()); }
+double DoublePendulum::getReplayStartTime() const { return m_replay.startTime(); }
+double DoublePendulum::getReplayEndTime() const { return m_replay.endTime(); }
 
 // Implementation of the saveTextToFile method
 bool DoublePendulum::saveTextToFile(const QString &filePath, const QString &content) {
@@ -595,141 +1066,75 @@ bool DoublePendulum::saveTextToFile(const QString &filePath, const QString &cont
     return true;
 }
 
-void DoublePendulum::performOneDormandPrinceStep(
-    double tCurrent,
-    const std::vector<double>& yCurrent,
-    double& hInOut,
-    std::vector<double>& yNext,
-    bool& stepAccepted
-) {
-    const int N = 4;
-    const std::vector<double> c = {0.0, DP5_C2, DP5_C3, DP5_C4, DP5_C5, DP5_C6, DP5_C7};
-
-    std::vector<std::vector<double>> k(7, std::vector<double>(N));
-    std::vector<double> y_stage(N);
-
-    if (m_fsal_ready && std::abs(tCurrent - m_last_fsal_t) < 1e-12) {
-        k[0] = m_last_fsal_k;
-    } else {
-        k[0] = getDerivatives(tCurrent, yCurrent);
-    }
-    
-    for(int j=0; j<N; ++j) y_stage[j] = yCurrent[j] + hInOut * (DP5_A21*k[0][j]);
-    k[1] = getDerivatives(tCurrent + c[1]*hInOut, y_stage);
-    
-    for(int j=0; j<N; ++j) y_stage[j] = yCurrent[j] + hInOut * (DP5_A31*k[0][j] + DP5_A32*k[1][j]);
-    k[2] = getDerivatives(tCurrent + c[2]*hInOut, y_stage);
-    
-    for(int j=0; j<N; ++j) y_stage[j] = yCurrent[j] + hInOut * (DP5_A41*k[0][j] + DP5_A42*k[1][j] + DP5_A43*k[2][j]);
-    k[3] = getDerivatives(tCurrent + c[3]*hInOut, y_stage);
-    
-    for(int j=0; j<N; ++j) y_stage[j] = yCurrent[j] + hInOut * (DP5_A51*k[0][j] + DP5_A52*k[1][j] + DP5_A53*k[2][j] + DP5_A54*k[3][j]);
-    k[4] = getDerivatives(tCurrent + c[4]*hInOut, y_stage);
-    
-    for(int j=0; j<N; ++j) y_stage[j] = yCurrent[j] + hInOut * (DP5_A61*k[0][j] + DP5_A62*k[1][j] + DP5_A63*k[2][j] + DP5_A64*k[3][j] + DP5_A65*k[4][j]);
-    k[5] = getDerivatives(tCurrent + c[5]*hInOut, y_stage);
-    
-    for(int j=0; j<N; ++j) y_stage[j] = yCurrent[j] + hInOut * (DP5_A71*k[0][j] + DP5_A73*k[2][j] + DP5_A74*k[3][j] + DP5_A75*k[4][j] + DP5_A76*k[5][j]);
-    k[6] = getDerivatives(tCurrent + c[6]*hInOut, y_stage);
-
-    std::vector<double> ySol5(N);
-    for (int j = 0; j < N; ++j) {
-        ySol5[j] = yCurrent[j] + hInOut * (DP5_B1*k[0][j] + DP5_B2*k[1][j] + DP5_B3*k[2][j] + DP5_B4*k[3][j] + DP5_B5*k[4][j] + DP5_B6*k[5][j] + DP5_B7*k[6][j]);
-    }
-    
-    double errNormSquare = 0.0;
-    for (int j=0; j<N; ++j) {
-        double error = hInOut * (DP5_E1*k[0][j] + DP5_E2*k[1][j] + DP5_E3*k[2][j] + DP5_E4*k[3][j] + DP5_E5*k[4][j] + DP5_E6*k[5][j] + DP5_E7*k[6][j]);
-        double scale = DOPRI_ATOL + DOPRI_RTOL * std::max(std::abs(yCurrent[j]), std::abs(ySol5[j]));
-        errNormSquare += (error*error) / (scale*scale);
-    }
-    double errNorm = std::sqrt(errNormSquare / N);
-
-    stepAccepted = (errNorm <= 1.0);
-    double hNew;
-    if (errNorm < 1e-15) {
-        hNew = hInOut * DOPRI_FAC_MAX;
-    } else {
-        hNew = DOPRI_SAFETY_FACTOR * hInOut * std::pow(errNorm, -0.2);
-        hNew = std::min(hInOut * DOPRI_FAC_MAX, std::max(hInOut * DOPRI_FAC_MIN, hNew));
-    }
-    hInOut = std::min(DOPRI_HMAX, std::max(DOPRI_HMIN, hNew));
-
-    if (stepAccepted) {
-        yNext = ySol5;
-        m_last_fsal_k = k[6];
-        m_last_fsal_t = tCurrent + hInOut; // This should be current_h_before_call
-        m_fsal_ready = true;
-    } else {
-        m_fsal_ready = false;
+// Rows read from the archive for a span of pixelWidth plot columns: with more
+// than four rows per column, each column is reduced to its M4 envelope (first,
+// min, max, last), the shape the pyramid gives for denser spans
+static void reduceToColumns(QVector<QPointF>& points, double tMin, double tMax, int pixelWidth) {
+    if (pixelWidth <= 0 || points.size() <= 4 * static_cast<qsizetype>(pixelWidth)) {
+        return;
     }
+    std::vector<double> envelope;
+    HistoryPyramid::reduce(reinterpret_cast<const double*>(points.constData()), static_cast<size_t>(points.size()),
+                           tMin, tMax, static_cast<size_t>(pixelWidth), envelope);
+    points.resize(static_cast<qsizetype>(envelope.size() / 2));
+    std::copy(envelope.begin(), envelope.end(), reinterpret_cast<double*>(points.data()));
 }
 
 // Новый метод для обработки временных рядов
-QVariantList DoublePendulum::getProcessedTimeSeriesData(
+QByteArray DoublePendulum::getProcessedTimeSeriesData(
     TimeSeriesType seriesType,
     double viewPortMinTime,
     double viewPortMaxTime,
     bool rdpEnabled,
     double rdpEpsilon,
     bool limitPointsEnabled,
-    int maxPointsLimit
+    int maxPointsLimit,
+    int pixelWidth,
+    int rdpTargetPoints
 ) {
-    QVector<QPointF> sourceData;
-    switch (seriesType) {
-        case TimeSeriesType::Theta1_Degrees:
-            sourceData = m_theta1History;
-            for (int i = 0; i < sourceData.size(); ++i) sourceData[i].setY(sourceData[i].y() * 180.0 / M_PI);
-            break;
-        case TimeSeriesType::Theta2_Degrees:
-            if (m_theta1History.size() > 0 && m_theta2History.size() > 0) {
-                for (int i = 0; i < std::min(m_theta1History.size(), m_theta2History.size()); ++i) {
-                    if (m_theta1History[i].x() == m_theta2History[i].x()) {
-                        sourceData.append(QPointF(m_theta1History[i].x(), (m_theta1History[i].y() + m_theta2History[i].y()) * 180.0 / M_PI));
-                    }
-                }
-            }
-            break;
-        case TimeSeriesType::Omega1_Rad_s: sourceData = m_omega1History; break;
-        case TimeSeriesType::Omega2_Rad_s: sourceData = m_omega2History; break;
-        case TimeSeriesType::KineticEnergy: sourceData = m_kineticEnergyHistory; break;
-        case TimeSeriesType::PotentialEnergy: sourceData = m_potentialEnergyHistory; break;
-        case TimeSeriesType::TotalEnergy: sourceData = m_totalEnergyHistory; break;
-        default: return QVariantList();
-    }
+    const CompressedHistory::Column column = historyColumnFor(seriesType);
+    if (column == CompressedHistory::Column::Count) return QByteArray();
 
     QVector<QPointF> processedPoints;
-    for (const QPointF& point : sourceData) {
-        if (point.x() >= viewPortMinTime && point.x() <= viewPortMaxTime) {
-            processedPoints.append(point);
+    std::vector<double> envelope;
+    if (!m_replay.isOpen() && pixelWidth > 0 &&
+        m_historyPyramid.envelope(static_cast<size_t>(seriesType), viewPortMinTime, viewPortMaxTime,
+                                  static_cast<size_t>(pixelWidth), envelope)) {
+        // Many rows per pixel column: the pyramid answers in O(pixels)
+        processedPoints.resize(static_cast<qsizetype>(envelope.size() / 2));
+        std::copy(envelope.begin(), envelope.end(), reinterpret_cast<double*>(processedPoints.data()));
+    } else if (m_replay.isOpen()) {
+        // Frames are sorted by time, so the viewport is found by binary search in the mapped file
+        const size_t first = m_replay.lowerBound(viewPortMinTime);
+        const size_t last = replayRowsUntil(viewPortMaxTime);
+        if (first < last) {
+            const size_t stride = (last - first + REPLAY_MAX_ROWS - 1) / REPLAY_MAX_ROWS;
+            processedPoints.reserve(static_cast<qsizetype>((last - first) / stride + 1));
+            for (size_t row = first; row < last; row += stride) {
+                const TrajectoryFrame& frame = m_replay.frame(row);
+                processedPoints.append(QPointF(frame.time, seriesValueAt(seriesType, frame)));
+            }
         }
+    } else {
+        // Only the archive chunks that overlap the viewport are decompressed
+        m_historyArchive.visitRange(viewPortMinTime, viewPortMaxTime,
+            [&processedPoints, seriesType](const CompressedHistory::RowBlock& block) {
+                for (size_t row = 0; row < block.size; ++row) {
+                    processedPoints.append(QPointF(block.time(row), seriesValueAt(seriesType, block, row)));
+                }
+            });
+        // Fewer rows than the pyramid serves, but still several per column: reduce them the same way
+        reduceToColumns(processedPoints, viewPortMinTime, viewPortMaxTime, pixelWidth);
     }
 
-    if (rdpEnabled && processedPoints.size() > 2 && rdpEpsilon > 0) {
-        std::function<QVector<QPointF>(const QVector<QPointF>&, double)> simplifyRDP;
-        auto perpendicularDistance = [](const QPointF& pt, const QPointF& p1, const QPointF& p2) {
-            double dx = p2.x() - p1.x(), dy = p2.y() - p1.y();
-            double mag = std::sqrt(dx*dx + dy*dy);
-            if (mag>0.) {dx/=mag; dy/=mag;}
-            double pvx = pt.x() - p1.x(), pvy = pt.y() - p1.y();
-            return std::abs(pvx*dy - pvy*dx);
-        };
-        simplifyRDP = [&perpendicularDistance, &simplifyRDP](const QVector<QPointF>& points, double epsilon) -> QVector<QPointF> {
-            if (points.size() <= 2) return points;
-            double dmax = 0; int index = 0; int end = points.size() - 1;
-            for (int i=1; i<end; ++i) {
-                double d = perpendicularDistance(points[i], points[0], points[end]);
-                if (d > dmax) { index = i; dmax = d; }
-            }
-            if (dmax > epsilon) {
-                QVector<QPointF> res1 = simplifyRDP(points.mid(0, index + 1), epsilon);
-                QVector<QPointF> res2 = simplifyRDP(points.mid(index), epsilon);
-                return res1.mid(0, res1.size()-1) + res2;
-            } else {
-                return QVector<QPointF>{points.first(), points.last()};
-            }
-        };
-        processedPoints = simplifyRDP(processedPoints, rdpEpsilon);
+    if (rdpEnabled && processedPoints.size() > 2 && (rdpTargetPoints > 0 || rdpEpsilon > 0)) {
+        // In place on the packed doubles: no copies, no recursion
+        double* points = reinterpret_cast<double*>(processedPoints.data());
+        const size_t count = static_cast<size_t>(processedPoints.size());
+        const size_t kept = rdpTargetPoints > 0
+            ? m_lineSimplifier.simplifyToCount(points, count, static_cast<size_t>(rdpTargetPoints))
+            : LineSimplifier::simplify(points, count, rdpEpsilon);
+        processedPoints.resize(static_cast<qsizetype>(kept));
     }
 
     if (limitPointsEnabled && processedPoints.size() > maxPointsLimit) {
@@ -745,9 +1150,34 @@ QVariantList DoublePendulum::getProcessedTimeSeriesData(
         }
     }
 
-    QVariantList result;
-    for (const QPointF& point : processedPoints) result.append(QVariant::fromValue(point));
-    return result;
+    return packPoints(processedPoints.constData(), processedPoints.size());
+}
+
+QByteArray DoublePendulum::getTimeSeriesDelta(
+    TimeSeriesType seriesType,
+    double fromRow,
+    double fromTime,
+    double toTime,
+    int pixelWidth
+) {
+    if (m_replay.isOpen() || historyColumnFor(seriesType) == CompressedHistory::Column::Count) return QByteArray();
+
+    // A client that fell far behind only needs what is still on screen: both
+    // bounds are found by binary search, so the cost is that of the rows returned
+    const std::uint64_t cursor = fromRow > 0 ? static_cast<std::uint64_t>(fromRow) : 0;
+    const std::uint64_t first = std::max(cursor, m_historyArchive.lowerBound(fromTime));
+    const std::uint64_t end = m_historyArchive.lowerBound(toTime);
+    if (first >= end) return QByteArray();
+
+    QVector<QPointF> points;
+    points.reserve(static_cast<qsizetype>(end - first));
+    m_historyArchive.visitRows(first, end, [&points, seriesType](const CompressedHistory::RowBlock& block) {
+        for (size_t row = 0; row < block.size; ++row) {
+            points.append(QPointF(block.time(row), seriesValueAt(seriesType, block, row)));
+        }
+    });
+    reduceToColumns(points, fromTime, toTime, pixelWidth);
+    return packPoints(points.constData(), points.size());
 }
 
 // Implementation of the bob2 flash getter
@@ -769,79 +1199,264 @@ double DoublePendulum::calculateDistance(const QPointF& p1, const QPointF& p2) c
 }
 
 // Methods for consuming new trace points
-QVariantList DoublePendulum::consumeNewTrace1Points()
+QByteArray DoublePendulum::consumeNewTrace1Points()
 {
-    QVariantList result;
-    for (const QPointF& point : m_new_trace1_points) {
-        result.append(QVariant::fromValue(point));
-    }
+    QByteArray result = packPoints(m_new_trace1_points.data(), static_cast<qsizetype>(m_new_trace1_points.size()));
     m_new_trace1_points.clear();
     return result;
 }
 
-QVariantList DoublePendulum::consumeNewTrace2Points()
+QByteArray DoublePendulum::consumeNewTrace2Points()
 {
-    QVariantList result;
-    for (const QPointF& point : m_new_trace2_points) {
-        result.append(QVariant::fromValue(point));
-    }
+    QByteArray result = packPoints(m_new_trace2_points.data(), static_cast<qsizetype>(m_new_trace2_points.size()));
     m_new_trace2_points.clear();
     return result;
 }
 
+QByteArray DoublePendulum::packPoints(const QPointF* points, qsizetype count)
+{
+    // QPointF is two qreals; on every platform we target that is exactly two doubles
+    static_assert(sizeof(QPointF) == 2 * sizeof(double), "QPointF must be two packed doubles");
+    if (count <= 0) return QByteArray();
+    return QByteArray(reinterpret_cast<const char*>(points), count * static_cast<qsizetype>(sizeof(QPointF)));
+}
+
 // Implementation of the new method for phase portrait data
-QVariantList DoublePendulum::getPhasePortraitData(
+QByteArray DoublePendulum::getPhasePortraitData(
     TimeSeriesType xSeries,
     TimeSeriesType ySeries
 ) {
-    // Helper lambda to get the correct data vector based on enum
-    auto getDataVector = [&](TimeSeriesType type) -> QVector<QPointF> {
-        switch (type) {
-            case TimeSeriesType::Theta1_Degrees:       return m_theta1History;
-            case TimeSeriesType::Theta2_Degrees:       return m_theta2History; // Note: this is relative theta2
-            case TimeSeriesType::Omega1_Rad_s:         return m_omega1History;
-            case TimeSeriesType::Omega2_Rad_s:         return m_omega2History;
-            case TimeSeriesType::KineticEnergy:        return m_kineticEnergyHistory;
-            case TimeSeriesType::PotentialEnergy:      return m_potentialEnergyHistory;
-            case TimeSeriesType::TotalEnergy:          return m_totalEnergyHistory;
-            default:                                   return {};
+    if (historyColumnFor(xSeries) == CompressedHistory::Column::Count ||
+        historyColumnFor(ySeries) == CompressedHistory::Column::Count) {
+        return QByteArray();
+    }
+
+    if (m_replay.isOpen()) {
+        // Everything replayed so far, thinned to a fixed stride for long recordings
+        const size_t rows = m_replayIndex + 1;
+        const size_t stride = (rows + REPLAY_MAX_ROWS - 1) / REPLAY_MAX_ROWS;
+        const size_t n = (rows + stride - 1) / stride;
+        QByteArray phaseData(static_cast<qsizetype>(n * 2 * sizeof(double)), Qt::Uninitialized);
+        double* out = reinterpret_cast<double*>(phaseData.data());
+        for (size_t row = 0; row < rows; row += stride) {
+            const TrajectoryFrame& frame = m_replay.frame(row);
+            *out++ = seriesValueAt(xSeries, frame);
+            *out++ = seriesValueAt(ySeries, frame);
         }
-    };
+        return phaseData;
+    }
+
+    if (m_historyArchive.empty()) {
+        return QByteArray();
+    }
 
-    QVector<QPointF> xData = getDataVector(xSeries);
-    QVector<QPointF> yData = getDataVector(ySeries);
+    // Both coordinates come from the same history row, so they are aligned by construction.
+    // Values are written straight into the output buffer.
+    const std::uint64_t first = firstRecentHistoryRow();
+    const std::uint64_t end = m_historyArchive.endRow();
+    QByteArray phaseData(static_cast<qsizetype>((end - first) * 2 * sizeof(double)), Qt::Uninitialized);
+    double* out = reinterpret_cast<double*>(phaseData.data());
+    m_historyArchive.visitRows(first, end, [&out, xSeries, ySeries](const CompressedHistory::RowBlock& block) {
+        for (size_t row = 0; row < block.size; ++row) {
+            *out++ = seriesValueAt(xSeries, block, row);
+            *out++ = seriesValueAt(ySeries, block, row);
+        }
+    });
 
-    // Post-processing for degrees if needed
-    if (xSeries == TimeSeriesType::Theta1_Degrees || xSeries == TimeSeriesType::Theta2_Degrees) {
-        for(auto& point : xData) { point.setY(point.y() * 180.0 / M_PI); }
+    return phaseData;
+}
+
+QVariantMap DoublePendulum::updatePhaseDensity(
+    TimeSeriesType xSeries,
+    TimeSeriesType ySeries,
+    int width,
+    int height,
+    const QColor& color
+) {
+    QVariantMap result;
+    if (historyColumnFor(xSeries) == CompressedHistory::Column::Count ||
+        historyColumnFor(ySeries) == CompressedHistory::Column::Count ||
+        width <= 0 || height <= 0) {
+        result.insert(QStringLiteral("empty"), true);
+        return result;
+    }
+
+    const bool restarted = feedPhaseDensity(xSeries, ySeries, width, height);
+    // A short history is drawn as well, on a grid fixed by what there is so far
+    m_phaseDensity.settle();
+    if (restarted || color != m_densityColor || m_phaseDensity.sampleCount() != m_densityColoredSamples) {
+        colorPhaseDensity(color);
+        m_densityColor = color;
+        m_densityColoredSamples = m_phaseDensity.sampleCount();
+        ++m_densityRevision;
+    }
+
+    result.insert(QStringLiteral("empty"), !m_phaseDensity.hasGrid());
+    result.insert(QStringLiteral("revision"), m_densityRevision);
+    if (m_phaseDensity.hasGrid()) {
+        result.insert(QStringLiteral("dataXMin"), m_phaseDensity.dataXMin());
+        result.insert(QStringLiteral("dataXMax"), m_phaseDensity.dataXMax());
+        result.insert(QStringLiteral("dataYMin"), m_phaseDensity.dataYMin());
+        result.insert(QStringLiteral("dataYMax"), m_phaseDensity.dataYMax());
+        result.insert(QStringLiteral("gridXMin"), m_phaseDensity.xMin());
+        result.insert(QStringLiteral("gridXMax"), m_phaseDensity.xMax());
+        result.insert(QStringLiteral("gridYMin"), m_phaseDensity.yMin());
+        result.insert(QStringLiteral("gridYMax"), m_phaseDensity.yMax());
     }
-    if (ySeries == TimeSeriesType::Theta1_Degrees || ySeries == TimeSeriesType::Theta2_Degrees) {
-        for(auto& point : yData) { point.setY(point.y() * 180.0 / M_PI); }
+    return result;
+}
+
+bool DoublePendulum::feedPhaseDensity(TimeSeriesType xSeries, TimeSeriesType ySeries, int width, int height)
+{
+    const bool replay = m_replay.isOpen();
+    const QString source = replay ? QString::fromStdString(m_replay.path()) : QString();
+    const std::uint64_t end = replay ? std::uint64_t(m_replayIndex) + 1 : m_historyArchive.endRow();
+    const QSize size(width, height);
+
+    // Seeking a replay backwards also starts over: the counts cannot be taken back
+    const bool restart = xSeries != m_densityXSeries || ySeries != m_densityYSeries ||
+                         size != m_densitySize || source != m_densitySource ||
+                         m_historyEpoch != m_densityEpoch || end < m_densityFedRows;
+    if (restart) {
+        m_phaseDensity.reset(static_cast<std::size_t>(width), static_cast<std::size_t>(height));
+        m_densityXSeries = xSeries;
+        m_densityYSeries = ySeries;
+        m_densitySize = size;
+        m_densitySource = source;
+        m_densityEpoch = m_historyEpoch;
+        m_densityFedRows = 0;
     }
 
-    // Special case: if theta2 is requested, it should be absolute angle
-    if (xSeries == TimeSeriesType::Theta2_Degrees) {
-        const auto& theta1Data = getDataVector(TimeSeriesType::Theta1_Degrees);
-        for(int i = 0; i < xData.size() && i < theta1Data.size(); ++i) {
-            xData[i].setY(xData[i].y() + (theta1Data[i].y() * 180.0 / M_PI));
+    auto feed = [&](std::uint64_t first) {
+        if (replay) {
+            for (std::uint64_t i = first; i < end; ++i) {
+                const TrajectoryFrame& frame = m_replay.frame(static_cast<std::size_t>(i));
+                m_phaseDensity.add(seriesValueAt(xSeries, frame), seriesValueAt(ySeries, frame));
+            }
+            return;
         }
+        // Rows the archive dropped before they were fed leave a gap in the line
+        if (first < m_historyArchive.droppedRows()) {
+            m_phaseDensity.breakStroke();
+        }
+        m_historyArchive.visitRows(first, end, [this, xSeries, ySeries](const CompressedHistory::RowBlock& block) {
+            for (size_t row = 0; row < block.size; ++row) {
+                m_phaseDensity.add(seriesValueAt(xSeries, block, row), seriesValueAt(ySeries, block, row));
+            }
+        });
+    };
+    feed(m_densityFedRows);
+    m_densityFedRows = end;
+
+    // Growing the grid can leave the trajectory a quarter of the image; it is
+    // then binned again on a grid fitted to its bounding box. Its extent has to
+    // grow by a good share before that recurs, so a long run rebuilds a few times.
+    if (m_phaseDensity.sparse()) {
+        const PhaseDensity& d = m_phaseDensity;
+        const double xMin = d.dataXMin(), xMax = d.dataXMax(), yMin = d.dataYMin(), yMax = d.dataYMax();
+        m_phaseDensity.reset(static_cast<std::size_t>(width), static_cast<std::size_t>(height));
+        m_phaseDensity.fitTo(xMin, xMax, yMin, yMax);
+        feed(0);
+        return true;
     }
-    if (ySeries == TimeSeriesType::Theta2_Degrees) {
-        const auto& theta1Data = getDataVector(TimeSeriesType::Theta1_Degrees);
-         for(int i = 0; i < yData.size() && i < theta1Data.size(); ++i) {
-            yData[i].setY(yData[i].y() + (theta1Data[i].y() * 180.0 / M_PI));
+    return restart;
+}
+
+void DoublePendulum::colorPhaseDensity(const QColor& color)
+{
+    const int width = static_cast<int>(m_phaseDensity.width());
+    const int height = static_cast<int>(m_phaseDensity.height());
+    QImage image(width, height, QImage::Format_ARGB32_Premultiplied);
+    image.fill(Qt::transparent);
+
+    const std::uint32_t maxCount = m_phaseDensity.maxCount();
+    if (m_phaseDensity.hasGrid() && maxCount > 0) {
+        // One premultiplied shade per alpha level, picked by the log of the count
+        std::array<QRgb, 256> shades;
+        for (int alpha = 0; alpha < 256; ++alpha) {
+            shades[alpha] = qPremultiply(qRgba(color.red(), color.green(), color.blue(), alpha));
+        }
+        const double scale = (1.0 - PHASE_DENSITY_MIN_ALPHA) / std::log1p(static_cast<double>(maxCount));
+        const std::uint32_t* counts = m_phaseDensity.counts();
+        for (int row = 0; row < height; ++row) {
+            // Grid row 0 is the bottom line of the image
+            QRgb* line = reinterpret_cast<QRgb*>(image.scanLine(height - 1 - row));
+            const std::uint32_t* rowCounts = counts + static_cast<std::size_t>(row) * static_cast<std::size_t>(width);
+            for (int col = 0; col < width; ++col) {
+                if (rowCounts[col] == 0) continue;
+                const double level = PHASE_DENSITY_MIN_ALPHA + std::log1p(static_cast<double>(rowCounts[col])) * scale;
+                line[col] = shades[std::clamp(qRound(255.0 * level), 1, 255)];
+            }
         }
     }
 
-    QVariantList phaseData;
-    int n = std::min(xData.size(), yData.size());
-    phaseData.reserve(n);
-    for (int i = 0; i < n; ++i) {
-        // We assume timestamps are aligned, which they are by design
-        phaseData.append(QPointF(xData[i].y(), yData[i].y()));
+    std::lock_guard<std::mutex> lock(m_densityImageMutex);
+    m_densityImage = std::move(image);
+}
+
+QImage DoublePendulum::phaseDensityImage() const
+{
+    std::lock_guard<std::mutex> lock(m_densityImageMutex);
+    return m_densityImage.copy();
+}
+
+CompressedHistory::Column DoublePendulum::historyColumnFor(TimeSeriesType type)
+{
+    switch (type) {
+        case TimeSeriesType::Theta1_Degrees:  return CompressedHistory::Column::Theta1;
+        case TimeSeriesType::Theta2_Degrees:  return CompressedHistory::Column::Theta2;
+        case TimeSeriesType::Omega1_Rad_s:    return CompressedHistory::Column::Omega1;
+        case TimeSeriesType::Omega2_Rad_s:    return CompressedHistory::Column::Omega2;
+        case TimeSeriesType::KineticEnergy:   return CompressedHistory::Column::KineticEnergy;
+        case TimeSeriesType::PotentialEnergy: return CompressedHistory::Column::PotentialEnergy;
+        case TimeSeriesType::TotalEnergy:     return CompressedHistory::Column::TotalEnergy;
+    }
+    return CompressedHistory::Column::Count;
+}
+
+double DoublePendulum::seriesValueAt(TimeSeriesType type, const CompressedHistory::RowBlock& block, size_t row)
+{
+    switch (type) {
+        case TimeSeriesType::Theta1_Degrees:
+            return block.value(CompressedHistory::Column::Theta1, row) * 180.0 / M_PI;
+        case TimeSeriesType::Theta2_Degrees:
+            // Charts show the absolute angle of the second rod
+            return (block.value(CompressedHistory::Column::Theta1, row) +
+                    block.value(CompressedHistory::Column::Theta2, row)) * 180.0 / M_PI;
+        default:
+            return block.value(historyColumnFor(type), row);
     }
+}
 
-    return phaseData;
+double DoublePendulum::seriesValueAt(TimeSeriesType type, const TrajectoryFrame& frame)
+{
+    switch (type) {
+        case TimeSeriesType::Theta1_Degrees:  return frame.theta1 * 180.0 / M_PI;
+        case TimeSeriesType::Theta2_Degrees:  return (frame.theta1 + frame.theta2) * 180.0 / M_PI;
+        case TimeSeriesType::Omega1_Rad_s:    return frame.omega1;
+        case TimeSeriesType::Omega2_Rad_s:    return frame.omega2;
+        case TimeSeriesType::KineticEnergy:   return frame.kineticEnergy;
+        case TimeSeriesType::PotentialEnergy: return frame.potentialEnergy;
+        case TimeSeriesType::TotalEnergy:     return frame.kineticEnergy + frame.potentialEnergy;
+    }
+    return 0.0;
 }
 
+PhaseDensityImageProvider::PhaseDensityImageProvider(DoublePendulum* pendulum)
+    : QQuickImageProvider(QQuickImageProvider::Image)
+    , m_pendulum(pendulum)
+{
+}
 
+QImage PhaseDensityImageProvider::requestImage(const QString& id, QSize* size, const QSize& requestedSize)
+{
+    Q_UNUSED(id);
+    QImage image = m_pendulum->phaseDensityImage();
+    if (size) {
+        *size = image.size();
+    }
+    if (requestedSize.isValid() && !image.isNull()) {
+        image = image.scaled(requestedSize, Qt::IgnoreAspectRatio, Qt::SmoothTransformation);
+    }
+    return image;
+}
@@ -0,0 +1,187 @@
+#include "core/EnsembleEngine.h"
+#include "core/WorkStealingScheduler.h"
+#include <algorithm>
+#include <cmath>
+#include <type_traits>
+
+EnsembleEngine::EnsembleEngine() = default;
+
+EnsembleEngine::EnsembleEngine(const Config& config)
+    : m_config(config)
+{
+}
+
+void EnsembleEngine::resize(std::size_t memberCount)
+{
+    m_batch.theta1.resize(memberCount, 0.0);
+    m_batch.omega1.resize(memberCount, 0.0);
+    m_batch.theta2.resize(memberCount, 0.0);
+    m_batch.omega2.resize(memberCount, 0.0);
+}
+
+void EnsembleEngine::setInitialState(std::size_t member, const PendulumState& state)
+{
+    m_batch.theta1[member] = state[0];
+    m_batch.omega1[member] = state[1];
+    m_batch.theta2[member] = state[2];
+    m_batch.omega2[member] = state[3];
+}
+
+PendulumState EnsembleEngine::initialState(std::size_t member) const
+{
+    return {m_batch.theta1[member], m_batch.omega1[member], m_batch.theta2[member], m_batch.omega2[member]};
+}
+
+bool EnsembleEngine::hasFlipped(const PendulumState& state)
+{
+    return std::abs(state[0]) > M_PI || std::abs(state[0] + state[2]) > M_PI;
+}
+
+void EnsembleEngine::prepareReductions()
+{
+    const std::size_t n = m_batch.size();
+    auto prepare = [n](auto& column, bool enabled) {
+        using Value = typename std::decay_t<decltype(column)>::value_type;
+        if (enabled) {
+            column.assign(n, Value());
+        } else {
+            column.clear();
+            column.shrink_to_fit();
+        }
+    };
+
+    const unsigned reductions = m_config.reductions;
+    prepare(m_batch.finalTheta1, reductions & FinalState);
+    prepare(m_batch.finalOmega1, reductions & FinalState);
+    prepare(m_batch.finalTheta2, reductions & FinalState);
+    prepare(m_batch.finalOmega2, reductions & FinalState);
+    prepare(m_batch.finalTime, reductions & FinalState);
+    prepare(m_batch.maxEnergyDrift, reductions & EnergyDrift);
+    prepare(m_batch.finalEnergyDrift, reductions & EnergyDrift);
+    prepare(m_batch.firstFlipTime, reductions & FirstFlipTime);
+    prepare(m_batch.acceptedSteps, reductions & StepCounts);
+    prepare(m_batch.rejectedSteps, reductions & StepCounts);
+    prepare(m_batch.failed, true);
+}
+
+void EnsembleEngine::run()
+{
+    prepareReductions();
+
+    m_lastSimdLevel = BatchKernel::detect();
+    if (static_cast<int>(m_config.maxSimdLevel) < static_cast<int>(m_lastSimdLevel)) {
+        m_lastSimdLevel = m_config.maxSimdLevel;
+    }
+    m_lastRunVectorized = m_config.vectorized && (m_lastSimdLevel != SimdLevel::Scalar || m_config.forceKernel);
+
+    WorkStealingScheduler scheduler(m_config.threadCount);
+    scheduler.parallelFor(m_batch.size(), m_config.grainSize,
+                          [this](std::size_t first, std::size_t last) { integrateRange(first, last); });
+
+    m_lastThreadCount = scheduler.threadCount();
+    m_lastStealCount = scheduler.lastStealCount();
+}
+
+void EnsembleEngine::integrateRange(std::size_t first, std::size_t last)
+{
+    if (m_lastRunVectorized) {
+        integrateKernelRange(first, last);
+        return;
+    }
+    for (std::size_t member = first; member < last; ++member) {
+        integrateMember(member);
+    }
+}
+
+void EnsembleEngine::integrateMember(std::size_t member)
+{
+    const unsigned reductions = m_config.reductions;
+    const bool trackEnergy = reductions & EnergyDrift;
+    const bool trackFlip = reductions & FirstFlipTime;
+    const double duration = m_config.duration;
+
+    PendulumIntegrator integrator(m_config.parameters, initialState(member));
+    integrator.setToleranceProfile(m_config.tolerances);
+
+    const double initialEnergy = trackEnergy ? integrator.energies().total : 0.0;
+    double maxDrift = 0.0;
+    double flipTime = (trackFlip && hasFlipped(integrator.state())) ? 0.0 : -1.0;
+    std::uint32_t accepted = 0;
+    std::uint32_t rejected = 0;
+
+    while (integrator.time() < duration) {
+        const double remaining = duration - integrator.time();
+        if (remaining < integrator.toleranceProfile().minStep / 2.0) {
+            break;
+        }
+        const PendulumIntegrator::StepResult result = integrator.tryStep(remaining);
+        if (result == PendulumIntegrator::StepResult::Failed) {
+            break;
+        }
+        if (result == PendulumIntegrator::StepResult::Rejected) {
+            ++rejected;
+            continue;
+        }
+        ++accepted;
+
+        if (trackEnergy) {
+            maxDrift = std::max(maxDrift, std::abs(integrator.energies().total - initialEnergy));
+        }
+        if (trackFlip && flipTime < 0.0 && hasFlipped(integrator.state())) {
+            flipTime = integrator.time();
+        }
+    }
+
+    const PendulumState& state = integrator.state();
+    if (reductions & FinalState) {
+        m_batch.finalTheta1[member] = state[0];
+        m_batch.finalOmega1[member] = state[1];
+        m_batch.finalTheta2[member] = state[2];
+        m_batch.finalOmega2[member] = state[3];
+        m_batch.finalTime[member] = integrator.time();
+    }
+    if (trackEnergy) {
+        m_batch.maxEnergyDrift[member] = maxDrift;
+        m_batch.finalEnergyDrift[member] = integrator.energies().total - initialEnergy;
+    }
+    if (trackFlip) {
+        m_batch.firstFlipTime[member] = flipTime;
+    }
+    if (reductions & StepCounts) {
+        m_batch.acceptedSteps[member] = accepted;
+        m_batch.rejectedSteps[member] = rejected;
+    }
+    m_batch.failed[member] = integrator.failed() ? 1 : 0;
+}
+
+void EnsembleEngine::integrateKernelRange(std::size_t first, std::size_t last)
+{
+    const unsigned reductions = m_config.reductions;
+    // Offset a column to this range, or pass null when its reduction is off
+    auto column = [first](auto& values) { return values.empty() ? nullptr : values.data() + first; };
+
+    BatchKernelJob job;
+    job.parameters = m_config.parameters;
+    job.tolerances = m_config.tolerances;
+    job.duration = m_config.duration;
+    job.trackEnergy = reductions & EnergyDrift;
+    job.trackFlip = reductions & FirstFlipTime;
+    job.count = last - first;
+    job.theta1 = m_batch.theta1.data() + first;
+    job.omega1 = m_batch.omega1.data() + first;
+    job.theta2 = m_batch.theta2.data() + first;
+    job.omega2 = m_batch.omega2.data() + first;
+    job.finalTheta1 = column(m_batch.finalTheta1);
+    job.finalOmega1 = column(m_batch.finalOmega1);
+    job.finalTheta2 = column(m_batch.finalTheta2);
+    job.finalOmega2 = column(m_batch.finalOmega2);
+    job.finalTime = column(m_batch.finalTime);
+    job.maxEnergyDrift = column(m_batch.maxEnergyDrift);
+    job.finalEnergyDrift = column(m_batch.finalEnergyDrift);
+    job.firstFlipTime = column(m_batch.firstFlipTime);
+    job.acceptedSteps = column(m_batch.acceptedSteps);
+    job.rejectedSteps = column(m_batch.rejectedSteps);
+    job.failed = column(m_batch.failed);
+
+    BatchKernel::run(m_lastSimdLevel, job);
+}
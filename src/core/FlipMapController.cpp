@@ -0,0 +1,208 @@
+#include "core/FlipMapController.h"
+#include "core/DoublePendulum.h"
+#include <QColor>
+#include <cmath>
+#include <cstdio>
+
+namespace {
+constexpr int REFRESH_INTERVAL_MS = 250;
+}
+
+FlipMapController::FlipMapController(QObject* parent)
+    : QObject(parent)
+{
+    m_refreshTimer.setInterval(REFRESH_INTERVAL_MS);
+    connect(&m_refreshTimer, &QTimer::timeout, this, &FlipMapController::updateProgress);
+}
+
+FlipMapController::~FlipMapController()
+{
+    shutdown();
+}
+
+void FlipMapController::setResolution(int resolution)
+{
+    resolution = qBound(16, resolution, 4096);
+    if (m_resolution == resolution) {
+        return;
+    }
+    m_resolution = resolution;
+    emit resolutionChanged();
+}
+
+void FlipMapController::setDuration(double duration)
+{
+    if (!(duration > 0.0) || m_duration == duration) {
+        return;
+    }
+    m_duration = duration;
+    emit durationChanged();
+}
+
+void FlipMapController::start(DoublePendulum* pendulum)
+{
+    if (!pendulum) {
+        return;
+    }
+    shutdown();
+
+    FlipMapConfig config;
+    config.parameters = pendulum->parameters();
+    config.width = static_cast<std::size_t>(m_resolution);
+    config.height = static_cast<std::size_t>(m_resolution);
+    config.duration = m_duration;
+    // Smaller tiles at low resolutions so the map still fills in gradually
+    config.tileSize = m_resolution <= 512 ? 32 : 64;
+    m_generator = std::make_unique<FlipMapGenerator>(config);
+    m_tileCount = m_generator->tileCount();
+    m_tilesDone.store(0, std::memory_order_relaxed);
+    m_tilesShown = 0;
+    m_completed = false;
+
+    {
+        std::lock_guard<std::mutex> lock(m_imageMutex);
+        m_image = QImage(m_resolution, m_resolution, QImage::Format_RGB32);
+        m_image.fill(QColor(0x30, 0x30, 0x30)); // Not computed yet
+    }
+
+    m_progress = 0.0;
+    m_elapsedSeconds = 0.0;
+    m_clock.start();
+
+    FlipMapGenerator* generator = m_generator.get();
+    m_thread = QThread::create([this, generator]() {
+        m_completed = generator->run([this](const FlipMapTile& tile) {
+            colorizeTile(tile);
+            m_tilesDone.fetch_add(1, std::memory_order_release);
+        });
+    });
+    m_thread->setObjectName(QStringLiteral("FlipMapGenerator"));
+    // A finished() still queued from a thread that shutdown() already joined must not touch the new one
+    QThread* thread = m_thread;
+    connect(m_thread, &QThread::finished, this, [this, thread]() {
+        if (m_thread == thread) {
+            onThreadFinished();
+        }
+    });
+    m_thread->start();
+    m_refreshTimer.start();
+
+    emit runningChanged();
+    emit progressChanged();
+    ++m_imageRevision;
+    emit imageRevisionChanged();
+}
+
+void FlipMapController::cancel()
+{
+    if (m_generator && m_thread) {
+        m_generator->cancel();
+    }
+}
+
+void FlipMapController::shutdown()
+{
+    if (!m_thread) {
+        return;
+    }
+    m_generator->cancel();
+    m_thread->wait();
+    onThreadFinished();
+}
+
+void FlipMapController::onThreadFinished()
+{
+    if (!m_thread) {
+        return; // Already handled by shutdown()
+    }
+    m_thread->wait();
+    delete m_thread;
+    m_thread = nullptr;
+    m_refreshTimer.stop();
+
+    updateProgress();
+    emit runningChanged();
+    emit finished(m_completed);
+}
+
+void FlipMapController::updateProgress()
+{
+    const std::size_t done = m_tilesDone.load(std::memory_order_acquire);
+    m_elapsedSeconds = m_clock.isValid() ? m_clock.elapsed() / 1000.0 : 0.0;
+    m_progress = m_tileCount > 0 ? static_cast<double>(done) / static_cast<double>(m_tileCount) : 0.0;
+    emit progressChanged();
+
+    if (done != m_tilesShown) {
+        m_tilesShown = done;
+        ++m_imageRevision;
+        emit imageRevisionChanged();
+    }
+}
+
+QRgb FlipMapController::colorFor(float flipTime, double duration)
+{
+    if (flipTime < 0.0f) {
+        return qRgb(0x10, 0x10, 0x18); // Never flipped
+    }
+    // Logarithmic time scale: most of the structure is in the first seconds
+    const double u = std::log1p(static_cast<double>(flipTime)) / std::log1p(duration);
+    return QColor::fromHsvF(0.8 * qBound(0.0, u, 1.0), 0.85, 1.0 - 0.45 * u).rgb();
+}
+
+void FlipMapController::colorizeTile(const FlipMapTile& tile)
+{
+    const double duration = m_generator->config().duration;
+    std::lock_guard<std::mutex> lock(m_imageMutex);
+    for (std::size_t y = tile.y; y < tile.y + tile.height; ++y) {
+        QRgb* line = reinterpret_cast<QRgb*>(m_image.scanLine(static_cast<int>(y)));
+        for (std::size_t x = tile.x; x < tile.x + tile.width; ++x) {
+            line[x] = colorFor(m_generator->flipTime(x, y), duration);
+        }
+    }
+}
+
+QImage FlipMapController::image() const
+{
+    std::lock_guard<std::mutex> lock(m_imageMutex);
+    return m_image.copy();
+}
+
+bool FlipMapController::saveImage(const QUrl& fileUrl)
+{
+    const QString path = fileUrl.isLocalFile() ? fileUrl.toLocalFile() : fileUrl.toString();
+    if (path.isEmpty()) {
+        return false;
+    }
+    if (path.endsWith(QStringLiteral(".pgm"), Qt::CaseInsensitive)) {
+        // Raw flip times are only consistent once the worker has stopped
+        if (!m_generator || m_thread) {
+            return false;
+        }
+        std::FILE* file = std::fopen(path.toLocal8Bit().constData(), "wb");
+        if (!file) {
+            return false;
+        }
+        const bool written = m_generator->writePgm16(file);
+        return std::fclose(file) == 0 && written;
+    }
+    return image().save(path);
+}
+
+FlipMapImageProvider::FlipMapImageProvider(FlipMapController* controller)
+    : QQuickImageProvider(QQuickImageProvider::Image)
+    , m_controller(controller)
+{
+}
+
+QImage FlipMapImageProvider::requestImage(const QString& id, QSize* size, const QSize& requestedSize)
+{
+    Q_UNUSED(id);
+    QImage image = m_controller->image();
+    if (size) {
+        *size = image.size();
+    }
+    if (requestedSize.isValid() && !image.isNull()) {
+        image = image.scaled(requestedSize, Qt::KeepAspectRatio, Qt::FastTransformation);
+    }
+    return image;
+}
@@ -0,0 +1,173 @@
+#include "core/FlipMapGenerator.h"
+#include "core/WorkStealingScheduler.h"
+#include <algorithm>
+
+FlipMapGenerator::FlipMapGenerator(const FlipMapConfig& config)
+    : m_config(config)
+{
+    m_config.tileSize = std::max<std::size_t>(1, m_config.tileSize);
+    m_flipTimes.assign(m_config.width * m_config.height, NEVER_FLIPPED);
+}
+
+std::size_t FlipMapGenerator::tileCount() const
+{
+    const std::size_t tile = m_config.tileSize;
+    return ((m_config.width + tile - 1) / tile) * ((m_config.height + tile - 1) / tile);
+}
+
+double FlipMapGenerator::theta1At(std::size_t x) const
+{
+    const double u = (static_cast<double>(x) + 0.5) / static_cast<double>(m_config.width);
+    return m_config.theta1Min + u * (m_config.theta1Max - m_config.theta1Min);
+}
+
+double FlipMapGenerator::theta2At(std::size_t y) const
+{
+    const double v = (static_cast<double>(y) + 0.5) / static_cast<double>(m_config.height);
+    return m_config.theta2Max - v * (m_config.theta2Max - m_config.theta2Min);
+}
+
+bool FlipMapGenerator::run(const TileCallback& onTile)
+{
+    std::fill(m_flipTimes.begin(), m_flipTimes.end(), NEVER_FLIPPED);
+    m_cancelled.store(false, std::memory_order_relaxed);
+    m_prunedPixels.store(0, std::memory_order_relaxed);
+    m_failedPixels.store(0, std::memory_order_relaxed);
+    m_onTile = onTile ? &onTile : nullptr;
+
+    m_simdLevel = BatchKernel::detect();
+    if (static_cast<int>(m_config.maxSimdLevel) < static_cast<int>(m_simdLevel)) {
+        m_simdLevel = m_config.maxSimdLevel;
+    }
+
+    // One tile per grain: tiles differ wildly in cost (fast-flipping edges
+    // versus slow chaotic bands), which is exactly what stealing evens out
+    WorkStealingScheduler scheduler(m_config.threadCount);
+    scheduler.parallelFor(tileCount(), 1, [this](std::size_t first, std::size_t last) {
+        for (std::size_t tile = first; tile < last; ++tile) {
+            if (m_cancelled.load(std::memory_order_relaxed)) {
+                return;
+            }
+            computeTile(tile);
+        }
+    });
+    m_lastThreadCount = scheduler.threadCount();
+    m_onTile = nullptr;
+    return !m_cancelled.load(std::memory_order_relaxed);
+}
+
+double FlipMapGenerator::flipEnergyThreshold() const
+{
+    // V = -(G1 cos(theta1) + G2 cos(theta2_abs)). Rod 1 upright costs at least
+    // G1 - G2, rod 2 upright at least G2 - G1.
+    const PendulumParameters& p = m_config.parameters;
+    const double g1 = (p.m1 + p.rodMass1 / 2.0 + p.m2 + p.rodMass2) * p.g * p.l1;
+    const double g2 = (p.m2 + p.rodMass2 / 2.0) * p.g * p.l2;
+    return -std::abs(g1 - g2);
+}
+
+void FlipMapGenerator::computeTile(std::size_t tile)
+{
+    const std::size_t tileSize = m_config.tileSize;
+    const std::size_t tilesPerRow = (m_config.width + tileSize - 1) / tileSize;
+    FlipMapTile rect;
+    rect.x = (tile % tilesPerRow) * tileSize;
+    rect.y = (tile / tilesPerRow) * tileSize;
+    rect.width = std::min(tileSize, m_config.width - rect.x);
+    rect.height = std::min(tileSize, m_config.height - rect.y);
+
+    // The energy bound holds only if the forces can do nothing but dissipate
+    const PendulumParameters& p = m_config.parameters;
+    const bool canPrune = p.b1 >= 0.0 && p.b2 >= 0.0 && p.c1 >= 0.0 && p.c2 >= 0.0;
+    const double threshold = flipEnergyThreshold();
+
+    const std::size_t capacity = rect.width * rect.height;
+    std::vector<double> theta1, omega, theta2Rel;
+    std::vector<std::size_t> pixel;
+    theta1.reserve(capacity);
+    theta2Rel.reserve(capacity);
+    pixel.reserve(capacity);
+
+    std::size_t pruned = 0;
+    for (std::size_t y = rect.y; y < rect.y + rect.height; ++y) {
+        const double theta2Abs = theta2At(y);
+        for (std::size_t x = rect.x; x < rect.x + rect.width; ++x) {
+            const double t1 = theta1At(x);
+            const PendulumState state{t1, 0.0, theta2Abs - t1, 0.0};
+            if (canPrune && PendulumIntegrator::energies(p, state).total < threshold) {
+                ++pruned; // Stays NEVER_FLIPPED
+                continue;
+            }
+            theta1.push_back(state[0]);
+            theta2Rel.push_back(state[2]);
+            pixel.push_back(y * m_config.width + x);
+        }
+    }
+
+    const std::size_t count = pixel.size();
+    if (count > 0) {
+        omega.assign(count, 0.0);
+        std::vector<double> flipTimes(count, -1.0);
+        std::vector<std::uint8_t> failed(count, 0);
+
+        BatchKernelJob job;
+        job.parameters = p;
+        job.tolerances = m_config.tolerances;
+        job.duration = m_config.duration;
+        job.trackFlip = true;
+        job.stopOnFlip = true; // Early termination: the rest of the trajectory is irrelevant
+        job.count = count;
+        job.theta1 = theta1.data();
+        job.omega1 = omega.data();
+        job.theta2 = theta2Rel.data();
+        job.omega2 = omega.data();
+        job.firstFlipTime = flipTimes.data();
+        job.failed = failed.data();
+        BatchKernel::run(m_simdLevel, job);
+
+        std::size_t failedCount = 0;
+        for (std::size_t i = 0; i < count; ++i) {
+            m_flipTimes[pixel[i]] = flipTimes[i] >= 0.0 ? static_cast<float>(flipTimes[i]) : NEVER_FLIPPED;
+            failedCount += failed[i];
+        }
+        m_failedPixels.fetch_add(failedCount, std::memory_order_relaxed);
+    }
+    m_prunedPixels.fetch_add(pruned, std::memory_order_relaxed);
+
+    if (m_onTile) {
+        (*m_onTile)(rect);
+    }
+}
+
+std::uint16_t FlipMapGenerator::encode16(float flipTime, double duration)
+{
+    if (flipTime < 0.0f || duration <= 0.0) {
+        return 0;
+    }
+    const double fraction = std::min(1.0, static_cast<double>(flipTime) / duration);
+    return static_cast<std::uint16_t>(65535.0 - std::lround(fraction * 65534.0));
+}
+
+bool FlipMapGenerator::writePgm16(std::FILE* file) const
+{
+    if (std::fprintf(file, "P5\n%zu %zu\n65535\n", m_config.width, m_config.height) < 0) {
+        return false;
+    }
+    std::vector<unsigned char> row(m_config.width * 2);
+    for (std::size_t y = 0; y < m_config.height; ++y) {
+        for (std::size_t x = 0; x < m_config.width; ++x) {
+            const std::uint16_t value = encode16(flipTime(x, y), m_config.duration);
+            row[2 * x] = static_cast<unsigned char>(value >> 8); // PGM samples are big-endian
+            row[2 * x + 1] = static_cast<unsigned char>(value & 0xff);
+        }
+        if (std::fwrite(row.data(), 1, row.size(), file) != row.size()) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool FlipMapGenerator::writeRawFloat(std::FILE* file) const
+{
+    return std::fwrite(m_flipTimes.data(), sizeof(float), m_flipTimes.size(), file) == m_flipTimes.size();
+}
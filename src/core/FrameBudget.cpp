@@ -0,0 +1,105 @@
+#include "core/FrameBudget.h"
+#include <algorithm>
+
+FrameBudget::FrameBudget()
+{
+    // Render gets half the frame; the GUI-thread phases share the rest
+    m_shares[Physics] = 0.2;
+    m_shares[Traces] = 0.15;
+    m_shares[Charts] = 0.15;
+    m_shares[Render] = 0.5;
+}
+
+void FrameBudget::setFramePeriod(double seconds)
+{
+    if (seconds > 0.0) {
+        m_period = seconds;
+    }
+}
+
+void FrameBudget::setShare(Phase phase, double share)
+{
+    m_shares[phase] = std::max(0.0, share);
+}
+
+void FrameBudget::beginFrame(double now)
+{
+    if (m_lastStart >= 0.0) {
+        // Close the frame that just ended
+        for (int phase = 0; phase < PhaseCount; ++phase) {
+            PhaseStats& stats = m_stats[phase];
+            const double seconds = m_current[phase];
+            stats.last = seconds;
+            stats.average = m_frames == 1 ? seconds : stats.average + SMOOTHING * (seconds - stats.average);
+            stats.peak = std::max(stats.peak, seconds);
+            if (seconds > budget(static_cast<Phase>(phase))) {
+                ++stats.overruns;
+            }
+        }
+        m_previous = m_current;
+
+        m_lastInterval = now - m_lastStart;
+        if (m_lastInterval > DROP_THRESHOLD * m_period) {
+            m_lastDropCause = worstPhase();
+            ++m_droppedFrames;
+            ++m_dropCauses[static_cast<std::size_t>(m_lastDropCause)];
+        }
+    }
+    m_current.fill(0.0);
+    m_lastStart = now;
+    ++m_frames;
+}
+
+void FrameBudget::record(Phase phase, double seconds)
+{
+    m_current[phase] += std::max(0.0, seconds);
+}
+
+double FrameBudget::spent() const
+{
+    double total = 0.0;
+    for (int phase = 0; phase < PhaseCount; ++phase) {
+        total += m_current[phase];
+    }
+    return total;
+}
+
+bool FrameBudget::hasRoomFor(Phase phase) const
+{
+    return spent() + budget(phase) <= m_period - budget(Render);
+}
+
+int FrameBudget::worstPhase() const
+{
+    int worst = Unaccounted;
+    double worstRatio = 1.0;
+    for (int phase = 0; phase < PhaseCount; ++phase) {
+        const double limit = budget(static_cast<Phase>(phase));
+        const double ratio = limit > 0.0 ? m_previous[phase] / limit : 0.0;
+        if (ratio > worstRatio) {
+            worstRatio = ratio;
+            worst = phase;
+        }
+    }
+    return worst;
+}
+
+void FrameBudget::resetPeaks()
+{
+    for (PhaseStats& stats : m_stats) {
+        stats.peak = 0.0;
+    }
+}
+
+void FrameBudget::reset()
+{
+    m_current.fill(0.0);
+    m_previous.fill(0.0);
+    m_stats.fill(PhaseStats());
+    m_dropCauses.fill(0);
+    m_lastStart = -1.0;
+    m_lastInterval = 0.0;
+    m_frames = 0;
+    m_droppedFrames = 0;
+    m_lastDropCause = -1;
+}
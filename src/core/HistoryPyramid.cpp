@@ -0,0 +1,257 @@
+#include "core/HistoryPyramid.h"
+#include <algorithm>
+#include <cmath>
+
+namespace {
+
+// One pixel column of an M4 reduction
+struct PixelColumn {
+    bool used = false;
+    double firstTime = 0.0, first = 0.0;
+    double lastTime = 0.0, last = 0.0;
+    double min = 0.0, max = 0.0;
+
+    void add(double t0, double v0, double t1, double v1, double lo, double hi)
+    {
+        if (!used) {
+            used = true;
+            firstTime = t0;
+            first = v0;
+            min = lo;
+            max = hi;
+        } else {
+            min = std::min(min, lo);
+            max = std::max(max, hi);
+        }
+        lastTime = t1;
+        last = v1;
+    }
+};
+
+class ColumnMapper
+{
+public:
+    ColumnMapper(double tMin, double tMax, std::size_t pixels)
+        : m_tMin(tMin)
+        , m_scale(static_cast<double>(pixels) / (tMax - tMin))
+        , m_last(pixels - 1)
+    {
+    }
+
+    std::size_t operator()(double t) const
+    {
+        const double x = (t - m_tMin) * m_scale;
+        if (!(x > 0.0)) return 0;
+        return std::min(static_cast<std::size_t>(x), m_last);
+    }
+
+private:
+    double m_tMin;
+    double m_scale;
+    std::size_t m_last;
+};
+
+// First, the two extremes and last of every used column. The extreme nearer
+// to the last value goes second, so the segment into the next column starts
+// where the data actually leaves this one.
+void emitColumns(const std::vector<PixelColumn>& columns, std::vector<double>& out)
+{
+    for (const PixelColumn& c : columns) {
+        if (!c.used) {
+            continue;
+        }
+        const double mid = 0.5 * (c.firstTime + c.lastTime);
+        const bool endsHigh = (c.max - c.last) < (c.last - c.min);
+        out.insert(out.end(), {c.firstTime, c.first,
+                               mid, endsHigh ? c.min : c.max,
+                               mid, endsHigh ? c.max : c.min,
+                               c.lastTime, c.last});
+    }
+}
+
+} // namespace
+
+HistoryPyramid::HistoryPyramid(std::size_t seriesCount)
+    : m_seriesCount(std::max<std::size_t>(seriesCount, 1))
+    , m_levels(1)
+{
+    m_open.resize(leafStride());
+}
+
+void HistoryPyramid::append(double time, const double* values)
+{
+    double* leaf = m_open.data();
+    if (m_openRows == 0) {
+        leaf[0] = time;
+        for (std::size_t s = 0; s < m_seriesCount; ++s) {
+            double* v = leaf + 2 + 4 * s;
+            v[0] = v[1] = v[2] = values[s];
+        }
+    } else {
+        for (std::size_t s = 0; s < m_seriesCount; ++s) {
+            double* v = leaf + 2 + 4 * s;
+            v[0] = std::min(v[0], values[s]);
+            v[1] = std::max(v[1], values[s]);
+        }
+    }
+    leaf[1] = time;
+    for (std::size_t s = 0; s < m_seriesCount; ++s) {
+        leaf[2 + 4 * s + 3] = values[s];
+    }
+    ++m_rowCount;
+    if (++m_openRows == BUCKET_ROWS) {
+        completeLeaf();
+    }
+}
+
+void HistoryPyramid::clear()
+{
+    m_levels.assign(1, Level());
+    m_openRows = 0;
+    m_rowCount = 0;
+}
+
+void HistoryPyramid::dropRowsBefore(std::uint64_t row)
+{
+    for (std::size_t k = 0; k < m_levels.size(); ++k) {
+        Level& level = m_levels[k];
+        // Buckets of this level that end at or before the row
+        const std::uint64_t dropped = std::min<std::uint64_t>(row / (BUCKET_ROWS << k), level.count);
+        if (dropped > level.retainedFrom) {
+            level.retainedFrom = dropped;
+            compact(level, k == 0 ? leafStride() : nodeStride());
+        }
+    }
+}
+
+void HistoryPyramid::compact(Level& level, std::size_t stride)
+{
+    const std::uint64_t stale = level.retainedFrom - level.firstIndex;
+    const std::uint64_t stored = level.count - level.firstIndex;
+    if (stale == 0 || 2 * stale < stored) {
+        return;
+    }
+    level.data.erase(level.data.begin(), level.data.begin() + static_cast<std::ptrdiff_t>(stale * stride));
+    level.firstIndex = level.retainedFrom;
+}
+
+std::size_t HistoryPyramid::memoryBytes() const
+{
+    std::size_t bytes = m_open.capacity() * sizeof(double);
+    for (const Level& level : m_levels) {
+        bytes += level.data.capacity() * sizeof(double);
+    }
+    return bytes;
+}
+
+const double* HistoryPyramid::leaf(std::uint64_t index) const
+{
+    const Level& leaves = m_levels[0];
+    return index < leaves.count ? leaves.bucket(index, leafStride()) : m_open.data();
+}
+
+void HistoryPyramid::completeLeaf()
+{
+    Level& leaves = m_levels[0];
+    leaves.data.insert(leaves.data.end(), m_open.begin(), m_open.end());
+    std::uint64_t index = leaves.count++;
+    m_openRows = 0;
+
+    // Each completed right half completes its parent
+    const std::size_t stride = nodeStride();
+    for (std::size_t k = 0; index % 2 == 1; ++k, index /= 2) {
+        if (k + 1 == m_levels.size()) {
+            m_levels.emplace_back();
+        }
+        const Level& children = m_levels[k];
+        Level& parents = m_levels[k + 1];
+        // The left half is gone only if it was dropped, and then so are the
+        // parent's first rows: no query uses this parent, any value will do
+        const bool hasLeft = index - 1 >= children.firstIndex;
+        const std::size_t childStride = k == 0 ? leafStride() : stride;
+        const std::size_t childOffset = k == 0 ? 2 : 0;
+        const std::size_t seriesStep = k == 0 ? 4 : 2;
+        const double* right = children.bucket(index, childStride) + childOffset;
+        const double* left = hasLeft ? children.bucket(index - 1, childStride) + childOffset : right;
+        for (std::size_t s = 0; s < m_seriesCount; ++s) {
+            parents.data.push_back(std::min(left[s * seriesStep], right[s * seriesStep]));
+            parents.data.push_back(std::max(left[s * seriesStep + 1], right[s * seriesStep + 1]));
+        }
+        ++parents.count;
+    }
+}
+
+bool HistoryPyramid::envelope(std::size_t series, double tMin, double tMax, std::size_t pixels,
+                              std::vector<double>& out) const
+{
+    const std::uint64_t first = m_levels[0].retainedFrom;
+    const std::uint64_t end = leafCount();
+    if (series >= m_seriesCount || pixels == 0 || !(tMax > tMin) || first >= end) {
+        return false;
+    }
+
+    // Leaves overlapping [tMin, tMax]; their times increase, so binary search
+    std::uint64_t lo = first, hi = end;
+    while (lo < hi) {
+        const std::uint64_t mid = lo + (hi - lo) / 2;
+        if (leaf(mid)[1] < tMin) lo = mid + 1; else hi = mid;
+    }
+    const std::uint64_t b0 = lo;
+    hi = end;
+    while (lo < hi) {
+        const std::uint64_t mid = lo + (hi - lo) / 2;
+        if (leaf(mid)[0] <= tMax) lo = mid + 1; else hi = mid;
+    }
+    const std::uint64_t b1 = lo;
+
+    const double rowsPerPixel = static_cast<double>((b1 - b0) * BUCKET_ROWS) / static_cast<double>(pixels);
+    if (b0 >= b1 || rowsPerPixel < static_cast<double>(MIN_ROWS_PER_PIXEL)) {
+        return false;
+    }
+    // Widest level whose buckets hold at most half a pixel's worth of rows
+    std::size_t maxLevel = 0;
+    while (maxLevel + 1 < m_levels.size()
+           && static_cast<double>(BUCKET_ROWS << (maxLevel + 1)) <= 0.5 * rowsPerPixel) {
+        ++maxLevel;
+    }
+
+    const ColumnMapper columnOf(tMin, tMax, pixels);
+    std::vector<PixelColumn> columns(pixels);
+    const std::size_t leafValue = 2 + 4 * series;
+    for (std::uint64_t b = b0; b < b1;) {
+        // Largest aligned, complete bucket starting at leaf b that stays inside the range
+        std::size_t k = maxLevel;
+        while (k > 0 && ((b & ((std::uint64_t(1) << k) - 1)) != 0
+                         || b + (std::uint64_t(1) << k) > b1
+                         || (b >> k) >= m_levels[k].count)) {
+            --k;
+        }
+        const std::uint64_t span = std::uint64_t(1) << k;
+        const double* firstLeaf = leaf(b);
+        const double* lastLeaf = leaf(b + span - 1);
+        const double* extremes = k == 0 ? firstLeaf + leafValue
+                                        : m_levels[k].bucket(b >> k, nodeStride()) + 2 * series;
+        columns[columnOf(firstLeaf[0])].add(firstLeaf[0], firstLeaf[leafValue + 2],
+                                            lastLeaf[1], lastLeaf[leafValue + 3],
+                                            extremes[0], extremes[1]);
+        b += span;
+    }
+    emitColumns(columns, out);
+    return true;
+}
+
+void HistoryPyramid::reduce(const double* points, std::size_t count,
+                            double tMin, double tMax, std::size_t pixels, std::vector<double>& out)
+{
+    if (count == 0 || pixels == 0 || !(tMax > tMin)) {
+        return;
+    }
+    const ColumnMapper columnOf(tMin, tMax, pixels);
+    std::vector<PixelColumn> columns(pixels);
+    for (std::size_t i = 0; i < count; ++i) {
+        const double t = points[2 * i];
+        const double v = points[2 * i + 1];
+        columns[columnOf(t)].add(t, v, t, v, v, v);
+    }
+    emitColumns(columns, out);
+}
@@ -0,0 +1,117 @@
+#include "core/LineSimplifier.h"
+#include <algorithm>
+#include <cmath>
+
+namespace {
+
+void copyPoint(double* points, std::size_t from, std::size_t to)
+{
+    points[2 * to] = points[2 * from];
+    points[2 * to + 1] = points[2 * from + 1];
+}
+
+} // namespace
+
+LineSimplifier::Segment LineSimplifier::measure(const double* points, std::size_t first, std::size_t last)
+{
+    Segment segment{first, last, first, 0.0};
+    if (last - first < 2) {
+        return segment;
+    }
+    const double x0 = points[2 * first];
+    const double y0 = points[2 * first + 1];
+    const double dx = points[2 * last] - x0;
+    const double dy = points[2 * last + 1] - y0;
+    const double length = std::sqrt(dx * dx + dy * dy);
+    // The farthest point by the unnormalised cross product; one division per segment
+    double best = 0.0;
+    if (length > 0.0) {
+        for (std::size_t i = first + 1; i < last; ++i) {
+            const double cross = std::abs((points[2 * i] - x0) * dy - (points[2 * i + 1] - y0) * dx);
+            if (cross > best) {
+                best = cross;
+                segment.farthest = i;
+            }
+        }
+        segment.distance = best / length;
+    } else {
+        for (std::size_t i = first + 1; i < last; ++i) {
+            const double px = points[2 * i] - x0;
+            const double py = points[2 * i + 1] - y0;
+            if (px * px + py * py > best) {
+                best = px * px + py * py;
+                segment.farthest = i;
+            }
+        }
+        segment.distance = std::sqrt(best);
+    }
+    return segment;
+}
+
+std::size_t LineSimplifier::simplify(double* points, std::size_t count, double epsilon)
+{
+    if (count <= 2 || !(epsilon > 0.0)) {
+        return count;
+    }
+    // Right ends of the pending segments; the bottom one is the last point
+    std::size_t stack[STACK_DEPTH];
+    std::size_t depth = 0;
+    std::size_t kept = 0;
+    std::size_t first = 0;
+    std::size_t last = count - 1;
+    for (;;) {
+        const Segment segment = measure(points, first, last);
+        if (segment.distance > epsilon) {
+            if (depth == STACK_DEPTH) {
+                // Merge the two rightmost pending segments; they are split again when reached
+                std::copy(stack + 2, stack + depth, stack + 1);
+                --depth;
+            }
+            stack[depth++] = last;
+            last = segment.farthest;
+            continue;
+        }
+        // Nothing in [first, last] needs keeping: first is final. Writes stay
+        // at or below `first`, behind every point still to be read.
+        copyPoint(points, first, kept++);
+        if (depth == 0) {
+            copyPoint(points, last, kept++);
+            return kept;
+        }
+        first = last;
+        last = stack[--depth];
+    }
+}
+
+std::size_t LineSimplifier::simplifyToCount(double* points, std::size_t count, std::size_t target)
+{
+    target = std::max<std::size_t>(target, 2);
+    if (count <= target) {
+        return count;
+    }
+    m_segments.clear();
+    m_kept.clear();
+    m_kept.push_back(0);
+    m_kept.push_back(count - 1);
+    auto pushSegment = [this](const Segment& segment) {
+        if (segment.distance > 0.0) {
+            m_segments.push_back(segment);
+            std::push_heap(m_segments.begin(), m_segments.end());
+        }
+    };
+    pushSegment(measure(points, 0, count - 1));
+    while (m_kept.size() < target && !m_segments.empty()) {
+        std::pop_heap(m_segments.begin(), m_segments.end());
+        const Segment segment = m_segments.back();
+        m_segments.pop_back();
+        m_kept.push_back(segment.farthest);
+        pushSegment(measure(points, segment.first, segment.farthest));
+        pushSegment(measure(points, segment.farthest, segment.last));
+    }
+
+    std::sort(m_kept.begin(), m_kept.end());
+    for (std::size_t i = 0; i < m_kept.size(); ++i) {
+        copyPoint(points, m_kept[i], i);
+    }
+    return m_kept.size();
+}
@@ -0,0 +1,280 @@
+#include "core/LyapunovEstimator.h"
+#include "core/WorkStealingScheduler.h"
+#include <algorithm>
+#include <cmath>
+
+namespace {
+
+using DP5 = DormandPrince5Tableau;
+
+} // namespace
+
+LyapunovEstimator::LyapunovEstimator(const PendulumParameters& parameters, const PendulumState& state,
+                                     int exponentCount, double renormalizationInterval,
+                                     const PendulumIntegrator::ToleranceProfile& tolerances)
+    : m_compiled(CompiledParameters::compile(parameters))
+    , m_profile(tolerances.bounded())
+    , m_exponentCount(std::clamp(exponentCount, 1, 4))
+    , m_dimension(4 + 4 * m_exponentCount)
+    , m_renormalizationInterval(renormalizationInterval > 0.0 ? renormalizationInterval : 0.5)
+    , m_state(state)
+{
+    m_nextStep = std::clamp(PendulumIntegrator::INITIAL_STEP, m_profile.minStep, m_profile.maxStep);
+
+    for (int j = 0; j < 4; ++j) {
+        m_y[j] = state[j];
+    }
+    // Generic starting directions, so no tangent vector begins inside an invariant subspace
+    for (int i = 0; i < m_exponentCount; ++i) {
+        for (int j = 0; j < 4; ++j) {
+            m_y[4 + 4 * i + j] = (i == j ? 1.0 : 0.0) + 0.1 * (j + 1);
+        }
+    }
+    renormalize();
+    m_logGrowth.fill(0.0);
+    m_nextRenormalization = m_renormalizationInterval;
+}
+
+void LyapunovEstimator::derivativesWithJacobian(const CompiledParameters& c, const PendulumState& y,
+                                                PendulumState& f, PendulumJacobian& jacobian)
+{
+    const double theta1 = y[0];
+    const double omega1 = y[1];
+    const double theta2Rel = y[2];
+    const double omega2Rel = y[3];
+    const double theta2Abs = theta1 + theta2Rel;
+    const double omega2Abs = omega1 + omega2Rel;
+
+    const double coupling = c.coupling;
+    const double a11 = c.a11;
+    const double a22 = c.a22;
+    const double gravity1 = c.gravity1;
+    const double gravity2 = c.gravity2;
+
+    // delta = theta1 - theta2_abs = -theta2_rel
+    const double sinDelta = std::sin(theta1 - theta2Abs);
+    const double cosDelta = std::cos(theta1 - theta2Abs);
+    const double cosTheta1 = std::cos(theta1);
+    const double cosTheta2 = std::cos(theta2Abs);
+    const double a12 = coupling * cosDelta;
+
+    const double qnc1 = -c.b1 * omega1 - c.c1 * omega1 * std::abs(omega1);
+    const double qnc2 = -c.b2 * omega2Rel - c.c2 * omega2Rel * std::abs(omega2Rel);
+    const double b1 = -coupling * omega2Abs * omega2Abs * sinDelta - gravity1 * std::sin(theta1) + qnc1;
+    const double b2 = coupling * omega1 * omega1 * sinDelta - gravity2 * std::sin(theta2Abs) + qnc2;
+
+    for (auto& row : jacobian) {
+        row.fill(0.0);
+    }
+    jacobian[0][1] = 1.0;
+    jacobian[2][3] = 1.0;
+
+    const double det = a11 * a22 - a12 * a12;
+    if (std::fabs(det) < 1e-12) { // Same singular fallback as PendulumIntegrator::derivatives
+        f = {omega1, 0.0, omega2Rel, 0.0};
+        return;
+    }
+    const double alpha1 = (b1 * a22 - a12 * b2) / det;
+    const double alpha2 = (a11 * b2 - b1 * a12) / det;
+    f = {omega1, alpha1, omega2Rel, alpha2 - alpha1};
+
+    // M(y) alpha = B(y)  =>  d alpha = M^-1 (dB - dM alpha); only a12 depends on y (through theta2_rel)
+    const double dB1[4] = {
+        -gravity1 * cosTheta1,
+        -2.0 * coupling * omega2Abs * sinDelta - c.b1 - 2.0 * c.c1 * std::abs(omega1),
+        coupling * omega2Abs * omega2Abs * cosDelta,
+        -2.0 * coupling * omega2Abs * sinDelta};
+    const double dB2[4] = {
+        -gravity2 * cosTheta2,
+        2.0 * coupling * omega1 * sinDelta,
+        -coupling * omega1 * omega1 * cosDelta - gravity2 * cosTheta2,
+        -c.b2 - 2.0 * c.c2 * std::abs(omega2Rel)};
+    const double dA12[4] = {0.0, 0.0, coupling * sinDelta, 0.0};
+
+    for (int j = 0; j < 4; ++j) {
+        const double r1 = dB1[j] - dA12[j] * alpha2;
+        const double r2 = dB2[j] - dA12[j] * alpha1;
+        const double dAlpha1 = (r1 * a22 - a12 * r2) / det;
+        const double dAlpha2 = (a11 * r2 - a12 * r1) / det;
+        jacobian[1][j] = dAlpha1;
+        jacobian[3][j] = dAlpha2 - dAlpha1;
+    }
+}
+
+void LyapunovEstimator::evaluate(const Extended& y, Extended& dy) const
+{
+    const PendulumState state{y[0], y[1], y[2], y[3]};
+    PendulumState f;
+    PendulumJacobian jacobian;
+    derivativesWithJacobian(m_compiled, state, f, jacobian);
+
+    for (int j = 0; j < 4; ++j) {
+        dy[j] = f[j];
+    }
+    for (int i = 0; i < m_exponentCount; ++i) {
+        const double* v = &y[4 + 4 * i];
+        double* dv = &dy[4 + 4 * i];
+        for (int r = 0; r < 4; ++r) {
+            dv[r] = jacobian[r][0] * v[0] + jacobian[r][1] * v[1] + jacobian[r][2] * v[2] + jacobian[r][3] * v[3];
+        }
+    }
+}
+
+bool LyapunovEstimator::step(double maxStep)
+{
+    const int n = m_dimension;
+    const double h = std::min(m_nextStep, maxStep);
+
+    Extended k[7];
+    Extended stage{};
+    k[0] = m_k0;
+
+    for (int j = 0; j < n; ++j) stage[j] = m_y[j] + h * (DP5::A21 * k[0][j]);
+    evaluate(stage, k[1]);
+    for (int j = 0; j < n; ++j) stage[j] = m_y[j] + h * (DP5::A31 * k[0][j] + DP5::A32 * k[1][j]);
+    evaluate(stage, k[2]);
+    for (int j = 0; j < n; ++j) stage[j] = m_y[j] + h * (DP5::A41 * k[0][j] + DP5::A42 * k[1][j] + DP5::A43 * k[2][j]);
+    evaluate(stage, k[3]);
+    for (int j = 0; j < n; ++j) stage[j] = m_y[j] + h * (DP5::A51 * k[0][j] + DP5::A52 * k[1][j] + DP5::A53 * k[2][j] + DP5::A54 * k[3][j]);
+    evaluate(stage, k[4]);
+    for (int j = 0; j < n; ++j) stage[j] = m_y[j] + h * (DP5::A61 * k[0][j] + DP5::A62 * k[1][j] + DP5::A63 * k[2][j] + DP5::A64 * k[3][j] + DP5::A65 * k[4][j]);
+    evaluate(stage, k[5]);
+    Extended ySol{};
+    for (int j = 0; j < n; ++j) ySol[j] = m_y[j] + h * (DP5::A71 * k[0][j] + DP5::A73 * k[2][j] + DP5::A74 * k[3][j] + DP5::A75 * k[4][j] + DP5::A76 * k[5][j]);
+    evaluate(ySol, k[6]);
+
+    // Error control on the pendulum state only
+    double errSq = 0.0;
+    for (int j = 0; j < 4; ++j) {
+        const double error = h * (DP5::E1 * k[0][j] + DP5::E3 * k[2][j] + DP5::E4 * k[3][j] + DP5::E5 * k[4][j] + DP5::E6 * k[5][j] + DP5::E7 * k[6][j]);
+        const double scale = m_profile.absoluteTolerance
+                             + m_profile.relativeTolerance * std::max(std::abs(m_y[j]), std::abs(ySol[j]));
+        errSq += (error / scale) * (error / scale);
+    }
+    const double errNorm = std::sqrt(errSq / 4.0);
+
+    const double hNew = m_profile.proposeStep(h, errNorm, -0.2);
+
+    if (errNorm > 1.0) {
+        ++m_rejectedSteps;
+        m_nextStep = hNew;
+        if (h <= m_profile.minStep) {
+            m_failed = true;
+        }
+        return false;
+    }
+    for (int j = 0; j < n; ++j) {
+        if (!std::isfinite(ySol[j])) {
+            m_failed = true;
+            return false;
+        }
+    }
+
+    m_y = ySol;
+    m_k0 = k[6];
+    m_time += h;
+    m_state = {m_y[0], m_y[1], m_y[2], m_y[3]};
+    ++m_acceptedSteps;
+    // A step clipped to a renormalization time says nothing about the natural step size
+    if (h == m_nextStep || hNew < m_nextStep) {
+        m_nextStep = hNew;
+    }
+    return true;
+}
+
+void LyapunovEstimator::renormalize()
+{
+    // Modified Gram-Schmidt; the stretch factor of vector i is its norm after
+    // removing the directions of the vectors before it
+    for (int i = 0; i < m_exponentCount; ++i) {
+        double* v = &m_y[4 + 4 * i];
+        for (int j = 0; j < i; ++j) {
+            const double* u = &m_y[4 + 4 * j];
+            const double dot = v[0] * u[0] + v[1] * u[1] + v[2] * u[2] + v[3] * u[3];
+            for (int r = 0; r < 4; ++r) {
+                v[r] -= dot * u[r];
+            }
+        }
+        const double norm = std::sqrt(v[0] * v[0] + v[1] * v[1] + v[2] * v[2] + v[3] * v[3]);
+        m_logGrowth[i] += std::log(norm);
+        for (int r = 0; r < 4; ++r) {
+            v[r] /= norm;
+        }
+    }
+    // The FSAL stage holds J v for the old vectors
+    evaluate(m_y, m_k0);
+}
+
+bool LyapunovEstimator::advanceTo(double t)
+{
+    const double EPSILON = m_profile.minStep / 2.0;
+    while (!m_failed) {
+        if (m_nextRenormalization - m_time < EPSILON) {
+            renormalize();
+            m_nextRenormalization += m_renormalizationInterval;
+        }
+        const double target = std::min(t, m_nextRenormalization);
+        if (target - m_time < EPSILON) {
+            break;
+        }
+        step(target - m_time);
+    }
+    return !m_failed;
+}
+
+void LyapunovEstimator::restartAveraging()
+{
+    renormalize();
+    m_logGrowth.fill(0.0);
+    m_averagingStart = m_time;
+    m_nextRenormalization = m_time + m_renormalizationInterval;
+}
+
+double LyapunovEstimator::exponent(int i) const
+{
+    const double elapsed = m_time - m_averagingStart;
+    if (i < 0 || i >= m_exponentCount || elapsed <= 0.0) {
+        return 0.0;
+    }
+    return m_logGrowth[i] / elapsed;
+}
+
+LyapunovResult LyapunovEstimator::result() const
+{
+    LyapunovResult result;
+    for (int i = 0; i < m_exponentCount; ++i) {
+        result.exponents[i] = exponent(i);
+    }
+    result.time = m_time;
+    result.acceptedSteps = m_acceptedSteps;
+    result.rejectedSteps = m_rejectedSteps;
+    result.failed = m_failed;
+    return result;
+}
+
+LyapunovResult LyapunovEstimator::estimate(const PendulumParameters& parameters, const PendulumState& state,
+                                           const LyapunovConfig& config)
+{
+    LyapunovEstimator estimator(parameters, state, config.exponentCount, config.renormalizationInterval,
+                                config.tolerances);
+    const double transient = std::min(std::max(config.transient, 0.0), config.duration);
+    if (transient > 0.0) {
+        estimator.advanceTo(transient);
+        estimator.restartAveraging();
+    }
+    estimator.advanceTo(config.duration);
+    return estimator.result();
+}
+
+std::vector<LyapunovResult> LyapunovEstimator::sweep(const std::vector<PendulumParameters>& parameterSets,
+                                                     const PendulumState& state, const LyapunovConfig& config)
+{
+    std::vector<LyapunovResult> results(parameterSets.size());
+    WorkStealingScheduler scheduler(config.threadCount);
+    scheduler.parallelFor(parameterSets.size(), 1, [&](std::size_t first, std::size_t last) {
+        for (std::size_t i = first; i < last; ++i) {
+            results[i] = estimate(parameterSets[i], state, config);
+        }
+    });
+    return results;
+}
@@ -0,0 +1,862 @@
+#include "core/PendulumIntegrator.h"
+#include <cmath>
+#include <algorithm>
+#include <string>
+
+namespace {
+
+using DP5 = DormandPrince5Tableau;
+
+// Canonical variables {phi1, phi2, p1, p2}: absolute angles and their conjugate momenta
+using CanonicalState = std::array<double, 4>;
+
+constexpr double SQRT3 = 1.7320508075688772935;
+constexpr double SQRT15 = 3.8729833462074168852;
+
+// Gauss-Legendre collocation tableaus (Butcher matrix and weights)
+template <int S>
+struct GaussLegendreTableau {
+    double a[S][S];
+    double b[S];
+};
+constexpr GaussLegendreTableau<1> GAUSS_LEGENDRE_2{{{0.5}}, {1.0}};
+constexpr GaussLegendreTableau<2> GAUSS_LEGENDRE_4{
+    {{0.25, 0.25 - SQRT3 / 6.0},
+     {0.25 + SQRT3 / 6.0, 0.25}},
+    {0.5, 0.5}};
+constexpr GaussLegendreTableau<3> GAUSS_LEGENDRE_6{
+    {{5.0 / 36.0, 2.0 / 9.0 - SQRT15 / 15.0, 5.0 / 36.0 - SQRT15 / 30.0},
+     {5.0 / 36.0 + SQRT15 / 24.0, 2.0 / 9.0, 5.0 / 36.0 - SQRT15 / 24.0},
+     {5.0 / 36.0 + SQRT15 / 30.0, 2.0 / 9.0 + SQRT15 / 15.0, 5.0 / 36.0}},
+    {5.0 / 18.0, 4.0 / 9.0, 5.0 / 18.0}};
+
+// Dormand-Prince 8(5,3) tableau (Hairer, Norsett & Wanner, DOP853), with the
+// coefficients of its 7th-order continuous extension
+constexpr int DOP853_STAGES = 12; // Stages per attempt; stage 13 is the FSAL derivative
+
+// Nodes c_i of all 16 stages: 12 of the step, the FSAL stage, 3 for dense output
+constexpr double DOP853_C[16] = {
+    0.0, 0.526001519587677318785587544488e-01, 0.789002279381515978178381316732e-01, 0.118350341907227396726757197510,
+    0.281649658092772603273242802490, 0.333333333333333333333333333333, 0.25, 0.307692307692307692307692307692,
+    0.651282051282051282051282051282, 0.6, 0.857142857142857142857142857142, 1.0,
+    1.0, 0.1, 0.2, 0.777777777777777777777777777778,
+};
+
+// Stage coefficients a_ij (row 12 holds the weights b_j of the 8th-order solution)
+constexpr double DOP853_A[16][16] = {
+    {},
+    {5.26001519587677318785587544488e-2},
+    {1.97250569845378994544595329183e-2, 5.91751709536136983633785987549e-2},
+    {2.95875854768068491816892993775e-2, 0.0, 8.87627564304205475450678981324e-2},
+    {2.41365134159266685502369798665e-1, 0.0, -8.84549479328286085344864962717e-1, 9.24834003261792003115737966543e-1},
+    {3.7037037037037037037037037037e-2, 0.0, 0.0, 1.70828608729473871279604482173e-1, 1.25467687566822425016691814123e-1},
+    {3.7109375e-2, 0.0, 0.0, 1.70252211019544039314978060272e-1, 6.02165389804559606850219397283e-2, -1.7578125e-2},
+    {3.70920001185047927108779319836e-2, 0.0, 0.0, 1.70383925712239993810214054705e-1, 1.07262030446373284651809199168e-1, -1.53194377486244017527936158236e-2, 8.27378916381402288758473766002e-3},
+    {6.24110958716075717114429577812e-1, 0.0, 0.0, -3.36089262944694129406857109825, -8.68219346841726006818189891453e-1, 2.75920996994467083049415600797e1, 2.01540675504778934086186788979e1, -4.34898841810699588477366255144e1},
+    {4.77662536438264365890433908527e-1, 0.0, 0.0, -2.48811461997166764192642586468, -5.90290826836842996371446475743e-1, 2.12300514481811942347288949897e1, 1.52792336328824235832596922938e1, -3.32882109689848629194453265587e1, -2.03312017085086261358222928593e-2},
+    {-9.3714243008598732571704021658e-1, 0.0, 0.0, 5.18637242884406370830023853209, 1.09143734899672957818500254654, -8.14978701074692612513997267357, -1.85200656599969598641566180701e1, 2.27394870993505042818970056734e1, 2.49360555267965238987089396762, -3.0467644718982195003823669022},
+    {2.27331014751653820792359768449, 0.0, 0.0, -1.05344954667372501984066689879e1, -2.00087205822486249909675718444, -1.79589318631187989172765950534e1, 2.79488845294199600508499808837e1, -2.85899827713502369474065508674, -8.87285693353062954433549289258, 1.23605671757943030647266201528e1, 6.43392746015763530355970484046e-1},
+    {5.42937341165687622380535766363e-2, 0.0, 0.0, 0.0, 0.0, 4.45031289275240888144113950566, 1.89151789931450038304281599044, -5.8012039600105847814672114227, 3.1116436695781989440891606237e-1, -1.52160949662516078556178806805e-1, 2.01365400804030348374776537501e-1, 4.47106157277725905176885569043e-2},
+    {5.61675022830479523392909219681e-2, 0.0, 0.0, 0.0, 0.0, 0.0, 2.53500210216624811088794765333e-1, -2.46239037470802489917441475441e-1, -1.24191423263816360469010140626e-1, 1.5329179827876569731206322685e-1, 8.20105229563468988491666602057e-3, 7.56789766054569976138603589584e-3, -8.298e-3},
+    {3.18346481635021405060768473261e-2, 0.0, 0.0, 0.0, 0.0, 2.83009096723667755288322961402e-2, 5.35419883074385676223797384372e-2, -5.49237485713909884646569340306e-2, 0.0, 0.0, -1.08347328697249322858509316994e-4, 3.82571090835658412954920192323e-4, -3.40465008687404560802977114492e-4, 1.41312443674632500278074618366e-1},
+    {-4.28896301583791923408573538692e-1, 0.0, 0.0, 0.0, 0.0, -4.69762141536116384314449447206, 7.68342119606259904184240953878, 4.06898981839711007970213554331, 3.56727187455281109270669543021e-1, 0.0, 0.0, 0.0, -1.39902416515901462129418009734e-3, 2.9475147891527723389556272149, -9.15095847217987001081870187138},
+};
+
+// Weights of the embedded 5th-order error estimate
+constexpr double DOP853_E5[12] = {
+    0.1312004499419488073250102996e-1, 0.0, 0.0, 0.0,
+    0.0, -0.1225156446376204440720569753e+1, -0.4957589496572501915214079952, 0.1664377182454986536961530415e+1,
+    -0.3503288487499736816886487290, 0.3341791187130174790297318841, 0.8192320648511571246570742613e-1, -0.2235530786388629525884427845e-1,
+};
+
+// b_j minus these gives the 3rd-order error estimate (stages 1, 9 and 12)
+constexpr double DOP853_BHH[3] = {0.244094488188976377952755905512, 0.733846688281611857341361741547, 0.220588235294117647058823529412e-1};
+
+// Dense output: the four highest interpolant coefficients as combinations of the stages
+constexpr double DOP853_D[4][16] = {
+    {-0.84289382761090128651353491142e+1, 0.0, 0.0, 0.0, 0.0, 0.56671495351937776962531783590, -0.30689499459498916912797304727e+1, 0.23846676565120698287728149680e+1,
+     0.21170345824450282767155149946e+1, -0.87139158377797299206789907490, 0.22404374302607882758541771650e+1, 0.63157877876946881815570249290, -0.88990336451333310820698117400e-1, 0.18148505520854727256656404962e+2, -0.91946323924783554000451984436e+1, -0.44360363875948939664310572000e+1},
+    {0.10427508642579134603413151009e+2, 0.0, 0.0, 0.0, 0.0, 0.24228349177525818288430175319e+3, 0.16520045171727028198505394887e+3, -0.37454675472269020279518312152e+3,
+     -0.22113666853125306036270938578e+2, 0.77334326684722638389603898808e+1, -0.30674084731089398182061213626e+2, -0.93321305264302278729567221706e+1, 0.15697238121770843886131091075e+2, -0.31139403219565177677282850411e+2, -0.93529243588444783865713862664e+1, 0.35816841486394083752465898540e+2},
+    {0.19985053242002433820987653617e+2, 0.0, 0.0, 0.0, 0.0, -0.38703730874935176555105901742e+3, -0.18917813819516756882830838328e+3, 0.52780815920542364900561016686e+3,
+     -0.11573902539959630126141871134e+2, 0.68812326946963000169666922661e+1, -0.10006050966910838403183860980e+1, 0.77771377980534432092869265740, -0.27782057523535084065932004339e+1, -0.60196695231264120758267380846e+2, 0.84320405506677161018159903784e+2, 0.11992291136182789328035130030e+2},
+    {-0.25693933462703749003312586129e+2, 0.0, 0.0, 0.0, 0.0, -0.15418974869023643374053993627e+3, -0.23152937917604549567536039109e+3, 0.35763911791061412378285349910e+3,
+     0.93405324183624310003907691704e+2, -0.37458323136451633156875139351e+2, 0.10409964950896230045147246184e+3, 0.29840293426660503123344363579e+2, -0.43533456590011143754432175058e+2, 0.96324553959188282948394950600e+2, -0.39177261675615439165231486172e+2, -0.14972683625798562581422125276e+3},
+};
+
+constexpr int COLLOCATION_MAX_ITERATIONS = 50;
+constexpr double COLLOCATION_TOLERANCE = 1.0e-15;  // Relative change of a stage increment
+constexpr double COLLOCATION_ROUNDOFF_FLOOR = 1.0e-12; // A stalled iteration below this has converged
+
+// Generalised friction torques on theta1 and theta2_rel; compiled out for the conservative kernel
+template <FrictionModel F>
+inline void frictionTorques(const CompiledParameters& c, double omega1, double omega2Rel, double& q1, double& q2)
+{
+    if constexpr (F == FrictionModel::Linear) {
+        q1 = -c.b1 * omega1;
+        q2 = -c.b2 * omega2Rel;
+    } else if constexpr (F == FrictionModel::Full) {
+        q1 = -c.b1 * omega1 - c.c1 * omega1 * std::abs(omega1);
+        q2 = -c.b2 * omega2Rel - c.c2 * omega2Rel * std::abs(omega2Rel);
+    } else {
+        q1 = 0.0;
+        q2 = 0.0;
+    }
+}
+
+// PendulumIntegrator::derivatives for one friction model (see the comment there)
+template <FrictionModel F>
+PendulumState derivativesKernel(const CompiledParameters& c, const PendulumState& y)
+{
+    const double theta1 = y[0];
+    const double omega1 = y[1];
+    const double omega2Rel = y[3];
+    const double theta2 = theta1 + y[2];
+    const double omega2 = omega1 + omega2Rel;
+    const double delta = theta1 - theta2;
+
+    const double sinDelta = std::sin(delta);
+    const double a12 = c.coupling * std::cos(delta);
+
+    double b1 = -c.coupling * omega2 * omega2 * sinDelta - c.gravity1 * std::sin(theta1);
+    double b2 = c.coupling * omega1 * omega1 * sinDelta - c.gravity2 * std::sin(theta2);
+    if constexpr (F != FrictionModel::None) {
+        double q1 = 0.0;
+        double q2 = 0.0;
+        frictionTorques<F>(c, omega1, omega2Rel, q1, q2);
+        b1 += q1;
+        b2 += q2;
+    }
+
+    const double det = c.a11 * c.a22 - a12 * a12;
+    if (std::fabs(det) < 1e-12) {
+        return {omega1, 0.0, omega2Rel, 0.0};
+    }
+    const double theta1Acc = (b1 * c.a22 - a12 * b2) / det;
+    const double theta2Acc = (c.a11 * b2 - b1 * a12) / det;
+    return {omega1, theta1Acc, omega2Rel, theta2Acc - theta1Acc};
+}
+
+CanonicalState toCanonical(const CompiledParameters& c, const PendulumState& y)
+{
+    const double phi1 = y[0];
+    const double phi2 = y[0] + y[2];
+    const double omega1 = y[1];
+    const double omega2 = y[1] + y[3];
+    const double a12 = c.coupling * std::cos(phi1 - phi2);
+    return {phi1, phi2, c.a11 * omega1 + a12 * omega2, a12 * omega1 + c.a22 * omega2};
+}
+
+// Angular velocities from momenta: omega = M^-1 p
+void canonicalVelocities(const CompiledParameters& c, const CanonicalState& z, double& omega1, double& omega2)
+{
+    const double a12 = c.coupling * std::cos(z[0] - z[1]);
+    const double det = c.a11 * c.a22 - a12 * a12;
+    omega1 = (c.a22 * z[2] - a12 * z[3]) / det;
+    omega2 = (c.a11 * z[3] - a12 * z[2]) / det;
+}
+
+PendulumState fromCanonical(const CompiledParameters& c, const CanonicalState& z)
+{
+    double omega1 = 0.0;
+    double omega2 = 0.0;
+    canonicalVelocities(c, z, omega1, omega2);
+    return {z[0], omega1, z[1] - z[0], omega2 - omega1};
+}
+
+/*
+ * Hamilton's equations with the same non-conservative torques as
+ * PendulumIntegrator::derivatives: phi' = M^-1 p, p' = -dH/dphi + Q.
+ */
+template <FrictionModel F>
+CanonicalState canonicalDerivatives(const CompiledParameters& c, const CanonicalState& z)
+{
+    double omega1 = 0.0;
+    double omega2 = 0.0;
+    canonicalVelocities(c, z, omega1, omega2);
+    double q1 = 0.0;
+    double q2 = 0.0;
+    frictionTorques<F>(c, omega1, omega2 - omega1, q1, q2);
+    const double coupling = c.coupling * std::sin(z[0] - z[1]) * omega1 * omega2;
+    return {omega1, omega2,
+            -coupling - c.gravity1 * std::sin(z[0]) + q1,
+            coupling - c.gravity2 * std::sin(z[1]) + q2};
+}
+
+/*
+ * @brief One Gauss-Legendre step in canonical variables.
+ *
+ * The implicit stage equations k_i = f(z0 + h sum_j a_ij k_j) are solved by
+ * fixed-point iteration starting from f(z0); for the step sizes used here the
+ * iteration contracts by roughly h * |df/dz| per sweep. It stops once no
+ * stage increment changes by more than COLLOCATION_TOLERANCE, or once the
+ * change stops shrinking below COLLOCATION_ROUNDOFF_FLOOR (large momenta put
+ * the rounding noise of the stages above the strict tolerance).
+ */
+template <FrictionModel F, int S>
+bool collocationStep(const CompiledParameters& c, const GaussLegendreTableau<S>& tableau,
+                     const CanonicalState& z0, double h, CanonicalState& z1, std::uint64_t& evaluations)
+{
+    std::array<CanonicalState, S> k;
+    k.fill(canonicalDerivatives<F>(c, z0));
+    ++evaluations;
+
+    bool converged = false;
+    double previousChange = HUGE_VAL;
+    for (int iteration = 0; iteration < COLLOCATION_MAX_ITERATIONS && !converged; ++iteration) {
+        std::array<CanonicalState, S> next;
+        for (int i = 0; i < S; ++i) {
+            CanonicalState stage = z0;
+            for (int j = 0; j < S; ++j) {
+                for (int component = 0; component < 4; ++component) {
+                    stage[component] += h * tableau.a[i][j] * k[j][component];
+                }
+            }
+            next[i] = canonicalDerivatives<F>(c, stage);
+        }
+        evaluations += S;
+
+        double change = 0.0; // Largest stage increment change, relative to the state
+        for (int i = 0; i < S; ++i) {
+            for (int component = 0; component < 4; ++component) {
+                change = std::max(change, std::abs(h * (next[i][component] - k[i][component])) / (1.0 + std::abs(z0[component])));
+            }
+        }
+        k = next;
+        converged = change <= COLLOCATION_TOLERANCE
+                    || (change >= previousChange && change <= COLLOCATION_ROUNDOFF_FLOOR);
+        previousChange = change;
+    }
+
+    z1 = z0;
+    for (int i = 0; i < S; ++i) {
+        for (int component = 0; component < 4; ++component) {
+            z1[component] += h * tableau.b[i] * k[i][component];
+        }
+    }
+    return converged;
+}
+
+// Gauss-Legendre scheme of the given method, instantiated for one friction model
+template <FrictionModel F>
+bool collocationStep(PendulumIntegrator::Method method, const CompiledParameters& c,
+                     const CanonicalState& z0, double h, CanonicalState& z1, std::uint64_t& evaluations)
+{
+    switch (method) {
+    case PendulumIntegrator::Method::ImplicitMidpoint:
+        return collocationStep<F>(c, GAUSS_LEGENDRE_2, z0, h, z1, evaluations);
+    case PendulumIntegrator::Method::GaussLegendre6:
+        return collocationStep<F>(c, GAUSS_LEGENDRE_6, z0, h, z1, evaluations);
+    default:
+        return collocationStep<F>(c, GAUSS_LEGENDRE_4, z0, h, z1, evaluations);
+    }
+}
+
+} // namespace
+
+CompiledParameters CompiledParameters::compile(const PendulumParameters& p)
+{
+    CompiledParameters c;
+    c.a11 = (p.m1 + p.rodMass1 / 3.0 + p.m2 + p.rodMass2) * p.l1 * p.l1;
+    c.a22 = (p.m2 + p.rodMass2 / 3.0) * p.l2 * p.l2;
+    c.coupling = (p.m2 + p.rodMass2 / 2.0) * p.l1 * p.l2;
+    c.gravity1 = p.g * (p.m1 + p.rodMass1 / 2.0 + p.m2 + p.rodMass2) * p.l1;
+    c.gravity2 = p.g * (p.m2 + p.rodMass2 / 2.0) * p.l2;
+    c.b1 = p.b1;
+    c.b2 = p.b2;
+    c.c1 = p.c1;
+    c.c2 = p.c2;
+    if (p.c1 != 0.0 || p.c2 != 0.0) {
+        c.friction = FrictionModel::Full;
+    } else if (p.b1 != 0.0 || p.b2 != 0.0) {
+        c.friction = FrictionModel::Linear;
+    } else {
+        c.friction = FrictionModel::None;
+    }
+    return c;
+}
+
+PendulumIntegrator::PendulumIntegrator(const PendulumParameters& parameters, const PendulumState& state)
+    : m_parameters(parameters)
+    , m_compiled(CompiledParameters::compile(parameters))
+    , m_state(state)
+{
+}
+
+void PendulumIntegrator::setParameters(const PendulumParameters& parameters)
+{
+    m_parameters = parameters;
+    m_compiled = CompiledParameters::compile(parameters);
+    m_fsalReady = false; // The cached derivative belongs to the old parameters
+    m_denseValid = false;
+    m_densePending = false;
+}
+
+void PendulumIntegrator::setMethod(Method method)
+{
+    m_method = method;
+}
+
+PendulumIntegrator::Method PendulumIntegrator::activeMethod() const
+{
+    if (m_method != Method::Automatic) {
+        return m_method;
+    }
+    return m_compiled.friction == FrictionModel::None ? Method::GaussLegendre4 : Method::DormandPrince5;
+}
+
+void PendulumIntegrator::setFixedStepSize(double step)
+{
+    m_fixedStepSize = std::max(DOPRI_HMIN, step);
+    m_retryStepSize = 0.0;
+}
+
+const char* PendulumIntegrator::methodName(Method method)
+{
+    switch (method) {
+    case Method::DormandPrince5: return "dp5";
+    case Method::DormandPrince853: return "dop853";
+    case Method::ImplicitMidpoint: return "midpoint";
+    case Method::GaussLegendre4: return "gl4";
+    case Method::GaussLegendre6: return "gl6";
+    case Method::Automatic: return "auto";
+    }
+    return "?";
+}
+
+PendulumIntegrator::ToleranceProfile PendulumIntegrator::ToleranceProfile::realtime()
+{
+    ToleranceProfile profile;
+    profile.absoluteTolerance = 1.0e-9;
+    profile.relativeTolerance = 1.0e-8;
+    profile.maxStep = 0.02;
+    return profile;
+}
+
+PendulumIntegrator::ToleranceProfile PendulumIntegrator::ToleranceProfile::analysis()
+{
+    ToleranceProfile profile;
+    profile.absoluteTolerance = 1.0e-12;
+    profile.relativeTolerance = 1.0e-11;
+    profile.maxStep = 0.01;
+    return profile;
+}
+
+bool PendulumIntegrator::ToleranceProfile::fromName(const char* name, ToleranceProfile& profile)
+{
+    const std::string text(name ? name : "");
+    if (text == "realtime") {
+        profile = realtime();
+    } else if (text == "analysis") {
+        profile = analysis();
+    } else if (text == "reference") {
+        profile = reference();
+    } else {
+        return false;
+    }
+    return true;
+}
+
+const char* PendulumIntegrator::ToleranceProfile::name() const
+{
+    if (*this == realtime()) return "realtime";
+    if (*this == analysis()) return "analysis";
+    if (*this == reference()) return "reference";
+    return "custom";
+}
+
+bool PendulumIntegrator::ToleranceProfile::operator==(const ToleranceProfile& other) const
+{
+    return absoluteTolerance == other.absoluteTolerance && relativeTolerance == other.relativeTolerance
+           && minStep == other.minStep && maxStep == other.maxStep && safetyFactor == other.safetyFactor
+           && minFactor == other.minFactor && maxFactor == other.maxFactor;
+}
+
+double PendulumIntegrator::ToleranceProfile::proposeStep(double h, double errNorm, double exponent) const
+{
+    double hNew;
+    if (errNorm < 1e-15) {
+        hNew = h * maxFactor;
+    } else {
+        hNew = safetyFactor * h * std::pow(errNorm, exponent);
+        hNew = std::min(h * maxFactor, std::max(h * minFactor, hNew));
+    }
+    return std::min(maxStep, std::max(minStep, hNew));
+}
+
+PendulumIntegrator::ToleranceProfile PendulumIntegrator::ToleranceProfile::bounded() const
+{
+    ToleranceProfile profile = *this;
+    profile.minStep = std::max(minStep, 1.0e-15);
+    profile.maxStep = std::max(maxStep, profile.minStep);
+    return profile;
+}
+
+void PendulumIntegrator::setToleranceProfile(const ToleranceProfile& profile)
+{
+    m_profile = profile.bounded();
+    m_nextStepSize = std::clamp(m_nextStepSize, m_profile.minStep, m_profile.maxStep);
+}
+
+void PendulumIntegrator::setMaxStepSize(double maxStep)
+{
+    ToleranceProfile profile = m_profile;
+    profile.maxStep = maxStep;
+    setToleranceProfile(profile);
+}
+
+void PendulumIntegrator::reset(const PendulumState& state, double time)
+{
+    m_state = state;
+    m_time = time;
+    m_nextStepSize = std::clamp(INITIAL_STEP, m_profile.minStep, m_profile.maxStep);
+    m_lastStepSize = 0.0;
+    m_failed = false;
+    m_fsalReady = false;
+    m_denseValid = false;
+    m_densePending = false;
+    m_retryStepSize = 0.0;
+}
+
+void PendulumIntegrator::setState(const PendulumState& state)
+{
+    m_state = state;
+    m_fsalReady = false;
+    m_denseValid = false; // The last step no longer ends at the current state
+    m_densePending = false;
+    m_retryStepSize = 0.0;
+}
+
+PendulumIntegrator::StepResult PendulumIntegrator::tryStep(double maxStep)
+{
+    if (m_failed) {
+        return StepResult::Failed;
+    }
+    if (usesFixedStep()) {
+        return tryCollocationStep(maxStep);
+    }
+
+    const double h = std::min(m_nextStepSize, maxStep);
+    double hNext = h;
+    PendulumState yNext;
+    bool accepted = false;
+    performAdaptiveStep(hNext, yNext, accepted);
+
+    if (!accepted) {
+        m_nextStepSize = hNext;
+        ++m_rejectedSteps;
+        if (h <= m_profile.minStep) {
+            m_failed = true; // Even the smallest allowed step does not meet the tolerance
+            return StepResult::Failed;
+        }
+        return StepResult::Rejected;
+    }
+
+    for (double val : yNext) {
+        if (std::isnan(val) || std::isinf(val)) {
+            m_failed = true;
+            return StepResult::Failed;
+        }
+    }
+
+    m_state = yNext;
+    m_time += h;
+    m_lastStepSize = h;
+    m_denseValid = true;
+    ++m_acceptedSteps;
+    // A step clipped by maxStep says nothing about the step the controller would like next
+    if (h == m_nextStepSize || hNext < m_nextStepSize) {
+        m_nextStepSize = hNext;
+    }
+    return StepResult::Accepted;
+}
+
+void PendulumIntegrator::performAdaptiveStep(double& hInOut, PendulumState& yNext, bool& stepAccepted)
+{
+    if (activeMethod() == Method::DormandPrince853) {
+        switch (m_compiled.friction) {
+        case FrictionModel::None:
+            performOneDop853Step<FrictionModel::None>(m_state, hInOut, yNext, stepAccepted);
+            return;
+        case FrictionModel::Linear:
+            performOneDop853Step<FrictionModel::Linear>(m_state, hInOut, yNext, stepAccepted);
+            return;
+        case FrictionModel::Full:
+            performOneDop853Step<FrictionModel::Full>(m_state, hInOut, yNext, stepAccepted);
+            return;
+        }
+    }
+    switch (m_compiled.friction) {
+    case FrictionModel::None:
+        performOneDormandPrinceStep<FrictionModel::None>(m_state, hInOut, yNext, stepAccepted);
+        return;
+    case FrictionModel::Linear:
+        performOneDormandPrinceStep<FrictionModel::Linear>(m_state, hInOut, yNext, stepAccepted);
+        return;
+    case FrictionModel::Full:
+        performOneDormandPrinceStep<FrictionModel::Full>(m_state, hInOut, yNext, stepAccepted);
+        return;
+    }
+}
+
+PendulumIntegrator::StepResult PendulumIntegrator::tryCollocationStep(double maxStep)
+{
+    const double h = std::min(m_retryStepSize > 0.0 ? m_retryStepSize : m_fixedStepSize, maxStep);
+    const Method method = activeMethod();
+    const CanonicalState z0 = toCanonical(m_compiled, m_state);
+    CanonicalState z1{};
+    bool converged = false;
+    switch (m_compiled.friction) {
+    case FrictionModel::None:
+        converged = collocationStep<FrictionModel::None>(method, m_compiled, z0, h, z1, m_rhsEvaluations);
+        break;
+    case FrictionModel::Linear:
+        converged = collocationStep<FrictionModel::Linear>(method, m_compiled, z0, h, z1, m_rhsEvaluations);
+        break;
+    case FrictionModel::Full:
+        converged = collocationStep<FrictionModel::Full>(method, m_compiled, z0, h, z1, m_rhsEvaluations);
+        break;
+    default:
+        break; // Not a friction model: z1 stays zero and the step is not converged
+    }
+
+    const PendulumState yNext = fromCanonical(m_compiled, z1);
+    bool finite = true;
+    for (double val : yNext) {
+        finite = finite && std::isfinite(val);
+    }
+    if (!converged || !finite) {
+        if (h <= DOPRI_HMIN) {
+            m_failed = true;
+            return StepResult::Failed;
+        }
+        // The stage iteration does not contract at this step size: retry this step
+        // at half of it, leaving the configured step size alone
+        m_retryStepSize = std::max(DOPRI_HMIN, h / 2.0);
+        ++m_rejectedSteps;
+        ++m_collocationRetries;
+        return StepResult::Rejected;
+    }
+
+    const PendulumState f0 = m_fsalReady ? m_fsalK : derivatives(m_compiled, m_state);
+    const PendulumState f1 = derivatives(m_compiled, yNext);
+    m_rhsEvaluations += m_fsalReady ? 1 : 2;
+    setHermiteDenseOutput(m_state, f0, yNext, f1, h);
+
+    m_state = yNext;
+    m_time += h;
+    m_lastStepSize = h;
+    m_denseValid = true;
+    ++m_acceptedSteps;
+    m_retryStepSize = 0.0;
+    m_fsalK = f1;
+    m_fsalReady = true;
+    return StepResult::Accepted;
+}
+
+void PendulumIntegrator::setHermiteDenseOutput(const PendulumState& y0, const PendulumState& f0,
+                                               const PendulumState& y1, const PendulumState& f1, double h)
+{
+    // The DP5 dense-output form with the fifth coefficient zero is the cubic Hermite interpolant
+    for (int j = 0; j < 4; ++j) {
+        const double yDiff = y1[j] - y0[j];
+        const double bSpl = h * f0[j] - yDiff;
+        m_dense[0][j] = y0[j];
+        m_dense[1][j] = yDiff;
+        m_dense[2][j] = bSpl;
+        m_dense[3][j] = yDiff - h * f1[j] - bSpl;
+    }
+    m_densePending = false;
+    for (std::size_t row = 4; row < m_dense.size(); ++row) {
+        m_dense[row].fill(0.0);
+    }
+}
+
+PendulumState PendulumIntegrator::interpolate(double t) const
+{
+    if (!m_denseValid || m_lastStepSize <= 0.0) {
+        return m_state;
+    }
+    if (m_densePending) {
+        completeDop853DenseOutput();
+    }
+    // theta = 0 is the start of the last step, theta = 1 its end (the current state)
+    const double theta = std::clamp((t - denseStartTime()) / m_lastStepSize, 0.0, 1.0);
+    const double theta1 = 1.0 - theta;
+    PendulumState y;
+    for (int j = 0; j < 4; ++j) {
+        const double high = m_dense[5][j] + theta1 * (m_dense[6][j] + theta * m_dense[7][j]);
+        y[j] = m_dense[0][j] + theta * (m_dense[1][j] + theta1 * (m_dense[2][j] + theta * (m_dense[3][j] + theta1 * (m_dense[4][j] + theta * high))));
+    }
+    return y;
+}
+
+/*
+ * @brief Calculates the derivatives of the state vector.
+ *
+ * This function implements the core physics of the double pendulum. It solves
+ * the system of linear equations A * x_ddot = B to find the angular
+ * accelerations, where:
+ *
+ * x = [theta1_abs]
+ *     [theta2_abs]
+ *
+ * x_ddot = [theta1_abs_ddot] -> angular acceleration of the first pendulum
+ *          [theta2_abs_ddot] -> angular acceleration of the second pendulum
+ *
+ * A = [[ A11, A12 ],  // The mass matrix, dependent on the current state.
+ *      [ A21, A22 ]]
+ *
+ * B = [[ B1 ],        // Vector of forces (gravity, centrifugal, Coriolis, friction).
+ *      [ B2 ]]
+ *
+ * The function returns the state derivative vector dy/dt:
+ * {omega1_abs, theta1_abs_ddot, omega2_rel, theta2_rel_ddot}
+ *
+ * The parameter-only parts of A and B come precompiled, and each friction
+ * model has its own kernel, so the conservative case never evaluates the
+ * friction terms. The integrator picks the kernel once per step.
+ */
+PendulumState PendulumIntegrator::derivatives(const PendulumParameters& p, const PendulumState& y)
+{
+    return derivatives(CompiledParameters::compile(p), y);
+}
+
+PendulumState PendulumIntegrator::derivatives(const CompiledParameters& c, const PendulumState& y)
+{
+    switch (c.friction) {
+    case FrictionModel::None:
+        return derivativesKernel<FrictionModel::None>(c, y);
+    case FrictionModel::Linear:
+        return derivativesKernel<FrictionModel::Linear>(c, y);
+    case FrictionModel::Full:
+        break;
+    }
+    return derivativesKernel<FrictionModel::Full>(c, y);
+}
+
+PendulumEnergies PendulumIntegrator::energies(const PendulumParameters& p, const PendulumState& state)
+{
+    double theta1_abs = state[0];
+    double omega1_abs = state[1];
+    double theta2_rel = state[2];
+    double omega2_rel = state[3];
+
+    double theta2_abs = theta1_abs + theta2_rel;
+    double omega2_abs = omega1_abs + omega2_rel;
+
+    PendulumEnergies result;
+
+    // Kinetic Energy T = T1 + T2
+    double T1 = 0.5 * (p.m1 + p.rodMass1 / 3.0) * p.l1 * p.l1 * omega1_abs * omega1_abs;
+    double T2 = 0.5 * (p.m2 + p.rodMass2) * p.l1 * p.l1 * omega1_abs * omega1_abs +
+                0.5 * (p.m2 + p.rodMass2 / 3.0) * p.l2 * p.l2 * omega2_abs * omega2_abs +
+                (p.m2 + p.rodMass2 / 2.0) * p.l1 * p.l2 * omega1_abs * omega2_abs * cos(theta2_rel);
+    result.kinetic = T1 + T2;
+
+    // Potential Energy V = V1 + V2 (relative to suspension point y=0)
+    double V1 = (p.m1 + p.rodMass1 / 2.0 + p.m2 + p.rodMass2) * p.g * p.l1 * cos(theta1_abs);
+    double V2 = (p.m2 + p.rodMass2 / 2.0) * p.g * p.l2 * cos(theta2_abs);
+    result.potential = -(V1 + V2); // Negative because y is downwards from origin
+
+    result.total = result.kinetic + result.potential;
+    return result;
+}
+
+template <FrictionModel F>
+void PendulumIntegrator::performOneDormandPrinceStep(
+    const PendulumState& yCurrent,
+    double& hInOut,
+    PendulumState& yNext,
+    bool& stepAccepted
+) {
+    constexpr int N = 4;
+    const CompiledParameters& c = m_compiled;
+    const double h = hInOut; // hInOut is overwritten with the next proposal below
+
+    // All stage buffers live on the stack: no heap traffic per attempt
+    std::array<PendulumState, 7> k;
+    PendulumState y_stage;
+
+    k[0] = m_fsalReady ? m_fsalK : derivativesKernel<F>(c, yCurrent);
+    m_rhsEvaluations += m_fsalReady ? 6 : 7;
+
+    for(int j=0; j<N; ++j) y_stage[j] = yCurrent[j] + hInOut * (DP5::A21*k[0][j]);
+    k[1] = derivativesKernel<F>(c, y_stage);
+
+    for(int j=0; j<N; ++j) y_stage[j] = yCurrent[j] + hInOut * (DP5::A31*k[0][j] + DP5::A32*k[1][j]);
+    k[2] = derivativesKernel<F>(c, y_stage);
+
+    for(int j=0; j<N; ++j) y_stage[j] = yCurrent[j] + hInOut * (DP5::A41*k[0][j] + DP5::A42*k[1][j] + DP5::A43*k[2][j]);
+    k[3] = derivativesKernel<F>(c, y_stage);
+
+    for(int j=0; j<N; ++j) y_stage[j] = yCurrent[j] + hInOut * (DP5::A51*k[0][j] + DP5::A52*k[1][j] + DP5::A53*k[2][j] + DP5::A54*k[3][j]);
+    k[4] = derivativesKernel<F>(c, y_stage);
+
+    for(int j=0; j<N; ++j) y_stage[j] = yCurrent[j] + hInOut * (DP5::A61*k[0][j] + DP5::A62*k[1][j] + DP5::A63*k[2][j] + DP5::A64*k[3][j] + DP5::A65*k[4][j]);
+    k[5] = derivativesKernel<F>(c, y_stage);
+
+    for(int j=0; j<N; ++j) y_stage[j] = yCurrent[j] + hInOut * (DP5::A71*k[0][j] + DP5::A73*k[2][j] + DP5::A74*k[3][j] + DP5::A75*k[4][j] + DP5::A76*k[5][j]);
+    k[6] = derivativesKernel<F>(c, y_stage);
+
+    PendulumState ySol5;
+    for (int j = 0; j < N; ++j) {
+        ySol5[j] = yCurrent[j] + hInOut * (DP5::B1*k[0][j] + DP5::B2*k[1][j] + DP5::B3*k[2][j] + DP5::B4*k[3][j] + DP5::B5*k[4][j] + DP5::B6*k[5][j] + DP5::B7*k[6][j]);
+    }
+
+    double errNormSquare = 0.0;
+    for (int j=0; j<N; ++j) {
+        double error = hInOut * (DP5::E1*k[0][j] + DP5::E2*k[1][j] + DP5::E3*k[2][j] + DP5::E4*k[3][j] + DP5::E5*k[4][j] + DP5::E6*k[5][j] + DP5::E7*k[6][j]);
+        double scale = m_profile.absoluteTolerance + m_profile.relativeTolerance * std::max(std::abs(yCurrent[j]), std::abs(ySol5[j]));
+        errNormSquare += (error*error) / (scale*scale);
+    }
+    double errNorm = std::sqrt(errNormSquare / N);
+
+    stepAccepted = (errNorm <= 1.0);
+    hInOut = m_profile.proposeStep(hInOut, errNorm, -0.2);
+
+    if (stepAccepted) {
+        yNext = ySol5;
+        // The 7th stage was evaluated at (t + h, ySol5): reuse it as the next first stage
+        m_fsalK = k[6];
+        m_fsalReady = true;
+
+        // Continuous extension: reuses the stages of this step, no extra evaluations
+        for (int j = 0; j < N; ++j) {
+            const double yDiff = ySol5[j] - yCurrent[j];
+            const double bSpl = h * k[0][j] - yDiff;
+            m_dense[0][j] = yCurrent[j];
+            m_dense[1][j] = yDiff;
+            m_dense[2][j] = bSpl;
+            m_dense[3][j] = yDiff - h * k[6][j] - bSpl;
+            m_dense[4][j] = h * (DP5::D1*k[0][j] + DP5::D3*k[2][j] + DP5::D4*k[3][j] + DP5::D5*k[4][j] + DP5::D6*k[5][j] + DP5::D7*k[6][j]);
+        }
+        for (std::size_t row = 5; row < m_dense.size(); ++row) {
+            m_dense[row].fill(0.0);
+        }
+        m_densePending = false;
+    } else {
+        // k[0] is still the derivative at yCurrent, which remains the starting point
+        m_fsalK = k[0];
+        m_fsalReady = true;
+    }
+}
+
+/*
+ * @brief One attempt of Dormand-Prince 8(5,3).
+ *
+ * Twelve stages give the 8th-order solution; the error is estimated from
+ * the embedded 5th- and 3rd-order solutions combined as in Hairer's DOP853,
+ * which keeps the estimate reliable at large steps. The derivative at the
+ * new state is evaluated only for accepted steps and reused as the next
+ * first stage. The stages are kept for the dense output, which needs three
+ * more evaluations and is only completed if interpolate() is called.
+ */
+template <FrictionModel F>
+void PendulumIntegrator::performOneDop853Step(const PendulumState& yCurrent, double& hInOut,
+                                              PendulumState& yNext, bool& stepAccepted)
+{
+    constexpr int N = 4;
+    const CompiledParameters& c = m_compiled;
+    const double h = hInOut;
+    // Local until accepted: a rejected attempt must not clobber the stages the
+    // previous step's pending dense output still needs
+    std::array<PendulumState, DOP853_STAGES + 1> k;
+
+    k[0] = m_fsalReady ? m_fsalK : derivativesKernel<F>(c, yCurrent);
+    m_rhsEvaluations += m_fsalReady ? DOP853_STAGES - 1 : DOP853_STAGES;
+
+    PendulumState yStage;
+    for (int stage = 1; stage <= DOP853_STAGES; ++stage) {
+        const double* a = DOP853_A[stage];
+        for (int j = 0; j < N; ++j) {
+            double sum = 0.0;
+            for (int i = 0; i < stage; ++i) {
+                sum += a[i] * k[i][j];
+            }
+            yStage[j] = yCurrent[j] + h * sum;
+        }
+        if (stage == DOP853_STAGES) {
+            break; // Row 12 holds the weights: yStage is the 8th-order solution
+        }
+        k[stage] = derivativesKernel<F>(c, yStage);
+    }
+    const PendulumState& ySol8 = yStage;
+
+    double err5Square = 0.0;
+    double err3Square = 0.0;
+    for (int j = 0; j < N; ++j) {
+        double err5 = 0.0;
+        double err3 = 0.0;
+        for (int i = 0; i < DOP853_STAGES; ++i) {
+            err5 += DOP853_E5[i] * k[i][j];
+            err3 += DOP853_A[DOP853_STAGES][i] * k[i][j];
+        }
+        err3 -= DOP853_BHH[0] * k[0][j] + DOP853_BHH[1] * k[8][j] + DOP853_BHH[2] * k[11][j];
+        const double scale = m_profile.absoluteTolerance
+                             + m_profile.relativeTolerance * std::max(std::abs(yCurrent[j]), std::abs(ySol8[j]));
+        err5Square += (err5 / scale) * (err5 / scale);
+        err3Square += (err3 / scale) * (err3 / scale);
+    }
+    const double denominator = err5Square + 0.01 * err3Square;
+    const double errNorm = denominator > 0.0 ? std::abs(h) * err5Square / std::sqrt(denominator * N) : 0.0;
+
+    stepAccepted = (errNorm <= 1.0);
+    hInOut = m_profile.proposeStep(h, errNorm, -1.0 / 8.0);
+
+    if (!stepAccepted) {
+        // k[0] is still the derivative at yCurrent, which remains the starting point
+        m_fsalK = k[0];
+        m_fsalReady = true;
+        return;
+    }
+
+    yNext = ySol8;
+    k[DOP853_STAGES] = derivativesKernel<F>(c, ySol8);
+    ++m_rhsEvaluations;
+    m_fsalK = k[DOP853_STAGES];
+    m_fsalReady = true;
+    std::copy(k.begin(), k.end(), m_dop853Stages.begin());
+
+    // The low rows of the interpolant need only the end points; d4..d7 wait for interpolate()
+    for (int j = 0; j < N; ++j) {
+        const double yDiff = ySol8[j] - yCurrent[j];
+        m_dense[0][j] = yCurrent[j];
+        m_dense[1][j] = yDiff;
+        m_dense[2][j] = h * k[0][j] - yDiff;
+        m_dense[3][j] = 2.0 * yDiff - h * (k[DOP853_STAGES][j] + k[0][j]);
+    }
+    m_densePending = true;
+}
+
+void PendulumIntegrator::completeDop853DenseOutput() const
+{
+    constexpr int N = 4;
+    std::array<PendulumState, 16>& k = m_dop853Stages;
+    const PendulumState& y0 = m_dense[0];
+    const double h = m_lastStepSize;
+
+    for (int stage = DOP853_STAGES + 1; stage < 16; ++stage) {
+        PendulumState yStage;
+        for (int j = 0; j < N; ++j) {
+            double sum = 0.0;
+            for (int i = 0; i < stage; ++i) {
+                sum += DOP853_A[stage][i] * k[i][j];
+            }
+            yStage[j] = y0[j] + h * sum;
+        }
+        k[stage] = derivatives(m_compiled, yStage);
+    }
+    m_rhsEvaluations += 16 - (DOP853_STAGES + 1);
+
+    for (int row = 0; row < 4; ++row) {
+        for (int j = 0; j < N; ++j) {
+            double sum = 0.0;
+            for (int i = 0; i < 16; ++i) {
+                sum += DOP853_D[row][i] * k[i][j];
+            }
+            m_dense[4 + row][j] = h * sum;
+        }
+    }
+    m_densePending = false;
+}
@@ -0,0 +1,210 @@
+#include "core/PhaseDensity.h"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+namespace {
+
+// Share of the first samples' extent added on each side when the grid is fixed
+constexpr double GRID_MARGIN = 0.15;
+
+// Grid extent for one axis from the held-back samples
+void fitAxis(double lo, double hi, std::size_t cells, double& origin, double& cellSize)
+{
+    const double minSpan = std::max(1e-9, 1e-6 * std::max(std::abs(lo), std::abs(hi)));
+    const double span = std::max((hi - lo) * (1.0 + 2.0 * GRID_MARGIN), minSpan);
+    origin = 0.5 * (lo + hi) - 0.5 * span;
+    cellSize = span / static_cast<double>(cells);
+}
+
+} // namespace
+
+void PhaseDensity::reset(std::size_t width, std::size_t height)
+{
+    m_width = std::max<std::size_t>(2, width + (width & 1));
+    m_height = std::max<std::size_t>(2, height + (height & 1));
+    m_counts.assign(m_width * m_height, 0);
+    m_maxCount = 0;
+    m_samples = 0;
+    m_hasGrid = false;
+    m_xGrown = false;
+    m_yGrown = false;
+    m_pending.clear();
+    m_hasLast = false;
+}
+
+void PhaseDensity::add(double x, double y)
+{
+    if (!std::isfinite(x) || !std::isfinite(y)) {
+        breakStroke();
+        return;
+    }
+    if (m_samples == 0) {
+        m_dataXMin = m_dataXMax = x;
+        m_dataYMin = m_dataYMax = y;
+    } else {
+        m_dataXMin = std::min(m_dataXMin, x);
+        m_dataXMax = std::max(m_dataXMax, x);
+        m_dataYMin = std::min(m_dataYMin, y);
+        m_dataYMax = std::max(m_dataYMax, y);
+    }
+    ++m_samples;
+
+    if (m_hasGrid) {
+        bin(x, y);
+        return;
+    }
+    if (!m_hasLast && !m_pending.empty()) {
+        // A stroke break among the held-back samples
+        m_pending.push_back(std::numeric_limits<double>::quiet_NaN());
+        m_pending.push_back(std::numeric_limits<double>::quiet_NaN());
+    }
+    m_pending.push_back(x);
+    m_pending.push_back(y);
+    m_hasLast = true;
+    if (m_pending.size() >= 2 * PENDING_SAMPLES) {
+        settle();
+    }
+}
+
+void PhaseDensity::settle()
+{
+    if (m_hasGrid || m_samples == 0) {
+        return;
+    }
+    fitAxis(m_dataXMin, m_dataXMax, m_width, m_xMin, m_cellWidth);
+    fitAxis(m_dataYMin, m_dataYMax, m_height, m_yMin, m_cellHeight);
+    m_hasGrid = true;
+
+    m_hasLast = false;
+    for (std::size_t i = 0; i < m_pending.size(); i += 2) {
+        if (std::isnan(m_pending[i])) {
+            m_hasLast = false;
+        } else {
+            bin(m_pending[i], m_pending[i + 1]);
+        }
+    }
+    m_pending.clear();
+    m_pending.shrink_to_fit();
+}
+
+void PhaseDensity::fitTo(double xMin, double xMax, double yMin, double yMax)
+{
+    if (m_hasGrid || m_samples > 0) {
+        return;
+    }
+    fitAxis(xMin, xMax, m_width, m_xMin, m_cellWidth);
+    fitAxis(yMin, yMax, m_height, m_yMin, m_cellHeight);
+    m_hasGrid = true;
+}
+
+bool PhaseDensity::sparse() const
+{
+    return (m_xGrown && 2.0 * (m_dataXMax - m_dataXMin) < xMax() - m_xMin) ||
+           (m_yGrown && 2.0 * (m_dataYMax - m_dataYMin) < yMax() - m_yMin);
+}
+
+long long PhaseDensity::colOf(double x) const
+{
+    const double c = std::floor((x - m_xMin) / m_cellWidth);
+    if (c < 0.0) return -1;
+    return c >= static_cast<double>(m_width) ? static_cast<long long>(m_width) : static_cast<long long>(c);
+}
+
+long long PhaseDensity::rowOf(double y) const
+{
+    const double r = std::floor((y - m_yMin) / m_cellHeight);
+    if (r < 0.0) return -1;
+    return r >= static_cast<double>(m_height) ? static_cast<long long>(m_height) : static_cast<long long>(r);
+}
+
+void PhaseDensity::increment(std::size_t col, std::size_t row)
+{
+    std::uint32_t& cell = m_counts[row * m_width + col];
+    if (cell != std::numeric_limits<std::uint32_t>::max()) {
+        ++cell;
+    }
+    m_maxCount = std::max(m_maxCount, cell);
+}
+
+void PhaseDensity::grow(double x, double y)
+{
+    std::vector<std::uint32_t> merged;
+    auto mergeInto = [&](bool alongX, std::size_t shift) {
+        merged.assign(m_counts.size(), 0);
+        m_maxCount = 0;
+        for (std::size_t row = 0; row < m_height; ++row) {
+            for (std::size_t col = 0; col < m_width; ++col) {
+                const std::size_t c = alongX ? col / 2 + shift : col;
+                const std::size_t r = alongX ? row : row / 2 + shift;
+                std::uint32_t& target = merged[r * m_width + c];
+                const std::uint64_t sum = std::uint64_t(target) + m_counts[row * m_width + col];
+                target = static_cast<std::uint32_t>(std::min<std::uint64_t>(sum, std::numeric_limits<std::uint32_t>::max()));
+                m_maxCount = std::max(m_maxCount, target);
+            }
+        }
+        m_counts.swap(merged);
+    };
+
+    // Each pass doubles one axis. The old grid lands on whole cells of the new
+    // one, shifted so that the samples so far are centred: growth in either
+    // direction then has room, and the data keeps about half of each axis.
+    auto centredShift = [](double origin, double cellSize, std::size_t cells, double lo, double hi) {
+        const double shift = std::round((origin - 0.5 * (lo + hi)) / (2.0 * cellSize) + 0.5 * static_cast<double>(cells));
+        return static_cast<std::size_t>(std::clamp(shift, 0.0, static_cast<double>(cells / 2)));
+    };
+    for (long long col = colOf(x); col < 0 || col >= static_cast<long long>(m_width); col = colOf(x)) {
+        const std::size_t shift = centredShift(m_xMin, m_cellWidth, m_width, m_dataXMin, m_dataXMax);
+        mergeInto(true, shift);
+        m_xMin -= 2.0 * m_cellWidth * static_cast<double>(shift);
+        m_cellWidth *= 2.0;
+        m_xGrown = true;
+        m_lastCol = m_lastCol / 2 + static_cast<long long>(shift);
+    }
+    for (long long row = rowOf(y); row < 0 || row >= static_cast<long long>(m_height); row = rowOf(y)) {
+        const std::size_t shift = centredShift(m_yMin, m_cellHeight, m_height, m_dataYMin, m_dataYMax);
+        mergeInto(false, shift);
+        m_yMin -= 2.0 * m_cellHeight * static_cast<double>(shift);
+        m_cellHeight *= 2.0;
+        m_yGrown = true;
+        m_lastRow = m_lastRow / 2 + static_cast<long long>(shift);
+    }
+}
+
+void PhaseDensity::bin(double x, double y)
+{
+    long long col = colOf(x);
+    long long row = rowOf(y);
+    if (col < 0 || row < 0 || col >= static_cast<long long>(m_width) || row >= static_cast<long long>(m_height)) {
+        grow(x, y);
+        col = colOf(x);
+        row = rowOf(y);
+    }
+    if (!m_hasLast || (col == m_lastCol && row == m_lastRow)) {
+        increment(static_cast<std::size_t>(col), static_cast<std::size_t>(row));
+    } else {
+        // Cells from the previous sample to this one, the previous cell excluded (Bresenham)
+        long long c = m_lastCol;
+        long long r = m_lastRow;
+        const long long dc = std::llabs(col - c);
+        const long long dr = -std::llabs(row - r);
+        const long long stepC = c < col ? 1 : -1;
+        const long long stepR = r < row ? 1 : -1;
+        long long error = dc + dr;
+        while (c != col || r != row) {
+            const long long twice = 2 * error;
+            if (twice >= dr) {
+                error += dr;
+                c += stepC;
+            }
+            if (twice <= dc) {
+                error += dc;
+                r += stepR;
+            }
+            increment(static_cast<std::size_t>(c), static_cast<std::size_t>(r));
+        }
+    }
+    m_lastCol = col;
+    m_lastRow = row;
+    m_hasLast = true;
+}
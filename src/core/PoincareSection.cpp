@@ -0,0 +1,139 @@
+#include "core/PoincareSection.h"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+namespace {
+
+constexpr int MAX_REFINE_ITERATIONS = 60;
+
+double wrapAngle(double angle)
+{
+    return std::remainder(angle, 2.0 * M_PI);
+}
+
+double sectionAngle(PoincareSection::Kind kind, const PendulumState& y)
+{
+    return kind == PoincareSection::Kind::Theta1 ? y[0] : y[0] + y[2];
+}
+
+} // namespace
+
+double PoincareSection::value(const PendulumParameters& p, const PendulumState& y) const
+{
+    switch (kind) {
+    case Kind::Theta1:
+    case Kind::Theta2:
+        return std::sin(sectionAngle(kind, y) - level);
+    case Kind::Omega1:
+        return y[1] - level;
+    case Kind::Energy:
+        return PendulumIntegrator::energies(p, y).total - level;
+    }
+    return 0.0;
+}
+
+bool PoincareSection::admissible(const PendulumState& y) const
+{
+    if (kind == Kind::Theta1 || kind == Kind::Theta2) {
+        return std::cos(sectionAngle(kind, y) - level) > 0.0;
+    }
+    return true;
+}
+
+std::array<double, 2> PoincareSection::mapCoordinates(const PendulumState& y) const
+{
+    if (kind == Kind::Theta2) {
+        return {wrapAngle(y[0]), y[1]};
+    }
+    return {wrapAngle(y[2]), y[3]};
+}
+
+PoincareEventLocator::PoincareEventLocator(const PoincareSection& section)
+    : m_section(section)
+{
+}
+
+bool PoincareEventLocator::crosses(double gA, double gB) const
+{
+    switch (m_section.direction) {
+    case PoincareSection::Direction::Increasing:
+        return gA < 0.0 && gB >= 0.0;
+    case PoincareSection::Direction::Decreasing:
+        return gA > 0.0 && gB <= 0.0;
+    case PoincareSection::Direction::Both:
+        return (gA < 0.0 && gB >= 0.0) || (gA > 0.0 && gB <= 0.0);
+    }
+    return false;
+}
+
+std::size_t PoincareEventLocator::locate(const PendulumIntegrator& integrator, Crossings& crossings) const
+{
+    if (!integrator.hasDenseOutput()) {
+        return 0;
+    }
+    const PendulumParameters& p = integrator.parameters();
+    const double t0 = integrator.denseStartTime();
+    const double h = integrator.lastStepSize();
+
+    std::size_t count = 0;
+    double tA = t0;
+    double gA = m_section.value(p, integrator.interpolate(tA));
+    for (std::size_t i = 1; i <= SUBDIVISIONS; ++i) {
+        // The last point is the step's end state itself, not an interpolation
+        const double tB = i == SUBDIVISIONS ? integrator.time() : t0 + h * static_cast<double>(i) / SUBDIVISIONS;
+        const double gB = m_section.value(p, i == SUBDIVISIONS ? integrator.state() : integrator.interpolate(tB));
+        if (crosses(gA, gB)) {
+            const double t = refine(integrator, tA, gA, tB, gB);
+            const PendulumState state = integrator.interpolate(t);
+            if (m_section.admissible(state)) {
+                crossings[count++] = PoincareCrossing{t, state};
+            }
+        }
+        tA = tB;
+        gA = gB;
+    }
+    return count;
+}
+
+/*
+ * @brief Root of the section function on the bracket [tA, tB].
+ *
+ * Illinois regula falsi: the secant through the bracket ends, halving the
+ * retained end's value whenever the same end survives twice in a row, which
+ * keeps the convergence superlinear without the derivative of g.
+ */
+double PoincareEventLocator::refine(const PendulumIntegrator& integrator,
+                                    double tA, double gA, double tB, double gB) const
+{
+    if (gB == 0.0) {
+        return tB;
+    }
+    const PendulumParameters& p = integrator.parameters();
+    const double tolerance = 4.0 * std::numeric_limits<double>::epsilon() * std::max(1.0, std::abs(tB));
+    int side = 0;
+    double t = tB;
+    for (int iteration = 0; iteration < MAX_REFINE_ITERATIONS && tB - tA > tolerance; ++iteration) {
+        t = (tA * gB - tB * gA) / (gB - gA);
+        const double g = m_section.value(p, integrator.interpolate(t));
+        if (g == 0.0) {
+            return t;
+        }
+        if ((g < 0.0) == (gA < 0.0)) {
+            tA = t;
+            gA = g;
+            if (side == -1) {
+                gB *= 0.5;
+            }
+            side = -1;
+        } else {
+            tB = t;
+            gB = g;
+            if (side == 1) {
+                gA *= 0.5;
+            }
+            side = 1;
+        }
+    }
+    return t;
+}
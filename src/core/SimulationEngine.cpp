@@ -0,0 +1,474 @@
+#include "core/SimulationEngine.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+
+namespace {
+using Clock = std::chrono::steady_clock;
+}
+
+SimulationEngine::SimulationEngine(const PendulumParameters& parameters,
+                                   const PendulumState& state,
+                                   QObject* parent)
+    : QObject(parent)
+    , m_integrator(parameters, state)
+{
+    restartStepBoundaries();
+    publishSnapshot();
+}
+
+SimulationEngine::~SimulationEngine()
+{
+    stop();
+}
+
+void SimulationEngine::start()
+{
+    if (m_thread) {
+        return;
+    }
+    m_stopRequested.store(false, std::memory_order_release);
+    m_thread = QThread::create([this]() { run(); });
+    m_thread->setObjectName(QStringLiteral("SimulationEngine"));
+    m_thread->start();
+}
+
+void SimulationEngine::stop()
+{
+    if (!m_thread) {
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> lock(m_commandMutex);
+        m_stopRequested.store(true, std::memory_order_release);
+    }
+    m_wakeCondition.notify_one();
+    m_thread->wait();
+    delete m_thread;
+    m_thread = nullptr;
+}
+
+void SimulationEngine::setRunning(bool running)
+{
+    {
+        std::lock_guard<std::mutex> lock(m_commandMutex);
+        m_running.store(running, std::memory_order_relaxed);
+        m_hasPending.store(true, std::memory_order_release);
+    }
+    wake();
+}
+
+void SimulationEngine::setHeld(bool held)
+{
+    {
+        std::lock_guard<std::mutex> lock(m_commandMutex);
+        m_held.store(held, std::memory_order_relaxed);
+        m_hasPending.store(true, std::memory_order_release);
+    }
+    wake();
+}
+
+void SimulationEngine::setSimulationSpeed(double speed)
+{
+    m_speed.store(speed, std::memory_order_relaxed);
+}
+
+void SimulationEngine::setFixedTimestep(double seconds)
+{
+    if (!(seconds > 0.0)) {
+        seconds = 0.0;
+    }
+    // The worker finishes the step in progress and uses the new length from the next one
+    m_fixedTimestep.store(seconds, std::memory_order_relaxed);
+}
+
+void SimulationEngine::setSampleRate(double hz)
+{
+    if (!(hz > 0.0)) {
+        hz = 0.0;
+    }
+    // The worker lays out a new grid when it sees the change
+    m_sampleRate.store(std::min(hz, MAX_SAMPLE_RATE_HZ), std::memory_order_relaxed);
+}
+
+void SimulationEngine::setParameters(const PendulumParameters& parameters)
+{
+    {
+        std::lock_guard<std::mutex> lock(m_commandMutex);
+        m_pending.hasParameters = true;
+        m_pending.parameters = parameters;
+        m_hasPending.store(true, std::memory_order_release);
+    }
+    wake();
+}
+
+void SimulationEngine::reset(const PendulumState& state, double time)
+{
+    {
+        std::lock_guard<std::mutex> lock(m_commandMutex);
+        // A reset supersedes any state edit or single step queued before it
+        m_pending.hasState = false;
+        m_pending.advance = 0.0;
+        m_pending.hasReset = true;
+        m_pending.resetState = state;
+        m_pending.resetTime = time;
+        m_epoch.fetch_add(1, std::memory_order_acq_rel);
+        m_hasPending.store(true, std::memory_order_release);
+    }
+    wake();
+}
+
+void SimulationEngine::setState(const PendulumState& state)
+{
+    {
+        std::lock_guard<std::mutex> lock(m_commandMutex);
+        m_pending.hasState = true;
+        m_pending.state = state;
+        m_hasPending.store(true, std::memory_order_release);
+    }
+    wake();
+}
+
+void SimulationEngine::requestAdvance(double simulatedSeconds)
+{
+    if (simulatedSeconds <= 0.0) {
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> lock(m_commandMutex);
+        m_pending.advance += simulatedSeconds;
+        m_hasPending.store(true, std::memory_order_release);
+    }
+    wake();
+}
+
+void SimulationEngine::setPoincareSection(const PoincareSection& section)
+{
+    {
+        std::lock_guard<std::mutex> lock(m_commandMutex);
+        m_pending.hasSection = true;
+        m_pending.section = section;
+        m_pending.sectionGeneration = m_sectionGeneration.fetch_add(1, std::memory_order_acq_rel) + 1;
+        m_hasPending.store(true, std::memory_order_release);
+    }
+    wake();
+}
+
+void SimulationEngine::setIntegratorMethod(PendulumIntegrator::Method method)
+{
+    {
+        std::lock_guard<std::mutex> lock(m_commandMutex);
+        m_pending.hasMethod = true;
+        m_pending.method = method;
+        m_hasPending.store(true, std::memory_order_release);
+    }
+    wake();
+}
+
+void SimulationEngine::setToleranceProfile(const PendulumIntegrator::ToleranceProfile& profile)
+{
+    {
+        std::lock_guard<std::mutex> lock(m_commandMutex);
+        m_pending.hasProfile = true;
+        m_pending.profile = profile;
+        m_hasPending.store(true, std::memory_order_release);
+    }
+    wake();
+}
+
+void SimulationEngine::wake()
+{
+    m_wakeCondition.notify_one();
+}
+
+void SimulationEngine::run()
+{
+    const auto period = std::chrono::milliseconds(PACING_PERIOD_MS);
+    // Integration may use 80% of a tick; the rest keeps the loop on schedule
+    const auto integrationBudget = std::chrono::microseconds(PACING_PERIOD_MS * 800);
+
+    auto lastTick = Clock::now();
+    auto nextTick = lastTick + period;
+    bool wasAccruing = false;
+
+    while (!m_stopRequested.load(std::memory_order_acquire)) {
+        applyPendingCommands();
+
+        const auto now = Clock::now();
+        const double wallElapsed = std::chrono::duration<double>(now - lastTick).count();
+        lastTick = now;
+
+        const bool held = m_held.load(std::memory_order_relaxed);
+        const bool accruing = m_running.load(std::memory_order_relaxed) && !held && !m_integrator.failed();
+        if (accruing) {
+            // The first tick after (re)starting owes nothing for the idle time before it
+            if (wasAccruing) {
+                const double speed = m_speed.load(std::memory_order_relaxed);
+                m_timeDebt += wallElapsed * speed;
+                // Falling further behind than MAX_LAG_SECONDS gives the excess up for good;
+                // a fixed step longer than that is still allowed to come due
+                const double maxDebt = std::max(MAX_LAG_SECONDS * speed,
+                                                2.0 * m_fixedTimestep.load(std::memory_order_relaxed));
+                if (m_timeDebt > maxDebt) {
+                    m_droppedTime += m_timeDebt - maxDebt;
+                    m_timeDebt = maxDebt;
+                }
+            }
+        } else {
+            m_timeDebt = 0.0;
+        }
+        wasAccruing = accruing;
+
+        bool advanceCompleted = false;
+        m_deadlineHit = false;
+        if (!held) {
+            const auto deadline = now + integrationBudget;
+            if (m_timeDebt > 0.0) {
+                m_timeDebt -= advanceClock(m_timeDebt, deadline);
+            }
+            if (m_advanceDebt > 0.0) {
+                m_advanceDebt -= integrate(m_advanceDebt, deadline);
+                if (m_advanceDebt < PendulumIntegrator::DOPRI_HMIN / 2.0 || m_integrator.failed()) {
+                    m_advanceDebt = 0.0;
+                    advanceCompleted = true;
+                    // A single step is not part of the real-time step sequence
+                    restartStepBoundaries();
+                }
+            }
+        }
+        m_tickLoad = std::chrono::duration<double>(Clock::now() - now).count() / (PACING_PERIOD_MS / 1000.0);
+        if (m_deadlineHit) {
+            ++m_overrunTicks;
+        }
+
+        publishSnapshot();
+        if (advanceCompleted) {
+            emit advanceFinished();
+        }
+
+        // Sleep until the next tick; when there is nothing to integrate, sleep until a command arrives
+        std::unique_lock<std::mutex> lock(m_commandMutex);
+        auto wakeUp = [this]() {
+            return m_stopRequested.load(std::memory_order_acquire) || m_hasPending.load(std::memory_order_acquire);
+        };
+        const bool idle = !accruing && m_advanceDebt <= 0.0;
+        if (idle) {
+            m_wakeCondition.wait(lock, wakeUp);
+            lastTick = Clock::now();
+            nextTick = lastTick + period;
+        } else {
+            m_wakeCondition.wait_until(lock, nextTick, wakeUp);
+            nextTick += period;
+            const auto afterWait = Clock::now();
+            if (nextTick < afterWait) {
+                nextTick = afterWait + period; // Overran: re-anchor instead of bursting to catch up
+            }
+        }
+    }
+}
+
+void SimulationEngine::applyPendingCommands()
+{
+    if (!m_hasPending.load(std::memory_order_acquire)) {
+        return;
+    }
+
+    PendingCommands commands;
+    {
+        std::lock_guard<std::mutex> lock(m_commandMutex);
+        commands = m_pending;
+        m_pending = PendingCommands();
+        m_hasPending.store(false, std::memory_order_relaxed);
+        if (commands.hasReset) {
+            m_workerEpoch = m_epoch.load(std::memory_order_relaxed);
+        }
+    }
+
+    if (commands.hasParameters) {
+        m_integrator.setParameters(commands.parameters);
+    }
+    if (commands.hasMethod) {
+        m_integrator.setMethod(commands.method);
+    }
+    if (commands.hasProfile) {
+        m_integrator.setToleranceProfile(commands.profile);
+    }
+    if (commands.hasSection) {
+        m_locator.setSection(commands.section);
+        m_workerSection = commands.sectionGeneration;
+    }
+    if (commands.hasReset) {
+        m_integrator.reset(commands.resetState, commands.resetTime);
+        m_timeDebt = 0.0;
+        m_advanceDebt = 0.0;
+        m_droppedTime = 0.0;
+        m_overrunTicks = 0;
+        restartSampleGrid();
+        restartStepBoundaries();
+    }
+    if (commands.hasState) {
+        m_integrator.setState(commands.state);
+        restartSampleGrid();
+        restartStepBoundaries();
+    }
+    m_advanceDebt += commands.advance;
+}
+
+double SimulationEngine::advanceClock(double debt, Clock::time_point deadline)
+{
+    const double stepLength = m_fixedTimestep.load(std::memory_order_relaxed);
+    if (stepLength <= 0.0) {
+        // Free-running: every tick integrates right up to the clock and is one step
+        const double advanced = integrate(debt, deadline);
+        if (advanced > 0.0) {
+            markStepBoundary();
+        }
+        return advanced;
+    }
+
+    double advanced = 0.0;
+    while (true) {
+        if (m_stepRemaining <= 0.0) {
+            if (debt - advanced < stepLength) {
+                break; // The next step is not due yet
+            }
+            m_stepRemaining = stepLength;
+        }
+        const double done = integrate(m_stepRemaining, deadline);
+        advanced += done;
+        m_stepRemaining -= done;
+        if (m_stepRemaining >= PendulumIntegrator::DOPRI_HMIN / 2.0) {
+            break; // Cut short (deadline, full queue, failure): finish it next tick
+        }
+        m_stepRemaining = 0.0;
+        markStepBoundary();
+    }
+    return advanced;
+}
+
+double SimulationEngine::integrate(double budget, Clock::time_point deadline)
+{
+    double advanced = 0.0;
+    while (advanced < budget) {
+        const double remaining = budget - advanced;
+        if (remaining < PendulumIntegrator::DOPRI_HMIN / 2.0) {
+            break; // Leave the sliver for the next tick
+        }
+        if (m_samples.sizeApprox() + SAMPLE_QUEUE_HEADROOM >= m_samples.capacity()) {
+            break; // GUI has not drained the queue yet: wait rather than drop history
+        }
+        if (Clock::now() > deadline) {
+            m_deadlineHit = true;
+            break; // Out of time for this tick; the rest stays owed
+        }
+
+        // Fixed-step schemes always take their full step: clipping it to the tick
+        // would shrink it to the tick length. The overshoot is repaid by the next tick.
+        double maxStep = m_integrator.usesFixedStep() ? std::max(remaining, m_integrator.fixedStepSize()) : remaining;
+        const double rate = m_sampleRate.load(std::memory_order_relaxed);
+        if (rate > 0.0 && !m_integrator.usesFixedStep()) {
+            // DOP853 and loose profiles take long steps: keep each one within the queue headroom
+            maxStep = std::min(maxStep, static_cast<double>(SAMPLE_QUEUE_HEADROOM) / rate);
+        }
+        const PendulumIntegrator::StepResult result = m_integrator.tryStep(maxStep);
+        if (result == PendulumIntegrator::StepResult::Failed) {
+            break;
+        }
+        if (result == PendulumIntegrator::StepResult::Rejected) {
+            continue;
+        }
+
+        advanced += m_integrator.lastStepSize();
+        recordStep();
+        locateCrossings();
+    }
+    return advanced;
+}
+
+void SimulationEngine::markStepBoundary()
+{
+    m_previousStepTime = m_stepTime;
+    m_previousStepState = m_stepState;
+    m_stepTime = m_integrator.time();
+    m_stepState = m_integrator.state();
+}
+
+void SimulationEngine::restartStepBoundaries()
+{
+    m_stepRemaining = 0.0;
+    m_stepTime = m_previousStepTime = m_integrator.time();
+    m_stepState = m_previousStepState = m_integrator.state();
+}
+
+void SimulationEngine::recordStep()
+{
+    const double rate = m_sampleRate.load(std::memory_order_relaxed);
+    if (rate <= 0.0) {
+        pushSample(m_integrator.time(), m_integrator.state(), m_integrator.energies());
+        return;
+    }
+    if (rate != m_gridRate) {
+        // New rate: the grid continues from the start of the step just taken
+        m_gridRate = rate;
+        m_nextSampleIndex = static_cast<long long>(std::floor(m_integrator.denseStartTime() * rate)) + 1;
+    }
+
+    const PendulumParameters& parameters = m_integrator.parameters();
+    double t = static_cast<double>(m_nextSampleIndex) / m_gridRate;
+    while (t <= m_integrator.time()) {
+        const PendulumState state = m_integrator.interpolate(t);
+        pushSample(t, state, PendulumIntegrator::energies(parameters, state));
+        t = static_cast<double>(++m_nextSampleIndex) / m_gridRate;
+    }
+}
+
+void SimulationEngine::pushSample(double time, const PendulumState& state, const PendulumEnergies& energies)
+{
+    SimulationSample sample;
+    sample.time = time;
+    sample.state = state;
+    sample.energies = energies;
+    sample.epoch = m_workerEpoch;
+    m_samples.tryPush(sample);
+}
+
+void SimulationEngine::locateCrossings()
+{
+    PoincareEventLocator::Crossings crossings;
+    const std::size_t count = m_locator.locate(m_integrator, crossings);
+    for (std::size_t i = 0; i < count; ++i) {
+        SimulationCrossing crossing;
+        crossing.crossing = crossings[i];
+        crossing.epoch = m_workerEpoch;
+        crossing.section = m_workerSection;
+        m_crossings.tryPush(crossing); // A full queue drops map points, never history
+    }
+}
+
+void SimulationEngine::restartSampleGrid()
+{
+    // Lay the grid out again from the current time on the next accepted step
+    m_gridRate = 0.0;
+}
+
+void SimulationEngine::publishSnapshot()
+{
+    SimulationSnapshot snapshot;
+    snapshot.time = m_integrator.time();
+    snapshot.state = m_integrator.state();
+    snapshot.energies = m_integrator.energies();
+    snapshot.lastStepSize = m_integrator.lastStepSize();
+    snapshot.acceptedSteps = m_integrator.acceptedSteps();
+    snapshot.rejectedSteps = m_integrator.rejectedSteps();
+    snapshot.failed = m_integrator.failed();
+    snapshot.epoch = m_workerEpoch;
+    snapshot.stepTime = m_stepTime;
+    snapshot.stepState = m_stepState;
+    snapshot.previousStepTime = m_previousStepTime;
+    snapshot.previousStepState = m_previousStepState;
+    snapshot.timeDebt = m_timeDebt;
+    snapshot.droppedTime = m_droppedTime;
+    snapshot.tickLoad = m_tickLoad;
+    snapshot.overrunTicks = m_overrunTicks;
+    m_snapshot.publish(snapshot);
+}
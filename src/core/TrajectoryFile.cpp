@@ -0,0 +1,49 @@
+#include "core/TrajectoryFile.h"
+#include <cstring>
+
+TrajectoryFileHeader TrajectoryFileHeader::make(const PendulumParameters& parameters, const char* methodName, double sampleRate)
+{
+    TrajectoryFileHeader header;
+    std::memcpy(header.magic, TRAJECTORY_MAGIC, sizeof(header.magic));
+    header.m1 = parameters.m1;
+    header.m2 = parameters.m2;
+    header.rodMass1 = parameters.rodMass1;
+    header.rodMass2 = parameters.rodMass2;
+    header.l1 = parameters.l1;
+    header.l2 = parameters.l2;
+    header.b1 = parameters.b1;
+    header.b2 = parameters.b2;
+    header.c1 = parameters.c1;
+    header.c2 = parameters.c2;
+    header.g = parameters.g;
+    header.sampleRate = sampleRate;
+    if (methodName) {
+        std::strncpy(header.method, methodName, sizeof(header.method) - 1);
+    }
+    return header;
+}
+
+PendulumParameters TrajectoryFileHeader::parameters() const
+{
+    PendulumParameters p;
+    p.m1 = m1;
+    p.m2 = m2;
+    p.rodMass1 = rodMass1;
+    p.rodMass2 = rodMass2;
+    p.l1 = l1;
+    p.l2 = l2;
+    p.b1 = b1;
+    p.b2 = b2;
+    p.c1 = c1;
+    p.c2 = c2;
+    p.g = g;
+    return p;
+}
+
+bool TrajectoryFileHeader::valid() const
+{
+    return std::memcmp(magic, TRAJECTORY_MAGIC, sizeof(magic)) == 0
+        && version == TRAJECTORY_VERSION
+        && headerSize == TRAJECTORY_HEADER_SIZE
+        && frameSize == sizeof(TrajectoryFrame);
+}
@@ -0,0 +1,113 @@
+#include "core/TrajectoryRecorder.h"
+#include <utility>
+
+TrajectoryRecorder::~TrajectoryRecorder()
+{
+    close();
+}
+
+bool TrajectoryRecorder::open(const std::string& path, const TrajectoryFileHeader& header)
+{
+    close();
+    m_file = std::fopen(path.c_str(), "wb");
+    if (!m_file) {
+        return false;
+    }
+    // Blocks are already large; stdio buffering would only add a copy
+    std::setvbuf(m_file, nullptr, _IONBF, 0);
+    m_path = path;
+    m_header = header;
+    m_header.frameCount = 0;
+    m_framesAppended = 0;
+    m_bytesWritten.store(0, std::memory_order_relaxed);
+    m_failed.store(false, std::memory_order_relaxed);
+    m_stopRequested = false;
+    m_fill.clear();
+    m_fill.reserve(BLOCK_FRAMES);
+
+    if (std::fwrite(&m_header, sizeof(m_header), 1, m_file) != 1) {
+        std::fclose(m_file);
+        m_file = nullptr;
+        return false;
+    }
+    m_bytesWritten.store(sizeof(m_header), std::memory_order_relaxed);
+    m_writer = std::thread([this]() { writerLoop(); });
+    return true;
+}
+
+bool TrajectoryRecorder::close()
+{
+    if (!m_file) {
+        return true;
+    }
+    flush();
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stopRequested = true;
+    }
+    m_wake.notify_one();
+    m_writer.join();
+
+    // The writer is gone, so the file is ours again: patch the final count into the header
+    bool ok = !failed();
+    if (ok) {
+        m_header.frameCount = m_framesAppended;
+        ok = std::fseek(m_file, 0, SEEK_SET) == 0
+            && std::fwrite(&m_header, sizeof(m_header), 1, m_file) == 1;
+    }
+    ok = std::fclose(m_file) == 0 && ok;
+    m_file = nullptr;
+    m_queue.clear();
+    return ok;
+}
+
+void TrajectoryRecorder::flush()
+{
+    if (m_file && !m_fill.empty()) {
+        submitBlock();
+    }
+}
+
+void TrajectoryRecorder::submitBlock()
+{
+    Block next;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (!failed()) {
+            m_queue.push_back(std::move(m_fill));
+        }
+        if (!m_spare.empty()) {
+            next = std::move(m_spare.back());
+            m_spare.pop_back();
+        }
+    }
+    m_wake.notify_one();
+    next.clear();
+    next.reserve(BLOCK_FRAMES);
+    m_fill = std::move(next);
+}
+
+void TrajectoryRecorder::writerLoop()
+{
+    std::unique_lock<std::mutex> lock(m_mutex);
+    for (;;) {
+        m_wake.wait(lock, [this]() { return m_stopRequested || !m_queue.empty(); });
+        if (m_queue.empty()) {
+            return; // Stop requested and everything submitted is on disk
+        }
+        Block block = std::move(m_queue.front());
+        m_queue.pop_front();
+        lock.unlock();
+
+        if (!failed()) {
+            const std::size_t written = std::fwrite(block.data(), sizeof(TrajectoryFrame), block.size(), m_file);
+            m_bytesWritten.fetch_add(written * sizeof(TrajectoryFrame), std::memory_order_relaxed);
+            if (written != block.size()) {
+                m_failed.store(true, std::memory_order_relaxed);
+            }
+        }
+
+        lock.lock();
+        m_spare.push_back(std::move(block));
+    }
+}
@@ -0,0 +1,126 @@
+#include "core/TrajectoryReplay.h"
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace {
+
+void setError(std::string* error, const std::string& message)
+{
+    if (error) {
+        *error = message;
+    }
+}
+
+} // namespace
+
+TrajectoryReplay::~TrajectoryReplay()
+{
+    close();
+}
+
+bool TrajectoryReplay::open(const std::string& path, std::string* error)
+{
+    close();
+
+#ifdef _WIN32
+    HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE, nullptr,
+                              OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (file == INVALID_HANDLE_VALUE) {
+        setError(error, "cannot open " + path);
+        return false;
+    }
+    LARGE_INTEGER fileSize;
+    if (!GetFileSizeEx(file, &fileSize) || static_cast<std::uint64_t>(fileSize.QuadPart) < sizeof(TrajectoryFileHeader)) {
+        CloseHandle(file);
+        setError(error, path + " is too short for a trajectory header");
+        return false;
+    }
+    HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    void* data = mapping ? MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0) : nullptr;
+    if (!data) {
+        if (mapping) CloseHandle(mapping);
+        CloseHandle(file);
+        setError(error, "cannot map " + path);
+        return false;
+    }
+    m_fileHandle = file;
+    m_mappingHandle = mapping;
+    const std::size_t bytes = static_cast<std::size_t>(fileSize.QuadPart);
+#else
+    const int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        setError(error, "cannot open " + path + ": " + std::strerror(errno));
+        return false;
+    }
+    struct stat info;
+    if (::fstat(fd, &info) != 0 || static_cast<std::size_t>(info.st_size) < sizeof(TrajectoryFileHeader)) {
+        ::close(fd);
+        setError(error, path + " is too short for a trajectory header");
+        return false;
+    }
+    const std::size_t bytes = static_cast<std::size_t>(info.st_size);
+    void* data = ::mmap(nullptr, bytes, PROT_READ, MAP_SHARED, fd, 0);
+    ::close(fd); // The mapping keeps the file alive
+    if (data == MAP_FAILED) {
+        setError(error, "cannot map " + path + ": " + std::strerror(errno));
+        return false;
+    }
+#endif
+
+    m_data = data;
+    m_mappedBytes = bytes;
+    std::memcpy(&m_header, data, sizeof(m_header));
+    if (!m_header.valid()) {
+        close();
+        setError(error, path + " is not a trajectory recording of a supported version");
+        return false;
+    }
+    m_path = path;
+    m_frames = reinterpret_cast<const TrajectoryFrame*>(static_cast<const char*>(data) + m_header.headerSize);
+    // A trailing partial frame belongs to a write still in flight (or cut off by a crash)
+    m_frameCount = (bytes - m_header.headerSize) / sizeof(TrajectoryFrame);
+    return true;
+}
+
+void TrajectoryReplay::close()
+{
+    if (!m_data) {
+        return;
+    }
+#ifdef _WIN32
+    UnmapViewOfFile(m_data);
+    CloseHandle(static_cast<HANDLE>(m_mappingHandle));
+    CloseHandle(static_cast<HANDLE>(m_fileHandle));
+    m_mappingHandle = nullptr;
+    m_fileHandle = nullptr;
+#else
+    ::munmap(m_data, m_mappedBytes);
+#endif
+    m_data = nullptr;
+    m_mappedBytes = 0;
+    m_frames = nullptr;
+    m_frameCount = 0;
+    m_path.clear();
+    m_header = TrajectoryFileHeader();
+}
+
+std::size_t TrajectoryReplay::lowerBound(double t) const
+{
+    const TrajectoryFrame* end = m_frames + m_frameCount;
+    const TrajectoryFrame* it = std::lower_bound(m_frames, end, t,
+        [](const TrajectoryFrame& frame, double time) { return frame.time < time; });
+    return static_cast<std::size_t>(it - m_frames);
+}
@@ -0,0 +1,122 @@
+#include "core/WorkStealingScheduler.h"
+#include <algorithm>
+#include <thread>
+#include <vector>
+
+WorkStealingScheduler::WorkStealingScheduler(std::size_t threadCount)
+    : m_threadCount(threadCount)
+{
+    if (m_threadCount == 0) {
+        m_threadCount = std::max(1u, std::thread::hardware_concurrency());
+    }
+    m_ranges.reset(new WorkerRange[m_threadCount]);
+}
+
+WorkStealingScheduler::~WorkStealingScheduler() = default;
+
+void WorkStealingScheduler::parallelFor(std::size_t count, std::size_t grainSize, const RangeTask& task)
+{
+    if (count == 0) {
+        return;
+    }
+    grainSize = std::max<std::size_t>(1, grainSize);
+    m_stealCount.store(0, std::memory_order_relaxed);
+
+    // Never start more workers than there are grains of work
+    const std::size_t grains = (count + grainSize - 1) / grainSize;
+    const std::size_t workers = std::min(m_threadCount, grains);
+
+    // Even initial split; stealing fixes whatever imbalance the work itself has
+    for (std::size_t w = 0; w < m_threadCount; ++w) {
+        WorkerRange& range = m_ranges[w];
+        if (w < workers) {
+            range.begin = count * w / workers;
+            range.end = count * (w + 1) / workers;
+        } else {
+            range.begin = range.end = 0;
+        }
+    }
+
+    std::vector<std::thread> threads;
+    threads.reserve(workers - 1);
+    for (std::size_t w = 1; w < workers; ++w) {
+        threads.emplace_back([this, w, grainSize, &task]() { workerLoop(w, grainSize, task); });
+    }
+    workerLoop(0, grainSize, task);
+    for (std::thread& thread : threads) {
+        thread.join();
+    }
+}
+
+void WorkStealingScheduler::workerLoop(std::size_t self, std::size_t grainSize, const RangeTask& task)
+{
+    std::size_t first = 0;
+    std::size_t last = 0;
+    for (;;) {
+        while (takeFront(self, grainSize, first, last)) {
+            task(first, last);
+        }
+        if (!stealInto(self, grainSize)) {
+            return; // Nothing left anywhere worth stealing
+        }
+    }
+}
+
+bool WorkStealingScheduler::takeFront(std::size_t self, std::size_t grainSize, std::size_t& first, std::size_t& last)
+{
+    WorkerRange& range = m_ranges[self];
+    std::lock_guard<std::mutex> lock(range.mutex);
+    if (range.begin >= range.end) {
+        return false;
+    }
+    first = range.begin;
+    last = std::min(range.end, range.begin + grainSize);
+    range.begin = last;
+    return true;
+}
+
+bool WorkStealingScheduler::stealInto(std::size_t self, std::size_t grainSize)
+{
+    // Pick the victim with the most remaining work. Sizes can change as soon as
+    // the lock is released, so the choice is only a hint; the steal re-checks it.
+    std::size_t victim = self;
+    std::size_t largest = 0;
+    for (std::size_t offset = 1; offset < m_threadCount; ++offset) {
+        const std::size_t candidate = (self + offset) % m_threadCount;
+        WorkerRange& range = m_ranges[candidate];
+        std::lock_guard<std::mutex> lock(range.mutex);
+        const std::size_t remaining = range.end > range.begin ? range.end - range.begin : 0;
+        if (remaining > largest) {
+            largest = remaining;
+            victim = candidate;
+        }
+    }
+    // A last grain is left to its owner: moving it would only add a steal
+    if (victim == self || largest <= grainSize) {
+        return false;
+    }
+
+    std::size_t stolenBegin = 0;
+    std::size_t stolenEnd = 0;
+    {
+        WorkerRange& range = m_ranges[victim];
+        std::lock_guard<std::mutex> lock(range.mutex);
+        const std::size_t remaining = range.end > range.begin ? range.end - range.begin : 0;
+        if (remaining <= grainSize) {
+            return true; // Lost the race; look again
+        }
+        // Leave the victim at least one grain; take the back half of the rest
+        const std::size_t take = (remaining - grainSize + 1) / 2;
+        stolenEnd = range.end;
+        stolenBegin = range.end - take;
+        range.end = stolenBegin;
+    }
+    {
+        WorkerRange& range = m_ranges[self];
+        std::lock_guard<std::mutex> lock(range.mutex);
+        range.begin = stolenBegin;
+        range.end = stolenEnd;
+    }
+    m_stealCount.fetch_add(1, std::memory_order_relaxed);
+    return true;
+}
@@ -9,279 +9,147 @@ Rectangle {
     // Это свойство будет устанавливаться при создании экземпляра
     property string chartTitle: "График"
     property bool isDarkTheme: false // По умолчанию светлая
-    property bool themeJustChanged: false // Флаг для отслеживания изменений темы
-    property bool forceFullChartRepaintDueToTheme: false // Флаг для двухпроходной перерисовки при смене темы
-    
-    signal themeChangedSignal() // Сигнал для уведомления о смене темы
-    
+
     // Layout properties
     Layout.fillWidth: true // Чтобы занимал ширину chartsColumnLayout
     Layout.fillHeight: true // Занимать всю доступную высоту
     Layout.minimumHeight: 744 // Минимальная высота для отображения графика
-    
-    // Вспомогательная функция для "дергания" viewport'а
-    function forceViewportUpdateForThemeChange() {
-        if (xAxisSelector.currentText === "t, с") { // Только для временных рядов
-            var originalAutoScroll = chartRoot.autoScrollToEnd;
-            var originalMinX = chartRoot.viewPortMinX;
-            var originalMaxX = chartRoot.viewPortMaxX;
-            var smallChange = 0.000001;
-
-            // 1. Явно отключаем автопрокрутку, как это происходит при ручном зуме/пане
-            chartRoot.autoScrollToEnd = false;
-            
-            // 2. "Дергаем" viewport
-            // Мы должны изменить и minX, и maxX, чтобы сохранить ширину окна,
-            // иначе это будет интерпретировано как зум, а не как небольшое смещение.
-            // Или, для простоты, просто сдвинем окно, а потом вернем.
-            chartRoot.viewPortMinX = originalMinX + smallChange;
-            chartRoot.viewPortMaxX = originalMaxX + smallChange;
-            
-            // 3. Вызываем основной метод обновления
-            // Он должен пересчитать данные для нового viewport и запросить перерисовку
-            updateChartDataAndPaint(); 
-            
-            // 4. Возвращаем значения viewport и autoScrollToEnd с помощью Qt.callLater,
-            //    чтобы дать QML время обработать предыдущие изменения и перерисовку.
-            //    Это важно, чтобы не "сломать" состояние, если пользователь действительно
-            //    находился в режиме ручного масштабирования.
-            Qt.callLater(function() {
-                chartRoot.viewPortMinX = originalMinX;
-                chartRoot.viewPortMaxX = originalMaxX;
-                chartRoot.autoScrollToEnd = originalAutoScroll; // Восстанавливаем исходное состояние автопрокрутки
-                // Еще один вызов updateChartDataAndPaint может понадобиться, если восстановление
-                // viewport должно также привести к перерисовке с исходным масштабом.
-                // Однако, если smallChange действительно мал, визуально разницы быть не должно.
-                // На данном этапе попробуем без него, чтобы избежать лишних перерисовок.
-                // Если тема обновилась, но масштаб "уехал" на smallChange, тогда нужно будет
-                // добавить здесь еще один updateChartDataAndPaint().
-                // console.log("Viewport and autoScrollToEnd restored after theme change nudge.");
-            });
 
-        } else {
-            // Для других типов графиков (фазовые, Пуанкаре)
-            lineChartCanvas.requestPaint();
-        }
-    }
-    
-    // Обработчик изменения темы
+    // Обработчик изменения темы: цвета chartView заданы привязками,
+    // а плотность фазового портрета перекрашивается в C++
     onIsDarkThemeChanged: {
-        console.log("chartRoot.onIsDarkThemeChanged FIRED. New theme isDark: " + isDarkTheme);
-        if (chartRoot.visible && lineChartCanvas.width > 0 && lineChartCanvas.height > 0) {
-            chartRoot.themeJustChanged = true; 
-            lineChartCanvas.requestPaint(); // Запускаем первый проход
+        if (chartRoot.visible && chartRoot.showsPhaseDensity) {
+            updateChartDataAndPaint();
         }
     }
-    
+
     // Обновленные цвета для светлой темы
     color: isDarkTheme ? "#2B2B2B" : "#F0F0F0"
     border.color: isDarkTheme ? "#555555" : "#D0D0D0"
-    
+
     Behavior on color { ColorAnimation { duration: 400 } }
     Behavior on border.color { ColorAnimation { duration: 400 } }
-    
+
     border.width: 1
     radius: 4
-    
+
     // Ссылка на C++ объект
     property var pendulum: mainWindow.pendulumObj
-    property list<point> chartData: []  // Данные для Canvas (для обычных графиков)
-    property list<var> poincareSeriesList: [] // Список серий точек для карты Пуанкаре. Каждая серия - это объект { color: "код_цвета", points: [QPointF, ...] }
     property string currentChartType: "time_series_or_phase" // "time_series_or_phase", "poincare"
     property list<string> poincareColors: ["blue", "red", "green", "orange", "purple", "cyan", "magenta", "brown"]
     property int currentColorIndex: 0
     property real poincarePointRadius: 2.0 // Размер точек на карте Пуанкаре
-    
-    // Свойства для интерактивного масштабирования и панорамирования временных рядов
-    property real viewPortMinX: 0.0         // Нижняя граница видимой области по X для временных рядов
-    property real viewPortMaxX: 30.0        // Верхняя граница видимой области по X для временных рядов
+    // Подписи осей карты Пуанкаре зависят от выбранного сечения (сечение θ₂ = 0 показывает θ₁, ω₁)
+    readonly property bool poincareShowsRod1: mainWindow.pendulumObj ? mainWindow.pendulumObj.poincareSection === 1 : false
+    readonly property string poincareXLabel: poincareShowsRod1 ? "θ₁, рад" : "θ₂, рад"
+    readonly property string poincareYLabel: poincareShowsRod1 ? "ω₁, рад/с" : "ω₂, рад/с"
+
+    // Свойства для интерактивного масштабирования и панорамирования временных рядов;
+    // сама видимая область — chartView.viewMinX/viewMaxX
     property bool isPanning: false          // Флаг состояния панорамирования
     property point lastPanPos               // Последняя позиция мыши при панорамировании
     property bool autoScrollToEnd: true     // Включено ли автоследование для временных рядов
     property real defaultTimeWindowWidth: 30.0 // Ширина окна по умолчанию в режиме следования (секунд)
     property real fullHistoryMinTime: 0.0   // Минимальное время во всей истории
     property real fullHistoryMaxTime: 0.0   // Максимальное время во всей истории
-    
-    // Эти свойства будут хранить фактические min/max значения области просмотра данных после всех вычислений
-    property real effectiveMinX: 0
-    property real effectiveMaxX: 1
-    property real effectiveMinY: 0
-    property real effectiveMaxY: 1
-    
-    // Флаг, указывающий, изменился ли масштаб или размеры графика с момента последнего цикла отрисовки
-    property bool scaleOrChartSizeChanged: true
-    
+
     // Флаг, указывающий, выполнено ли первоначальное обновление графика
     property bool initialUpdateDone: false
-    
-    // Для отслеживания изменений размеров холста
-    property real prevCanvasWidth: 0
-    property real prevCanvasHeight: 0
-    
+
+    // Последний ответ updatePhaseDensity: ревизия изображения плотности, границы данных и сетки
+    property var phaseDensity: ({ "empty": true })
+    readonly property bool showsPhaseDensity: currentChartType !== "poincare" &&
+                                              xAxisSelector.currentText !== "t, с" &&
+                                              !phaseDensity.empty
+
     // Обработчик изменения видимости
     onVisibleChanged: {
         if (visible && width > 0 && height > 0 && !chartRoot.initialUpdateDone) {
-            // console.log("ChartPlaceholder (" + chartTitle + ") became visible with valid size. Performing initial update.");
             updateChartDataAndPaint();
             chartRoot.initialUpdateDone = true;
         }
     }
-    
-    // Функция для сохранения текущей серии точек карты Пуанкаре перед сбросом
+
+    // Функция для сохранения текущей серии точек карты Пуанкаре перед сбросом:
+    // точки из C++ буфера переносятся в активную серию, если они там есть
     function finalizeCurrentPoincareSeries() {
-        if (currentChartType === "poincare" && mainWindow.pendulumObj) {
-            var currentPoints = mainWindow.pendulumObj.getPoincareMapPoints();
-            if (poincareSeriesList.length > 0) {
-                var activeSeriesIndex = poincareSeriesList.length - 1;
-                // Вносим изменение: обновляем точки только если в C++ буфере есть новые точки,
-                // иначе сохраняем уже существующие точки активной серии
-                if (currentPoints.length > 0) {
-                    poincareSeriesList[activeSeriesIndex].points = currentPoints; 
-                    // console.log("Poincare series (color: " + poincareSeriesList[activeSeriesIndex].color + 
-                    //             ") finalized with " + currentPoints.length + " points before reset/param change.");
-                } else {
-                    // console.log("Poincare series (color: " + poincareSeriesList[activeSeriesIndex].color + 
-                    //             ") preserved with " + poincareSeriesList[activeSeriesIndex].points.length + 
-                    //             " existing points (C++ buffer empty).");
-                }
-            }
-            // После reset() в C++, getPoincareMapPoints() будет возвращать пустой список,
-            // и при следующем переключении В режим Пуанкаре или клике на палитру начнется новая серия.
+        if (currentChartType === "poincare") {
+            chartView.finalizePoincareSeries();
         }
     }
-    
-    // Replace the old getHistoryData function with a new one that uses the C++ optimized function
+
+    // Обновление графика по таймеру и по действиям пользователя. Временной ряд
+    // ChartItem читает из истории сам: в режиме следования дописывает новые строки
+    // на chartTick планировщика кадров (время идёт в фазу графиков), а при смене
+    // настроек или области запрашивает окно заново.
     function updateChartDataAndPaint() {
         if (!mainWindow.pendulumObj) return;
 
-        // First, make sure we know the full time range of the simulation
-        var fullHistoryForTime = pendulumObj.getTheta1History();
-        if (fullHistoryForTime.length > 0) {
-            chartRoot.fullHistoryMinTime = fullHistoryForTime[0].x;
-            chartRoot.fullHistoryMaxTime = fullHistoryForTime[fullHistoryForTime.length - 1].x;
-        } else {
-            chartRoot.fullHistoryMinTime = 0;
-            chartRoot.fullHistoryMaxTime = 0;
-        }
+        chartRoot.fullHistoryMinTime = mainWindow.pendulumObj.historyStartTime;
+        chartRoot.fullHistoryMaxTime = mainWindow.pendulumObj.historyEndTime;
 
         if (chartRoot.currentChartType === "poincare") {
-            updateVisibleChart();
-        } else {
-            var finalDataForChart;
-            var xAxisType = xAxisSelector.currentText;
-
-            // --- LOGIC BRANCH FOR TIME SERIES ---
-            if (xAxisType === 't, с') {
-                // 1. Calculate the correct viewport
-                if (chartRoot.autoScrollToEnd && chartRoot.fullHistoryMaxTime > 0) {
-                    chartRoot.viewPortMinX = Math.max(0, chartRoot.fullHistoryMaxTime - chartRoot.defaultTimeWindowWidth);
-                    chartRoot.viewPortMaxX = chartRoot.fullHistoryMaxTime;
-                }
-
-                // 2. Request data, WITH OPTIMIZATION SETTINGS from UI
-                var ySeriesEnum;
-                switch(yAxisSelector.currentText) {
-                    case "θ₁, °":     ySeriesEnum = PendulumApi.Theta1_Degrees; break;
-                    case "θ₂, °":     ySeriesEnum = PendulumApi.Theta2_Degrees; break;
-                    case "ω₁, рад/с": ySeriesEnum = PendulumApi.Omega1_Rad_s; break;
-                    case "ω₂, рад/с": ySeriesEnum = PendulumApi.Omega2_Rad_s; break;
-                    case "T, Дж":     ySeriesEnum = PendulumApi.KineticEnergy; break;
-                    case "V, Дж":     ySeriesEnum = PendulumApi.PotentialEnergy; break;
-                    case "E, Дж":     ySeriesEnum = PendulumApi.TotalEnergy; break;
-                    default:          ySeriesEnum = PendulumApi.Theta1_Degrees; // Default case
-                }
-                
-                finalDataForChart = mainWindow.pendulumObj.getProcessedTimeSeriesData(
-                    ySeriesEnum, // Now using the enum instead of string
-                    chartRoot.viewPortMinX,
-                    chartRoot.viewPortMaxX,
-                    rdpEnabledCheckBox.checked,
-                    rdpEpsilonSpinBox.value / 100.0,
-                    limitPointsEnabledCheckBox.checked,
-                    maxPointsSpinBox.value
-                );
-
+            // Если нет серий, всегда создаем первую, даже если пока нет точек
+            if (chartView.poincareSeriesCount === 0) {
+                chartView.beginPoincareSeries(chartRoot.poincareColors[chartRoot.currentColorIndex]);
+            }
+            chartView.refresh();
+        } else if (xAxisSelector.currentText !== "t, с") {
+            // The portrait is binned in C++ into a density image the size of the plot;
+            // only its bounding box comes back, so the axes are fitted as before
+            // while the image overlay draws the data
+            var density = mainWindow.pendulumObj.updatePhaseDensity(
+                seriesTypeFor(xAxisSelector.currentText),
+                seriesTypeFor(yAxisSelector.currentText),
+                Math.max(1, Math.round(chartView.plotRect.width)),
+                Math.max(1, Math.round(chartView.plotRect.height)),
+                seriesLineColor());
+            chartRoot.phaseDensity = density;
+            if (density.empty) {
+                chartView.clearData();
             } else {
-                // --- LOGIC BRANCH FOR PHASE PORTRAITS (NEW & EFFICIENT) ---
-                
-                // Map X axis selection to series type enum
-                var xSeriesEnum;
-                switch(xAxisSelector.currentText) {
-                    case "t, с":      xSeriesEnum = -1; break; // Should not happen in this branch
-                    case "θ₁, °":     xSeriesEnum = PendulumApi.TimeSeriesType.Theta1_Degrees; break;
-                    case "θ₂, °":     xSeriesEnum = PendulumApi.TimeSeriesType.Theta2_Degrees; break;
-                    case "ω₁, рад/с": xSeriesEnum = PendulumApi.TimeSeriesType.Omega1_Rad_s; break;
-                    case "ω₂, рад/с": xSeriesEnum = PendulumApi.TimeSeriesType.Omega2_Rad_s; break;
-                }
-                
-                // Map Y axis selection to series type enum
-                var ySeriesEnum;
-                switch(yAxisSelector.currentText) {
-                    case "θ₁, °":     ySeriesEnum = PendulumApi.TimeSeriesType.Theta1_Degrees; break;
-                    case "θ₂, °":     ySeriesEnum = PendulumApi.TimeSeriesType.Theta2_Degrees; break;
-                    case "ω₁, рад/с": ySeriesEnum = PendulumApi.TimeSeriesType.Omega1_Rad_s; break;
-                    case "ω₂, рад/с": ySeriesEnum = PendulumApi.TimeSeriesType.Omega2_Rad_s; break;
-                    case "T, Дж":      ySeriesEnum = PendulumApi.TimeSeriesType.KineticEnergy; break;
-                    case "V, Дж":      ySeriesEnum = PendulumApi.TimeSeriesType.PotentialEnergy; break;
-                    case "E, Дж":      ySeriesEnum = PendulumApi.TimeSeriesType.TotalEnergy; break;
-                }
-
-                // Get phase portrait data directly from C++ with a single call
-                if (xSeriesEnum !== -1) {
-                    finalDataForChart = mainWindow.pendulumObj.getPhasePortraitData(xSeriesEnum, ySeriesEnum);
-                } else {
-                    finalDataForChart = []; // Should not happen
-                }
+                chartView.setDataBounds(density.dataXMin, density.dataXMax, density.dataYMin, density.dataYMax);
             }
-
-            chartRoot.chartData = finalDataForChart;
         }
+    }
 
-        // --- UNIFIED REPAINT BLOCK ---
-        if (backgroundFeaturesCanvas.available) backgroundFeaturesCanvas.requestPaint();
-        if (dataLineOffscreenCanvas.available) dataLineOffscreenCanvas.requestPaint();
-        if (lineChartCanvas.available) lineChartCanvas.requestPaint();
+    // Ряд истории для подписи оси
+    function seriesTypeFor(axisText) {
+        switch (axisText) {
+            case "θ₁, °":     return PendulumApi.Theta1_Degrees;
+            case "θ₂, °":     return PendulumApi.Theta2_Degrees;
+            case "ω₁, рад/с": return PendulumApi.Omega1_Rad_s;
+            case "ω₂, рад/с": return PendulumApi.Omega2_Rad_s;
+            case "T, Дж":     return PendulumApi.KineticEnergy;
+            case "V, Дж":     return PendulumApi.PotentialEnergy;
+            case "E, Дж":     return PendulumApi.TotalEnergy;
+        }
+        return PendulumApi.Theta1_Degrees;
     }
-    
-    // Функция для обновления видимой области графика
-    function updateVisibleChart() {
-        if (chartRoot.currentChartType === "poincare") {
-            // В режиме карты Пуанкаре
-            // Получаем данные карты Пуанкаре из C++ кода для текущей активной серии
-            var currentPoincarePoints = mainWindow.pendulumObj.getPoincareMapPoints();
-            
-            // Обновляем или создаем активную серию с текущими точками
-            if (chartRoot.poincareSeriesList.length === 0) {
-                // Если нет серий, всегда создаем первую, даже если пока нет точек
-                chartRoot.poincareSeriesList.push({
-                    "color": chartRoot.poincareColors[chartRoot.currentColorIndex],
-                    "points": currentPoincarePoints
-                });
-                
-                // Запрашиваем перерисовку с безопасной проверкой доступности холстов
-                if (dataLineOffscreenCanvas && dataLineOffscreenCanvas.available) {
-                    dataLineOffscreenCanvas.requestPaint();
-                }
-                if (backgroundFeaturesCanvas && backgroundFeaturesCanvas.available) {
-                    backgroundFeaturesCanvas.requestPaint();
-                }
-                return true; // Данные обновлены
-            } else {
-                // Обновляем точки последней (активной) серии только если есть новые точки
-                var activeSeriesIndex = chartRoot.poincareSeriesList.length - 1;
-                if (currentPoincarePoints.length > 0) {
-                    chartRoot.poincareSeriesList[activeSeriesIndex].points = currentPoincarePoints;
-                    
-                    // Запрашиваем перерисовку с безопасной проверкой
-                    if (dataLineOffscreenCanvas && dataLineOffscreenCanvas.available) {
-                        dataLineOffscreenCanvas.requestPaint();
-                    }
-                    return true; // Данные обновлены
-                }
-            }
+
+    // Цвет линии выбранного ряда с учётом темы
+    function seriesLineColor() {
+        var lineColor = "black"; // Дефолтный цвет
+        switch (yAxisSelector.currentText) {
+            case "θ₁, °":
+            case "ω₁, рад/с":
+                lineColor = "red"; // Цвет первого боба
+                break;
+            case "θ₂, °":
+            case "ω₂, рад/с":
+                lineColor = "blue"; // Цвет второго боба
+                break;
+            case "T, Дж":
+                lineColor = "green";
+                break;
+            case "V, Дж":
+                lineColor = "purple";
+                break;
+            case "E, Дж":
+                lineColor = "black";
+                break;
         }
-        
-        return false; // Данные не изменились
+        return chartRoot.isDarkTheme ? (lineColor === "black" ? "white" : Qt.lighter(lineColor, 1.5)) : lineColor;
     }
 
     ColumnLayout {
@@ -311,12 +179,158 @@ Rectangle {
             }
         }
 
-        Canvas {
-            id: lineChartCanvas
+        // График: сетка, оси и данные рисует ChartItem в графе сцены,
+        // подписи и заголовки осей — обычные Text поверх него
+        Item {
+            id: chartArea
             Layout.fillWidth: true
             Layout.fillHeight: true // Изменено с Layout.preferredHeight для максимального использования пространства
             Layout.minimumHeight: 150 // Гарантированная минимальная высота
-            antialiasing: true
+
+            // Число делений сетки, как GRID_LINES_X/GRID_LINES_Y в ChartItem
+            readonly property int gridLinesX: 30
+            readonly property int gridLinesY: 24
+            // Для карты Пуанкаре подписи по X реже
+            readonly property int labelLinesX: chartRoot.currentChartType === "poincare" ? 20 : gridLinesX
+            readonly property int decimalsX: chartRoot.currentChartType === "poincare" ? 2 : 1
+            readonly property int decimalsY: chartRoot.currentChartType !== "poincare" &&
+                                             yAxisSelector.currentText.includes("°") ? 1 : 2 // Меньше десятичных знаков для углов
+            readonly property color labelColor: chartRoot.isDarkTheme ? "#DCDCDC" : "#333333" // Светлее для темной темы
+            readonly property color titleColor: chartRoot.isDarkTheme ? "#F0F0F0" : "#000000" // Очень яркий для темной темы
+            readonly property rect plot: chartView.plotRect
+            readonly property bool plotVisible: plot.width > 0 && plot.height > 0
+
+            ChartItem {
+                id: chartView
+                anchors.fill: parent
+                pendulum: mainWindow.pendulumObj
+                scheduler: frameScheduler
+                active: mainWindow.analysisModeActive && chartRoot.visible
+                mode: chartRoot.currentChartType === "poincare" ? ChartItem.PoincareMap
+                    : (xAxisSelector.currentText === "t, с" ? ChartItem.TimeSeries : ChartItem.PhasePortrait)
+                series: chartRoot.seriesTypeFor(yAxisSelector.currentText)
+                following: chartRoot.autoScrollToEnd
+                windowWidth: chartRoot.defaultTimeWindowWidth
+
+                rdpEnabled: rdpEnabledCheckBox.checked
+                rdpEpsilon: rdpEpsilonSpinBox.value / 100.0
+                // RDP по числу точек вместо epsilon (0 — по epsilon)
+                rdpTargetPoints: rdpModeComboBox.currentIndex === 1 ? rdpTargetSpinBox.value : 0
+                limitPoints: limitPointsEnabledCheckBox.checked
+                maxPoints: maxPointsSpinBox.value
+
+                plotColor: chartRoot.isDarkTheme ? "#333333" : "white"
+                gridColor: chartRoot.isDarkTheme ? "#6E6E6E" : "#BBBBBB" // Чуть светлее для темной темы
+                axisColor: chartRoot.isDarkTheme ? "#A0A0A0" : "#333333"
+                zeroLineColor: chartRoot.isDarkTheme ? "#E0E0E0" : "#000000"
+                lineColor: chartRoot.seriesLineColor()
+                pointRadius: chartRoot.poincarePointRadius
+            }
+
+            // Плотность фазового портрета поверх графика (image://phasedensity). Изображение
+            // покрывает сетку PhaseDensity, а не только данные, поэтому его положение и размер
+            // пересчитываются из границ сетки в текущий масштаб осей и обрезаются областью графика.
+            Item {
+                id: phaseDensityArea
+                x: chartArea.plot.x
+                y: chartArea.plot.y
+                width: chartArea.plot.width
+                height: chartArea.plot.height
+                clip: true
+                visible: chartRoot.showsPhaseDensity
+
+                Image {
+                    readonly property var density: chartRoot.phaseDensity
+                    readonly property real xScale: parent.width / (chartView.maxX - chartView.minX)
+                    readonly property real yScale: parent.height / (chartView.maxY - chartView.minY)
+                    x: (density.gridXMin - chartView.minX) * xScale
+                    y: (chartView.maxY - density.gridYMax) * yScale
+                    width: (density.gridXMax - density.gridXMin) * xScale
+                    height: (density.gridYMax - density.gridYMin) * yScale
+                    source: chartRoot.showsPhaseDensity ? "image://phasedensity/" + density.revision : ""
+                    cache: false
+                    smooth: true
+                    fillMode: Image.Stretch
+                }
+            }
+
+            // Метки оси Y на внутренних линиях сетки (крайние слишком близко к краям)
+            Repeater {
+                model: chartView.hasData && chartArea.plotVisible ? chartArea.gridLinesY - 1 : 0
+                delegate: Text {
+                    readonly property real fraction: (index + 1) / chartArea.gridLinesY
+                    text: (chartView.maxY - fraction * (chartView.maxY - chartView.minY)).toFixed(chartArea.decimalsY)
+                    x: chartArea.plot.x - 5 - width
+                    y: chartArea.plot.y + fraction * chartArea.plot.height - height / 2
+                    color: chartArea.labelColor
+                    font.pixelSize: 12
+                    font.bold: true
+                }
+            }
+
+            // Метки оси X: через столько делений, чтобы соседние не накладывались
+            TextMetrics {
+                id: xLabelMetrics
+                font.pixelSize: 12
+                font.bold: true
+                text: {
+                    var first = chartView.minX.toFixed(chartArea.decimalsX);
+                    var last = chartView.maxX.toFixed(chartArea.decimalsX);
+                    return first.length > last.length ? first : last;
+                }
+            }
+
+            Repeater {
+                id: xLabelRepeater
+                readonly property real spacing: chartArea.plot.width / chartArea.labelLinesX
+                readonly property int step: Math.max(1, Math.ceil((xLabelMetrics.advanceWidth + 5) / Math.max(1, spacing)))
+                model: chartView.hasData && chartArea.plotVisible ? chartArea.labelLinesX - 1 : 0
+                delegate: Text {
+                    readonly property real fraction: (index + 1) / chartArea.labelLinesX
+                    visible: index % xLabelRepeater.step === 0
+                    text: (chartView.minX + fraction * (chartView.maxX - chartView.minX)).toFixed(chartArea.decimalsX)
+                    x: chartArea.plot.x + fraction * chartArea.plot.width - width / 2
+                    y: chartArea.plot.y + chartArea.plot.height + 6
+                    color: chartArea.labelColor
+                    font.pixelSize: 12
+                    font.bold: true
+                }
+            }
+
+            // Заголовки осей
+            Text {
+                id: yAxisTitle
+                visible: chartArea.plotVisible
+                text: chartRoot.currentChartType === "poincare" ? chartRoot.poincareYLabel : yAxisSelector.currentText
+                rotation: -90
+                // Нижний край повёрнутого текста — на отступе слева от оси Y
+                x: chartArea.plot.x - (chartRoot.currentChartType === "poincare" ? 35 : 45) - height / 2 - width / 2
+                y: chartArea.plot.y + chartArea.plot.height / 2 - height / 2
+                color: chartArea.titleColor
+                font.pixelSize: 13
+                font.bold: true
+            }
+
+            Text {
+                id: xAxisTitle
+                visible: chartArea.plotVisible
+                text: chartRoot.currentChartType === "poincare" ? chartRoot.poincareXLabel : xAxisSelector.currentText
+                x: chartArea.plot.x + chartArea.plot.width / 2 - width / 2
+                y: chartArea.plot.y + chartArea.plot.height + 20
+                color: chartArea.titleColor
+                font.pixelSize: 13
+                font.bold: true
+            }
+
+            Text {
+                anchors.centerIn: parent
+                visible: !chartArea.plotVisible || !chartView.hasData
+                text: !chartArea.plotVisible ? "Область графика слишком мала"
+                    : (chartRoot.currentChartType === "poincare" ? "Нет данных для карты Пуанкаре (запустите симуляцию)"
+                                                                 : "Нет данных для отображения")
+                color: chartRoot.isDarkTheme ? "#AAAAAA" : "#555555"
+                font.pixelSize: 10
+            }
 
             // Добавляем MouseArea для обработки зума и пана
             MouseArea {
@@ -324,768 +338,122 @@ Rectangle {
                 anchors.fill: parent
                 hoverEnabled: true
                 acceptedButtons: Qt.LeftButton
-                
+
                 onPressed: function(mouse) {
                     if (xAxisSelector.currentText !== "t, с") {
                         mouse.accepted = false; // Не перехватываем для других типов графиков
                         return;
                     }
-                    
+
                     chartRoot.autoScrollToEnd = false; // Отключаем автоследование
+                    chartRoot.fullHistoryMinTime = mainWindow.pendulumObj.historyStartTime;
+                    chartRoot.fullHistoryMaxTime = mainWindow.pendulumObj.historyEndTime;
                     chartRoot.isPanning = true;
                     chartRoot.lastPanPos = Qt.point(mouse.x, mouse.y);
-                    // console.log("Mouse press: disabled auto-scroll, started panning");
                 }
-                
+
                 onPositionChanged: function(mouse) {
                     if (!chartRoot.isPanning || xAxisSelector.currentText !== "t, с") {
                         return;
                     }
-                    
+
                     // Рассчитываем смещение в пикселях
                     var deltaX = chartRoot.lastPanPos.x - mouse.x;
                     chartRoot.lastPanPos = Qt.point(mouse.x, mouse.y);
-                    
+
                     // Преобразуем смещение пикселей в единицы данных по оси X
-                    var chartWidth = lineChartCanvas.width - 80; // Приблизительно учитываем padding
-                    var xRange = chartRoot.viewPortMaxX - chartRoot.viewPortMinX;
+                    var chartWidth = Math.max(1, chartArea.plot.width);
+                    var xRange = chartView.viewMaxX - chartView.viewMinX;
                     var deltaInDataUnits = (deltaX / chartWidth) * xRange;
-                    
-                    // Обновляем viewPort с учетом смещения
-                    var oldMinX = chartRoot.viewPortMinX;
-                    var oldMaxX = chartRoot.viewPortMaxX;
-                    var newMinX = chartRoot.viewPortMinX + deltaInDataUnits;
-                    var newMaxX = chartRoot.viewPortMaxX + deltaInDataUnits;
-                    
+
+                    // Обновляем область просмотра с учетом смещения
+                    var newMinX = chartView.viewMinX + deltaInDataUnits;
+                    var newMaxX = chartView.viewMaxX + deltaInDataUnits;
+
                     // Ограничиваем панорамирование диапазоном данных
                     if (newMinX < chartRoot.fullHistoryMinTime) {
                         var adjustment = chartRoot.fullHistoryMinTime - newMinX;
                         newMinX += adjustment;
                         newMaxX += adjustment;
                     }
-                    
+
                     if (newMaxX > chartRoot.fullHistoryMaxTime) {
                         var adjustment = newMaxX - chartRoot.fullHistoryMaxTime;
                         newMinX -= adjustment;
                         newMaxX -= adjustment;
                     }
-                    
-                    chartRoot.viewPortMinX = newMinX;
-                    chartRoot.viewPortMaxX = newMaxX;
-                    // console.log("Panning: viewport shifted from [" + oldMinX.toFixed(2) + "," + oldMaxX.toFixed(2) + 
-                    //           "] to [" + chartRoot.viewPortMinX.toFixed(2) + "," + chartRoot.viewPortMaxX.toFixed(2) + 
-                    //           "], by dx=" + deltaX.toFixed(2));
-                    
-                    updateChartDataAndPaint();
+
+                    // ChartItem запросит новое окно на следующем кадре
+                    chartView.viewMinX = newMinX;
+                    chartView.viewMaxX = newMaxX;
                 }
-                
+
                 onReleased: function(mouse) {
                     if (xAxisSelector.currentText !== "t, с") {
                         return;
                     }
-                    
+
                     chartRoot.isPanning = false;
                 }
-                
+
                 onWheel: function(wheel) {
                     if (xAxisSelector.currentText !== "t, с") {
                         wheel.accepted = false; // Не перехватываем для других типов графиков
                         return;
                     }
-                    
+
                     // Отключаем автоследование при любом взаимодействии
                     chartRoot.autoScrollToEnd = false;
-                    
+                    chartRoot.fullHistoryMinTime = mainWindow.pendulumObj.historyStartTime;
+                    chartRoot.fullHistoryMaxTime = mainWindow.pendulumObj.historyEndTime;
+
                     // Определяем фактор масштабирования (delta < 0 - увеличить, delta > 0 - уменьшить)
                     var zoomFactor = wheel.angleDelta.y < 0 ? 1.2 : 0.8;
-                    
+
                     // Рассчитываем положение мыши в координатах данных
-                    var chartWidth = lineChartCanvas.width - 80; // Приблизительно учитываем padding
-                    var leftPadding = 60; // Приблизительно левый отступ
-                    var mouseXRatio = (wheel.x - leftPadding) / chartWidth;
-                    
+                    var chartWidth = Math.max(1, chartArea.plot.width);
+                    var mouseXRatio = (wheel.x - chartArea.plot.x) / chartWidth;
+
                     // Если мышь за пределами графика, центрируем зум
                     if (mouseXRatio < 0 || mouseXRatio > 1) {
                         mouseXRatio = 0.5;
                     }
-                    
-                    var mouseDataX = chartRoot.viewPortMinX + mouseXRatio * (chartRoot.viewPortMaxX - chartRoot.viewPortMinX);
-                    
+
+                    var mouseDataX = chartView.viewMinX + mouseXRatio * (chartView.viewMaxX - chartView.viewMinX);
+
                     // Вычисляем новую ширину диапазона
-                    var newRangeX = (chartRoot.viewPortMaxX - chartRoot.viewPortMinX) * zoomFactor;
-                    
+                    var newRangeX = (chartView.viewMaxX - chartView.viewMinX) * zoomFactor;
+
                     // Ограничиваем диапазон (от 1 секунды до полной длительности истории)
                     var maxRange = Math.max(chartRoot.fullHistoryMaxTime - chartRoot.fullHistoryMinTime, 30);
                     var minRange = 1.0; // Минимум 1 секунда
-                    
+
                     if (newRangeX > maxRange) newRangeX = maxRange;
                     if (newRangeX < minRange) newRangeX = minRange;
-                    
+
                     // Рассчитываем новые границы, центрируя относительно позиции мыши
                     var newMinX = mouseDataX - mouseXRatio * newRangeX;
                     var newMaxX = newMinX + newRangeX;
-                    
+
                     // Проверяем и корректируем границы
                     if (newMinX < chartRoot.fullHistoryMinTime) {
                         newMinX = chartRoot.fullHistoryMinTime;
                         newMaxX = newMinX + newRangeX;
                     }
-                    
+
                     if (newMaxX > chartRoot.fullHistoryMaxTime) {
                         newMaxX = chartRoot.fullHistoryMaxTime;
                         newMinX = newMaxX - newRangeX;
-                        
+
                         // Если минX выходит за левую границу после корректировки
                         if (newMinX < chartRoot.fullHistoryMinTime) {
                             newMinX = chartRoot.fullHistoryMinTime;
                         }
                     }
-                    
-                    // Применяем новые границы
-                    chartRoot.viewPortMinX = newMinX;
-                    chartRoot.viewPortMaxX = newMaxX;
-                    
-                    updateChartDataAndPaint();
-                }
-            }
 
-            onPaint: {
-                if (!visible || width <= 0 || height <= 0) return;
-                var ctx = getContext("2d");
-                if (!ctx) return;
-
-                // --- НОВЫЙ БЛОК ДЛЯ ОБРАБОТКИ СМЕНЫ ТЕМЫ ---
-                if (chartRoot.themeJustChanged) {
-                    console.log("Theme Change - Pass 1: Requesting offscreen repaints and scheduling Pass 2.");
-                    // Запрашиваем перерисовку скрытых холстов с новыми цветами
-                    if (backgroundFeaturesCanvas.available) backgroundFeaturesCanvas.requestPaint();
-                    if (dataLineOffscreenCanvas.available) dataLineOffscreenCanvas.requestPaint();
-                    
-                    chartRoot.themeJustChanged = false; // Сбрасываем флаг
-                    // Планируем второй проход, который "проявит" уже готовые скрытые холсты
-                    Qt.callLater(lineChartCanvas.requestPaint);
-                    return; // Важно: прерываем текущую отрисовку
-                }
-                // --- КОНЕЦ НОВОГО БЛОКА ---
-
-                // Обычная отрисовка или второй проход после смены темы
-                ctx.clearRect(0, 0, width, height);
-                ctx.fillStyle = chartRoot.isDarkTheme ? "#333333" : "white";
-                ctx.fillRect(0, 0, width, height);
-
-                var padding = { top: 10, right: 10, bottom: 35, left: 45 };
-                var chartWidth = width - padding.left - padding.right;
-                var chartHeight = height - padding.top - padding.bottom;
-
-                if (chartWidth <= 0 || chartHeight <= 0) {
-                    ctx.fillStyle = chartRoot.isDarkTheme ? "#AAAAAA" : "#555555";
-                    ctx.font = "10px sans-serif";
-                    ctx.textAlign = "center";
-                    ctx.fillText("Область графика слишком мала", width / 2, height / 2);
-                    return;
-                }
-
-                var data = chartRoot.chartData;
-                if (!data || data.length < 1) {
-                    ctx.fillStyle = "#555"; // Используем один цвет, т.к. фон самого холста уже задан темой
-                    ctx.font = "10px sans-serif";
-                    ctx.textAlign = "center";
-                    if (chartRoot.currentChartType === "poincare") {
-                        ctx.fillText("Нет данных для карты Пуанкаре (запустите симуляцию)", width / 2, height / 2);
-                    } else {
-                        ctx.fillText("Нет данных для отображения", width / 2, height / 2);
-                    }
-                    return;
-                }
-                
-                var minX, maxX, minY, maxY;
-                
-                if (chartRoot.currentChartType === "poincare") {
-                    // Для режима Пуанкаре находим границы по всем сериям
-                    var hasFoundAnyPoint = false;
-                    
-                    // Инициализация граничных значений
-                    for (var seriesIndex = 0; seriesIndex < chartRoot.poincareSeriesList.length; seriesIndex++) {
-                        var series = chartRoot.poincareSeriesList[seriesIndex];
-                        if (series.points.length > 0) {
-                            if (!hasFoundAnyPoint) {
-                                minX = series.points[0].x;
-                                maxX = series.points[0].x;
-                                minY = series.points[0].y;
-                                maxY = series.points[0].y;
-                                hasFoundAnyPoint = true;
-                            }
-                            
-                            // Поиск min/max в серии
-                            for (var i = 0; i < series.points.length; ++i) {
-                                if (series.points[i].x < minX) minX = series.points[i].x;
-                                if (series.points[i].x > maxX) maxX = series.points[i].x;
-                                if (series.points[i].y < minY) minY = series.points[i].y;
-                                if (series.points[i].y > maxY) maxY = series.points[i].y;
-                            }
-                        }
-                    }
-                    
-                    // Если нет точек, задаем дефолтный диапазон
-                    if (!hasFoundAnyPoint) {
-                        minX = -1;
-                        maxX = 1;
-                        minY = -1;
-                        maxY = 1;
-                    }
-                } else {
-                    // Обычный режим графика
-                    if (xAxisSelector.currentText === "t, с") {
-                        // Для временных рядов используем значения из viewPort
-                        minX = chartRoot.viewPortMinX;
-                        maxX = chartRoot.viewPortMaxX;
-                        // console.log("onPaint: Using time series viewport: X=[" + minX.toFixed(2) + "," + maxX.toFixed(2) + "]");
-                        
-                        // minY и maxY рассчитываем по видимым данным
-                        if (data.length > 0) {
-                            minY = data[0].y;
-                            maxY = minY;
-                            
-                            for (var i = 0; i < data.length; ++i) {
-                                if (data[i].y < minY) minY = data[i].y;
-                                if (data[i].y > maxY) maxY = data[i].y;
-                            }
-                        } else {
-                            minY = -1;
-                            maxY = 1;
-                        }
-                    } else {
-                        // Для фазовых портретов рассчитываем все границы по данным
-                        if (data.length > 0) {
-                            minX = data[0].x;
-                            maxX = minX;
-                            minY = data[0].y;
-                            maxY = minY;
-                            
-                            if (data.length > 1) {
-                                for (var i = 1; i < data.length; ++i) {
-                                    if (data[i].x < minX) minX = data[i].x;
-                                    if (data[i].x > maxX) maxX = data[i].x;
-                                    if (data[i].y < minY) minY = data[i].y;
-                                    if (data[i].y > maxY) maxY = data[i].y;
-                                }
-                            } else {
-                                minX = data[0].x - 0.5;
-                                maxX = data[0].x + 0.5;
-                                minY = data[0].y - 0.5;
-                                maxY = data[0].y + 0.5;
-                            }
-                        } else {
-                            // Если нет точек вообще
-                            minX = -1;
-                            maxX = 1;
-                            minY = -1;
-                            maxY = 1;
-                        }
-                    }
-                }
-                
-                if (minX === maxX) { minX -= 0.5; maxX += 0.5; }
-                
-                // Сохраняем исходные диапазоны данных (minX_data, maxX_data, minY_data, maxY_data)
-                // minX, maxY, minY, maxY на этом этапе содержат значения из viewPort (для времени)
-                // или вычисленные по всем точкам (для фазовых портретов/Пуанкаре)
-                var xDataMin = minX;
-                var xDataMax = maxX;
-                var yDataMin = minY;
-                var yDataMax = maxY;
-
-                var xInitialDataRange = xDataMax - xDataMin;
-                if (xInitialDataRange === 0) xInitialDataRange = 1; 
-                
-                var yInitialDataRange = yDataMax - yDataMin;
-                if (yInitialDataRange === 0) { yDataMin -= 0.5; yDataMax += 0.5; yInitialDataRange = 1; }
-
-                // Устанавливаем финальные minX, maxX, minY, maxY для масштабирования на Canvas
-                if (xAxisSelector.currentText === "t, с") {
-                    // Для всех временных рядов (как с автоследованием, так и с ручным зумом):
-                    // Ось X: данные должны занимать всю ширину от padding.left до padding.left + chartWidth.
-                    // Не добавляем внешние отступы к диапазону данных по X.
-                    minX = xDataMin; // Начало диапазона данных = начало видимой области
-                    maxX = xDataMax; // Конец диапазона данных = конец видимой области
-                    
-                    // Ось Y: по-прежнему добавляем отступы, чтобы избежать прилипания к границам
-                    var yPaddingValue = yInitialDataRange * 0.15; 
-                    minY = yDataMin - yPaddingValue;
-                    maxY = yDataMax + yPaddingValue;
-
-                } else {
-                    // Стандартная логика отступов для фазовых портретов, карты Пуанкаре и других типов графиков
-                    var xPaddingValue = xInitialDataRange * 0.15;
-                    minX = xDataMin - xPaddingValue;
-                    maxX = xDataMax + xPaddingValue;
-
-                    var yPaddingValue = yInitialDataRange * 0.15;
-                    minY = yDataMin - yPaddingValue;
-                    maxY = yDataMax + yPaddingValue;
-                }
-                
-                // Пересчитываем итоговые диапазоны для масштабирования
-                var xRange = maxX - minX;
-                if (xRange === 0) { minX -= 0.5; maxX += 0.5; xRange = 1; }
-
-                var yRange = maxY - minY;
-                if (yRange === 0) { minY -= 0.5; maxY += 0.5; yRange = 1; }
-
-                // --- Логика обновления effectiveMin/Max ---
-                chartRoot.effectiveMinX = minX;
-                chartRoot.effectiveMaxX = maxX;
-                chartRoot.effectiveMinY = minY;
-                chartRoot.effectiveMaxY = maxY;
-                chartRoot.prevCanvasWidth = width;
-                chartRoot.prevCanvasHeight = height;
-                
-                // УДАЛЯЕМ ЛОГИКУ ОБНОВЛЕНИЯ СКРЫТЫХ ХОЛСТОВ:
-                // var scaleActuallyChanged = (oldEffectiveMinX !== minX || 
-                //                           oldEffectiveMaxX !== maxX || 
-                //                           oldEffectiveMinY !== minY || 
-                //                           oldEffectiveMaxY !== maxY);
-                // var sizeActuallyChanged = (oldPrevCanvasWidth !== width || 
-                //                          oldPrevCanvasHeight !== height);
-                //
-                // // ОБЫЧНАЯ перерисовка скрытых холстов (не из-за темы, а из-за масштаба/данных)
-                // if (scaleActuallyChanged || sizeActuallyChanged) {
-                //     if (backgroundFeaturesCanvas.available) backgroundFeaturesCanvas.requestPaint();
-                // }
-                // if (chartRoot.chartDataContentChanged || scaleActuallyChanged || sizeActuallyChanged) {
-                //     if (dataLineOffscreenCanvas.available) dataLineOffscreenCanvas.requestPaint();
-                // }
-                
-                // Просто собираем композицию из готовых холстов
-                if (backgroundFeaturesCanvas.available) ctx.drawImage(backgroundFeaturesCanvas, 0, 0);
-                if (dataLineOffscreenCanvas.available) ctx.drawImage(dataLineOffscreenCanvas, 0, 0);
-                
-                // chartRoot.chartDataContentChanged = false; // <-- УДАЛЯЕМ СБРОС ФЛАГА
-                // console.log("--- lineChartCanvas.onPaint FINISHED ---");
-            }
-            
-            // Скрытый холст для фоновых элементов (сетка, оси, метки)
-            Canvas {
-                id: backgroundFeaturesCanvas
-                width: lineChartCanvas.width
-                height: lineChartCanvas.height
-                visible: false
-                antialiasing: true
-                
-                Connections {
-                    target: chartRoot
-                    function onThemeChangedSignal() {
-                        // console.log("backgroundFeaturesCanvas: Theme changed signal received. Requesting paint.");
-                        backgroundFeaturesCanvas.requestPaint();
-                    }
-                }
-                
-                onPaint: {
-                    // console.log("backgroundFeaturesCanvas onPaint. isDarkTheme:", chartRoot.isDarkTheme); // Для отладки
-                    if (width <= 0 || height <= 0) return;
-                    
-                    var ctx = getContext("2d");
-                    if (!ctx) return;
-                    
-                    ctx.clearRect(0, 0, width, height);
-                    
-                    var padding = { top: 10, right: 20, bottom: 40, left: 60 };
-                    var chartWidth = width - padding.left - padding.right;
-                    var chartHeight = height - padding.top - padding.bottom;
-                    
-                    if (chartWidth <= 0 || chartHeight <= 0) return;
-                    
-                    // Используем сохраненные эффективные значения масштабирования
-                    var minX = chartRoot.effectiveMinX;
-                    var maxX = chartRoot.effectiveMaxX;
-                    var minY = chartRoot.effectiveMinY;
-                    var maxY = chartRoot.effectiveMaxY;
-                    
-                    var xRange = maxX - minX;
-                    var yRange = maxY - minY;
-                    
-                    function toCanvasX(dataX) {
-                        return padding.left + ((dataX - minX) / xRange) * chartWidth;
-                    }
-                    
-                    function toCanvasY(dataY) {
-                        return padding.top + chartHeight - ((dataY - minY) / yRange) * chartHeight;
-                    }
-                    
-                    // 1. Заливаем фон области графика белым
-                    // ctx.fillStyle = "white"; // Старый код
-                    ctx.fillStyle = chartRoot.isDarkTheme ? "#333333" : "white"; // Новый код
-                    ctx.fillRect(padding.left, padding.top, chartWidth, chartHeight);
-                    
-                    // 2. Рисуем сетку
-                    // ctx.strokeStyle = "#BBBBBB"; // Старый цвет
-                    ctx.strokeStyle = chartRoot.isDarkTheme ? "#6E6E6E" : "#BBBBBB"; // Чуть светлее для темной темы
-                    ctx.lineWidth = 0.5;
-                    var numGridLinesX = 30; // Изменено с 20 до 30
-                    var numGridLinesY = 24; // Изменено с 16 до 24
-
-                    // Вертикальные линии сетки
-                    for (var i = 0; i <= numGridLinesX; i++) {
-                        var xPos = padding.left + (i / numGridLinesX) * chartWidth;
-                        ctx.beginPath();
-                        ctx.moveTo(xPos, padding.top);
-                        ctx.lineTo(xPos, padding.top + chartHeight);
-                        ctx.stroke();
-                    }
-
-                    // Горизонтальные линии сетки
-                    for (var i = 0; i <= numGridLinesY; i++) {
-                        var yPos = padding.top + (i / numGridLinesY) * chartHeight;
-                        ctx.beginPath();
-                        ctx.moveTo(padding.left, yPos);
-                        ctx.lineTo(padding.left + chartWidth, yPos);
-                        ctx.stroke();
-                    }
-
-                    // 3. Рисуем основные оси
-                    // ctx.strokeStyle = "#333333";
-                    ctx.strokeStyle = chartRoot.isDarkTheme ? "#A0A0A0" : "#333333";
-                    ctx.lineWidth = 1;
-                    // Ось Y
-                    ctx.beginPath();
-                    ctx.moveTo(padding.left, padding.top);
-                    ctx.lineTo(padding.left, padding.top + chartHeight);
-                    ctx.stroke();
-                    // Ось X
-                    ctx.beginPath();
-                    ctx.moveTo(padding.left, padding.top + chartHeight);
-                    ctx.lineTo(padding.left + chartWidth, padding.top + chartHeight);
-                    ctx.stroke();
-
-                    // 4. Рисуем нулевые линии (только для обычного режима, не для Пуанкаре)
-                    if (chartRoot.currentChartType !== "poincare") {
-                        // ctx.strokeStyle = "#000000"; // Старый цвет
-                        ctx.strokeStyle = chartRoot.isDarkTheme ? "#E0E0E0" : "#000000";
-                        ctx.lineWidth = 1.2;      // Увеличено с 1.0 до 1.2
-                        
-                        // Нулевая линия для Y
-                        if (minY <= 0 && maxY >= 0) {
-                            var yZero = toCanvasY(0);
-                            ctx.beginPath();
-                            ctx.moveTo(padding.left, yZero);
-                            ctx.lineTo(padding.left + chartWidth, yZero);
-                            ctx.stroke();
-                        }
-                        
-                        // Нулевая линия для X
-                        if (minX <= 0 && maxX >= 0) {
-                            var xZero = toCanvasX(0);
-                            ctx.beginPath();
-                            ctx.moveTo(xZero, padding.top);
-                            ctx.lineTo(xZero, padding.top + chartHeight);
-                            ctx.stroke();
-                        }
-                    }
-                    
-                    // 5. Рисуем метки на осях (только для обычного режима, не для Пуанкаре)
-                    ctx.fillStyle = chartRoot.isDarkTheme ? "#E0E0E0" : "#111111"; // Ярче для темной, чуть темнее для светлой
-                    ctx.font = "bold 12px sans-serif"; // Увеличено с 11px до 12px и сделано жирным
-                    
-                    if (chartRoot.currentChartType !== "poincare") {
-                        // Метки для Y
-                        ctx.textAlign = "right";
-                        ctx.textBaseline = "middle";
-                        for (var i = 0; i <= numGridLinesY; i++) {
-                            var valY = maxY - (i / numGridLinesY) * yRange;
-                            var yPos = padding.top + (i / numGridLinesY) * chartHeight;
-                            
-                            // Проверка на нулевое значение для особого выделения
-                            var isZeroY = Math.abs(valY) < 0.0001;
-                            
-                            var textHeightApproximation = 9; // Приблизительная высота для шрифта 9px
-                            var skipThisYLabel = false;
-                            
-                            // Пропускаем метку, только если она очень близко к нижнему краю (оси X)
-                            if (i === numGridLinesY && yPos > padding.top + chartHeight - textHeightApproximation / 1.5) {
-                                skipThisYLabel = true;
-                            }
-                            
-                            // Пропускаем метку, если она очень близко к верхнему краю графика
-                            if (i === 0 && yPos < padding.top + textHeightApproximation / 1.5) {
-                                skipThisYLabel = true;
-                            }
-                            
-                            if (!skipThisYLabel) {
-                                var decimals = 2; // Default precision
-                                if (yAxisSelector.currentText.includes("°")) { // Changed from "град"
-                                    decimals = 1; // Меньше десятичных знаков для углов
-                                } else if (yAxisSelector.currentText.includes("энергия")) {
-                                    decimals = 3; // Больше десятичных знаков для энергий
-                                }
-                                
-                                // Общий цвет для меток
-                                var labelColor = chartRoot.isDarkTheme ? "#DCDCDC" : "#333333"; // Светлее для темной темы
-                                ctx.fillStyle = labelColor;
-                                ctx.fillText(valY.toFixed(decimals), padding.left - 5, yPos);
-                            }
-                        }
-
-                        // Метки для X
-                        ctx.textAlign = "center";
-                        ctx.textBaseline = "top";
-                        var lastLabelEndX_regular = -Infinity; // Координата X правого края последней нарисованной метки
-                        var labelSpacingBuffer_regular = 5;  // Минимальный отступ в пикселях между метками
-
-                        for (var i = 0; i <= numGridLinesX; i++) {
-                            var valX = minX + (i / numGridLinesX) * xRange;
-                            var xPos = padding.left + (i / numGridLinesX) * chartWidth;
-                            
-                            var decimals = 1; // Default precision
-                            if (xAxisSelector.currentText.includes("°")) { // Changed from "град"
-                                decimals = 1;
-                            } else if (xAxisSelector.currentText === "t, с") {
-                                decimals = 1;
-                            }
-                            
-                            var labelText = valX.toFixed(decimals);
-                            var textWidth = ctx.measureText(labelText).width;
-                            var labelStartX = xPos - textWidth / 2;
-                            var labelEndX = xPos + textWidth / 2;
-                            
-                            var skipThisXLabel = false;
-                            // Пропускаем метку, если она слишком близко к левому краю (оси Y)
-                            if (i === 0 && xPos < padding.left + textWidth / 1.5) {
-                                skipThisXLabel = true;
-                            }
-                            
-                            // Пропускаем метку, если она слишком близко к правому краю графика
-                            if (i === numGridLinesX && xPos > padding.left + chartWidth - textWidth / 1.5) {
-                                skipThisXLabel = true;
-                            }
-                            
-                            // Пропускаем метку, если она накладывается на предыдущую метку
-                            if (labelStartX < lastLabelEndX_regular + labelSpacingBuffer_regular) {
-                                skipThisXLabel = true;
-                            }
-                            
-                            if (!skipThisXLabel) {
-                                var labelColor = chartRoot.isDarkTheme ? "#DCDCDC" : "#333333"; // Светлее для темной темы
-                                ctx.fillStyle = labelColor;
-                                ctx.fillText(labelText, xPos, padding.top + chartHeight + 6);
-                                lastLabelEndX_regular = labelEndX; // Обновляем позицию края последней нарисованной метки
-                            }
-                        }
-                        
-                        // Рисуем заголовки осей для обычного графика
-                        var yLabel = yAxisSelector.currentText;
-                        ctx.save();
-                        ctx.textAlign = "center";
-                        ctx.textBaseline = "bottom";
-                        ctx.translate(padding.left - 45, padding.top + chartHeight / 2);
-                        ctx.rotate(-Math.PI / 2);
-                        ctx.fillStyle = chartRoot.isDarkTheme ? "#F0F0F0" : "#000000"; // Очень яркий для темной темы
-                        ctx.font = "bold 13px sans-serif"; // Крупнее и жирнее
-                        ctx.fillText(yLabel, 0, 0);
-                        ctx.restore();
-
-                        ctx.textAlign = "center";
-                        ctx.textBaseline = "top";
-                        ctx.fillStyle = chartRoot.isDarkTheme ? "#F0F0F0" : "#000000"; // Очень яркий для темной темы
-                        ctx.font = "bold 13px sans-serif"; // Крупнее и жирнее
-                        ctx.fillText(xAxisSelector.currentText, padding.left + chartWidth / 2, padding.top + chartHeight + 20);
-                    } else {
-                        // Обновляем заголовки осей для карты Пуанкаре
-                        ctx.fillStyle = chartRoot.isDarkTheme ? "#F0F0F0" : "#000000"; // Очень яркий для темной темы
-                        ctx.font = "bold 13px sans-serif"; // Крупнее и жирнее
-                        
-                        // Заголовок оси Y (omega2)
-                        ctx.save();
-                        ctx.textAlign = "center";
-                        ctx.textBaseline = "bottom";
-                        ctx.translate(padding.left - 35, padding.top + chartHeight / 2);
-                        ctx.rotate(-Math.PI / 2);
-                        ctx.fillText("ω₂, рад/с", 0, 0);
-                        ctx.restore();
-                        
-                        // Заголовок оси X (theta2)
-                        ctx.textAlign = "center";
-                        ctx.textBaseline = "top";
-                        ctx.fillText("θ₂, рад", padding.left + chartWidth / 2, padding.top + chartHeight + 20);
-                        
-                        // Добавляем числовые метки для карты Пуанкаре
-                        
-                        // Метки для оси Y (omega2)
-                        ctx.fillStyle = chartRoot.isDarkTheme ? "#E0E0E0" : "#111111";
-                        ctx.font = "bold 12px sans-serif";
-                        ctx.textAlign = "right";
-                        ctx.textBaseline = "middle";
-                        
-                        for (var i = 0; i <= numGridLinesY; i++) {
-                            var valY = maxY - (i / numGridLinesY) * yRange;
-                            var yPos = padding.top + (i / numGridLinesY) * chartHeight;
-                            
-                            var textHeightApproximation = 9;
-                            var skipThisYLabel = false;
-                            
-                            // Пропускаем метку, если она очень близко к нижнему краю
-                            if (i === numGridLinesY && yPos > padding.top + chartHeight - textHeightApproximation / 1.5) {
-                                skipThisYLabel = true;
-                            }
-                            
-                            // Пропускаем метку, если она очень близко к верхнему краю графика
-                            if (i === 0 && yPos < padding.top + textHeightApproximation / 1.5) {
-                                skipThisYLabel = true;
-                            }
-                            
-                            if (!skipThisYLabel) {
-                                var labelColor = chartRoot.isDarkTheme ? "#DCDCDC" : "#333333";
-                                ctx.fillStyle = labelColor;
-                                ctx.fillText(valY.toFixed(2), padding.left - 5, yPos);
-                            }
-                        }
-                        
-                        // Метки для оси X (theta2)
-                        ctx.textAlign = "center";
-                        ctx.textBaseline = "top";
-                        var lastLabelEndX = -Infinity; // Координата X правого края последней нарисованной метки
-                        var labelSpacingBuffer = 5;  // Минимальный отступ в пикселях между метками
-
-                        // Используем оригинальное количество линий сетки для расчета потенциальных позиций меток
-                        var numPotentialLabelsX = 20; // или 30, как было для других графиков, или ваше предпочтительное значение
-
-                        for (var i = 0; i <= numPotentialLabelsX; i++) {
-                            var valX = minX + (i / numPotentialLabelsX) * xRange;
-                            var xPos = padding.left + (i / numPotentialLabelsX) * chartWidth;
-
-                            var decimals = 2; // Для карты Пуанкаре (радианы)
-                            var labelText = valX.toFixed(decimals);
-                            var textWidth = ctx.measureText(labelText).width;
-                            var labelStartX = xPos - textWidth / 2;
-                            var labelEndX = xPos + textWidth / 2;
-
-                            // Пропускаем метку, если она слишком близко к левому краю (оси Y),
-                            // или если она слишком близко к правому краю графика,
-                            // ИЛИ если она накладывается на предыдущую метку
-                            var skipThisXLabel = false;
-                            if (i === 0 && xPos < padding.left + textWidth / 1.5) { // Слишком близко к оси Y
-                                skipThisXLabel = true;
-                            }
-                            if (i === numPotentialLabelsX && xPos > padding.left + chartWidth - textWidth / 1.5) { // Слишком близко к правому краю
-                                skipThisXLabel = true;
-                            }
-                            if (labelStartX < lastLabelEndX + labelSpacingBuffer) { // Накладывается на предыдущую
-                                skipThisXLabel = true;
-                            }
-
-                            if (!skipThisXLabel) {
-                                var labelColor = chartRoot.isDarkTheme ? "#DCDCDC" : "#333333";
-                                ctx.fillStyle = labelColor;
-                                ctx.fillText(labelText, xPos, padding.top + chartHeight + 6);
-                                lastLabelEndX = labelEndX; // Обновляем позицию края последней нарисованной метки
-                            }
-                        }
-                    }
-                }
-            }
-            
-            // Скрытый холст для линий данных
-            Canvas {
-                id: dataLineOffscreenCanvas
-                width: lineChartCanvas.width
-                height: lineChartCanvas.height
-                visible: false
-                antialiasing: true
-                
-                Connections {
-                    target: chartRoot
-                    function onThemeChangedSignal() {
-                        // console.log("dataLineOffscreenCanvas: Theme changed signal received. Requesting paint.");
-                        dataLineOffscreenCanvas.requestPaint();
-                    }
-                }
-                
-                onPaint: {
-                    // console.log("dataLineOffscreenCanvas onPaint. isDarkTheme:", chartRoot.isDarkTheme); // Для отладки
-                    if (width <= 0 || height <= 0) return;
-                    
-                    var ctx = getContext("2d");
-                    if (!ctx) return;
-                    
-                    ctx.clearRect(0, 0, width, height);
-                    
-                    var padding = { top: 10, right: 20, bottom: 40, left: 60 };
-                    var chartWidth = width - padding.left - padding.right;
-                    var chartHeight = height - padding.top - padding.bottom;
-                    
-                    if (chartWidth <= 0 || chartHeight <= 0) return;
-                    
-                    // Используем сохраненные эффективные значения масштабирования
-                    var minX = chartRoot.effectiveMinX;
-                    var maxX = chartRoot.effectiveMaxX;
-                    var minY = chartRoot.effectiveMinY;
-                    var maxY = chartRoot.effectiveMaxY;
-                    
-                    var xRange = maxX - minX;
-                    var yRange = maxY - minY;
-                    
-                    function toCanvasX(dataX) {
-                        return padding.left + ((dataX - minX) / xRange) * chartWidth;
-                    }
-                    
-                    function toCanvasY(dataY) {
-                        return padding.top + chartHeight - ((dataY - minY) / yRange) * chartHeight;
-                    }
-                    
-                    var data = chartRoot.chartData;
-                    if (!data || data.length < 1) return;
-                    
-                    if (chartRoot.currentChartType === "poincare") {
-                        // Отрисовка точек Карты Пуанкаре из всех серий
-                        var pointRadius = chartRoot.poincarePointRadius; // Используем динамический радиус
-                        
-                        // Рисуем все сохраненные серии
-                        for (var seriesIndex = 0; seriesIndex < chartRoot.poincareSeriesList.length; seriesIndex++) {
-                            var series = chartRoot.poincareSeriesList[seriesIndex];
-                            ctx.fillStyle = series.color; // Используем цвет из серии
-                            
-                            // Рисуем все точки серии
-                            for (var i = 0; i < series.points.length; ++i) {
-                                var canvasX = toCanvasX(series.points[i].x); // .x это theta2
-                                var canvasY = toCanvasY(series.points[i].y); // .y это omega2
-
-                                // Рисуем кружок
-                                ctx.beginPath();
-                                ctx.arc(canvasX, canvasY, pointRadius, 0, 2 * Math.PI);
-                                ctx.fill();
-                            }
-                        }
-                    } else {
-                        // Обычная отрисовка линии графика
-                        var lineColor = "black"; // Дефолтный цвет
-                        switch (yAxisSelector.currentText) {
-                            case "θ₁, °": // Changed from "град"
-                            case "ω₁, рад/с":
-                                lineColor = "red"; // Цвет первого боба
-                                break;
-                            case "θ₂, °": // Changed from "град"
-                            case "ω₂, рад/с":
-                                lineColor = "blue"; // Цвет второго боба
-                                break;
-                            case "T, Дж":
-                                lineColor = "green";
-                                break;
-                            case "V, Дж":
-                                lineColor = "purple";
-                                break;
-                            case "E, Дж":
-                                lineColor = "black";
-                                break;
-                        }
-                        // ctx.strokeStyle = lineColor; // Старый
-                        ctx.strokeStyle = chartRoot.isDarkTheme ? (lineColor === "black" ? "white" : Qt.lighter(lineColor, 1.5)) : lineColor;
-                        ctx.lineWidth = 1; // Тонкая линия для данных
-                        ctx.beginPath();
-                        ctx.moveTo(toCanvasX(data[0].x), toCanvasY(data[0].y));
-                        for (var j = 1; j < data.length; ++j) {
-                            ctx.lineTo(toCanvasX(data[j].x), toCanvasY(data[j].y));
-                        }
-                        ctx.stroke();
-                    }
+                    // Применяем новые границы
+                    chartView.viewMinX = newMinX;
+                    chartView.viewMaxX = newMaxX;
                 }
             }
         }
@@ -1466,6 +834,27 @@ Rectangle {
                     visible: chartRoot.currentChartType === "poincare" // Явное управление видимостью, а не только прозрачностью
                     Behavior on opacity { NumberAnimation { duration: 300 } }
                     spacing: 10
+
+                    Label {
+                        text: "Сечение:"
+                        Layout.alignment: Qt.AlignVCenter
+                        color: chartRoot.isDarkTheme ? "white" : "#333333"
+                    }
+
+                    // Пересечения ищутся точно на плотном выводе интегратора; смена сечения очищает карту
+                    ComboBox {
+                        id: poincareSectionSelector
+                        Layout.preferredWidth: 90
+                        Layout.preferredHeight: 24
+                        model: ["θ₁ = 0", "θ₂ = 0", "ω₁ = 0"]
+                        currentIndex: mainWindow.pendulumObj ? mainWindow.pendulumObj.poincareSection : 0
+                        onActivated: {
+                            if (!mainWindow.pendulumObj || mainWindow.pendulumObj.poincareSection === currentIndex) return;
+                            mainWindow.pendulumObj.poincareSection = currentIndex;
+                            chartView.clearPoincareSeries();
+                            chartView.beginPoincareSeries(chartRoot.poincareColors[chartRoot.currentColorIndex]);
+                        }
+                    }
                     
                     Row {
                         id: colorPalette
@@ -1484,22 +873,9 @@ Rectangle {
                                 MouseArea {
                                     anchors.fill: parent
                                     onClicked: {
-                                        // 1. "Завершаем" текущую активную серию (она уже есть в poincareSeriesList)
-                                        var activeSeriesIndex = chartRoot.poincareSeriesList.length - 1;
-                                        if (activeSeriesIndex >= 0) {
-                                            var latestPoints = mainWindow.pendulumObj.getPoincareMapPoints();
-                                            // Обновляем точки последней (теперь уже "старой") активной серии
-                                            // только если в C++ буфере есть новые точки
-                                            if (latestPoints.length > 0) {
-                                                chartRoot.poincareSeriesList[activeSeriesIndex].points = latestPoints;
-                                                // console.log("Finalized series with color " + chartRoot.poincareSeriesList[activeSeriesIndex].color + 
-                                                //             " and " + latestPoints.length + " points before switching color.");
-                                            } else {
-                                                // console.log("Preserved series with color " + chartRoot.poincareSeriesList[activeSeriesIndex].color + 
-                                                //             " and " + chartRoot.poincareSeriesList[activeSeriesIndex].points.length + 
-                                                //             " existing points before switching color (C++ buffer empty).");
-                                            }
-                                        }
+                                        // 1. "Завершаем" текущую активную серию: точки из C++ буфера
+                                        // переносятся в неё, только если они там есть
+                                        chartView.finalizePoincareSeries();
                                         
                                         // 2. Устанавливаем НОВЫЙ текущий цвет
                                         chartRoot.currentColorIndex = index; // index из Repeater
@@ -1508,12 +884,8 @@ Rectangle {
                                         mainWindow.pendulumObj.clearPoincareMapPoints();
                                         
                                         // 4. Добавить НОВУЮ АКТИВНУЮ серию с новым цветом и пустыми точками
-                                        chartRoot.poincareSeriesList.push({
-                                            "color": chartRoot.poincareColors[chartRoot.currentColorIndex],
-                                            "points": []
-                                        });
+                                        chartView.beginPoincareSeries(chartRoot.poincareColors[chartRoot.currentColorIndex]);
                                         
-                                        // console.log("Started new Poincare series with color:", chartRoot.poincareColors[chartRoot.currentColorIndex]);
                                         updateChartDataAndPaint(); // Обновить отображение
                                     }
                                 }
@@ -1545,8 +917,7 @@ Rectangle {
                         }
                         
                         onValueChanged: {
-                            chartRoot.poincarePointRadius = value / 10.0;
-                            lineChartCanvas.requestPaint(); // Перерисовать с новым размером точек
+                            chartRoot.poincarePointRadius = value / 10.0; // chartView перерисует точки сам
                         }
                     }
                     
@@ -1565,20 +936,13 @@ Rectangle {
                         flat: true
                         background: Item {}
                         onClicked: {
-                            chartRoot.poincareSeriesList = []; // Очищаем список серий в QML
                             chartRoot.currentColorIndex = 0;   // Сбрасываем индекс цвета
                             if (mainWindow.pendulumObj) {
                                 mainWindow.pendulumObj.clearPoincareMapPoints(); // Очищаем буфер точек в C++
                             }
+                            chartView.clearPoincareSeries(); // Очищаем серии в chartView
                             // Создаем первую "пустую" активную серию для новых точек
-                            if (chartRoot.poincareSeriesList.length === 0 && mainWindow.pendulumObj) {
-                                chartRoot.poincareSeriesList.push({
-                                    "color": chartRoot.poincareColors[chartRoot.currentColorIndex],
-                                    "points": []
-                                });
-                            }
-                            lineChartCanvas.requestPaint(); // Перерисовать пустую карту
-                            // console.log("Poincare map cleared.");
+                            chartView.beginPoincareSeries(chartRoot.poincareColors[chartRoot.currentColorIndex]);
                         }
                     }
                 }
@@ -1651,15 +1015,31 @@ Rectangle {
             }
             
             Label {
-                text: "Epsilon:"
+                text: "Критерий:"
                 visible: rdpEnabledCheckBox.checked
                 Layout.alignment: Qt.AlignRight | Qt.AlignVCenter
                 color: chartRoot.isDarkTheme ? "white" : "#333333"
             }
+
+            ComboBox {
+                id: rdpModeComboBox
+                visible: rdpEnabledCheckBox.checked
+                model: ["Epsilon", "Число точек"]
+                currentIndex: 0
+                Layout.preferredWidth: 130
+                onCurrentIndexChanged: chartRoot.updateChartDataAndPaint()
+            }
+
+            Label {
+                text: "Epsilon:"
+                visible: rdpEnabledCheckBox.checked && rdpModeComboBox.currentIndex === 0
+                Layout.alignment: Qt.AlignRight | Qt.AlignVCenter
+                color: chartRoot.isDarkTheme ? "white" : "#333333"
+            }
             
             SpinBox {
                 id: rdpEpsilonSpinBox
-                visible: rdpEnabledCheckBox.checked
+                visible: rdpEnabledCheckBox.checked && rdpModeComboBox.currentIndex === 0
                 from: 1    // 0.01 в реальности
                 to: 1000   // 10.00 в реальности
                 stepSize: 1
@@ -1676,6 +1056,26 @@ Rectangle {
                 
                 onValueChanged: chartRoot.updateChartDataAndPaint()
             }
+
+            Label {
+                text: "Точек:"
+                visible: rdpEnabledCheckBox.checked && rdpModeComboBox.currentIndex === 1
+                Layout.alignment: Qt.AlignRight | Qt.AlignVCenter
+                color: chartRoot.isDarkTheme ? "white" : "#333333"
+            }
+
+            // Сколько точек оставить: самые значимые, при любом масштабе данных
+            SpinBox {
+                id: rdpTargetSpinBox
+                visible: rdpEnabledCheckBox.checked && rdpModeComboBox.currentIndex === 1
+                from: 100
+                to: 50000
+                stepSize: 100
+                value: 2000
+                Layout.preferredWidth: 70
+
+                onValueChanged: chartRoot.updateChartDataAndPaint()
+            }
             
             CheckBox {
                 id: limitPointsEnabledCheckBox
@@ -1760,7 +1160,7 @@ Rectangle {
             }
             
             // console.log("QML: Saving chart as PNG to:", localFilePath);
-            lineChartCanvas.grabToImage(function(result) {
+            chartArea.grabToImage(function(result) {
                 result.saveToFile(localFilePath);
                 // console.log("QML: Chart image saved successfully to:", localFilePath);
             });
@@ -1779,18 +1179,13 @@ Rectangle {
             // Переключаемся В режим Пуанкаре
             currentChartType = "poincare";
             
-            // Создаем новую серию для точек Пуанкаре, если нужно
-            if (poincareSeriesList.length === 0 || 
-                (poincareSeriesList.length > 0 && mainWindow.pendulumObj)) {
+            // Создаем новую серию для точек Пуанкаре
+            if (mainWindow.pendulumObj) {
                 // Очищаем буфер точек в C++ перед созданием новой серии
                 mainWindow.pendulumObj.clearPoincareMapPoints();
-                
-                // Добавляем новую серию с текущим цветом
-                poincareSeriesList.push({
-                    "color": poincareColors[currentColorIndex],
-                    "points": []
-                });
             }
+            // Добавляем новую серию с текущим цветом
+            chartView.beginPoincareSeries(poincareColors[currentColorIndex]);
         }
         
         // Явно обновляем состояние UI-элементов, зависящих от режима
@@ -1824,14 +1219,6 @@ Rectangle {
             if (yAxisSelectorText) yAxisSelectorText.text = yAxisSelector.currentText;
         }
 
-        Qt.callLater(function() {
-            updateChartDataAndPaint();
-
-            Qt.callLater(function() {
-                if (lineChartCanvas && lineChartCanvas.available) {
-                    lineChartCanvas.requestPaint();
-                }
-            });
-        });
+        Qt.callLater(updateChartDataAndPaint);
     }
 }
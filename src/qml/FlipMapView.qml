@@ -0,0 +1,187 @@
+import QtQuick 2.15
+import QtQuick.Controls 2.15
+import QtQuick.Layouts 1.15
+import QtQuick.Dialogs
+
+// Time-to-flip fractal: one simulation per pixel over (theta1, theta2) at rest.
+// The map is computed by the C++ FlipMapController ("flipMap" context property)
+// and shown progressively as tiles finish.
+Popup {
+    id: flipMapPopup
+    x: 0
+    y: 0
+    width: parent.width
+    height: parent.height
+    modal: true
+    focus: true
+    closePolicy: Popup.CloseOnEscape
+    padding: 20
+
+    property color textColor: mainWindow.isDarkTheme ? "#E0E0E0" : "#333333"
+    property color secondaryTextColor: mainWindow.isDarkTheme ? "#AAAAAA" : "#666666"
+
+    background: Rectangle {
+        color: mainWindow.isDarkTheme ? "#3A3A3A" : "#F5F5F5"
+        border.color: mainWindow.isDarkTheme ? "#555555" : "#C0C0C0"
+    }
+
+    Button {
+        id: closeIcon
+        anchors.top: parent.top
+        anchors.right: parent.right
+        anchors.margins: 5
+        z: 1
+
+        icon.source: "qrc:/icons/cross.svg"
+        icon.width: 18
+        icon.height: 18
+        icon.color: mainWindow.isDarkTheme ? "#CCCCCC" : "#333333"
+
+        flat: true
+        background: Item {}
+        onClicked: flipMapPopup.close()
+
+        ToolTip.text: "Закрыть (Esc)"
+        ToolTip.visible: hovered
+    }
+
+    ColumnLayout {
+        anchors.fill: parent
+        spacing: 8
+
+        Label {
+            text: qsTr("Карта времени переворота")
+            Layout.alignment: Qt.AlignHCenter
+            Layout.topMargin: 10
+            font.bold: true
+            font.pixelSize: 22
+            color: flipMapPopup.textColor
+        }
+
+        Label {
+            text: qsTr("Каждый пиксель — отдельная симуляция из состояния покоя с текущими параметрами (массы стержней и трение учитываются). Цвет показывает, когда один из стержней впервые перевернулся через верх.")
+            Layout.fillWidth: true
+            wrapMode: Text.WordWrap
+            horizontalAlignment: Text.AlignHCenter
+            color: flipMapPopup.secondaryTextColor
+        }
+
+        RowLayout {
+            Layout.alignment: Qt.AlignHCenter
+            spacing: 10
+
+            Label { text: qsTr("Разрешение:"); color: flipMapPopup.textColor }
+            ComboBox {
+                id: resolutionComboBox
+                model: [256, 512, 1024, 2048]
+                enabled: !flipMap.running
+                currentIndex: Math.max(0, model.indexOf(flipMap.resolution))
+                onActivated: flipMap.resolution = model[currentIndex]
+            }
+
+            Label { text: qsTr("Время, с:"); color: flipMapPopup.textColor }
+            SpinBox {
+                id: durationSpinBox
+                from: 1
+                to: 100
+                value: flipMap.duration
+                enabled: !flipMap.running
+                editable: true
+                onValueModified: flipMap.duration = value
+            }
+
+            Button {
+                text: flipMap.running ? qsTr("Остановить") : qsTr("Построить")
+                onClicked: {
+                    if (flipMap.running) {
+                        flipMap.cancel();
+                    } else {
+                        flipMap.start(mainWindow.pendulumObj);
+                    }
+                }
+            }
+
+            Button {
+                text: qsTr("Сохранить")
+                enabled: !flipMap.running && flipMap.imageRevision > 0
+                onClicked: flipMapSaveDialog.open()
+            }
+        }
+
+        RowLayout {
+            Layout.fillWidth: true
+            spacing: 10
+
+            ProgressBar {
+                Layout.fillWidth: true
+                from: 0
+                to: 1
+                value: flipMap.progress
+            }
+            Label {
+                text: Math.round(flipMap.progress * 100) + "%  " + flipMap.elapsedSeconds.toFixed(1) + " с"
+                color: flipMapPopup.secondaryTextColor
+            }
+        }
+
+        // Map with axis labels: theta1 along x, absolute theta2 along y (top = +180°)
+        Item {
+            Layout.fillWidth: true
+            Layout.fillHeight: true
+
+            Image {
+                id: mapImage
+                anchors.centerIn: parent
+                width: Math.min(parent.width - 60, parent.height - 40)
+                height: width
+                fillMode: Image.PreserveAspectFit
+                smooth: false
+                cache: false
+                // A new revision makes the provider hand over a fresh copy of the map
+                source: flipMap.imageRevision > 0 ? "image://flipmap/" + flipMap.imageRevision : ""
+
+                Rectangle {
+                    anchors.fill: parent
+                    color: "transparent"
+                    border.color: mainWindow.isDarkTheme ? "#666666" : "#AAAAAA"
+                }
+
+                Label {
+                    anchors.top: parent.bottom
+                    anchors.topMargin: 4
+                    anchors.horizontalCenter: parent.horizontalCenter
+                    text: "θ₁: −180° … 180°"
+                    color: flipMapPopup.textColor
+                }
+
+                Label {
+                    anchors.right: parent.left
+                    anchors.rightMargin: 6
+                    anchors.verticalCenter: parent.verticalCenter
+                    text: "θ₂\n180°\n…\n−180°"
+                    horizontalAlignment: Text.AlignHCenter
+                    color: flipMapPopup.textColor
+                }
+            }
+        }
+
+        Label {
+            text: qsTr("Красный — быстрый переворот, фиолетовый — поздний (логарифмическая шкала), тёмный — переворота не было.")
+            Layout.alignment: Qt.AlignHCenter
+            color: flipMapPopup.secondaryTextColor
+        }
+    }
+
+    FileDialog {
+        id: flipMapSaveDialog
+        title: qsTr("Сохранить карту переворотов")
+        fileMode: FileDialog.SaveFile
+        nameFilters: ["PNG Images (*.png)", "16-bit PGM (*.pgm)"]
+        defaultSuffix: "png"
+        onAccepted: {
+            if (!flipMap.saveImage(flipMapSaveDialog.selectedFile)) {
+                console.warn("FlipMapView: failed to save " + flipMapSaveDialog.selectedFile);
+            }
+        }
+    }
+}
@@ -96,6 +96,7 @@ Popup {
                         <ul style="font-size:14px;">
                             <li><b>Переключатель режимов:</b> Переключает интерфейс между режимами "Симуляция" и "Анализ".</li>
                             <li><b>Добавить график (+):</b> Появляется в режиме "Анализ" и создает новое окно для построения графика.</li>
+                            <li><b>Карта переворотов:</b> Строит фрактал времени первого переворота по сетке начальных углов θ₁ × θ₂ с текущими параметрами; карта заполняется по мере расчёта.</li>
                             <li><b>Настройки (⚙️):</b> Открывает диалог для настройки параметров 3D-графики и отображения FPS.</li>
                             <li><b>Справка (?):</b> Открывает это руководство.</li>
                             <li><b>Смена темы (солнце/луна):</b> Мгновенно переключает оформление между светлой и темной темами.</li>
@@ -125,7 +126,7 @@ Popup {
                         </ul>
 
                         <p style="font-size:16px;"><b>Карта Пуанкаре: Особые возможности</b></p>
-                        <p style="font-size:14px;">Карта Пуанкаре — мощнейший инструмент для визуализации хаоса. Она показывает состояние системы (ω₂ от θ₂) каждый раз, когда маятник пересекает плоскость θ₁=0.</p>
+                        <p style="font-size:14px;">Карта Пуанкаре — мощнейший инструмент для визуализации хаоса. Она показывает состояние системы (ω₂ от θ₂) каждый раз, когда маятник пересекает плоскость θ₁=0. Сечение можно сменить на θ₂=0 (тогда точки — ω₁ от θ₁) или ω₁=0 (точки поворота первого стержня); момент пересечения находится точно, по интерполяции внутри шага интегратора.</p>
                         <ul style="font-size:14px;">
                              <li><b>Сравнительный анализ:</b> Палитра цветов позволяет накладывать несколько симуляций (аттракторов) друг на друга. Запустите одну, смените цвет, измените параметры, сбросьте и запустите снова. Старые точки останутся на карте.</li>
                              <li><b>Размер точек и Очистка (🗑️):</b> Позволяют настроить вид и удалить все точки с карты.</li>
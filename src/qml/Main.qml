@@ -10,6 +10,7 @@ import "qrc:/models/" // Добавляем импорт для доступа 
 // Import ParameterStepper component
 import "qrc:/"
 import QtQuick.Dialogs
+import DoublePendulum 1.0 // FrameScheduler
 // Import our new component
 import "."
 
@@ -154,12 +155,8 @@ Window {
     
     // ВСТАВИТЬ НОВУЮ ФУНКЦИЮ ЗДЕСЬ
     function forceFullRedrawOfOffscreenTraces() {
-        if (traceDrawer && pendulumObj) {
-            traceDrawer.clearAllTraces();
-            traceDrawer.updateAndDrawNewTraceSegments(true);
-            if (pendulumCanvas && pendulumCanvas.available) {
-                pendulumCanvas.requestPaint(); // Request repaint to display the updated traces
-            }
+        if (pendulumCanvas && pendulumObj) {
+            pendulumCanvas.forceFullRedrawOfOffscreenTraces();
         }
     }
 
@@ -271,8 +268,8 @@ Window {
                         mainWindow.analysisModeActive = !mainWindow.analysisModeActive;
 
                         if (mainWindow.analysisModeActive) {
-                            if (simulationTimer.running) {
-                                simulationTimer.stop();
+                            if (frameScheduler.running) {
+                                frameScheduler.stop();
                             }
                             // When switching to analysis mode, update all charts once immediately
                             if (chartsColumnLayout) {
@@ -283,10 +280,7 @@ Window {
                                     }
                                 }
                             }
-                            // The master timer's "running" property will handle starting/stopping automatically
-                        } else {
-                            // Stop master timer when exiting analysis mode
-                            masterChartUpdateTimer.stop();
+                            // While the simulation runs, frameScheduler.chartTick keeps them updated
                         }
                     }
                 }
@@ -315,6 +309,50 @@ Window {
                     }
                 }
                 
+                Button {
+                    id: flipMapButton
+                    text: ""
+                    icon.source: "qrc:/icons/dots.svg"
+                    icon.width: 26
+                    icon.height: 26
+                    icon.color: mainWindow.isDarkTheme ? "#CCCCCC" : "#333333"
+                    Layout.preferredWidth: 40
+                    Layout.preferredHeight: 40
+                    Layout.alignment: Qt.AlignVCenter
+                    ToolTip.text: qsTr("Карта времени переворота")
+                    ToolTip.visible: hovered
+                    padding: 2
+                    flat: true
+                    background: Item {}
+                    onClicked: flipMapView.open()
+                }
+
+                // Воспроизведение записанной траектории (.dptraj); в режиме воспроизведения кнопка закрывает запись
+                Button {
+                    id: replayButton
+                    text: ""
+                    icon.source: pendulumObj && pendulumObj.replayActive ? "qrc:/icons/cross.svg" : "qrc:/icons/download.svg"
+                    icon.width: 26
+                    icon.height: 26
+                    icon.color: mainWindow.isDarkTheme ? "#CCCCCC" : "#333333"
+                    Layout.preferredWidth: 40
+                    Layout.preferredHeight: 40
+                    Layout.alignment: Qt.AlignVCenter
+                    ToolTip.text: pendulumObj && pendulumObj.replayActive ? qsTr("Закрыть запись и вернуться к симуляции")
+                                                                          : qsTr("Открыть запись траектории")
+                    ToolTip.visible: hovered
+                    padding: 2
+                    flat: true
+                    background: Item {}
+                    onClicked: {
+                        if (pendulumObj.replayActive) {
+                            pendulumObj.closeReplay();
+                        } else {
+                            replayOpenDialog.open();
+                        }
+                    }
+                }
+
                 Button {
                     id: settingsButton
                     icon.source: "qrc:/icons/settings.svg"
@@ -419,6 +457,20 @@ Window {
                         font.pixelSize: 16 // Увеличено с 14 до 16
                         font.bold: false 
                     }
+
+                    // Перемотка записи: виден только в режиме воспроизведения
+                    Slider {
+                        id: replaySlider
+                        visible: pendulumObj ? pendulumObj.replayActive : false
+                        Layout.preferredWidth: 160
+                        Layout.alignment: Qt.AlignVCenter
+                        from: pendulumObj ? pendulumObj.replayStartTime : 0
+                        to: pendulumObj ? pendulumObj.replayEndTime : 1
+                        value: pendulumObj ? pendulumObj.currentTime : 0
+                        onMoved: pendulumObj.seekReplay(value)
+                        ToolTip.text: qsTr("Воспроизведение записи: ") + (pendulumObj ? pendulumObj.replayPath : "")
+                        ToolTip.visible: hovered
+                    }
                 }
                 
                 // FPS display - REMOVED (moved to speedControlButtonsLayout)
@@ -510,6 +562,32 @@ Window {
                             color: mainWindow.isDarkTheme ? "white" : "black"
                             visible: mainWindow.fpsCounterVisible
                         }
+
+                        // Статистика регулятора шага: средний шаг и доля отклонённых попыток
+                        Text {
+                            id: stepStatisticsText
+                            text: "h: " + (pendulumObj.averageStepSize * 1000).toFixed(2) + " мс, откл.: "
+                                  + (pendulumObj.rejectedStepRatio * 100).toFixed(1) + "%"
+                            Layout.alignment: Qt.AlignVCenter
+                            font.pixelSize: 14
+                            Layout.leftMargin: 15
+                            color: mainWindow.isDarkTheme ? "white" : "black"
+                            visible: mainWindow.fpsCounterVisible
+                        }
+
+                        // Бюджет кадра: отставание физики от часов и пропущенные кадры с фазой-виновницей
+                        Text {
+                            id: frameBudgetText
+                            readonly property var metrics: frameScheduler.metrics
+                            text: metrics.lagMs === undefined ? "" :
+                                  "отставание: " + metrics.lagMs.toFixed(0) + " мс, пропуски: " + metrics.droppedFrames
+                                  + (metrics.lastDropCause ? " (" + metrics.lastDropCause + ")" : "")
+                            Layout.alignment: Qt.AlignVCenter
+                            font.pixelSize: 14
+                            Layout.leftMargin: 15
+                            color: mainWindow.isDarkTheme ? "white" : "black"
+                            visible: mainWindow.fpsCounterVisible && frameScheduler.running
+                        }
                     }
                 
                 Item { Layout.fillWidth: true } // Spacer
@@ -568,13 +646,13 @@ Window {
                             Layout.preferredHeight: 40
                             Layout.alignment: Qt.AlignVCenter
                             flat: true
-                            icon.source: simulationTimer.running ? "qrc:/icons/pause.svg" : "qrc:/icons/play.svg"
+                            icon.source: frameScheduler.running ? "qrc:/icons/pause.svg" : "qrc:/icons/play.svg"
                             icon.width: 26
                             icon.height: 26
                             icon.color: mainWindow.isDarkTheme ? "#CCCCCC" : "#333333"
                             padding: 2
                             background: Item {}
-                            onClicked: simulationTimer.running = !simulationTimer.running
+                            onClicked: frameScheduler.running = !frameScheduler.running
                         }
                         
                         Button {
@@ -593,11 +671,11 @@ Window {
                             background: Item {}
                             
                             // 1. УБРАЛИ 'visible'. Видимость контролируется ТОЛЬКО прозрачностью.
-                            opacity: simulationTimer.running ? 0.0 : 1.0
+                            opacity: frameScheduler.running ? 0.0 : 1.0
                             Behavior on opacity { NumberAnimation { duration: 200 } }
                             
                             // 2. Отключаем кнопку, когда она невидима, чтобы избежать случайных нажатий.
-                            enabled: !simulationTimer.running
+                            enabled: !frameScheduler.running
                             
                             // 3. Анимация ширины, запускаемая с задержкой, чтобы макет сдвигался плавно.
                             SequentialAnimation {
@@ -615,9 +693,9 @@ Window {
                             
                             // 4. Триггер, который запускает анимацию ширины при смене состояния.
                             Connections {
-                                target: simulationTimer
+                                target: frameScheduler
                                 function onRunningChanged() {
-                                    var targetWidth = simulationTimer.running ? 0 : 40;
+                                    var targetWidth = frameScheduler.running ? 0 : 40;
                                     widthAnimation.animations[1].to = targetWidth; // Устанавливаем целевую ширину
                                     widthAnimation.start(); // Запускаем последовательность (пауза -> анимация)
                                 }
@@ -864,7 +942,7 @@ Window {
                     // From the original block at line 2464 - simulation failure handling
                     function onSimulationFailedChanged() {
                         if (pendulumObj.simulationFailed) {
-                            simulationTimer.stop();
+                            frameScheduler.stop();
                             startStopButton.text = "Start";
                         }
                     }
@@ -2542,30 +2620,16 @@ Window {
         }
     }
 
-    // Timer to update the simulation
-    Timer {
-        id: simulationTimer
-        interval: {
-            if (mainWindow.limitFpsEnabled && mainWindow.targetMaxFps > 0) {
-                return Math.round(1000 / mainWindow.targetMaxFps);
-            } else {
-                return 16; // Default ~60 FPS
-            }
-        }
-        running: false
-        repeat: true
-        onTriggered: {
-            if (mainWindow.pendulumObj) {
-                mainWindow.pendulumObj.step(interval / 1000.0); // dt in seconds
-                mainWindow.frameCount++; // Increment frameCount here
-                
-                // Update trace paths only when needed (every 5th frame to optimize performance)
-                if (pendulumCanvas && pendulumCanvas.visible && pendulumCanvas.available) {
-                    // We rely on the Connections to pendulumObj.onStateChanged to update the off-screen traces
-                    // No need to call redrawOffscreenTraces() directly here
-                }
-            }
-        }
+    // Frame loop. The integrator runs on its own thread; the scheduler only paces
+    // the UI, collecting the finished steps and refreshing the charts within the
+    // frame budget. Its running state starts and pauses the simulation thread.
+    FrameScheduler {
+        id: frameScheduler
+        window: mainWindow
+        pendulum: mainWindow.pendulumObj
+        targetFps: mainWindow.limitFpsEnabled ? mainWindow.targetMaxFps : 60
+        chartInterval: 100 // Charts refresh 10 times per second
+        onFrame: mainWindow.frameCount++
     }
 
     // Add simulation failure handling
@@ -2573,7 +2637,7 @@ Window {
         target: pendulumObj
         function onSimulationFailedChanged() {
             if (pendulumObj.simulationFailed) {
-                simulationTimer.stop();
+                frameScheduler.stop();
                 startStopButton.text = "Start";
             }
         }
@@ -2624,14 +2688,11 @@ Window {
         }
     }
 
-    // Master timer for updating all charts
-    Timer {
-        id: masterChartUpdateTimer
-        interval: 100 // Update charts 10 times per second
-        repeat: true
-        running: mainWindow.analysisModeActive && simulationTimer.running
-        onTriggered: {
-            if (chartsColumnLayout) {
+    // Chart refresh, paced by the frame scheduler
+    Connections {
+        target: frameScheduler
+        function onChartTick() {
+            if (mainWindow.analysisModeActive && chartsColumnLayout) {
                 for (var i = 0; i < chartsColumnLayout.children.length; ++i) {
                     var chartPlaceholder = chartsColumnLayout.children[i];
                     // Update only visible charts
@@ -2648,7 +2709,7 @@ Window {
         id: settingsDialog
         title: qsTr("Настройки")
         width: 360
-        height: 325 
+        height: 500
         anchors.centerIn: parent
         modal: true
         standardButtons: Dialog.Ok | Dialog.Cancel
@@ -2658,6 +2719,10 @@ Window {
         property int  proxyAaQuality: 0 // Это всегда будет INT
         property bool proxyReflections: false
         property bool proxyShowFps: false
+        property int  proxySampleRateIndex: 0 // Индекс в sampleRateComboBox.rates
+        property int  proxyIntegratorMethod: 0 // DoublePendulum.IntegratorMethod
+        property string proxyToleranceProfile: "reference" // Пресет точности или "custom"
+        property bool proxyRecording: true // Запись траектории в .dptraj
         
         // --- Стилизация (без изменений) ---
         background: Rectangle { color: mainWindow.isDarkTheme ? "#424242" : "#F8F8F8"; border.color: mainWindow.isDarkTheme ? "#555555" : "#D0D0D0"; border.width: 1; radius: 4 }
@@ -2680,12 +2745,20 @@ Window {
                     proxyReflections = (partToCheck.materials[0].metalness > 0.5);
                 }
                 proxyShowFps = mainWindow.fpsCounterVisible;
+                proxySampleRateIndex = Math.max(0, sampleRateComboBox.rates.indexOf(pendulumObj.historySampleRate));
+                proxyIntegratorMethod = pendulumObj.integratorMethod;
+                proxyToleranceProfile = pendulumObj.toleranceProfile;
+                proxyRecording = pendulumObj.recording;
 
                 // 2. Устанавливаем значения для UI
                 aaCheckbox.checked = proxyAntialiasing;
                 aaQualityComboBox.currentIndex = proxyAaQuality;
                 reflectionsCheckbox.checked = proxyReflections;
                 showFpsCheckbox.checked = proxyShowFps;
+                sampleRateComboBox.currentIndex = proxySampleRateIndex;
+                integratorComboBox.currentIndex = proxyIntegratorMethod;
+                toleranceComboBox.currentIndex = toleranceComboBox.profiles.indexOf(proxyToleranceProfile);
+                recordingCheckbox.checked = proxyRecording;
             }
         }
 
@@ -2699,6 +2772,12 @@ Window {
             var targetMaterial = proxyReflections ? polishedAluminumMaterial : matteGrayMaterial;
             mainWindow.applyMaterialToPendulum(targetMaterial);
             mainWindow.fpsCounterVisible = proxyShowFps;
+            pendulumObj.historySampleRate = sampleRateComboBox.rates[proxySampleRateIndex];
+            pendulumObj.integratorMethod = proxyIntegratorMethod;
+            if (proxyToleranceProfile !== "custom") {
+                pendulumObj.toleranceProfile = proxyToleranceProfile;
+            }
+            pendulumObj.recording = proxyRecording;
         }
         
         // onRejected остается пустым, так как мы ничего не меняем до нажатия "OK"
@@ -2862,7 +2941,7 @@ Window {
                         
                         CheckBox {
                             id: showFpsCheckbox
-                            text: "Показывать FPS"
+                            text: "Показывать FPS и статистику шага"
                             checked: settingsDialog.proxyShowFps
                             onCheckedChanged: settingsDialog.proxyShowFps = checked
                             
@@ -2890,12 +2969,219 @@ Window {
                             }
                             contentItem: Text { text: parent.text; font: parent.font; color: mainWindow.isDarkTheme ? "#E0E0E0" : "#333333"; verticalAlignment: Text.AlignVCenter; leftPadding: parent.indicator.width + parent.spacing }
                         }
+
+                        // Потоковая запись истории в файл .dptraj (каталог recordingDirectory);
+                        // записи открываются кнопкой на панели инструментов
+                        CheckBox {
+                            id: recordingCheckbox
+                            text: "Записывать траекторию на диск"
+                            checked: settingsDialog.proxyRecording
+                            onCheckedChanged: settingsDialog.proxyRecording = checked
+
+                            indicator: Rectangle {
+                                width: 18; height: 18; radius: 4;
+                                x: parent.leftPadding;
+                                y: parent.topPadding + (parent.availableHeight - height) / 2;
+                                color: parent.checked ? (mainWindow.isDarkTheme ? "#6E6E6E" : "#777777") : "transparent";
+                                border.color: mainWindow.isDarkTheme ? "#AAAAAA" : "#777777";
+                                border.width: 2;
+                                Behavior on color { ColorAnimation { duration: 150 } }
+
+                                Text {
+                                    text: "✓"
+                                    anchors.centerIn: parent
+                                    visible: recordingCheckbox.checked
+                                    color: mainWindow.isDarkTheme ? "#FFFFFF" : "#FFFFFF"
+                                    font.pixelSize: 14
+                                    font.bold: true
+                                }
+                            }
+                            contentItem: Text { text: parent.text; font: parent.font; color: mainWindow.isDarkTheme ? "#E0E0E0" : "#333333"; verticalAlignment: Text.AlignVCenter; leftPadding: parent.indicator.width + parent.spacing }
+                        }
+
+                        // Плотность истории графиков: по шагу интегратора или по фиксированной
+                        // сетке симулированного времени (интерполяция внутри шага)
+                        RowLayout {
+                            width: parent.width
+                            spacing: 5
+
+                            Label {
+                                text: "Запись истории:"
+                                color: mainWindow.isDarkTheme ? "#E0E0E0" : "#333333"
+                                Layout.alignment: Qt.AlignVCenter
+                            }
+
+                            ComboBox {
+                                id: sampleRateComboBox
+                                readonly property var rates: [0, 100, 200, 500, 1000]
+                                Layout.preferredWidth: 150
+                                Layout.preferredHeight: 28
+                                model: ["Каждый шаг", "100 Гц", "200 Гц", "500 Гц", "1000 Гц"]
+
+                                currentIndex: settingsDialog.proxySampleRateIndex
+                                onCurrentIndexChanged: settingsDialog.proxySampleRateIndex = currentIndex
+
+                                palette.text: mainWindow.isDarkTheme ? "#E0E0E0" : "#222222"
+                                contentItem: Text {
+                                    text: parent.displayText
+                                    font: parent.font
+                                    color: parent.palette.text
+                                    verticalAlignment: Text.AlignVCenter
+                                    horizontalAlignment: Text.AlignHCenter
+                                    elide: Text.ElideRight
+                                }
+                                background: Rectangle { color: mainWindow.isDarkTheme ? "#444444" : "#DDDDDD"; radius: 3; border.color: mainWindow.isDarkTheme ? "#666666" : "#BBBBBB"; border.width: 1 }
+                                popup: Popup { y: sampleRateComboBox.height; width: sampleRateComboBox.width; implicitHeight: contentItem.implicitHeight; padding: 1; contentItem: ListView { clip: true; implicitHeight: contentHeight; model: sampleRateComboBox.popup.visible ? sampleRateComboBox.delegateModel : null; currentIndex: sampleRateComboBox.highlightedIndex; ScrollIndicator.vertical: ScrollIndicator { } } background: Rectangle { color: mainWindow.isDarkTheme ? "#444444" : "#FFFFFF"; border.color: mainWindow.isDarkTheme ? "#666666" : "#BBBBBB"; border.width: 1; radius: 2 } }
+                                delegate: ItemDelegate {
+                                    width: sampleRateComboBox.width
+                                    contentItem: Text {
+                                        text: modelData;
+                                        color: mainWindow.isDarkTheme ? "#E0E0E0" : "#222222";
+                                        font: sampleRateComboBox.font;
+                                        elide: Text.ElideRight;
+                                        verticalAlignment: Text.AlignVCenter;
+                                        horizontalAlignment: Text.AlignHCenter;
+                                        width: parent.width
+                                    }
+                                    highlighted: sampleRateComboBox.highlightedIndex === index;
+                                    background: Rectangle {
+                                        color: highlighted ? (mainWindow.isDarkTheme ? "#666666" : "#DDDDDD") : (mainWindow.isDarkTheme ? "#444444" : "#FFFFFF")
+                                    }
+                                }
+                            }
+
+                            Item { Layout.fillWidth: true }
+                        }
+
+                        // Схема интегрирования: адаптивные DP5 и DOP853 или симплектические методы
+                        // Гаусса–Лежандра с постоянным шагом (энергия без дрейфа при b = c = 0)
+                        RowLayout {
+                            width: parent.width
+                            spacing: 5
+
+                            Label {
+                                text: "Интегратор:"
+                                color: mainWindow.isDarkTheme ? "#E0E0E0" : "#333333"
+                                Layout.alignment: Qt.AlignVCenter
+                            }
+
+                            ComboBox {
+                                id: integratorComboBox
+                                Layout.preferredWidth: 170
+                                Layout.preferredHeight: 28
+                                model: ["DP5 (адаптивный)", "DOP853 (8-й порядок)", "Средняя точка", "Гаусс–Лежандр 4", "Гаусс–Лежандр 6", "Авто"]
+
+                                currentIndex: settingsDialog.proxyIntegratorMethod
+                                onCurrentIndexChanged: settingsDialog.proxyIntegratorMethod = currentIndex
+
+                                palette.text: mainWindow.isDarkTheme ? "#E0E0E0" : "#222222"
+                                contentItem: Text {
+                                    text: parent.displayText
+                                    font: parent.font
+                                    color: parent.palette.text
+                                    verticalAlignment: Text.AlignVCenter
+                                    horizontalAlignment: Text.AlignHCenter
+                                    elide: Text.ElideRight
+                                }
+                                background: Rectangle { color: mainWindow.isDarkTheme ? "#444444" : "#DDDDDD"; radius: 3; border.color: mainWindow.isDarkTheme ? "#666666" : "#BBBBBB"; border.width: 1 }
+                                popup: Popup { y: integratorComboBox.height; width: integratorComboBox.width; implicitHeight: contentItem.implicitHeight; padding: 1; contentItem: ListView { clip: true; implicitHeight: contentHeight; model: integratorComboBox.popup.visible ? integratorComboBox.delegateModel : null; currentIndex: integratorComboBox.highlightedIndex; ScrollIndicator.vertical: ScrollIndicator { } } background: Rectangle { color: mainWindow.isDarkTheme ? "#444444" : "#FFFFFF"; border.color: mainWindow.isDarkTheme ? "#666666" : "#BBBBBB"; border.width: 1; radius: 2 } }
+                                delegate: ItemDelegate {
+                                    width: integratorComboBox.width
+                                    contentItem: Text {
+                                        text: modelData;
+                                        color: mainWindow.isDarkTheme ? "#E0E0E0" : "#222222";
+                                        font: integratorComboBox.font;
+                                        elide: Text.ElideRight;
+                                        verticalAlignment: Text.AlignVCenter;
+                                        horizontalAlignment: Text.AlignHCenter;
+                                        width: parent.width
+                                    }
+                                    highlighted: integratorComboBox.highlightedIndex === index;
+                                    background: Rectangle {
+                                        color: highlighted ? (mainWindow.isDarkTheme ? "#666666" : "#DDDDDD") : (mainWindow.isDarkTheme ? "#444444" : "#FFFFFF")
+                                    }
+                                }
+                            }
+
+                            Item { Layout.fillWidth: true }
+                        }
+
+                        // Допуски адаптивных методов (DP5, DOP853): пропускная способность против точности.
+                        // Для методов Гаусса–Лежандра не используются.
+                        RowLayout {
+                            width: parent.width
+                            spacing: 5
+
+                            Label {
+                                text: "Точность:"
+                                color: mainWindow.isDarkTheme ? "#E0E0E0" : "#333333"
+                                Layout.alignment: Qt.AlignVCenter
+                            }
+
+                            ComboBox {
+                                id: toleranceComboBox
+                                // Имена пресетов DoublePendulum.toleranceProfile, по порядку пунктов
+                                readonly property var profiles: ["realtime", "analysis", "reference"]
+                                Layout.preferredWidth: 170
+                                Layout.preferredHeight: 28
+                                model: ["Реальное время", "Анализ", "Эталон"]
+                                displayText: currentIndex < 0 ? "Пользовательская" : currentText
+
+                                currentIndex: profiles.indexOf(settingsDialog.proxyToleranceProfile)
+                                onActivated: settingsDialog.proxyToleranceProfile = profiles[currentIndex]
+
+                                palette.text: mainWindow.isDarkTheme ? "#E0E0E0" : "#222222"
+                                contentItem: Text {
+                                    text: parent.displayText
+                                    font: parent.font
+                                    color: parent.palette.text
+                                    verticalAlignment: Text.AlignVCenter
+                                    horizontalAlignment: Text.AlignHCenter
+                                    elide: Text.ElideRight
+                                }
+                                background: Rectangle { color: mainWindow.isDarkTheme ? "#444444" : "#DDDDDD"; radius: 3; border.color: mainWindow.isDarkTheme ? "#666666" : "#BBBBBB"; border.width: 1 }
+                                popup: Popup { y: toleranceComboBox.height; width: toleranceComboBox.width; implicitHeight: contentItem.implicitHeight; padding: 1; contentItem: ListView { clip: true; implicitHeight: contentHeight; model: toleranceComboBox.popup.visible ? toleranceComboBox.delegateModel : null; currentIndex: toleranceComboBox.highlightedIndex; ScrollIndicator.vertical: ScrollIndicator { } } background: Rectangle { color: mainWindow.isDarkTheme ? "#444444" : "#FFFFFF"; border.color: mainWindow.isDarkTheme ? "#666666" : "#BBBBBB"; border.width: 1; radius: 2 } }
+                                delegate: ItemDelegate {
+                                    width: toleranceComboBox.width
+                                    contentItem: Text {
+                                        text: modelData;
+                                        color: mainWindow.isDarkTheme ? "#E0E0E0" : "#222222";
+                                        font: toleranceComboBox.font;
+                                        elide: Text.ElideRight;
+                                        verticalAlignment: Text.AlignVCenter;
+                                        horizontalAlignment: Text.AlignHCenter;
+                                        width: parent.width
+                                    }
+                                    highlighted: toleranceComboBox.highlightedIndex === index;
+                                    background: Rectangle {
+                                        color: highlighted ? (mainWindow.isDarkTheme ? "#666666" : "#DDDDDD") : (mainWindow.isDarkTheme ? "#444444" : "#FFFFFF")
+                                    }
+                                }
+                            }
+
+                            Item { Layout.fillWidth: true }
+                        }
                     }
                 }
             }
         }
     }
 
+    // FileDialog for opening a trajectory recording in replay mode
+    FileDialog {
+        id: replayOpenDialog
+        title: "Открыть запись траектории"
+        fileMode: FileDialog.OpenFile
+        nameFilters: ["Записи траекторий (*.dptraj)"]
+        currentFolder: pendulumObj ? (Qt.platform.os === "windows" ? "file:///" : "file://") + pendulumObj.recordingDirectory : ""
+
+        onAccepted: {
+            if (!pendulumObj.openReplay(replayOpenDialog.selectedFile)) {
+                console.warn("ReplayOpenDialog: failed to open " + replayOpenDialog.selectedFile);
+            }
+        }
+    }
+
     // FileDialog for exporting 2D trace as PNG
     FileDialog {
         id: traceSaveDialog
@@ -3188,6 +3474,11 @@ Window {
         id: helpPopup
     }
 
+    // Time-to-flip fractal over a theta1 x theta2 grid
+    FlipMapView {
+        id: flipMapView
+    }
+
     // Function to reset the pendulum with values from the controls
     function resetPendulumWithCurrentValues() {
         if (!pendulumObj) return;
@@ -1,6 +1,7 @@
 import QtQuick
 import QtQuick.Controls
 import QtQuick.Layouts
+import DoublePendulum 1.0 // TraceItem
 
 Canvas {
     id: pendulumCanvas
@@ -27,169 +28,49 @@ Canvas {
     property bool bob2Hovered: false
     property int draggingBob: 0
     
-    // Reference to the trace drawer
-    property var traceDrawer: traceDrawerInstance
+    // Pixels per metre of the drawing, as in calculateVisualState()
+    readonly property real traceScale: Math.min(width, height) * 0.42 /
+        Math.max(0.1, (pendulumObj ? Math.max(0.01, pendulumObj.l1) + Math.max(0.01, pendulumObj.l2) : 0))
 
-    // IncrementalTraceDrawer instance
-    IncrementalTraceDrawer {
-        id: traceDrawerInstance
-        pendulumObj: pendulumCanvas.pendulumObj
-        isDarkTheme: pendulumCanvas.isDarkTheme
-        massScaleFactorForRadius: pendulumCanvas.massScaleFactorForRadius
-        traceLineWidth: pendulumCanvas.traceLineWidth
-        canvasWidth: pendulumCanvas.width
-        canvasHeight: pendulumCanvas.height
+    // Traces are drawn by the scene graph from the C++ trace buffers, below the rods and bobs
+    TraceItem {
+        id: trace1Item
+        z: -1
+        anchors.fill: parent
+        pendulum: pendulumCanvas.pendulumObj
+        bob: 1
+        visible: pendulumCanvas.pendulumObj ? pendulumCanvas.pendulumObj.showTrace1 : false
+        color: pendulumCanvas.isDarkTheme ? Qt.rgba(1.0, 100 / 255, 100 / 255, 0.7) : Qt.rgba(1.0, 0.0, 0.0, 0.5)
+        lineWidth: pendulumCanvas.traceLineWidth
+        origin: Qt.point(pendulumCanvas.width / 2, pendulumCanvas.height / 2)
+        pixelsPerMetre: pendulumCanvas.traceScale
+        maxSegmentLength: pendulumCanvas.pendulumObj ? 1.5 * (pendulumCanvas.pendulumObj.l1 + pendulumCanvas.pendulumObj.l2) : 0
+    }
+
+    TraceItem {
+        id: trace2Item
+        z: -1
+        anchors.fill: parent
+        pendulum: pendulumCanvas.pendulumObj
+        bob: 2
+        visible: pendulumCanvas.pendulumObj ? pendulumCanvas.pendulumObj.showTrace2 : false
+        color: pendulumCanvas.isDarkTheme ? Qt.rgba(100 / 255, 100 / 255, 1.0, 0.7) : Qt.rgba(0.0, 0.0, 1.0, 0.5)
+        lineWidth: pendulumCanvas.traceLineWidth
+        origin: Qt.point(pendulumCanvas.width / 2, pendulumCanvas.height / 2)
+        pixelsPerMetre: pendulumCanvas.traceScale
+        maxSegmentLength: pendulumCanvas.pendulumObj ? 1.5 * (pendulumCanvas.pendulumObj.l1 + pendulumCanvas.pendulumObj.l2) : 0
     }
 
     // Public function to clear traces - can be called from outside
     function clearTraces() {
-        if (traceDrawerInstance) {
-            traceDrawerInstance.clearAllTraces();
-        }
+        trace1Item.restart();
+        trace2Item.restart();
     }
 
-    // Function to fully redraw offscreen traces
+    // Function to fully redraw traces from the C++ buffers
     function forceFullRedrawOfOffscreenTraces() {
-        if (!available || !pendulumObj) return;
-        
-        // Clear caches
-        var ctx1 = trace1OffscreenCanvas.getContext("2d");
-        var ctx2 = trace2OffscreenCanvas.getContext("2d");
-        
-        ctx1.clearRect(0, 0, width, height);
-        ctx2.clearRect(0, 0, width, height);
-        
-        lastScreenPointTrace1 = Qt.point(-1, -1);
-        lastScreenPointTrace2 = Qt.point(-1, -1);
-        drawnTrace1PointsCount = 0;
-        drawnTrace2PointsCount = 0;
-        
-        // Force redraw all points from buffers
-        updateAndDrawNewTraceSegments(true);
-        
-        // Request redraw of the main canvas
-        requestPaint();
-    }
-    
-    // Function for incremental drawing
-    function updateAndDrawNewTraceSegments(forceRedrawAll) {
-        if (!available || !pendulumObj || 
-            !trace1OffscreenCanvas.available || 
-            !trace2OffscreenCanvas.available) return;
-
-        var visualState = calculateVisualState(pendulumObj, width, height, massScaleFactorForRadius);
-        if (!visualState) return;
-
-        var centerX = visualState.centerX;
-        var centerY = visualState.centerY;
-        var globalScaleFactor = visualState.globalScaleFactor;
-        var maxDistance = (visualState.l1_visual + visualState.l2_visual) * 1.5; // Maximum threshold for breaks
-
-        // --- Trace 1 ---
-        if (pendulumObj.showTrace1) {
-            let trace1Data = pendulumObj.getTrace1Points();
-            if (trace1Data && trace1Data.length > 0) {
-                let ctx1 = trace1OffscreenCanvas.getContext("2d");
-                
-                // Determine from which index to start drawing
-                let startIdx = forceRedrawAll ? 0 : Math.max(0, drawnTrace1PointsCount);
-                
-                // If there are new points to draw
-                if (startIdx < trace1Data.length) {
-                    // For full redraw or if it's the first point
-                    if (forceRedrawAll || startIdx == 0) {
-                        lastScreenPointTrace1 = Qt.point(-1, -1);
-                    }
-                    
-                    // Draw all new points
-                    for (let i = startIdx; i < trace1Data.length; i++) {
-                        let newScreenPoint = Qt.point(
-                            centerX + trace1Data[i].x * globalScaleFactor,
-                            centerY + trace1Data[i].y * globalScaleFactor
-                        );
-                        
-                        // If there's already a previous point, draw a line
-                        if (lastScreenPointTrace1.x !== -1) {
-                            let dist = Math.sqrt(
-                                Math.pow(newScreenPoint.x - lastScreenPointTrace1.x, 2) + 
-                                Math.pow(newScreenPoint.y - lastScreenPointTrace1.y, 2)
-                            );
-                            
-                            // Draw the line only if the distance is not too large (to prevent "tails")
-                            if (dist < maxDistance) {
-                                ctx1.beginPath();
-                                ctx1.moveTo(lastScreenPointTrace1.x, lastScreenPointTrace1.y);
-                                ctx1.lineTo(newScreenPoint.x, newScreenPoint.y);
-                                ctx1.strokeStyle = "rgba(255, 0, 0, 0.5)";
-                                ctx1.lineWidth = traceLineWidth;
-                                ctx1.stroke();
-                            }
-                        }
-                        
-                        // Update the last drawn point
-                        lastScreenPointTrace1 = newScreenPoint;
-                    }
-                    
-                    // Update the counter of drawn points
-                    drawnTrace1PointsCount = trace1Data.length;
-                }
-            }
-        }
-        
-        // --- Trace 2 ---
-        if (pendulumObj.showTrace2) {
-            let trace2Data = pendulumObj.getTrace2Points();
-            if (trace2Data && trace2Data.length > 0) {
-                let ctx2 = trace2OffscreenCanvas.getContext("2d");
-                
-                // Determine from which index to start drawing
-                let startIdx = forceRedrawAll ? 0 : Math.max(0, drawnTrace2PointsCount);
-                
-                // If there are new points to draw
-                if (startIdx < trace2Data.length) {
-                    // For full redraw or if it's the first point
-                    if (forceRedrawAll || startIdx == 0) {
-                        lastScreenPointTrace2 = Qt.point(-1, -1);
-                    }
-                    
-                    // Draw all new points
-                    for (let i = startIdx; i < trace2Data.length; i++) {
-                        let newScreenPoint = Qt.point(
-                            centerX + trace2Data[i].x * globalScaleFactor,
-                            centerY + trace2Data[i].y * globalScaleFactor
-                        );
-                        
-                        // If there's already a previous point, draw a line
-                        if (lastScreenPointTrace2.x !== -1) {
-                            let dist = Math.sqrt(
-                                Math.pow(newScreenPoint.x - lastScreenPointTrace2.x, 2) + 
-                                Math.pow(newScreenPoint.y - lastScreenPointTrace2.y, 2)
-                            );
-                            
-                            // Draw the line only if the distance is not too large
-                            if (dist < maxDistance) {
-                                ctx2.beginPath();
-                                ctx2.moveTo(lastScreenPointTrace2.x, lastScreenPointTrace2.y);
-                                ctx2.lineTo(newScreenPoint.x, newScreenPoint.y);
-                                ctx2.strokeStyle = isDarkTheme ? 
-                                    "rgba(100, 100, 255, 0.7)" : "rgba(0, 0, 255, 0.5)";
-                                ctx2.lineWidth = traceLineWidth;
-                                ctx2.stroke();
-                            }
-                        }
-                        
-                        // Update the last drawn point
-                        lastScreenPointTrace2 = newScreenPoint;
-                    }
-                    
-                    // Update the counter of drawn points
-                    drawnTrace2PointsCount = trace2Data.length;
-                }
-            }
-        }
-
-        // Request redraw of the main canvas to display updates
-        requestPaint();
+        trace1Item.restart();
+        trace2Item.restart();
     }
 
     function calculateVisualState(pendulumObject, canvasWidth, canvasHeight, massScaleFactor) {
@@ -253,7 +134,8 @@ Canvas {
             }
         }
         onPressed: (mouse) => {
-            if (!pendulumCanvas.pendulumObj) return;
+            // A replay only shows a recording: its bobs are not dragged
+            if (!pendulumCanvas.pendulumObj || pendulumCanvas.pendulumObj.replayActive) return;
             var visualState = pendulumCanvas.calculateVisualState(pendulumCanvas.pendulumObj, pendulumCanvas.width, pendulumCanvas.height, pendulumCanvas.massScaleFactorForRadius);
             if (!visualState) return;
             var distance1 = Math.sqrt(Math.pow(mouse.x - visualState.x1, 2) + Math.pow(mouse.y - visualState.y1, 2));
@@ -261,7 +143,7 @@ Canvas {
             
             if (distance1 <= visualState.r1 * 1.5 || distance2 <= visualState.r2 * 1.5) {
                 // We are about to start dragging
-                simulationTimer.stop();
+                frameScheduler.stop();
                 
                 // Notify the C++ core that we are taking over
                 pendulumCanvas.pendulumObj.setManualControl(true);
@@ -277,11 +159,6 @@ Canvas {
                 
                 if (pendulumCanvas.draggingBob > 0) {
                     pendulumCanvas.pendulumObj.clearTraces();
-                    
-                    // Clear traces in the trace drawer
-                    if (traceDrawerInstance) {
-                        traceDrawerInstance.clearAllTraces();
-                    }
                 } else {
                     // If we didn't grab any bob, reset the flag
                     pendulumCanvas.pendulumObj.setManualControl(false);
@@ -320,12 +197,6 @@ Canvas {
                 pendulumCanvas.requestPaint();
             }
         }
-        function onHistoryUpdated() {
-            if (pendulumCanvas.visible && pendulumCanvas.available && traceDrawerInstance) {
-                traceDrawerInstance.updateAndDrawNewTraceSegments(false);
-                pendulumCanvas.requestPaint();
-            }
-        }
     }
     
     onPaint: {
@@ -410,21 +281,6 @@ Canvas {
             });
         }
 
-        // --- DISPLAY CACHED TRAJECTORIES ---
-        if (pendulumObj.showTrace1 && traceDrawerInstance) {
-            let trace1Canvas = traceDrawerInstance.getTrace1Canvas();
-            if (trace1Canvas && trace1Canvas.available) {
-                ctx.drawImage(trace1Canvas, 0, 0);
-            }
-        }
-        
-        if (pendulumObj.showTrace2 && traceDrawerInstance) {
-            let trace2Canvas = traceDrawerInstance.getTrace2Canvas();
-            if (trace2Canvas && trace2Canvas.available) {
-                ctx.drawImage(trace2Canvas, 0, 0);
-            }
-        }
-
         // --- DRAW RODS AND BOBS ---
         let x1 = visualState.x1, y1 = visualState.y1, x2 = visualState.x2, y2 = visualState.y2;
         ctx.strokeStyle = "#666666"; ctx.lineWidth = visualState.rod1LineWidth; ctx.lineCap = "round";
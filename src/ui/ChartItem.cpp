@@ -0,0 +1,971 @@
+#include "ui/ChartItem.h"
+#include <QMatrix4x4>
+#include <QPainter>
+#include <QPolygonF>
+#include <QQuickWindow>
+#include <QSGClipNode>
+#include <QSGFlatColorMaterial>
+#include <QSGGeometryNode>
+#include <QSGImageNode>
+#include <QSGRectangleNode>
+#include <QSGRendererInterface>
+#include <QSGTransformNode>
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <limits>
+
+namespace {
+
+constexpr int POINT_SIDES = 6; // Poincaré points are hexagons
+
+// Pixel columns the time series is reduced to, the same for a fetch and an append
+int plotColumns(const QRectF& plot)
+{
+    return std::max(1, static_cast<int>(std::lround(plot.width())));
+}
+
+// Flat-coloured node that owns its geometry and material
+class ChartGeometryNode : public QSGGeometryNode
+{
+public:
+    ChartGeometryNode(QSGGeometry::DrawingMode mode, const QColor& color)
+        : m_geometry(QSGGeometry::defaultAttributes_Point2D(), 0)
+    {
+        m_geometry.setDrawingMode(mode);
+        m_geometry.setLineWidth(1.0f);
+        m_material.setColor(color);
+        setGeometry(&m_geometry);
+        setMaterial(&m_material);
+    }
+
+    // New vertex storage of `count` vertices, to be filled by the caller
+    QSGGeometry::Point2D* resize(int count)
+    {
+        m_geometry.allocate(count);
+        m_geometry.markVertexDataDirty();
+        markDirty(QSGNode::DirtyGeometry);
+        return m_geometry.vertexDataAsPoint2D();
+    }
+
+    void setColor(const QColor& color)
+    {
+        if (m_material.color() != color) {
+            m_material.setColor(color);
+            markDirty(QSGNode::DirtyMaterial);
+        }
+    }
+
+    std::uint64_t firstPoint = 0; // Line chunks: the first line point they hold
+
+private:
+    QSGGeometry m_geometry;
+    QSGFlatColorMaterial m_material;
+};
+
+// The node tree of a chart, built once:
+// background, grid, axes, zero lines, then the plot clip holding the line and the points
+class ChartRootNode : public QSGNode
+{
+public:
+    explicit ChartRootNode(QQuickWindow* window)
+        : background(window->createRectangleNode())
+        , grid(new ChartGeometryNode(QSGGeometry::DrawLines, Qt::gray))
+        , axes(new ChartGeometryNode(QSGGeometry::DrawLines, Qt::black))
+        , zeroLines(new ChartGeometryNode(QSGGeometry::DrawLines, Qt::black))
+        , clip(new QSGClipNode)
+        , line(new QSGTransformNode)
+        , points(new QSGNode)
+        , m_clipGeometry(QSGGeometry::defaultAttributes_Point2D(), 4)
+    {
+        clip->setIsRectangular(true);
+        clip->setGeometry(&m_clipGeometry);
+        appendChildNode(background);
+        appendChildNode(grid);
+        appendChildNode(axes);
+        appendChildNode(zeroLines);
+        appendChildNode(clip);
+        clip->appendChildNode(line);
+        clip->appendChildNode(points);
+    }
+
+    void setClipRect(const QRectF& rect)
+    {
+        QSGGeometry::updateRectGeometry(&m_clipGeometry, rect);
+        clip->setClipRect(rect);
+        clip->markDirty(QSGNode::DirtyGeometry);
+    }
+
+    QSGRectangleNode* background;
+    ChartGeometryNode* grid;
+    ChartGeometryNode* axes;
+    ChartGeometryNode* zeroLines;
+    QSGClipNode* clip;
+    QSGTransformNode* line;
+    QSGNode* points;
+    // Zero-line positions in the geometry (NaN: none)
+    double zeroX = std::numeric_limits<double>::quiet_NaN();
+    double zeroY = std::numeric_limits<double>::quiet_NaN();
+
+private:
+    QSGGeometry m_clipGeometry;
+};
+
+void setLine(QSGGeometry::Point2D* v, double x1, double y1, double x2, double y2)
+{
+    v[0].set(float(x1), float(y1));
+    v[1].set(float(x2), float(y2));
+}
+
+} // namespace
+
+ChartItem::ChartItem(QQuickItem* parent)
+    : QQuickItem(parent)
+{
+    setFlag(ItemHasContents, true);
+}
+
+void ChartItem::setPendulum(DoublePendulum* pendulum)
+{
+    if (m_pendulum == pendulum) {
+        return;
+    }
+    if (m_pendulum) {
+        disconnect(m_pendulum, nullptr, this, nullptr);
+    }
+    m_pendulum = pendulum;
+    if (m_pendulum) {
+        connect(m_pendulum, &DoublePendulum::historyUpdated, this, &ChartItem::onHistoryUpdated);
+    }
+    scheduleRefresh();
+    emit pendulumChanged();
+}
+
+void ChartItem::setScheduler(FrameScheduler* scheduler)
+{
+    if (m_scheduler == scheduler) {
+        return;
+    }
+    if (m_scheduler) {
+        disconnect(m_scheduler, nullptr, this, nullptr);
+    }
+    m_scheduler = scheduler;
+    if (m_scheduler) {
+        connect(m_scheduler, &FrameScheduler::chartTick, this, &ChartItem::onChartTick);
+        // Rows that came in just before a pause are drawn without a tick
+        connect(m_scheduler, &FrameScheduler::runningChanged, this, [this]() {
+            if (m_appendPending && !m_scheduler->isRunning()) {
+                polish();
+            }
+        });
+    }
+    emit schedulerChanged();
+}
+
+void ChartItem::setActive(bool active)
+{
+    if (m_active == active) {
+        return;
+    }
+    m_active = active;
+    if (m_active) {
+        scheduleRefresh();
+    }
+    emit activeChanged();
+}
+
+void ChartItem::setMode(Mode mode)
+{
+    if (m_mode == mode) {
+        return;
+    }
+    m_mode = mode;
+    m_line.clear();
+    m_lineFirst = 0;
+    m_lineRebuild = true;
+    m_cursor = -1.0;
+    m_hasData = false;
+    m_pointsDirty = true;
+    m_frameDirty = true;
+    scheduleRefresh();
+    emit modeChanged();
+    emit rangeChanged();
+}
+
+void ChartItem::setSeries(int series)
+{
+    if (m_series == series) {
+        return;
+    }
+    m_series = series;
+    scheduleRefresh();
+    emit seriesChanged();
+}
+
+void ChartItem::setFollowing(bool following)
+{
+    if (m_following == following) {
+        return;
+    }
+    m_following = following;
+    if (m_following) {
+        scheduleRefresh();
+    } else {
+        m_cursor = -1.0;
+    }
+    emit followingChanged();
+}
+
+void ChartItem::setWindowWidth(double width)
+{
+    if (m_windowWidth == width || !(width > 0.0)) {
+        return;
+    }
+    m_windowWidth = width;
+    if (m_following) {
+        scheduleRefresh();
+    }
+    emit windowWidthChanged();
+}
+
+void ChartItem::setViewMinX(double x)
+{
+    setView(x, m_viewMaxX);
+    if (!m_following) {
+        scheduleRefresh();
+    }
+}
+
+void ChartItem::setViewMaxX(double x)
+{
+    setView(m_viewMinX, x);
+    if (!m_following) {
+        scheduleRefresh();
+    }
+}
+
+void ChartItem::setView(double minX, double maxX)
+{
+    if (m_viewMinX == minX && m_viewMaxX == maxX) {
+        return;
+    }
+    m_viewMinX = minX;
+    m_viewMaxX = maxX;
+    emit viewChanged();
+}
+
+void ChartItem::setRdpEnabled(bool enabled)
+{
+    if (m_rdpEnabled == enabled) {
+        return;
+    }
+    m_rdpEnabled = enabled;
+    scheduleRefresh();
+    emit processingChanged();
+}
+
+void ChartItem::setRdpEpsilon(double epsilon)
+{
+    if (m_rdpEpsilon == epsilon) {
+        return;
+    }
+    m_rdpEpsilon = epsilon;
+    if (m_rdpEnabled) {
+        scheduleRefresh();
+    }
+    emit processingChanged();
+}
+
+void ChartItem::setRdpTargetPoints(int points)
+{
+    if (m_rdpTargetPoints == points) {
+        return;
+    }
+    m_rdpTargetPoints = points;
+    if (m_rdpEnabled) {
+        scheduleRefresh();
+    }
+    emit processingChanged();
+}
+
+void ChartItem::setLimitPoints(bool enabled)
+{
+    if (m_limitPoints == enabled) {
+        return;
+    }
+    m_limitPoints = enabled;
+    scheduleRefresh();
+    emit processingChanged();
+}
+
+void ChartItem::setMaxPoints(int points)
+{
+    if (m_maxPoints == points) {
+        return;
+    }
+    m_maxPoints = points;
+    if (m_limitPoints) {
+        scheduleRefresh();
+    }
+    emit processingChanged();
+}
+
+void ChartItem::setPlotColor(const QColor& color)
+{
+    if (m_plotColor == color) {
+        return;
+    }
+    m_plotColor = color;
+    m_colorsDirty = true;
+    update();
+    emit colorsChanged();
+}
+
+void ChartItem::setGridColor(const QColor& color)
+{
+    if (m_gridColor == color) {
+        return;
+    }
+    m_gridColor = color;
+    m_colorsDirty = true;
+    update();
+    emit colorsChanged();
+}
+
+void ChartItem::setAxisColor(const QColor& color)
+{
+    if (m_axisColor == color) {
+        return;
+    }
+    m_axisColor = color;
+    m_colorsDirty = true;
+    update();
+    emit colorsChanged();
+}
+
+void ChartItem::setZeroLineColor(const QColor& color)
+{
+    if (m_zeroLineColor == color) {
+        return;
+    }
+    m_zeroLineColor = color;
+    m_colorsDirty = true;
+    update();
+    emit colorsChanged();
+}
+
+void ChartItem::setLineColor(const QColor& color)
+{
+    if (m_lineColor == color) {
+        return;
+    }
+    m_lineColor = color;
+    m_colorsDirty = true;
+    update();
+    emit colorsChanged();
+}
+
+void ChartItem::setPointRadius(double radius)
+{
+    if (m_pointRadius == radius) {
+        return;
+    }
+    m_pointRadius = radius;
+    m_pointsDirty = true;
+    update();
+    emit pointRadiusChanged();
+}
+
+QRectF ChartItem::plotRect() const
+{
+    return QRectF(PADDING_LEFT, PADDING_TOP,
+                  std::max(0.0, width() - PADDING_LEFT - PADDING_RIGHT),
+                  std::max(0.0, height() - PADDING_TOP - PADDING_BOTTOM));
+}
+
+void ChartItem::refresh()
+{
+    scheduleRefresh();
+}
+
+void ChartItem::setDataBounds(double xMin, double xMax, double yMin, double yMax)
+{
+    m_hasData = true;
+    setRanges(xMin, xMax, yMin, yMax, true);
+    update();
+}
+
+void ChartItem::clearData()
+{
+    if (!m_hasData) {
+        return;
+    }
+    m_hasData = false;
+    update();
+    emit rangeChanged();
+}
+
+void ChartItem::beginPoincareSeries(const QColor& color)
+{
+    m_poincareSeries.push_back({color, {}});
+    m_pointsDirty = true;
+    update();
+    emit poincareSeriesChanged();
+}
+
+void ChartItem::finalizePoincareSeries()
+{
+    pullPoincarePoints();
+}
+
+void ChartItem::clearPoincareSeries()
+{
+    m_poincareSeries.clear();
+    pullPoincarePoints();
+    emit poincareSeriesChanged();
+}
+
+void ChartItem::scheduleRefresh()
+{
+    m_refreshPending = true;
+    polish();
+}
+
+void ChartItem::onHistoryUpdated()
+{
+    if (!m_active || m_mode != TimeSeries) {
+        return;
+    }
+    if (m_following) {
+        m_appendPending = true;
+        // A running frame loop hands the rows over on its chart tick
+        if (!m_scheduler || !m_scheduler->isRunning()) {
+            polish();
+        }
+    } else if (m_pendulum->getHistoryEpoch() != m_fetchEpoch) {
+        scheduleRefresh(); // The rows in the window are gone
+    }
+}
+
+void ChartItem::onChartTick()
+{
+    // A pending refresh is done by updatePolish, and takes the rows with it
+    if (m_active && m_appendPending && !m_refreshPending) {
+        m_appendPending = false;
+        takePendingRows();
+    }
+}
+
+void ChartItem::takePendingRows()
+{
+    if (!appendNewRows()) {
+        fetchTimeSeries();
+    }
+}
+
+void ChartItem::updatePolish()
+{
+    if (!m_active) {
+        return; // setActive(true) fetches everything again
+    }
+    if (m_refreshPending) {
+        m_refreshPending = false;
+        m_appendPending = false;
+        refreshNow();
+    } else if (m_appendPending) {
+        m_appendPending = false;
+        takePendingRows();
+    }
+}
+
+void ChartItem::refreshNow()
+{
+    switch (m_mode) {
+    case TimeSeries:
+        fetchTimeSeries();
+        break;
+    case PoincareMap:
+        pullPoincarePoints();
+        break;
+    case PhasePortrait:
+        break; // setDataBounds() comes with the density image
+    }
+}
+
+void ChartItem::fetchTimeSeries()
+{
+    m_line.clear();
+    m_lineFirst = 0;
+    m_lineRebuild = true;
+    m_cursor = -1.0;
+    m_scrolledPixels = 0.0;
+    update();
+
+    const QRectF plot = plotRect();
+    if (!m_pendulum || plot.isEmpty()) {
+        m_hasData = false;
+        emit rangeChanged();
+        return;
+    }
+    if (m_following) {
+        const double end = m_pendulum->getHistoryEndTime();
+        if (end > 0.0) {
+            // A full window width even while the history is shorter, so the X scale
+            // stays put and new rows are appended from the first frame on
+            const double minX = std::max(0.0, end - m_windowWidth);
+            setView(minX, minX + m_windowWidth);
+        }
+    }
+    m_lineOriginX = m_viewMinX;
+
+    // Reduced to a min/max envelope per pixel column of the plot
+    const QByteArray packed = m_pendulum->getProcessedTimeSeriesData(
+        static_cast<DoublePendulum::TimeSeriesType>(m_series), m_viewMinX, m_viewMaxX,
+        m_rdpEnabled, m_rdpEpsilon, m_limitPoints, m_maxPoints, plotColumns(plot), m_rdpTargetPoints);
+    appendLinePoints(packed.constData(), static_cast<std::size_t>(packed.size()) / sizeof(QPointF));
+
+    // Later frames continue from here, unless the user is looking at the past or a replay
+    m_fetchEpoch = m_pendulum->getHistoryEpoch();
+    if (m_following && !m_pendulum->isReplayActive()) {
+        m_cursor = m_pendulum->getHistoryEndRow();
+        m_cursorTime = m_pendulum->getHistoryEndTime();
+    }
+
+    double yMin = -1.0;
+    double yMax = 1.0;
+    m_hasData = lineYBounds(-std::numeric_limits<double>::infinity(), yMin, yMax);
+    setRanges(m_viewMinX, m_viewMaxX, yMin, yMax, false);
+}
+
+bool ChartItem::appendNewRows()
+{
+    if (m_cursor < 0.0 || !m_pendulum || m_pendulum->isReplayActive() ||
+        m_pendulum->getHistoryEpoch() != m_fetchEpoch || m_rdpEnabled) {
+        return false;
+    }
+    const QRectF plot = plotRect();
+    const double window = m_windowWidth;
+    // Only a new window width or plot width changes the X scale; both fetch again
+    if (plot.isEmpty() || std::abs(m_viewMaxX - m_viewMinX - window) > 1e-9 * window) {
+        return false;
+    }
+
+    // The window moves by whole pixel columns, so the columns of the fetch stay
+    // the columns of every append
+    const int columns = plotColumns(plot);
+    const double secondsPerColumn = window / columns;
+    const double endTime = m_pendulum->getHistoryEndTime();
+    const double targetMinX = std::max(0.0, endTime - window);
+    const double shift = std::floor((targetMinX - m_viewMinX) / secondsPerColumn);
+    if (shift < 0.0 || shift >= columns) {
+        return false; // Nothing drawn is left on screen
+    }
+    const double newMinX = m_viewMinX + shift * secondsPerColumn;
+
+    // Rows up to the last complete column, reduced like the fetch; the column
+    // still filling is taken once it is complete, at most a pixel behind
+    const double fromColumn = std::max(newMinX, newMinX + std::floor((m_cursorTime - newMinX) / secondsPerColumn) * secondsPerColumn);
+    const double toColumn = newMinX + std::floor((endTime - newMinX) / secondsPerColumn) * secondsPerColumn;
+    std::size_t count = 0;
+    const std::size_t oldSize = m_line.size();
+    if (toColumn > fromColumn) {
+        const QByteArray delta = m_pendulum->getTimeSeriesDelta(
+            static_cast<DoublePendulum::TimeSeriesType>(m_series), m_cursor, fromColumn, toColumn,
+            static_cast<int>(std::lround((toColumn - fromColumn) / secondsPerColumn)));
+        count = static_cast<std::size_t>(delta.size()) / sizeof(QPointF);
+        if (m_limitPoints && m_line.size() + count > static_cast<std::size_t>(std::max(0, m_maxPoints))) {
+            return false;
+        }
+        appendLinePoints(delta.constData(), count);
+        m_cursor = m_pendulum->getHistoryRowAt(toColumn);
+        m_cursorTime = toColumn;
+    }
+
+    bool rebased = false;
+    if (shift > 0.0) {
+        setView(newMinX, newMinX + window);
+        trimLine();
+        // Once per plot width the vertices are rebuilt around the new view, which
+        // keeps their float offsets small and lets the Y range shrink to the data
+        m_scrolledPixels += shift;
+        if (m_scrolledPixels >= columns) {
+            m_scrolledPixels = 0.0;
+            m_lineOriginX = m_viewMinX;
+            m_lineRebuild = true;
+            rebased = true;
+        }
+    }
+
+    // New extremes widen the Y range at once; it shrinks again at the next rebase
+    bool outside = false;
+    for (std::size_t i = oldSize; i < m_line.size() && !outside; ++i) {
+        outside = m_line[i].y() < m_minY || m_line[i].y() > m_maxY;
+    }
+    if (rebased || outside || (count > 0 && !m_hasData)) {
+        double yMin = -1.0;
+        double yMax = 1.0;
+        m_hasData = lineYBounds(m_viewMinX, yMin, yMax);
+        setRanges(m_viewMinX, m_viewMaxX, yMin, yMax, false);
+    } else if (shift > 0.0) {
+        m_minX = m_viewMinX;
+        m_maxX = m_viewMaxX;
+        emit rangeChanged();
+    }
+    if (count > 0 || shift > 0.0) {
+        update();
+    }
+    return true;
+}
+
+void ChartItem::pullPoincarePoints()
+{
+    // The points of the series being filled are replaced only when the buffer has any,
+    // so a series keeps its points after the buffer is cleared
+    if (m_pendulum && !m_poincareSeries.empty()) {
+        QVector<QPointF> points = m_pendulum->getPoincareMapPoints();
+        if (!points.isEmpty()) {
+            m_poincareSeries.back().points = std::move(points);
+        }
+    }
+
+    double xMin = -1.0, xMax = 1.0, yMin = -1.0, yMax = 1.0;
+    bool found = false;
+    for (const PoincareSeries& series : m_poincareSeries) {
+        for (const QPointF& p : series.points) {
+            if (!found) {
+                xMin = xMax = p.x();
+                yMin = yMax = p.y();
+                found = true;
+            }
+            xMin = std::min(xMin, p.x());
+            xMax = std::max(xMax, p.x());
+            yMin = std::min(yMin, p.y());
+            yMax = std::max(yMax, p.y());
+        }
+    }
+    m_hasData = found;
+    m_pointsDirty = true;
+    setRanges(xMin, xMax, yMin, yMax, true);
+    update();
+}
+
+void ChartItem::setRanges(double xMin, double xMax, double yMin, double yMax, bool marginX)
+{
+    if (xMin == xMax) {
+        xMin -= 0.5;
+        xMax += 0.5;
+    }
+    if (yMin == yMax) {
+        yMin -= 0.5;
+        yMax += 0.5;
+    }
+    if (marginX) {
+        const double margin = (xMax - xMin) * RANGE_MARGIN;
+        xMin -= margin;
+        xMax += margin;
+    }
+    const double margin = (yMax - yMin) * RANGE_MARGIN;
+    m_minX = xMin;
+    m_maxX = xMax;
+    m_minY = yMin - margin;
+    m_maxY = yMax + margin;
+    m_pointsDirty = true;
+    emit rangeChanged();
+}
+
+bool ChartItem::lineYBounds(double fromX, double& yMin, double& yMax) const
+{
+    bool found = false;
+    for (const QPointF& p : m_line) {
+        if (p.x() < fromX) {
+            continue;
+        }
+        if (!found) {
+            yMin = yMax = p.y();
+            found = true;
+        }
+        yMin = std::min(yMin, p.y());
+        yMax = std::max(yMax, p.y());
+    }
+    return found;
+}
+
+void ChartItem::appendLinePoints(const char* packed, std::size_t count)
+{
+    for (std::size_t i = 0; i < count; ++i) {
+        QPointF point;
+        std::memcpy(&point, packed + i * sizeof(QPointF), sizeof(QPointF));
+        m_line.push_back(point);
+    }
+}
+
+void ChartItem::trimLine()
+{
+    // A chunk goes once the next one starts left of the window, so the segment joining them is gone too
+    while (m_line.size() > LINE_CHUNK_POINTS && m_line[LINE_CHUNK_POINTS].x() < m_viewMinX) {
+        m_line.erase(m_line.begin(), m_line.begin() + static_cast<std::ptrdiff_t>(LINE_CHUNK_POINTS));
+        m_lineFirst += LINE_CHUNK_POINTS;
+    }
+}
+
+void ChartItem::geometryChange(const QRectF& newGeometry, const QRectF& oldGeometry)
+{
+    QQuickItem::geometryChange(newGeometry, oldGeometry);
+    if (newGeometry.size() == oldGeometry.size()) {
+        return;
+    }
+    m_frameDirty = true;
+    m_pointsDirty = true;
+    if (m_mode != PhasePortrait) {
+        scheduleRefresh(); // The envelope is as wide as the plot
+    }
+    update();
+    emit plotRectChanged();
+}
+
+QSGNode* ChartItem::updatePaintNode(QSGNode* oldNode, UpdatePaintNodeData* data)
+{
+    Q_UNUSED(data);
+    if (window()->rendererInterface()->graphicsApi() == QSGRendererInterface::Software) {
+        return updateSoftwareNode(oldNode);
+    }
+    return updateGeometryNodes(oldNode);
+}
+
+QSGNode* ChartItem::updateGeometryNodes(QSGNode* oldNode)
+{
+    auto* root = static_cast<ChartRootNode*>(oldNode);
+    if (!root) {
+        root = new ChartRootNode(window());
+        m_frameDirty = true;
+        m_colorsDirty = true;
+        m_pointsDirty = true;
+        m_lineRebuild = true;
+    }
+    const QRectF plot = plotRect();
+    const double left = plot.left();
+    const double top = plot.top();
+    const double right = plot.right();
+    const double bottom = plot.bottom();
+
+    // Background, grid and axes depend on the size only
+    if (m_frameDirty) {
+        root->background->setRect(boundingRect());
+        QSGGeometry::Point2D* v = root->grid->resize(plot.isEmpty() ? 0 : 2 * (GRID_LINES_X + 1 + GRID_LINES_Y + 1));
+        if (!plot.isEmpty()) {
+            for (int i = 0; i <= GRID_LINES_X; ++i, v += 2) {
+                const double x = left + plot.width() * i / GRID_LINES_X;
+                setLine(v, x, top, x, bottom);
+            }
+            for (int i = 0; i <= GRID_LINES_Y; ++i, v += 2) {
+                const double y = top + plot.height() * i / GRID_LINES_Y;
+                setLine(v, left, y, right, y);
+            }
+        }
+        v = root->axes->resize(plot.isEmpty() ? 0 : 4);
+        if (!plot.isEmpty()) {
+            setLine(v, left, top, left, bottom);
+            setLine(v + 2, left, bottom, right, bottom);
+        }
+        root->setClipRect(plot);
+        m_frameDirty = false;
+        root->zeroX = root->zeroY = std::numeric_limits<double>::quiet_NaN();
+        root->zeroLines->resize(0);
+    }
+    if (m_colorsDirty) {
+        root->background->setColor(m_plotColor);
+        root->grid->setColor(m_gridColor);
+        root->axes->setColor(m_axisColor);
+        root->zeroLines->setColor(m_zeroLineColor);
+        for (QSGNode* child = root->line->firstChild(); child; child = child->nextSibling()) {
+            static_cast<ChartGeometryNode*>(child)->setColor(m_lineColor);
+        }
+        m_colorsDirty = false;
+    }
+
+    const double xScale = plot.width() / (m_maxX - m_minX);
+    const double yScale = plot.height() / (m_maxY - m_minY);
+
+    // Zero lines move with the ranges; the geometry changes only when they do
+    const bool showZero = m_hasData && m_mode != PoincareMap && !plot.isEmpty();
+    const double zeroX = showZero && m_minX <= 0.0 && m_maxX >= 0.0 ? left - m_minX * xScale : std::numeric_limits<double>::quiet_NaN();
+    const double zeroY = showZero && m_minY <= 0.0 && m_maxY >= 0.0 ? bottom + m_minY * yScale : std::numeric_limits<double>::quiet_NaN();
+    auto same = [](double a, double b) { return (std::isnan(a) && std::isnan(b)) || a == b; };
+    if (!same(zeroX, root->zeroX) || !same(zeroY, root->zeroY)) {
+        QSGGeometry::Point2D* v = root->zeroLines->resize((std::isnan(zeroX) ? 0 : 2) + (std::isnan(zeroY) ? 0 : 2));
+        if (!std::isnan(zeroY)) {
+            setLine(v, left, zeroY, right, zeroY);
+            v += 2;
+        }
+        if (!std::isnan(zeroX)) {
+            setLine(v, zeroX, top, zeroX, bottom);
+        }
+        root->zeroX = zeroX;
+        root->zeroY = zeroY;
+    }
+
+    // Time series: data units to pixels; scrolling and Y refits change only this
+    QMatrix4x4 matrix;
+    matrix.translate(float(left + (m_lineOriginX - m_minX) * xScale), float(bottom + m_minY * yScale));
+    matrix.scale(float(xScale), float(-yScale));
+    if (root->line->matrix() != matrix) {
+        root->line->setMatrix(matrix);
+    }
+
+    if (m_lineRebuild) {
+        while (QSGNode* child = root->line->firstChild()) {
+            root->line->removeChildNode(child);
+            delete child;
+        }
+        m_drawnEnd = m_lineFirst;
+        m_lineRebuild = false;
+    }
+    while (auto* chunk = static_cast<ChartGeometryNode*>(root->line->firstChild())) {
+        if (chunk->firstPoint + LINE_CHUNK_POINTS > m_lineFirst) {
+            break;
+        }
+        root->line->removeChildNode(chunk);
+        delete chunk;
+    }
+    // Only the chunk being filled and the ones after it are written
+    const std::uint64_t end = m_lineFirst + m_line.size();
+    if (m_drawnEnd < end) {
+        std::uint64_t start = std::max(m_drawnEnd, m_lineFirst);
+        start -= start % LINE_CHUNK_POINTS;
+        for (; start < end; start += LINE_CHUNK_POINTS) {
+            auto* chunk = static_cast<ChartGeometryNode*>(root->line->lastChild());
+            if (!chunk || chunk->firstPoint != start) {
+                chunk = new ChartGeometryNode(QSGGeometry::DrawLineStrip, m_lineColor);
+                chunk->firstPoint = start;
+                root->line->appendChildNode(chunk);
+            }
+            // Each chunk starts at the last point of the one before, so the strips join
+            const std::uint64_t from = start > m_lineFirst ? start - 1 : start;
+            const std::uint64_t to = std::min(start + LINE_CHUNK_POINTS, end);
+            QSGGeometry::Point2D* v = chunk->resize(static_cast<int>(to - from));
+            for (std::uint64_t i = from; i < to; ++i, ++v) {
+                const QPointF& p = m_line[i - m_lineFirst];
+                v->set(float(p.x() - m_lineOriginX), float(p.y()));
+            }
+        }
+        m_drawnEnd = end;
+    }
+
+    // Poincaré points are in pixels, so any change of the ranges rebuilds them
+    if (m_pointsDirty) {
+        while (QSGNode* child = root->points->firstChild()) {
+            root->points->removeChildNode(child);
+            delete child;
+        }
+        if (m_mode == PoincareMap && !plot.isEmpty()) {
+            for (const PoincareSeries& series : m_poincareSeries) {
+                if (series.points.isEmpty()) {
+                    continue;
+                }
+                auto* node = new ChartGeometryNode(QSGGeometry::DrawTriangles, series.color);
+                QSGGeometry::Point2D* v = node->resize(static_cast<int>(series.points.size()) * POINT_SIDES * 3);
+                for (const QPointF& p : series.points) {
+                    const double cx = left + (p.x() - m_minX) * xScale;
+                    const double cy = bottom - (p.y() - m_minY) * yScale;
+                    for (int side = 0; side < POINT_SIDES; ++side, v += 3) {
+                        const double a0 = 2.0 * M_PI * side / POINT_SIDES;
+                        const double a1 = 2.0 * M_PI * (side + 1) / POINT_SIDES;
+                        v[0].set(float(cx), float(cy));
+                        v[1].set(float(cx + m_pointRadius * std::cos(a0)), float(cy + m_pointRadius * std::sin(a0)));
+                        v[2].set(float(cx + m_pointRadius * std::cos(a1)), float(cy + m_pointRadius * std::sin(a1)));
+                    }
+                }
+                root->points->appendChildNode(node);
+            }
+        }
+        m_pointsDirty = false;
+    }
+    return root;
+}
+
+QSGNode* ChartItem::updateSoftwareNode(QSGNode* oldNode)
+{
+    const qreal dpr = window()->effectiveDevicePixelRatio();
+    const QSize size = (boundingRect().size() * dpr).toSize();
+    if (size.isEmpty()) {
+        return nullptr;
+    }
+    auto* node = static_cast<QSGImageNode*>(oldNode);
+    if (!node) {
+        node = window()->createImageNode();
+        node->setOwnsTexture(true);
+    }
+    if (m_raster.size() != size) {
+        m_raster = QImage(size, QImage::Format_ARGB32_Premultiplied);
+    }
+    paintSoftware(m_raster, dpr);
+    m_lineRebuild = m_frameDirty = m_pointsDirty = m_colorsDirty = false;
+    m_drawnEnd = m_lineFirst + m_line.size();
+    node->setTexture(window()->createTextureFromImage(m_raster));
+    node->setRect(boundingRect());
+    return node;
+}
+
+void ChartItem::paintSoftware(QImage& image, qreal dpr) const
+{
+    image.fill(m_plotColor);
+    QPainter painter(&image);
+    painter.scale(dpr, dpr);
+    const QRectF plot = plotRect();
+    if (plot.isEmpty()) {
+        return;
+    }
+    painter.setRenderHint(QPainter::Antialiasing);
+
+    painter.setPen(QPen(m_gridColor, 0.5));
+    for (int i = 0; i <= GRID_LINES_X; ++i) {
+        const double x = plot.left() + plot.width() * i / GRID_LINES_X;
+        painter.drawLine(QPointF(x, plot.top()), QPointF(x, plot.bottom()));
+    }
+    for (int i = 0; i <= GRID_LINES_Y; ++i) {
+        const double y = plot.top() + plot.height() * i / GRID_LINES_Y;
+        painter.drawLine(QPointF(plot.left(), y), QPointF(plot.right(), y));
+    }
+    painter.setPen(QPen(m_axisColor, 1.0));
+    painter.drawLine(plot.topLeft(), plot.bottomLeft());
+    painter.drawLine(plot.bottomLeft(), plot.bottomRight());
+
+    const double xScale = plot.width() / (m_maxX - m_minX);
+    const double yScale = plot.height() / (m_maxY - m_minY);
+    auto toPixel = [&](const QPointF& p) {
+        return QPointF(plot.left() + (p.x() - m_minX) * xScale, plot.bottom() - (p.y() - m_minY) * yScale);
+    };
+    if (!m_hasData) {
+        return;
+    }
+    if (m_mode != PoincareMap) {
+        painter.setPen(QPen(m_zeroLineColor, 1.2));
+        if (m_minY <= 0.0 && m_maxY >= 0.0) {
+            const double y = plot.bottom() + m_minY * yScale;
+            painter.drawLine(QPointF(plot.left(), y), QPointF(plot.right(), y));
+        }
+        if (m_minX <= 0.0 && m_maxX >= 0.0) {
+            const double x = plot.left() - m_minX * xScale;
+            painter.drawLine(QPointF(x, plot.top()), QPointF(x, plot.bottom()));
+        }
+    }
+
+    painter.setClipRect(plot);
+    if (m_mode == TimeSeries && m_line.size() > 1) {
+        QPolygonF polyline;
+        polyline.reserve(static_cast<qsizetype>(m_line.size()));
+        for (const QPointF& p : m_line) {
+            polyline.append(toPixel(p));
+        }
+        painter.setPen(QPen(m_lineColor, 1.0));
+        painter.drawPolyline(polyline);
+    } else if (m_mode == PoincareMap) {
+        painter.setPen(Qt::NoPen);
+        for (const PoincareSeries& series : m_poincareSeries) {
+            painter.setBrush(series.color);
+            for (const QPointF& p : series.points) {
+                painter.drawEllipse(toPixel(p), m_pointRadius, m_pointRadius);
+            }
+        }
+    }
+}
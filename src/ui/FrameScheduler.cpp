@@ -0,0 +1,184 @@
+#include "ui/FrameScheduler.h"
+#include <QtMath>
+#include <algorithm>
+
+namespace {
+
+const char* phaseName(int phase)
+{
+    switch (phase) {
+    case FrameBudget::Physics: return "physics";
+    case FrameBudget::Traces:  return "traces";
+    case FrameBudget::Charts:  return "charts";
+    case FrameBudget::Render:  return "render";
+    case FrameBudget::Unaccounted: return "unaccounted";
+    }
+    return "";
+}
+
+} // namespace
+
+FrameScheduler::FrameScheduler(QObject* parent)
+    : QObject(parent)
+{
+    m_clock.start();
+    m_timer.setTimerType(Qt::PreciseTimer);
+    m_timer.setInterval(qRound(framePeriod() * 1000.0));
+    m_budget.setFramePeriod(framePeriod());
+    connect(&m_timer, &QTimer::timeout, this, &FrameScheduler::runFrame);
+}
+
+void FrameScheduler::setWindow(QQuickWindow* window)
+{
+    if (m_window == window) {
+        return;
+    }
+    if (m_window) {
+        disconnect(m_window, nullptr, this, nullptr);
+    }
+    m_window = window;
+    if (m_window) {
+        // Emitted on the render thread; only the atomics are touched there
+        connect(m_window, &QQuickWindow::beforeSynchronizing, this, [this]() {
+            m_renderStart.store(m_clock.nsecsElapsed(), std::memory_order_relaxed);
+        }, Qt::DirectConnection);
+        connect(m_window, &QQuickWindow::afterRendering, this, [this]() {
+            const qint64 start = m_renderStart.load(std::memory_order_relaxed);
+            if (start > 0) {
+                m_renderNanos.fetch_add(m_clock.nsecsElapsed() - start, std::memory_order_relaxed);
+            }
+        }, Qt::DirectConnection);
+    }
+    emit windowChanged();
+}
+
+void FrameScheduler::setPendulum(DoublePendulum* pendulum)
+{
+    if (m_pendulum == pendulum) {
+        return;
+    }
+    m_pendulum = pendulum;
+    emit pendulumChanged();
+}
+
+void FrameScheduler::setRunning(bool running)
+{
+    if (m_running == running) {
+        return;
+    }
+    m_running = running;
+    if (m_pendulum) {
+        m_pendulum->setRunning(running);
+    }
+    if (running) {
+        // Pauses are not frame drops: the budget starts over with the first frame
+        m_budget.reset();
+        m_renderNanos.store(0, std::memory_order_relaxed);
+        m_lastChartTick = -1.0;
+        m_metricsStart = -1.0;
+        m_timer.start();
+    } else {
+        m_timer.stop();
+    }
+    emit runningChanged();
+}
+
+void FrameScheduler::setTargetFps(double fps)
+{
+    if (m_targetFps == fps) {
+        return;
+    }
+    m_targetFps = fps;
+    m_timer.setInterval(std::max(1, qRound(framePeriod() * 1000.0)));
+    m_budget.setFramePeriod(framePeriod());
+    emit targetFpsChanged();
+}
+
+void FrameScheduler::setChartInterval(int milliseconds)
+{
+    milliseconds = std::max(0, milliseconds);
+    if (m_chartInterval == milliseconds) {
+        return;
+    }
+    m_chartInterval = milliseconds;
+    emit chartIntervalChanged();
+}
+
+void FrameScheduler::runFrame()
+{
+    // The render of the previous frame has finished by now (or is still going, then it
+    // lands in the next one); it belongs to the frame that is about to close
+    m_budget.record(FrameBudget::Render,
+                    static_cast<double>(m_renderNanos.exchange(0, std::memory_order_relaxed)) * 1e-9);
+
+    const double frameStart = now();
+    m_budget.beginFrame(frameStart);
+
+    if (m_pendulum) {
+        double mark = now();
+        const DoublePendulum::FrameChanges changes = m_pendulum->collectFromEngine();
+        double done = now();
+        m_budget.record(FrameBudget::Physics, done - mark);
+
+        mark = done;
+        m_pendulum->publishFrame(changes);
+        done = now();
+        m_budget.record(FrameBudget::Traces, done - mark);
+    }
+
+    const double chartInterval = m_chartInterval / 1000.0;
+    if (m_lastChartTick < 0.0) {
+        m_lastChartTick = frameStart;
+    } else if (frameStart - m_lastChartTick >= chartInterval) {
+        // A refresh that does not fit waits for a lighter frame, at most one extra interval
+        const bool overdue = frameStart - m_lastChartTick >= 2.0 * chartInterval;
+        if (m_budget.hasRoomFor(FrameBudget::Charts) || overdue) {
+            const double mark = now();
+            emit chartTick();
+            m_budget.record(FrameBudget::Charts, now() - mark);
+            m_lastChartTick = frameStart;
+        } else {
+            ++m_chartDeferrals;
+        }
+    }
+
+    emit frame();
+
+    ++m_metricsFrames;
+    if (m_metricsStart < 0.0) {
+        m_metricsStart = frameStart;
+        m_metricsFrames = 0;
+    } else if (frameStart - m_metricsStart >= METRICS_INTERVAL_MS / 1000.0) {
+        updateMetrics(frameStart);
+    }
+}
+
+void FrameScheduler::updateMetrics(double frameStart)
+{
+    QVariantMap metrics;
+    metrics.insert(QStringLiteral("fps"), static_cast<double>(m_metricsFrames) / (frameStart - m_metricsStart));
+    metrics.insert(QStringLiteral("framePeriodMs"), m_budget.framePeriod() * 1000.0);
+    for (int phase = 0; phase < FrameBudget::PhaseCount; ++phase) {
+        const QString name = QString::fromLatin1(phaseName(phase));
+        const FrameBudget::Phase p = static_cast<FrameBudget::Phase>(phase);
+        metrics.insert(name + QStringLiteral("BudgetMs"), m_budget.budget(p) * 1000.0);
+        metrics.insert(name + QStringLiteral("Ms"), m_budget.stats(p).average * 1000.0);
+        metrics.insert(name + QStringLiteral("PeakMs"), m_budget.stats(p).peak * 1000.0);
+    }
+    metrics.insert(QStringLiteral("droppedFrames"), static_cast<double>(m_budget.droppedFrames()));
+    metrics.insert(QStringLiteral("lastDropCause"), QString::fromLatin1(phaseName(m_budget.lastDropCause())));
+    metrics.insert(QStringLiteral("chartDeferrals"), static_cast<double>(m_chartDeferrals));
+    if (m_pendulum) {
+        const DoublePendulum::PhysicsTiming& timing = m_pendulum->physicsTiming();
+        metrics.insert(QStringLiteral("lagMs"), timing.lagSeconds * 1000.0);
+        metrics.insert(QStringLiteral("droppedSimTime"), timing.droppedTime);
+        metrics.insert(QStringLiteral("physicsLoad"), timing.load);
+        metrics.insert(QStringLiteral("overrunTicks"), static_cast<double>(timing.overrunTicks));
+    }
+
+    m_metrics = metrics;
+    m_budget.resetPeaks();
+    m_metricsStart = frameStart;
+    m_metricsFrames = 0;
+    emit metricsChanged();
+}
@@ -0,0 +1,382 @@
+#include "ui/TraceItem.h"
+#include <QMatrix4x4>
+#include <QPainter>
+#include <QPolygonF>
+#include <QQuickWindow>
+#include <QSGFlatColorMaterial>
+#include <QSGGeometryNode>
+#include <QSGImageNode>
+#include <QSGRendererInterface>
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+namespace {
+
+constexpr int VERTICES_PER_SEGMENT = 6; // Two triangles
+
+// CHUNK_SEGMENTS quads of the trace in one vertex buffer. Quads not written
+// yet, and those of gaps, stay degenerate at the origin and draw nothing.
+class TraceChunkNode : public QSGGeometryNode
+{
+public:
+    TraceChunkNode(std::uint64_t firstSegment, const QColor& color)
+        : firstSegment(firstSegment)
+        , m_geometry(QSGGeometry::defaultAttributes_Point2D(),
+                     static_cast<int>(TraceItem::CHUNK_SEGMENTS) * VERTICES_PER_SEGMENT)
+    {
+        m_geometry.setDrawingMode(QSGGeometry::DrawTriangles);
+        m_geometry.setVertexDataPattern(QSGGeometry::DynamicPattern);
+        std::memset(m_geometry.vertexData(), 0, static_cast<std::size_t>(m_geometry.vertexCount()) * m_geometry.sizeOfVertex());
+        m_material.setColor(color);
+        setGeometry(&m_geometry);
+        setMaterial(&m_material);
+    }
+
+    // Quad of the segment from a to b, halfWidth either side, in the slot of segment `index`
+    void setSegment(std::uint64_t index, const QPointF& a, const QPointF& b, double halfWidth)
+    {
+        const double dx = b.x() - a.x();
+        const double dy = b.y() - a.y();
+        const double length = std::hypot(dx, dy);
+        if (!(length > 0.0)) {
+            return;
+        }
+        const double nx = -dy / length * halfWidth;
+        const double ny = dx / length * halfWidth;
+        QSGGeometry::Point2D* v = m_geometry.vertexDataAsPoint2D() + (index - firstSegment) * VERTICES_PER_SEGMENT;
+        v[0].set(float(a.x() + nx), float(a.y() + ny));
+        v[1].set(float(a.x() - nx), float(a.y() - ny));
+        v[2].set(float(b.x() + nx), float(b.y() + ny));
+        v[3] = v[2];
+        v[4] = v[1];
+        v[5].set(float(b.x() - nx), float(b.y() - ny));
+    }
+
+    void uploadChanges()
+    {
+        m_geometry.markVertexDataDirty();
+        markDirty(QSGNode::DirtyGeometry);
+    }
+
+    // The chunk is full and will not change again
+    void seal() { m_geometry.setVertexDataPattern(QSGGeometry::StaticPattern); }
+
+    void setColor(const QColor& color)
+    {
+        m_material.setColor(color);
+        markDirty(QSGNode::DirtyMaterial);
+    }
+
+    const std::uint64_t firstSegment;
+
+private:
+    QSGGeometry m_geometry;
+    QSGFlatColorMaterial m_material;
+};
+
+} // namespace
+
+TraceItem::TraceItem(QQuickItem* parent)
+    : QQuickItem(parent)
+{
+    setFlag(ItemHasContents, true);
+}
+
+void TraceItem::setPendulum(DoublePendulum* pendulum)
+{
+    if (m_pendulum == pendulum) {
+        return;
+    }
+    if (m_pendulum) {
+        disconnect(m_pendulum, nullptr, this, nullptr);
+    }
+    m_pendulum = pendulum;
+    if (m_pendulum) {
+        connect(m_pendulum, &DoublePendulum::historyUpdated, this, &TraceItem::pullPoints);
+    }
+    restart();
+    emit pendulumChanged();
+}
+
+void TraceItem::setBob(int bob)
+{
+    if (m_bob == bob) {
+        return;
+    }
+    m_bob = bob;
+    restart();
+    emit bobChanged();
+}
+
+void TraceItem::setColor(const QColor& color)
+{
+    if (m_color == color) {
+        return;
+    }
+    m_color = color;
+    m_colorDirty = true;
+    update();
+    emit colorChanged();
+}
+
+void TraceItem::setLineWidth(double width)
+{
+    if (m_lineWidth == width) {
+        return;
+    }
+    m_lineWidth = width;
+    update();
+    emit lineWidthChanged();
+}
+
+void TraceItem::setOrigin(const QPointF& origin)
+{
+    if (m_origin == origin) {
+        return;
+    }
+    m_origin = origin;
+    update();
+    emit originChanged();
+}
+
+void TraceItem::setPixelsPerMetre(double scale)
+{
+    if (m_pixelsPerMetre == scale || !(scale > 0.0)) {
+        return;
+    }
+    m_pixelsPerMetre = scale;
+    update();
+    emit pixelsPerMetreChanged();
+}
+
+void TraceItem::setMaxSegmentLength(double length)
+{
+    if (m_maxSegmentLength == length) {
+        return;
+    }
+    m_maxSegmentLength = length;
+    m_rebuild = true; // Other segments are joined now
+    update();
+    emit maxSegmentLengthChanged();
+}
+
+void TraceItem::setMaxPoints(int points)
+{
+    points = std::max(points, 1);
+    if (m_maxPoints == points) {
+        return;
+    }
+    m_maxPoints = points;
+    emit maxPointsChanged();
+}
+
+void TraceItem::restart()
+{
+    m_points.clear();
+    m_firstIndex = 0;
+    m_rebuild = true;
+    if (m_pendulum) {
+        m_traceEpoch = m_pendulum->getTraceEpoch();
+        const QVector<QPointF> trace = m_bob == 2 ? m_pendulum->getTrace2Points() : m_pendulum->getTrace1Points();
+        // The copy already holds the points waiting in the incremental buffer
+        if (m_bob == 2) {
+            m_pendulum->consumeNewTrace2Points();
+        } else {
+            m_pendulum->consumeNewTrace1Points();
+        }
+        appendPoints(reinterpret_cast<const char*>(trace.constData()), static_cast<std::size_t>(trace.size()));
+    }
+    update();
+}
+
+void TraceItem::pullPoints()
+{
+    if (!m_pendulum) {
+        return;
+    }
+    if (m_pendulum->getTraceEpoch() != m_traceEpoch) {
+        restart();
+        return;
+    }
+    const QByteArray packed = m_bob == 2 ? m_pendulum->consumeNewTrace2Points() : m_pendulum->consumeNewTrace1Points();
+    if (packed.isEmpty()) {
+        return;
+    }
+    appendPoints(packed.constData(), static_cast<std::size_t>(packed.size()) / sizeof(QPointF));
+    update();
+}
+
+void TraceItem::appendPoints(const char* packed, std::size_t count)
+{
+    for (std::size_t i = 0; i < count; ++i) {
+        QPointF point;
+        std::memcpy(&point, packed + i * sizeof(QPointF), sizeof(QPointF));
+        m_points.push_back(point);
+    }
+    // Whole chunks at a time, so the first kept point starts a chunk of the geometry
+    while (m_points.size() >= static_cast<std::size_t>(m_maxPoints) + CHUNK_SEGMENTS) {
+        m_points.erase(m_points.begin(), m_points.begin() + CHUNK_SEGMENTS);
+        m_firstIndex += CHUNK_SEGMENTS;
+    }
+}
+
+bool TraceItem::joins(std::uint64_t index) const
+{
+    if (index <= m_firstIndex) {
+        return false;
+    }
+    if (m_maxSegmentLength <= 0.0) {
+        return true;
+    }
+    const QPointF& a = m_points[index - 1 - m_firstIndex];
+    const QPointF& b = m_points[index - m_firstIndex];
+    return std::hypot(b.x() - a.x(), b.y() - a.y()) <= m_maxSegmentLength;
+}
+
+void TraceItem::geometryChange(const QRectF& newGeometry, const QRectF& oldGeometry)
+{
+    QQuickItem::geometryChange(newGeometry, oldGeometry);
+    update();
+}
+
+QSGNode* TraceItem::updatePaintNode(QSGNode* oldNode, UpdatePaintNodeData* data)
+{
+    Q_UNUSED(data);
+    if (window()->rendererInterface()->graphicsApi() == QSGRendererInterface::Software) {
+        return updateSoftwareNode(oldNode);
+    }
+    return updateGeometryNodes(oldNode);
+}
+
+QSGNode* TraceItem::updateGeometryNodes(QSGNode* oldNode)
+{
+    auto* root = static_cast<QSGTransformNode*>(oldNode);
+    if (!root) {
+        root = new QSGTransformNode;
+        m_rebuild = true;
+    }
+
+    // Metres to item pixels; this is all a zoom or a resize changes
+    QMatrix4x4 matrix;
+    matrix.translate(float(m_origin.x()), float(m_origin.y()));
+    matrix.scale(float(m_pixelsPerMetre), float(m_pixelsPerMetre));
+    if (root->matrix() != matrix) {
+        root->setMatrix(matrix);
+    }
+
+    const double drift = m_builtScale > 0.0 ? m_pixelsPerMetre / m_builtScale : 0.0;
+    if (m_rebuild || m_lineWidth != m_builtLineWidth ||
+        drift > WIDTH_REBUILD_RATIO || drift < 1.0 / WIDTH_REBUILD_RATIO) {
+        while (QSGNode* child = root->firstChild()) {
+            root->removeChildNode(child);
+            delete child;
+        }
+        m_builtScale = m_pixelsPerMetre;
+        m_builtLineWidth = m_lineWidth;
+        m_drawnEnd = m_firstIndex;
+        m_rebuild = false;
+        m_colorDirty = false;
+    }
+
+    // Chunks whose points have all been dropped
+    while (auto* chunk = static_cast<TraceChunkNode*>(root->firstChild())) {
+        if (chunk->firstSegment + CHUNK_SEGMENTS > m_firstIndex) {
+            break;
+        }
+        root->removeChildNode(chunk);
+        delete chunk;
+    }
+    if (m_colorDirty) {
+        for (QSGNode* child = root->firstChild(); child; child = child->nextSibling()) {
+            static_cast<TraceChunkNode*>(child)->setColor(m_color);
+        }
+        m_colorDirty = false;
+    }
+
+    // Quads for the new points; only the chunks they land in are uploaded again
+    const double halfWidth = 0.5 * m_lineWidth / m_builtScale;
+    const std::uint64_t end = m_firstIndex + m_points.size();
+    auto* chunk = static_cast<TraceChunkNode*>(root->lastChild());
+    bool written = false;
+    for (std::uint64_t index = std::max(m_drawnEnd, m_firstIndex); index < end; ++index) {
+        if (!chunk || index >= chunk->firstSegment + CHUNK_SEGMENTS) {
+            if (chunk) {
+                if (written) {
+                    chunk->uploadChanges();
+                }
+                chunk->seal();
+            }
+            chunk = new TraceChunkNode(index - index % CHUNK_SEGMENTS, m_color);
+            root->appendChildNode(chunk);
+        }
+        if (joins(index)) {
+            chunk->setSegment(index, m_points[index - 1 - m_firstIndex], m_points[index - m_firstIndex], halfWidth);
+        }
+        written = true;
+    }
+    if (chunk && written) {
+        chunk->uploadChanges();
+    }
+    m_drawnEnd = end;
+    return root;
+}
+
+QSGNode* TraceItem::updateSoftwareNode(QSGNode* oldNode)
+{
+    const qreal dpr = window()->effectiveDevicePixelRatio();
+    const QSize size = (boundingRect().size() * dpr).toSize();
+    if (size.isEmpty()) {
+        return nullptr;
+    }
+    auto* node = static_cast<QSGImageNode*>(oldNode);
+    if (!node) {
+        node = window()->createImageNode();
+        node->setOwnsTexture(true);
+        m_rebuild = true;
+    }
+
+    // Any change of the mapping paints the whole trace again
+    const bool repaint = m_rebuild || m_colorDirty || m_raster.size() != size ||
+                         m_rasterOrigin != m_origin || m_rasterScale != m_pixelsPerMetre ||
+                         m_builtLineWidth != m_lineWidth;
+    if (repaint) {
+        m_raster = QImage(size, QImage::Format_ARGB32_Premultiplied);
+        m_raster.fill(Qt::transparent);
+        m_rasterOrigin = m_origin;
+        m_rasterScale = m_pixelsPerMetre;
+        m_builtLineWidth = m_lineWidth;
+        m_drawnEnd = m_firstIndex;
+        m_rebuild = false;
+        m_colorDirty = false;
+    }
+
+    const std::uint64_t end = m_firstIndex + m_points.size();
+    if (repaint || m_drawnEnd < end) {
+        QPainter painter(&m_raster);
+        painter.setRenderHint(QPainter::Antialiasing);
+        painter.setPen(QPen(m_color, m_lineWidth * dpr, Qt::SolidLine, Qt::RoundCap, Qt::RoundJoin));
+        auto toRaster = [this, dpr](const QPointF& p) { return (m_origin + p * m_pixelsPerMetre) * dpr; };
+
+        // One polyline per run of joined points, so the translucent pen does not overlap itself at the joints
+        QPolygonF run;
+        for (std::uint64_t index = std::max(m_drawnEnd, m_firstIndex + 1); index < end; ++index) {
+            if (!joins(index)) {
+                if (run.size() > 1) painter.drawPolyline(run);
+                run.clear();
+                continue;
+            }
+            if (run.isEmpty()) {
+                run.append(toRaster(m_points[index - 1 - m_firstIndex]));
+            }
+            run.append(toRaster(m_points[index - m_firstIndex]));
+        }
+        if (run.size() > 1) painter.drawPolyline(run);
+        painter.end();
+
+        m_drawnEnd = end;
+        node->setTexture(window()->createTextureFromImage(m_raster));
+    }
+    node->setRect(boundingRect());
+    return node;
+}